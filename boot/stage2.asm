@@ -1,6 +1,7 @@
 ; proOS Stage 2 Loader
-; Loads the protected-mode kernel into memory, enables A20, switches to 32-bit mode,
-; copies the kernel to its final location at 0x00100000, and jumps to it.
+; Loads the protected-mode kernel into memory, collects the E820 memory map,
+; enables A20, switches to 32-bit mode, copies the kernel to its final location
+; at 0x00100000, and jumps to it.
 
 BITS 16
 ORG 0x7E00
@@ -17,6 +18,10 @@ ORG 0x7E00
 %define FAT16_SECTORS       32
 %endif
 
+%if KERNEL_SECTORS > 1024
+%error "KERNEL_SECTORS overflows the 0x10000-0x90000 staging buffer"
+%endif
+
 %define KERNEL_SIZE         (KERNEL_SECTORS * 512)
 %define KERNEL_START_SECTOR (2 + STAGE2_SECTORS)
 %define KERNEL_TEMP_SEG     0x1000            ; 0x1000 << 4 = 0x00010000
@@ -33,6 +38,11 @@ ORG 0x7E00
 %define BOOT_INFO_ADDR      0x0000FE00
 %define BOOT_INFO_MAGIC     0x534F5250       ; "PROS"
 
+%define E820_MAP_ADDR       0x0000F000
+%define E820_MAX_ENTRIES    32
+%define E820_ENTRY_SIZE     24
+%define E820_SIGNATURE      0x534D4150       ; "SMAP"
+
 start_stage2:
     cli
     xor ax, ax
@@ -71,6 +81,7 @@ start_stage2:
 .fat_load_done:
 %endif
 
+    call detect_memory_map
     call get_bios_font
     call try_vbe_modes
     mov byte [vbe_available], 0
@@ -170,6 +181,42 @@ read_sectors:
     pop bp
     ret
 
+; Collect the BIOS E820 memory map at E820_MAP_ADDR.
+; Leaves the number of stored entries in [e820_count] (0 when unsupported).
+detect_memory_map:
+    mov word [e820_count], 0
+    xor ax, ax
+    mov es, ax
+    mov di, E820_MAP_ADDR
+    xor ebx, ebx
+
+.next_entry:
+    mov dword [es:di + 20], 1                ; default ACPI 3.x attributes: valid
+    mov eax, 0xE820
+    mov ecx, E820_ENTRY_SIZE
+    mov edx, E820_SIGNATURE
+    int 0x15
+    jc .done
+    cmp eax, E820_SIGNATURE
+    jne .done
+    jcxz .skip_entry
+
+    mov eax, [es:di + 8]
+    or eax, [es:di + 12]
+    jz .skip_entry
+
+    inc word [e820_count]
+    add di, E820_ENTRY_SIZE
+    cmp word [e820_count], E820_MAX_ENTRIES
+    jae .done
+
+.skip_entry:
+    test ebx, ebx
+    jnz .next_entry
+
+.done:
+    ret
+
 get_bios_font:
     mov word [font_seg], 0
     mov word [font_off], 0
@@ -379,6 +426,13 @@ pm_entry:
     movzx eax, byte [boot_drive]
     mov [BOOT_INFO_ADDR + 72], eax
 
+    movzx eax, word [e820_count]
+    test eax, eax
+    jz .skip_mem_map
+    mov dword [BOOT_INFO_ADDR + 76], E820_MAP_ADDR
+    mov [BOOT_INFO_ADDR + 80], eax
+.skip_mem_map:
+
 %if FAT16_SECTORS > 0
     cmp byte [fat_loaded], 1
     jne .skip_fat_info
@@ -432,6 +486,7 @@ pm_entry:
 [BITS 16]
 boot_drive: db 0
 fat_loaded: db 0
+e820_count: dw 0
 
 vbe_available: db 0
 vbe_selected_mode: dw 0
@@ -0,0 +1,69 @@
+/*
+ * Application processor start-up code. smp_init() copies everything between
+ * ap_trampoline_start and ap_trampoline_end to AP_TRAMPOLINE_BASE, below
+ * 1 MiB, and points the start-up IPI at it. The copy runs at a different
+ * address than it was linked for, so it only uses absolute addresses and
+ * branches within itself.
+ */
+.section .text
+
+/* Must match CONFIG_SMP_TRAMPOLINE_BASE. */
+.equ AP_TRAMPOLINE_BASE, 0x8000
+
+.global ap_trampoline_start, ap_trampoline_gdtr, ap_trampoline_end
+
+.extern smp_ap_entry
+.extern smp_ap_next
+.extern smp_ap_max
+.extern smp_ap_stacks
+.extern smp_ap_stack_size
+
+.code16
+ap_trampoline_start:
+    cli
+    cld
+    xorw %ax, %ax
+    movw %ax, %ds
+    lgdtl AP_TRAMPOLINE_BASE + (ap_trampoline_gdtr - ap_trampoline_start)
+
+    movl %cr0, %eax
+    orl $1, %eax
+    movl %eax, %cr0
+    ljmpl $0x08, $(AP_TRAMPOLINE_BASE + (ap_protected_entry - ap_trampoline_start))
+
+.code32
+ap_protected_entry:
+    movw $0x10, %ax
+    movw %ax, %ds
+    movw %ax, %es
+    movw %ax, %fs
+    movw %ax, %gs
+    movw %ax, %ss
+
+    /* Take a ticket; it selects both the CPU slot and the stack. */
+    movl $1, %eax
+    lock xaddl %eax, smp_ap_next
+    cmpl smp_ap_max, %eax
+    jae ap_park
+
+    movl %eax, %ebx
+    incl %eax
+    imull smp_ap_stack_size, %eax
+    addl smp_ap_stacks, %eax
+    movl %eax, %esp
+
+    pushl %ebx
+    movl $smp_ap_entry, %eax
+    call *%eax
+
+ap_park:
+    cli
+    hlt
+    jmp ap_park
+
+.balign 8
+ap_trampoline_gdtr:
+    .word 0
+    .long 0
+
+ap_trampoline_end:
@@ -0,0 +1,235 @@
+#include "apic.h"
+
+#include "io.h"
+#include "tsc.h"
+
+#include <stddef.h>
+
+#define MSR_APIC_BASE          0x1Bu
+#define MSR_TSC_DEADLINE       0x6E0u
+#define APIC_BASE_ENABLE       (1u << 11)
+#define APIC_BASE_ADDR_MASK    0xFFFFF000u
+
+#define LAPIC_REG_ID           0x020u
+#define LAPIC_REG_TPR          0x080u
+#define LAPIC_REG_EOI          0x0B0u
+#define LAPIC_REG_SVR          0x0F0u
+#define LAPIC_REG_ICR_LOW      0x300u
+#define LAPIC_REG_ICR_HIGH     0x310u
+#define LAPIC_REG_LVT_TIMER    0x320u
+#define LAPIC_REG_TIMER_INIT   0x380u
+#define LAPIC_REG_TIMER_CUR    0x390u
+#define LAPIC_REG_TIMER_DIV    0x3E0u
+
+#define LAPIC_SVR_ENABLE       0x100u
+#define LAPIC_LVT_MASKED       (1u << 16)
+#define LAPIC_LVT_ONESHOT      (0u << 17)
+#define LAPIC_LVT_TSC_DEADLINE (2u << 17)
+#define LAPIC_TIMER_DIV_16     0x3u
+
+#define LAPIC_ICR_FIXED        (0u << 8)
+#define LAPIC_ICR_INIT         (5u << 8)
+#define LAPIC_ICR_STARTUP      (6u << 8)
+#define LAPIC_ICR_PENDING      (1u << 12)
+#define LAPIC_ICR_ASSERT       (1u << 14)
+#define LAPIC_ICR_ALL_BUT_SELF (3u << 18)
+
+#define CPUID_EDX_APIC         (1u << 9)
+#define CPUID_ECX_TSC_DEADLINE (1u << 24)
+
+#define LAPIC_CALIBRATE_NS     10000000u
+#define LAPIC_INIT_SETTLE_NS   10000000u
+#define LAPIC_SIPI_GAP_NS      200000u
+
+static volatile uint32_t *lapic_base = NULL;
+static enum lapic_timer_mode timer_mode = LAPIC_TIMER_NONE;
+static uint32_t timer_khz = 0;
+/* APIC timer counts per nanosecond, scaled by 2^24. */
+static uint32_t timer_count_mult = 0;
+
+static uint32_t lapic_read(uint32_t reg)
+{
+    return lapic_base[reg / 4u];
+}
+
+static void lapic_write(uint32_t reg, uint32_t value)
+{
+    lapic_base[reg / 4u] = value;
+    (void)lapic_base[LAPIC_REG_TPR / 4u];
+}
+
+int lapic_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_APIC))
+        return -1;
+
+    uint64_t base = rdmsr(MSR_APIC_BASE);
+    wrmsr(MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+    lapic_base = (volatile uint32_t *)(uintptr_t)((uint32_t)base & APIC_BASE_ADDR_MASK);
+
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | IRQ_VECTOR_LAPIC_SPURIOUS);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | IRQ_VECTOR_LAPIC_TIMER);
+
+    if (!tsc_khz())
+        return -1;
+
+    if (ecx & CPUID_ECX_TSC_DEADLINE)
+    {
+        timer_mode = LAPIC_TIMER_TSC_DEADLINE;
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_LVT_TSC_DEADLINE | IRQ_VECTOR_LAPIC_TIMER);
+        return 0;
+    }
+
+    /* Count the divided bus clock down across a TSC-timed window. */
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFFu);
+    tsc_delay_ns(LAPIC_CALIBRATE_NS);
+    uint32_t elapsed = 0xFFFFFFFFu - lapic_read(LAPIC_REG_TIMER_CUR);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+
+    timer_khz = elapsed / (LAPIC_CALIBRATE_NS / 1000000u);
+    if (timer_khz == 0)
+        return -1;
+
+    timer_count_mult = (uint32_t)div_u64_u32((uint64_t)timer_khz << 24, 1000000u, NULL);
+    timer_mode = LAPIC_TIMER_ONESHOT;
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_LVT_ONESHOT | IRQ_VECTOR_LAPIC_TIMER);
+    return 0;
+}
+
+void lapic_ap_init(void)
+{
+    uint64_t base = rdmsr(MSR_APIC_BASE);
+    wrmsr(MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+
+    /* Only the boot CPU runs hrtimers; the others take tick IPIs instead. */
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | IRQ_VECTOR_LAPIC_SPURIOUS);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | IRQ_VECTOR_LAPIC_TIMER);
+}
+
+uint32_t lapic_id(void)
+{
+    if (!lapic_base)
+        return 0;
+    return lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+static void lapic_icr_wait(void)
+{
+    while (lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING)
+        __asm__ __volatile__("pause");
+}
+
+/* The ICR is two registers, so an interrupt between the writes would corrupt a nested send. */
+static void lapic_icr_send(uint32_t high, uint32_t low)
+{
+    uint32_t flags;
+    __asm__ __volatile__("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+    lapic_icr_wait();
+    lapic_write(LAPIC_REG_ICR_HIGH, high);
+    lapic_write(LAPIC_REG_ICR_LOW, low);
+    lapic_icr_wait();
+    if (flags & 0x200u)
+        __asm__ __volatile__("sti" : : : "memory");
+}
+
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector)
+{
+    if (!lapic_base)
+        return;
+    lapic_icr_send(apic_id << 24, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | vector);
+}
+
+void lapic_send_init_sipi(uint32_t start_page)
+{
+    if (!lapic_base)
+        return;
+
+    lapic_icr_send(0, LAPIC_ICR_ALL_BUT_SELF | LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+    tsc_delay_ns(LAPIC_INIT_SETTLE_NS);
+
+    /* Intel's MP start-up sequence sends the SIPI twice. */
+    for (int i = 0; i < 2; ++i)
+    {
+        lapic_icr_send(0, LAPIC_ICR_ALL_BUT_SELF | LAPIC_ICR_STARTUP | (start_page & 0xFFu));
+        tsc_delay_ns(LAPIC_SIPI_GAP_NS);
+    }
+}
+
+int lapic_present(void)
+{
+    return lapic_base != NULL;
+}
+
+enum lapic_timer_mode lapic_timer_mode(void)
+{
+    return timer_mode;
+}
+
+const char *lapic_timer_mode_name(void)
+{
+    switch (timer_mode)
+    {
+    case LAPIC_TIMER_TSC_DEADLINE:
+        return "tsc-deadline";
+    case LAPIC_TIMER_ONESHOT:
+        return "apic-oneshot";
+    default:
+        return "pit";
+    }
+}
+
+uint32_t lapic_timer_khz(void)
+{
+    return timer_khz;
+}
+
+void lapic_eoi(void)
+{
+    if (lapic_base)
+        lapic_write(LAPIC_REG_EOI, 0);
+}
+
+void lapic_timer_set_handler(irq_callback_t handler)
+{
+    irq_install_local_handler(IRQ_VECTOR_LAPIC_TIMER, handler);
+}
+
+void lapic_timer_arm(uint64_t deadline_tsc)
+{
+    if (timer_mode == LAPIC_TIMER_TSC_DEADLINE)
+    {
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_TSC_DEADLINE | IRQ_VECTOR_LAPIC_TIMER);
+        /* A deadline of zero disarms the timer, so nudge past it. */
+        wrmsr(MSR_TSC_DEADLINE, deadline_tsc ? deadline_tsc : 1u);
+        return;
+    }
+
+    if (timer_mode != LAPIC_TIMER_ONESHOT)
+        return;
+
+    uint64_t now = rdtsc();
+    uint64_t delay_ns = (deadline_tsc > now) ? tsc_to_ns(deadline_tsc - now) : 0;
+    uint64_t low = ((uint64_t)(uint32_t)delay_ns * timer_count_mult) >> 24;
+    uint64_t high = ((delay_ns >> 32) * timer_count_mult) << 8;
+    uint64_t count = low + high;
+    if (count == 0)
+        count = 1;
+    if (count > 0xFFFFFFFFu)
+        count = 0xFFFFFFFFu;
+
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_ONESHOT | IRQ_VECTOR_LAPIC_TIMER);
+    lapic_write(LAPIC_REG_TIMER_INIT, (uint32_t)count);
+}
+
+void lapic_timer_disarm(void)
+{
+    if (timer_mode == LAPIC_TIMER_TSC_DEADLINE)
+        wrmsr(MSR_TSC_DEADLINE, 0);
+    else if (timer_mode == LAPIC_TIMER_ONESHOT)
+        lapic_write(LAPIC_REG_TIMER_INIT, 0);
+}
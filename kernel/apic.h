@@ -0,0 +1,48 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+
+#include "interrupts.h"
+
+enum lapic_timer_mode
+{
+    LAPIC_TIMER_NONE = 0,
+    LAPIC_TIMER_ONESHOT,
+    LAPIC_TIMER_TSC_DEADLINE
+};
+
+/**
+ * @brief Enable the local APIC and calibrate its timer against the TSC.
+ *
+ * Call after tsc_calibrate() with interrupts disabled. Leaves the 8259 in
+ * charge of external interrupts. @return 0 when the APIC timer is usable,
+ * -1 when the machine has no APIC and callers must stay on the PIT.
+ */
+int lapic_init(void);
+/** Enable the local APIC of an application processor; its timer stays masked. */
+void lapic_ap_init(void);
+int lapic_present(void);
+/** @return the APIC ID of the calling CPU. */
+uint32_t lapic_id(void);
+/** Send fixed interrupt @p vector to the CPU with APIC ID @p apic_id. */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+/**
+ * @brief Broadcast INIT then two start-up IPIs to every other CPU.
+ *
+ * The APs begin executing in real mode at @p start_page * 4096, which must
+ * lie below 1 MiB. Needs a calibrated TSC for the mandated delays.
+ */
+void lapic_send_init_sipi(uint32_t start_page);
+enum lapic_timer_mode lapic_timer_mode(void);
+const char *lapic_timer_mode_name(void);
+/** Timer input clock after the divider, in kHz (0 in TSC-deadline-only setups). */
+uint32_t lapic_timer_khz(void);
+void lapic_eoi(void);
+/** Interrupt vector @p handler runs on when the one-shot timer fires. */
+void lapic_timer_set_handler(irq_callback_t handler);
+/** Fire the timer once when the TSC reaches @p deadline_tsc. */
+void lapic_timer_arm(uint64_t deadline_tsc);
+void lapic_timer_disarm(void);
+
+#endif
@@ -3,7 +3,7 @@
 #include "ethernet.h"
 #include "klog.h"
 #include "string.h"
-#include "pit.h"
+#include "clock.h"
 #include "ipv4.h"
 
 struct arp_header
@@ -48,7 +48,7 @@ struct arp_cache_entry
     struct net_device *dev;
     uint8_t ipv4[4];
     uint8_t mac[6];
-    uint64_t updated;
+    uint64_t updated_ns;
 };
 
 static struct arp_cache_entry g_cache[ARP_CACHE_CAPACITY];
@@ -78,16 +78,16 @@ static void arp_cache_store(struct net_device *dev, const uint8_t ipv4[4], const
         if (entry->dev && entry->dev == dev && ipv4_equal(entry->ipv4, ipv4))
         {
             memcpy(entry->mac, mac, sizeof(entry->mac));
-            entry->updated = get_ticks();
+            entry->updated_ns = clock_monotonic_ns();
             return;
         }
 
         if (!entry->dev && free_index == ARP_CACHE_CAPACITY)
             free_index = i;
 
-        if (entry->dev && entry->updated < oldest_time)
+        if (entry->dev && entry->updated_ns < oldest_time)
         {
-            oldest_time = entry->updated;
+            oldest_time = entry->updated_ns;
             oldest_index = i;
         }
     }
@@ -100,7 +100,7 @@ static void arp_cache_store(struct net_device *dev, const uint8_t ipv4[4], const
     dest->dev = dev;
     memcpy(dest->ipv4, ipv4, sizeof(dest->ipv4));
     memcpy(dest->mac, mac, sizeof(dest->mac));
-    dest->updated = get_ticks();
+    dest->updated_ns = clock_monotonic_ns();
 }
 
 int arp_cache_lookup(struct net_device *dev, const uint8_t ipv4[4], uint8_t mac_out[6])
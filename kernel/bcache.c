@@ -0,0 +1,793 @@
+#include "bcache.h"
+
+#include "blockdev.h"
+#include "blkqueue.h"
+#include "spinlock.h"
+#include "memory.h"
+#include "proc.h"
+#include "timer.h"
+#include "workqueue.h"
+#include "klog.h"
+#include "string.h"
+#include "config.h"
+
+#define BCACHE_BUFFERS (CONFIG_BCACHE_BYTES / CONFIG_BCACHE_BLOCK_SIZE)
+#define BCACHE_NONE    (-1)
+/* bcache_claim(): another thread cached the block while the lock was dropped. */
+#define BCACHE_RACED   (-2)
+
+struct bcache_buffer
+{
+    /* NULL while the buffer holds nothing. */
+    struct block_device *dev;
+    uint64_t lba;
+    uint8_t *data;
+    int32_t hash_next;
+    uint8_t valid;
+    uint8_t dirty;
+    /* Set while I/O runs on the buffer outside the lock; others wait for it. */
+    uint8_t busy;
+    /* Second chance for the CLOCK sweep. */
+    uint8_t referenced;
+};
+
+/* Lives on the waiting thread's stack while it sleeps on a busy buffer. */
+struct bcache_waiter
+{
+    struct process *proc;
+    int32_t idx;
+    struct bcache_waiter *next;
+    /* Set under the lock by bcache_unbusy(). */
+    volatile int woken;
+};
+
+static spinlock_t bcache_lock;
+static struct bcache_buffer buffers[BCACHE_BUFFERS];
+static struct bcache_waiter *busy_waiters = NULL;
+static int32_t hash_heads[CONFIG_BCACHE_HASH_BUCKETS];
+static uint8_t *bcache_memory = NULL;
+static uint32_t clock_hand = 0;
+static uint32_t used_count = 0;
+static uint32_t dirty_count = 0;
+static struct bcache_stats stats;
+/*
+ * Writes submitted under the cache and not yet complete, and a generation
+ * bumped as each starts and ends. A block read from the driver is cached
+ * only if none was in flight for the whole read, since the driver may have
+ * returned the contents from before one of them.
+ */
+static uint32_t bypass_writes = 0;
+static uint32_t bypass_generation = 0;
+
+/* Where the last cached read ended, to spot sequential access. */
+static struct block_device *last_read_dev = NULL;
+static uint64_t last_read_end = 0;
+
+/* Read-ahead and write-back wait for the workers; see bcache_start_writeback(). */
+static int background_ready = 0;
+static struct work_item readahead_work;
+static struct block_device *readahead_dev = NULL;
+static uint64_t readahead_lba = 0;
+
+static struct timer writeback_timer;
+static struct work_item writeback_work;
+
+static int bcache_usable(const struct block_device *dev)
+{
+    if (!bcache_memory || !dev)
+        return 0;
+    if (dev->flags & BLOCKDEV_FLAG_PARTITION)
+        return 0;
+    return dev->block_size == CONFIG_BCACHE_BLOCK_SIZE;
+}
+
+static uint32_t bcache_hash(const struct block_device *dev, uint64_t lba)
+{
+    uint32_t key = (uint32_t)lba ^ (uint32_t)(lba >> 32) ^ ((uint32_t)(uintptr_t)dev >> 4);
+    key ^= key >> 7;
+    return key & (CONFIG_BCACHE_HASH_BUCKETS - 1u);
+}
+
+/* Lock held. */
+static int32_t bcache_find(const struct block_device *dev, uint64_t lba)
+{
+    for (int32_t idx = hash_heads[bcache_hash(dev, lba)]; idx != BCACHE_NONE; idx = buffers[idx].hash_next)
+    {
+        if (buffers[idx].dev == dev && buffers[idx].lba == lba)
+            return idx;
+    }
+    return BCACHE_NONE;
+}
+
+/* Lock held. */
+static void bcache_hash_remove(int32_t idx)
+{
+    struct bcache_buffer *buf = &buffers[idx];
+    int32_t *link = &hash_heads[bcache_hash(buf->dev, buf->lba)];
+    while (*link != BCACHE_NONE)
+    {
+        if (*link == idx)
+        {
+            *link = buf->hash_next;
+            break;
+        }
+        link = &buffers[*link].hash_next;
+    }
+    buf->hash_next = BCACHE_NONE;
+    buf->dev = NULL;
+    buf->valid = 0;
+    --used_count;
+}
+
+/* Lock held: next buffer the CLOCK hand gives up, skipping busy ones. */
+static int32_t bcache_pick_victim(void)
+{
+    for (uint32_t step = 0; step < 2u * BCACHE_BUFFERS; ++step)
+    {
+        int32_t idx = (int32_t)clock_hand;
+        clock_hand = (clock_hand + 1u) % BCACHE_BUFFERS;
+        struct bcache_buffer *buf = &buffers[idx];
+        if (buf->busy)
+            continue;
+        if (buf->dev && buf->referenced)
+        {
+            buf->referenced = 0;
+            continue;
+        }
+        return idx;
+    }
+    return BCACHE_NONE;
+}
+
+/* Lock held: end I/O on buffer @p idx and wake the threads waiting for it. */
+static void bcache_unbusy(int32_t idx)
+{
+    buffers[idx].busy = 0;
+    struct bcache_waiter **link = &busy_waiters;
+    while (*link)
+    {
+        struct bcache_waiter *waiter = *link;
+        if (waiter->idx != idx)
+        {
+            link = &waiter->next;
+            continue;
+        }
+        *link = waiter->next;
+        waiter->woken = 1;
+        process_wake(waiter->proc);
+    }
+}
+
+/* Lock held and dropped around the driver call: write one dirty buffer back. */
+static int bcache_write_back(int32_t idx, uint32_t *flags)
+{
+    struct bcache_buffer *buf = &buffers[idx];
+    buf->busy = 1;
+    spinlock_unlock_irqrestore(&bcache_lock, *flags);
+    int rc = blkqueue_io(buf->dev, BIO_WRITE, buf->lba, 1, buf->data);
+    spinlock_lock_irqsave(&bcache_lock, flags);
+    bcache_unbusy(idx);
+    if (rc < 0)
+        return -1;
+    buf->dirty = 0;
+    --dirty_count;
+    ++stats.writebacks;
+    return 0;
+}
+
+/*
+ * Lock held, possibly dropped to write back a dirty victim. Binds a buffer
+ * to (dev, lba) and returns it busy and not yet valid; BCACHE_RACED if the
+ * block turned up meanwhile, BCACHE_NONE if every buffer is busy or a full
+ * sweep of dirty victims failed to write back.
+ */
+static int32_t bcache_claim(struct block_device *dev, uint64_t lba, uint32_t *flags)
+{
+    uint32_t failures = 0;
+    for (;;)
+    {
+        if (bcache_find(dev, lba) != BCACHE_NONE)
+            return BCACHE_RACED;
+
+        int32_t idx = bcache_pick_victim();
+        if (idx == BCACHE_NONE)
+            return BCACHE_NONE;
+
+        struct bcache_buffer *buf = &buffers[idx];
+        if (buf->dirty)
+        {
+            if (bcache_write_back(idx, flags) < 0)
+            {
+                klog_warn("bcache: write-back failed; block kept dirty");
+                if (++failures >= BCACHE_BUFFERS)
+                    return BCACHE_NONE;
+            }
+            continue;
+        }
+        if (buf->dev)
+        {
+            bcache_hash_remove(idx);
+            ++stats.evictions;
+        }
+
+        uint32_t bucket = bcache_hash(dev, lba);
+        buf->dev = dev;
+        buf->lba = lba;
+        buf->valid = 0;
+        buf->busy = 1;
+        buf->referenced = 1;
+        buf->hash_next = hash_heads[bucket];
+        hash_heads[bucket] = idx;
+        ++used_count;
+        return idx;
+    }
+}
+
+/* Lock held, and dropped: sleep until I/O another thread is doing on buffer @p idx ends. */
+static void bcache_wait_busy(int32_t idx, uint32_t flags)
+{
+    struct process *self = process_current();
+    if (!self)
+    {
+        /* Only before the scheduler runs, when the holder cannot be preempted. */
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        __asm__ __volatile__("pause");
+        return;
+    }
+
+    struct bcache_waiter waiter = { self, idx, busy_waiters, 0 };
+    busy_waiters = &waiter;
+    spinlock_unlock_irqrestore(&bcache_lock, flags);
+
+    /* woken is only trusted under the lock, which bcache_unbusy() holds across the wake. */
+    for (;;)
+    {
+        process_block_current();
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        int woken = waiter.woken;
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        if (woken)
+            return;
+    }
+}
+
+/*
+ * Cache @p data, read from the driver since @p generation, as (dev, lba).
+ * If the block was cached meanwhile that copy wins and is copied back over
+ * @p data; if a bypassing write overlapped the read, nothing is cached.
+ */
+static void bcache_insert_clean(struct block_device *dev, uint64_t lba, uint8_t *data, uint32_t generation)
+{
+    for (;;)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        int32_t idx = bcache_find(dev, lba);
+        if (idx != BCACHE_NONE)
+        {
+            if (buffers[idx].busy)
+            {
+                bcache_wait_busy(idx, flags);
+                continue;
+            }
+            memcpy(data, buffers[idx].data, CONFIG_BCACHE_BLOCK_SIZE);
+            spinlock_unlock_irqrestore(&bcache_lock, flags);
+            return;
+        }
+        if (bypass_writes || bypass_generation != generation)
+        {
+            spinlock_unlock_irqrestore(&bcache_lock, flags);
+            return;
+        }
+
+        idx = bcache_claim(dev, lba, &flags);
+        if (idx == BCACHE_RACED)
+        {
+            spinlock_unlock_irqrestore(&bcache_lock, flags);
+            continue;
+        }
+        if (idx != BCACHE_NONE)
+        {
+            memcpy(buffers[idx].data, data, CONFIG_BCACHE_BLOCK_SIZE);
+            buffers[idx].valid = 1;
+            bcache_unbusy(idx);
+        }
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        return;
+    }
+}
+
+/* Copy the cached block into @p out. @return 1 on a hit, 0 if it is not cached. */
+static int bcache_copy_out(struct block_device *dev, uint64_t lba, uint8_t *out)
+{
+    for (;;)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        int32_t idx = bcache_find(dev, lba);
+        if (idx == BCACHE_NONE)
+        {
+            spinlock_unlock_irqrestore(&bcache_lock, flags);
+            return 0;
+        }
+        if (buffers[idx].busy)
+        {
+            bcache_wait_busy(idx, flags);
+            continue;
+        }
+        memcpy(out, buffers[idx].data, CONFIG_BCACHE_BLOCK_SIZE);
+        buffers[idx].referenced = 1;
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        return 1;
+    }
+}
+
+static int bcache_cached(struct block_device *dev, uint64_t lba)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&bcache_lock, &flags);
+    int cached = bcache_find(dev, lba) != BCACHE_NONE;
+    spinlock_unlock_irqrestore(&bcache_lock, flags);
+    return cached;
+}
+
+/* Read [lba, lba + count) from the driver into @p buffer and cache every block. */
+static int bcache_fill(struct block_device *dev, uint64_t lba, uint32_t count, uint8_t *buffer)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&bcache_lock, &flags);
+    /* A write already in flight makes the generation check below fail. */
+    uint32_t generation = bypass_writes ? bypass_generation - 1u : bypass_generation;
+    spinlock_unlock_irqrestore(&bcache_lock, flags);
+
+    if (blkqueue_io(dev, BIO_READ, lba, count, buffer) < 0)
+        return -1;
+    for (uint32_t i = 0; i < count; ++i)
+        bcache_insert_clean(dev, lba + i, buffer + i * CONFIG_BCACHE_BLOCK_SIZE, generation);
+    return 0;
+}
+
+static void bcache_readahead_work(void *data)
+{
+    (void)data;
+    bcache_readahead(readahead_dev, readahead_lba, CONFIG_BCACHE_READAHEAD);
+}
+
+static void bcache_queue_readahead(struct block_device *dev, uint64_t lba)
+{
+    if (!background_ready || dev->block_count == 0 || lba >= dev->block_count)
+        return;
+    /* One prefetch in flight at a time; a busy stream simply skips a window. */
+    if (readahead_work.pending)
+        return;
+    readahead_dev = dev;
+    readahead_lba = lba;
+    workqueue_queue(&readahead_work);
+}
+
+int bcache_read(struct block_device *dev, uint64_t lba, uint32_t count, void *buffer)
+{
+    if (!bcache_usable(dev))
+        return blkqueue_io(dev, BIO_READ, lba, count, buffer);
+
+    uint8_t *out = (uint8_t *)buffer;
+    if (count > CONFIG_BCACHE_BYPASS_BLOCKS)
+    {
+        if (blkqueue_io(dev, BIO_READ, lba, count, buffer) < 0)
+            return -1;
+        /* Cached copies may be newer than the disk. */
+        for (uint32_t i = 0; i < count; ++i)
+            bcache_copy_out(dev, lba + i, out + i * CONFIG_BCACHE_BLOCK_SIZE);
+        __sync_fetch_and_add(&stats.bypassed, 1);
+        return 0;
+    }
+
+    uint32_t i = 0;
+    while (i < count)
+    {
+        if (bcache_copy_out(dev, lba + i, out + i * CONFIG_BCACHE_BLOCK_SIZE))
+        {
+            __sync_fetch_and_add(&stats.hits, 1);
+            ++i;
+            continue;
+        }
+
+        /* Fetch the whole run of missing blocks in one driver call. */
+        uint32_t run = 1;
+        while (i + run < count && !bcache_cached(dev, lba + i + run))
+            ++run;
+        __sync_fetch_and_add(&stats.misses, run);
+        if (bcache_fill(dev, lba + i, run, out + i * CONFIG_BCACHE_BLOCK_SIZE) < 0)
+            return -1;
+        i += run;
+    }
+
+    if (dev == last_read_dev && lba == last_read_end)
+        bcache_queue_readahead(dev, lba + count);
+    last_read_dev = dev;
+    last_read_end = lba + count;
+    return 0;
+}
+
+/* Put one block in the cache as dirty. @return 0, or -1 when every buffer is busy. */
+static int bcache_write_block(struct block_device *dev, uint64_t lba, const uint8_t *data)
+{
+    for (;;)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        int32_t idx = bcache_find(dev, lba);
+        if (idx != BCACHE_NONE && buffers[idx].busy)
+        {
+            bcache_wait_busy(idx, flags);
+            continue;
+        }
+        if (idx == BCACHE_NONE)
+        {
+            idx = bcache_claim(dev, lba, &flags);
+            if (idx == BCACHE_RACED)
+            {
+                spinlock_unlock_irqrestore(&bcache_lock, flags);
+                continue;
+            }
+            if (idx == BCACHE_NONE)
+            {
+                spinlock_unlock_irqrestore(&bcache_lock, flags);
+                return -1;
+            }
+        }
+
+        struct bcache_buffer *buf = &buffers[idx];
+        memcpy(buf->data, data, CONFIG_BCACHE_BLOCK_SIZE);
+        buf->valid = 1;
+        bcache_unbusy(idx);
+        buf->referenced = 1;
+        if (!buf->dirty)
+        {
+            buf->dirty = 1;
+            ++dirty_count;
+        }
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        return 0;
+    }
+}
+
+/* Refresh a cached copy after a write went straight to the driver. */
+static void bcache_update_clean(struct block_device *dev, uint64_t lba, const uint8_t *data)
+{
+    for (;;)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        int32_t idx = bcache_find(dev, lba);
+        if (idx == BCACHE_NONE)
+        {
+            spinlock_unlock_irqrestore(&bcache_lock, flags);
+            return;
+        }
+        if (buffers[idx].busy)
+        {
+            bcache_wait_busy(idx, flags);
+            continue;
+        }
+        memcpy(buffers[idx].data, data, CONFIG_BCACHE_BLOCK_SIZE);
+        if (buffers[idx].dirty)
+        {
+            buffers[idx].dirty = 0;
+            --dirty_count;
+        }
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        return;
+    }
+}
+
+int bcache_write(struct block_device *dev, uint64_t lba, uint32_t count, const void *buffer)
+{
+    if (!bcache_usable(dev))
+        return blkqueue_io(dev, BIO_WRITE, lba, count, (void *)buffer);
+
+    const uint8_t *in = (const uint8_t *)buffer;
+    if (count > CONFIG_BCACHE_BYPASS_BLOCKS)
+    {
+        if (blkqueue_io(dev, BIO_WRITE, lba, count, (void *)buffer) < 0)
+            return -1;
+        for (uint32_t i = 0; i < count; ++i)
+            bcache_update_clean(dev, lba + i, in + i * CONFIG_BCACHE_BLOCK_SIZE);
+        __sync_fetch_and_add(&stats.bypassed, 1);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint8_t *block = in + i * CONFIG_BCACHE_BLOCK_SIZE;
+        if (bcache_write_block(dev, lba + i, block) == 0)
+            continue;
+        /* No buffer to spare: write this one through. */
+        if (blkqueue_io(dev, BIO_WRITE, lba + i, 1, (void *)block) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Write back up to CONFIG_BLKQUEUE_DEPTH dirty blocks at once: they are all
+ * submitted before the first wait, so the request queue sorts them and
+ * merges neighbours into larger transfers. @return blocks written, or -1.
+ */
+static int bcache_sync_batch(struct block_device *dev, struct bio *bios)
+{
+    int32_t batch[CONFIG_BLKQUEUE_DEPTH];
+    uint8_t submitted[CONFIG_BLKQUEUE_DEPTH];
+    uint32_t count = 0;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&bcache_lock, &flags);
+    for (uint32_t i = 0; i < BCACHE_BUFFERS && count < CONFIG_BLKQUEUE_DEPTH; ++i)
+    {
+        struct bcache_buffer *buf = &buffers[i];
+        if (!buf->dirty || buf->busy || (dev && buf->dev != dev))
+            continue;
+        buf->busy = 1;
+        batch[count++] = (int32_t)i;
+    }
+    spinlock_unlock_irqrestore(&bcache_lock, flags);
+
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        struct bcache_buffer *buf = &buffers[batch[k]];
+        bio_init(&bios[k], buf->dev, BIO_WRITE, buf->lba, 1, buf->data);
+        submitted[k] = blkqueue_submit(&bios[k]) == 0;
+    }
+
+    int failed = 0;
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        int status = submitted[k] ? blockdev_wait(&bios[k]) : -1;
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        struct bcache_buffer *buf = &buffers[batch[k]];
+        bcache_unbusy(batch[k]);
+        if (status == 0)
+        {
+            buf->dirty = 0;
+            --dirty_count;
+            ++stats.writebacks;
+        }
+        else
+        {
+            failed = 1;
+        }
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+    }
+    return failed ? -1 : (int)count;
+}
+
+int bcache_sync(struct block_device *dev)
+{
+    if (!bcache_memory)
+        return 0;
+
+    struct bio *bios = (struct bio *)kalloc(sizeof(struct bio) * CONFIG_BLKQUEUE_DEPTH);
+    if (!bios)
+    {
+        /* Fall back to one block at a time. */
+        int result = 0;
+        uint32_t flags;
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        for (uint32_t i = 0; i < BCACHE_BUFFERS && dirty_count > 0; ++i)
+        {
+            struct bcache_buffer *buf = &buffers[i];
+            if (!buf->dirty || buf->busy || (dev && buf->dev != dev))
+                continue;
+            if (bcache_write_back((int32_t)i, &flags) < 0)
+                result = -1;
+        }
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        return result;
+    }
+
+    /* A failed block stays dirty; stop rather than retrying it forever. */
+    int rc;
+    while ((rc = bcache_sync_batch(dev, bios)) > 0)
+        ;
+    kfree(bios);
+    return rc < 0 ? -1 : 0;
+}
+
+int bcache_flush_range(struct block_device *dev, uint64_t lba, uint32_t count)
+{
+    if (!bcache_usable(dev))
+        return 0;
+
+    int result = 0;
+    uint32_t i = 0;
+    while (i < count && dirty_count > 0)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        int32_t idx = bcache_find(dev, lba + i);
+        if (idx != BCACHE_NONE && buffers[idx].busy)
+        {
+            bcache_wait_busy(idx, flags);
+            continue;
+        }
+        if (idx != BCACHE_NONE && buffers[idx].dirty && bcache_write_back(idx, &flags) < 0)
+            result = -1;
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        ++i;
+    }
+    return result;
+}
+
+void bcache_discard_range(struct block_device *dev, uint64_t lba, uint32_t count)
+{
+    if (!bcache_usable(dev))
+        return;
+
+    uint32_t i = 0;
+    while (i < count && used_count > 0)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&bcache_lock, &flags);
+        int32_t idx = bcache_find(dev, lba + i);
+        if (idx != BCACHE_NONE && buffers[idx].busy)
+        {
+            bcache_wait_busy(idx, flags);
+            continue;
+        }
+        if (idx != BCACHE_NONE)
+        {
+            if (buffers[idx].dirty)
+            {
+                buffers[idx].dirty = 0;
+                --dirty_count;
+            }
+            bcache_hash_remove(idx);
+        }
+        spinlock_unlock_irqrestore(&bcache_lock, flags);
+        ++i;
+    }
+}
+
+int bcache_write_begin(struct block_device *dev, uint64_t lba, uint32_t count)
+{
+    if (!bcache_usable(dev))
+        return 0;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&bcache_lock, &flags);
+    ++bypass_writes;
+    ++bypass_generation;
+    spinlock_unlock_irqrestore(&bcache_lock, flags);
+    bcache_discard_range(dev, lba, count);
+    return 1;
+}
+
+void bcache_write_end(void)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&bcache_lock, &flags);
+    --bypass_writes;
+    ++bypass_generation;
+    spinlock_unlock_irqrestore(&bcache_lock, flags);
+}
+
+int bcache_readahead(struct block_device *dev, uint64_t lba, uint32_t count)
+{
+    if (!bcache_usable(dev) || count == 0)
+        return 0;
+    if (dev->block_count != 0)
+    {
+        if (lba >= dev->block_count)
+            return 0;
+        if (lba + count > dev->block_count)
+            count = (uint32_t)(dev->block_count - lba);
+    }
+
+    uint8_t *scratch = (uint8_t *)kalloc(count * CONFIG_BCACHE_BLOCK_SIZE);
+    if (!scratch)
+        return -1;
+
+    int result = 0;
+    uint32_t i = 0;
+    while (i < count)
+    {
+        if (bcache_cached(dev, lba + i))
+        {
+            ++i;
+            continue;
+        }
+        uint32_t run = 1;
+        while (i + run < count && !bcache_cached(dev, lba + i + run))
+            ++run;
+        if (bcache_fill(dev, lba + i, run, scratch) < 0)
+        {
+            result = -1;
+            break;
+        }
+        __sync_fetch_and_add(&stats.readahead, run);
+        i += run;
+    }
+    kfree(scratch);
+    return result;
+}
+
+void bcache_invalidate(struct block_device *dev)
+{
+    if (!bcache_memory)
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&bcache_lock, &flags);
+    for (uint32_t i = 0; i < BCACHE_BUFFERS; ++i)
+    {
+        struct bcache_buffer *buf = &buffers[i];
+        if (!buf->dev || buf->busy || (dev && buf->dev != dev))
+            continue;
+        if (buf->dirty)
+        {
+            buf->dirty = 0;
+            --dirty_count;
+        }
+        bcache_hash_remove((int32_t)i);
+    }
+    if (!dev || last_read_dev == dev)
+        last_read_dev = NULL;
+    spinlock_unlock_irqrestore(&bcache_lock, flags);
+}
+
+void bcache_get_stats(struct bcache_stats *out)
+{
+    if (!out)
+        return;
+    uint32_t flags;
+    spinlock_lock_irqsave(&bcache_lock, &flags);
+    *out = stats;
+    out->buffers = bcache_memory ? BCACHE_BUFFERS : 0;
+    out->used = used_count;
+    out->dirty = dirty_count;
+    spinlock_unlock_irqrestore(&bcache_lock, flags);
+}
+
+static void bcache_writeback_work(void *data)
+{
+    (void)data;
+    if (dirty_count > 0)
+        bcache_sync(NULL);
+}
+
+/* Runs in IRQ context, so the I/O itself goes to the low-priority worker. */
+static void bcache_writeback_tick(void *data)
+{
+    (void)data;
+    timer_arm(&writeback_timer, CONFIG_BCACHE_WRITEBACK_TICKS);
+    if (dirty_count > 0)
+        workqueue_queue(&writeback_work);
+}
+
+void bcache_init(void)
+{
+    spinlock_init_named(&bcache_lock, "bcache");
+    memset(&stats, 0, sizeof(stats));
+    for (uint32_t i = 0; i < CONFIG_BCACHE_HASH_BUCKETS; ++i)
+        hash_heads[i] = BCACHE_NONE;
+
+    bcache_memory = (uint8_t *)kalloc(CONFIG_BCACHE_BYTES);
+    if (!bcache_memory)
+        klog_warn("bcache: no memory; block I/O goes straight to drivers");
+    for (uint32_t i = 0; i < BCACHE_BUFFERS; ++i)
+    {
+        memset(&buffers[i], 0, sizeof(buffers[i]));
+        buffers[i].hash_next = BCACHE_NONE;
+        buffers[i].data = bcache_memory ? bcache_memory + i * CONFIG_BCACHE_BLOCK_SIZE : NULL;
+    }
+
+    work_init(&readahead_work, bcache_readahead_work, NULL, WORK_PRIORITY_LOW);
+    work_init(&writeback_work, bcache_writeback_work, NULL, WORK_PRIORITY_LOW);
+    timer_init(&writeback_timer, bcache_writeback_tick, NULL);
+}
+
+void bcache_start_writeback(void)
+{
+    background_ready = 1;
+    timer_arm(&writeback_timer, CONFIG_BCACHE_WRITEBACK_TICKS);
+}
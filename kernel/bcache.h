@@ -0,0 +1,66 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct block_device;
+
+/**
+ * Write-back buffer cache under blockdev_read()/blockdev_write().
+ *
+ * Blocks are keyed by (device, LBA) in a hash table and evicted with a
+ * CLOCK sweep. Misses and write-back go through the device request queue
+ * (blkqueue.c), which merges neighbouring dirty blocks into one transfer.
+ * Writes only dirty the cached copy; dirty blocks reach the driver when
+ * evicted, on blockdev_sync(), and from a periodic write-back work item.
+ * A read that continues where the last one ended queues read-ahead of the
+ * following blocks on the low-priority worker.
+ * Partitions are not cached themselves since they forward to their parent,
+ * and requests larger than CONFIG_BCACHE_BYPASS_BLOCKS go straight to the
+ * driver, with cached copies still taking precedence.
+ */
+
+struct bcache_stats
+{
+    uint32_t buffers;
+    uint32_t used;
+    uint32_t dirty;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    /** Dirty blocks written to a driver. */
+    uint64_t writebacks;
+    uint64_t readahead;
+    /** Requests too large for the cache, served by the driver directly. */
+    uint64_t bypassed;
+};
+
+void bcache_init(void);
+/** Arm the periodic write-back and enable read-ahead; needs timers and the workers. */
+void bcache_start_writeback(void);
+int bcache_read(struct block_device *dev, uint64_t lba, uint32_t count, void *buffer);
+int bcache_write(struct block_device *dev, uint64_t lba, uint32_t count, const void *buffer);
+/** Write back dirty blocks of @p dev, or of every device when NULL. */
+int bcache_sync(struct block_device *dev);
+/** Write back dirty cached blocks in [lba, lba + count) before a read that bypasses the cache. */
+int bcache_flush_range(struct block_device *dev, uint64_t lba, uint32_t count);
+/** Drop cached blocks in [lba, lba + count) that a bypassing write replaces. */
+void bcache_discard_range(struct block_device *dev, uint64_t lba, uint32_t count);
+/**
+ * @brief A write to [lba, lba + count) is about to bypass the cache.
+ *
+ * Drops the cached copies, and until the matching bcache_write_end() no
+ * block read from a driver is cached, since it may predate the write.
+ * @return 1 if bcache_write_end() must be called when the write completes.
+ */
+int bcache_write_begin(struct block_device *dev, uint64_t lba, uint32_t count);
+/** The bypassing write has completed; safe from interrupt context. */
+void bcache_write_end(void);
+/** Pull blocks into the cache without copying them anywhere. */
+int bcache_readahead(struct block_device *dev, uint64_t lba, uint32_t count);
+/** Forget cached blocks of @p dev (all when NULL); dirty data is dropped, so sync first. */
+void bcache_invalidate(struct block_device *dev);
+void bcache_get_stats(struct bcache_stats *out);
+
+#endif
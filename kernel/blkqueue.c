@@ -0,0 +1,748 @@
+#include "blkqueue.h"
+
+#include "spinlock.h"
+#include "memory.h"
+#include "proc.h"
+#include "pit.h"
+#include "workqueue.h"
+#include "bcache.h"
+#include "string.h"
+#include "config.h"
+
+struct blk_request
+{
+    uint64_t lba;
+    uint32_t count;
+    uint8_t op;
+    uint8_t in_use;
+    /* Set while the request's data goes through the queue's bounce buffer. */
+    uint8_t bounced;
+    uint64_t expires;
+    /* Member bios in LBA order; together they cover [lba, lba + count). */
+    struct bio *head;
+    struct bio *tail;
+    struct blk_request *next;
+    /* What the driver sees: one transfer over the whole request. */
+    struct bio io;
+};
+
+/* Lives on the stack of a thread sleeping on the queue itself rather than on a bio. */
+struct blkqueue_waiter
+{
+    struct process *proc;
+    struct blkqueue_waiter *next;
+    /* Set under the queue lock when the thread is woken. */
+    volatile int woken;
+};
+
+struct blk_queue
+{
+    struct block_device *dev;
+    spinlock_t lock;
+    uint8_t in_use;
+    uint8_t elevator;
+    /*
+     * Set while one thread starts a request, and for a synchronous driver
+     * until it has finished. Waiters sleep meanwhile; when it is cleared,
+     * one waiter of the next request is woken in the same critical section.
+     */
+    uint8_t dispatching;
+    uint8_t bounce_busy;
+    uint8_t *bounce;
+    /* Pending requests: arrival order for FIFO, LBA order for deadline. */
+    struct blk_request *head;
+    uint32_t queued;
+    uint32_t in_flight;
+    /* Submitters waiting for a free request slot; one is woken per completion. */
+    struct blkqueue_waiter *slot_waiters;
+    /* blkqueue_detach() waiting for the queue to drain. */
+    struct blkqueue_waiter *drain_waiters;
+    /* Where the deadline sweep continues. */
+    uint64_t next_lba;
+    struct blk_request requests[CONFIG_BLKQUEUE_DEPTH];
+    struct work_item work;
+    struct blkqueue_info stats;
+};
+
+static struct blk_queue queues[BLOCKDEV_MAX_DEVICES];
+static spinlock_t queues_lock;
+static int workers_ready = 0;
+
+static void blkqueue_kick(struct blk_queue *q)
+{
+    if (workers_ready)
+        workqueue_queue(&q->work);
+}
+
+/* Queue lock held: wake the first thread on @p list, or all of them. */
+static void blkqueue_wake_list(struct blkqueue_waiter **list, int all)
+{
+    while (*list)
+    {
+        struct blkqueue_waiter *waiter = *list;
+        *list = waiter->next;
+        waiter->woken = 1;
+        process_wake(waiter->proc);
+        if (!all)
+            break;
+    }
+}
+
+/* No thread to put to sleep: halt until the completion interrupt if one can arrive. */
+static void blkqueue_idle_wait(void)
+{
+    uint32_t eflags;
+    __asm__ __volatile__("pushf; pop %0" : "=r"(eflags));
+    if (eflags & 0x200u)
+        __asm__ __volatile__("hlt");
+    else
+        __asm__ __volatile__("pause");
+}
+
+/*
+ * Queue lock held, and dropped: sleep on @p list until woken. woken is
+ * only trusted under the lock, which the waker holds across the wake.
+ */
+static void blkqueue_sleep_on(struct blk_queue *q, struct blkqueue_waiter **list, uint32_t flags)
+{
+    struct process *self = process_current();
+    if (!self)
+    {
+        spinlock_unlock_irqrestore(&q->lock, flags);
+        blkqueue_idle_wait();
+        return;
+    }
+
+    struct blkqueue_waiter waiter = { self, *list, 0 };
+    *list = &waiter;
+    spinlock_unlock_irqrestore(&q->lock, flags);
+    for (;;)
+    {
+        process_block_current();
+        spinlock_lock_irqsave(&q->lock, &flags);
+        int woken = waiter.woken;
+        spinlock_unlock_irqrestore(&q->lock, flags);
+        if (woken)
+            return;
+    }
+}
+
+/* Queue lock held. */
+static void blkqueue_insert(struct blk_queue *q, struct blk_request *rq)
+{
+    struct blk_request **link = &q->head;
+    if (q->elevator == BLOCKDEV_ELEVATOR_DEADLINE)
+    {
+        while (*link && (*link)->lba <= rq->lba)
+            link = &(*link)->next;
+    }
+    else
+    {
+        while (*link)
+            link = &(*link)->next;
+    }
+    rq->next = *link;
+    *link = rq;
+    ++q->queued;
+}
+
+/* Queue lock held. */
+static void blkqueue_unlink(struct blk_queue *q, struct blk_request *rq)
+{
+    struct blk_request **link = &q->head;
+    while (*link != rq)
+        link = &(*link)->next;
+    *link = rq->next;
+    rq->next = NULL;
+    --q->queued;
+}
+
+/* Queue lock held: join @p bio to a queued request it extends. */
+static int blkqueue_try_merge(struct blk_queue *q, struct bio *bio)
+{
+    for (struct blk_request *rq = q->head; rq; rq = rq->next)
+    {
+        if (rq->op != bio->op || rq->count + bio->count > CONFIG_BLKQUEUE_MAX_MERGE_BLOCKS)
+            continue;
+        if (rq->lba + rq->count == bio->lba)
+        {
+            rq->tail->next = bio;
+            rq->tail = bio;
+            rq->count += bio->count;
+            return 1;
+        }
+        if (bio->lba + bio->count == rq->lba)
+        {
+            bio->next = rq->head;
+            rq->head = bio;
+            rq->lba = bio->lba;
+            rq->count += bio->count;
+            /* The request moved down; keep the deadline list sorted. */
+            if (q->elevator == BLOCKDEV_ELEVATOR_DEADLINE)
+            {
+                blkqueue_unlink(q, rq);
+                blkqueue_insert(q, rq);
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Queue lock held. */
+static struct blk_request *blkqueue_alloc_request(struct blk_queue *q)
+{
+    for (uint32_t i = 0; i < CONFIG_BLKQUEUE_DEPTH; ++i)
+    {
+        struct blk_request *rq = &q->requests[i];
+        if (!rq->in_use)
+        {
+            memset(rq, 0, sizeof(*rq));
+            rq->in_use = 1;
+            return rq;
+        }
+    }
+    return NULL;
+}
+
+/* Queue lock held: the request the elevator would dispatch next; *@p expired if it is overdue. */
+static struct blk_request *blkqueue_choose(struct blk_queue *q, int *expired)
+{
+    struct blk_request *pick = q->head;
+    *expired = 0;
+    if (pick && q->elevator == BLOCKDEV_ELEVATOR_DEADLINE)
+    {
+        struct blk_request *oldest = q->head;
+        struct blk_request *ahead = NULL;
+        for (struct blk_request *rq = q->head; rq; rq = rq->next)
+        {
+            if (rq->expires < oldest->expires)
+                oldest = rq;
+            if (!ahead && rq->lba >= q->next_lba)
+                ahead = rq;
+        }
+        if (oldest->expires <= get_ticks())
+        {
+            pick = oldest;
+            *expired = 1;
+        }
+        else if (ahead)
+        {
+            pick = ahead;
+        }
+    }
+    return pick;
+}
+
+/* Queue lock held: choose the next request and take it off the queue. */
+static struct blk_request *blkqueue_pick(struct blk_queue *q)
+{
+    int expired;
+    struct blk_request *pick = blkqueue_choose(q, &expired);
+    if (!pick)
+        return NULL;
+    if (expired)
+        ++q->stats.expired;
+
+    blkqueue_unlink(q, pick);
+    q->next_lba = pick->lba + pick->count;
+    return pick;
+}
+
+/*
+ * Queue lock held: wake one thread waiting on the request that goes next,
+ * so it can dispatch it. The rest sleep until their own bio completes or
+ * their request comes up. @return 1 if the worker has to run the queue
+ * instead: an asynchronous driver, or nobody waiting on that request.
+ */
+static int blkqueue_wake_next(struct blk_queue *q)
+{
+    int expired;
+    struct blk_request *next = blkqueue_choose(q, &expired);
+    if (!next)
+        return 0;
+    if (q->dev->ops->submit)
+        return 1;
+    for (struct bio *bio = next->head; bio; bio = bio->next)
+    {
+        if (bio->waiter)
+        {
+            process_wake(bio->waiter);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void blkqueue_finish_request(struct blk_queue *q, struct blk_request *rq, int failed)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&q->lock, &flags);
+    if (rq->bounced)
+        q->bounce_busy = 0;
+    rq->in_use = 0;
+    --q->in_flight;
+    ++q->stats.completed;
+    if (failed)
+        ++q->stats.errors;
+    /* A slot is free for one submitter; the queue may have drained for detach. */
+    blkqueue_wake_list(&q->slot_waiters, 0);
+    if (!q->head && q->in_flight == 0)
+        blkqueue_wake_list(&q->drain_waiters, 1);
+    /* While a dispatch is running, the next request's waiter is woken when it ends instead. */
+    int more = !q->dispatching && blkqueue_wake_next(q);
+    spinlock_unlock_irqrestore(&q->lock, flags);
+
+    if (more)
+        blkqueue_kick(q);
+}
+
+/* Completion of the merged transfer: hand the result to every member bio. */
+static void blkqueue_request_done(struct bio *io)
+{
+    struct blk_request *rq = (struct blk_request *)io->private_data;
+    struct blk_queue *q = io->dev->queue;
+    uint32_t block_size = io->dev->block_size;
+
+    uint32_t offset = 0;
+    struct bio *bio = rq->head;
+    while (bio)
+    {
+        struct bio *next = bio->next;
+        if (rq->bounced && rq->op == BIO_READ && io->status == 0)
+            memcpy(bio->buffer, q->bounce + offset, bio->count * block_size);
+        offset += bio->count * block_size;
+        blockdev_complete(bio, io->status);
+        bio = next;
+    }
+    blkqueue_finish_request(q, rq, io->status != 0);
+}
+
+/* No bounce buffer to spare: run the member bios one by one. */
+static void blkqueue_run_split(struct blk_queue *q, struct blk_request *rq)
+{
+    struct block_device *dev = q->dev;
+    int failed = 0;
+    struct bio *bio = rq->head;
+    while (bio)
+    {
+        struct bio *next = bio->next;
+        int status = blockdev_driver_io(dev, bio->op, bio->lba, bio->count, bio->buffer);
+        if (status < 0)
+            failed = 1;
+        blockdev_complete(bio, status);
+        bio = next;
+    }
+    blkqueue_finish_request(q, rq, failed);
+}
+
+/* Process context: the bounce buffer is allocated on first use. */
+static uint8_t *blkqueue_take_bounce(struct blk_queue *q)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&q->lock, &flags);
+    if (q->bounce_busy)
+    {
+        spinlock_unlock_irqrestore(&q->lock, flags);
+        return NULL;
+    }
+    q->bounce_busy = 1;
+    spinlock_unlock_irqrestore(&q->lock, flags);
+
+    if (!q->bounce)
+        q->bounce = (uint8_t *)kalloc(CONFIG_BLKQUEUE_MAX_MERGE_BLOCKS * q->dev->block_size);
+    if (!q->bounce)
+    {
+        spinlock_lock_irqsave(&q->lock, &flags);
+        q->bounce_busy = 0;
+        spinlock_unlock_irqrestore(&q->lock, flags);
+    }
+    return q->bounce;
+}
+
+static void blkqueue_start_request(struct blk_queue *q, struct blk_request *rq)
+{
+    struct block_device *dev = q->dev;
+    struct bio *io = &rq->io;
+    bio_init(io, dev, rq->op, rq->lba, rq->count, rq->head->buffer);
+    io->end_io = blkqueue_request_done;
+    io->private_data = rq;
+
+    if (rq->head != rq->tail)
+    {
+        uint8_t *bounce = blkqueue_take_bounce(q);
+        if (!bounce)
+        {
+            blkqueue_run_split(q, rq);
+            return;
+        }
+        rq->bounced = 1;
+        if (rq->op == BIO_WRITE)
+        {
+            uint32_t offset = 0;
+            for (struct bio *bio = rq->head; bio; bio = bio->next)
+            {
+                memcpy(bounce + offset, bio->buffer, bio->count * dev->block_size);
+                offset += bio->count * dev->block_size;
+            }
+        }
+        io->buffer = bounce;
+    }
+
+    if (dev->ops->submit)
+    {
+        if (dev->ops->submit(dev, io) < 0)
+            blockdev_complete(io, -1);
+        return;
+    }
+    blockdev_complete(io, blockdev_driver_io(dev, rq->op, rq->lba, rq->count, io->buffer));
+}
+
+/* Hand one request to the driver. @return 1 if one was started. */
+static int blkqueue_dispatch(struct blk_queue *q)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&q->lock, &flags);
+    if (q->dispatching || !q->head)
+    {
+        spinlock_unlock_irqrestore(&q->lock, flags);
+        return 0;
+    }
+    struct blk_request *rq = blkqueue_pick(q);
+    ++q->in_flight;
+    ++q->stats.dispatched;
+    q->stats.dispatched_blocks += rq->count;
+    q->dispatching = 1;
+    spinlock_unlock_irqrestore(&q->lock, flags);
+
+    blkqueue_start_request(q, rq);
+
+    spinlock_lock_irqsave(&q->lock, &flags);
+    q->dispatching = 0;
+    int more = blkqueue_wake_next(q);
+    spinlock_unlock_irqrestore(&q->lock, flags);
+    if (more)
+        blkqueue_kick(q);
+    return 1;
+}
+
+static void blkqueue_work(void *data)
+{
+    struct blk_queue *q = (struct blk_queue *)data;
+    while (blkqueue_dispatch(q))
+        ;
+}
+
+int blkqueue_submit(struct bio *bio)
+{
+    bio->done = 0;
+    bio->status = 0;
+    bio->waiter = NULL;
+    bio->next = NULL;
+
+    struct blk_queue *q = bio->dev->queue;
+    if (!q)
+    {
+        /* Partitions have no queue of their own; their parent's queue does the work. */
+        blockdev_complete(bio, blockdev_driver_io(bio->dev, bio->op, bio->lba, bio->count, bio->buffer));
+        return 0;
+    }
+
+    /* A synchronous driver is run by the threads waiting on it; nobody waits for an end_io bio. */
+    int needs_worker = q->dev->ops->submit || bio->end_io;
+    for (;;)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&q->lock, &flags);
+        if (blkqueue_try_merge(q, bio))
+        {
+            ++q->stats.submitted;
+            ++q->stats.merged;
+            spinlock_unlock_irqrestore(&q->lock, flags);
+            if (needs_worker)
+                blkqueue_kick(q);
+            return 0;
+        }
+        struct blk_request *rq = blkqueue_alloc_request(q);
+        if (rq)
+        {
+            rq->lba = bio->lba;
+            rq->count = bio->count;
+            rq->op = bio->op;
+            rq->expires = get_ticks() + (bio->op == BIO_WRITE ? CONFIG_BLKQUEUE_WRITE_EXPIRE : CONFIG_BLKQUEUE_READ_EXPIRE);
+            rq->head = bio;
+            rq->tail = bio;
+            blkqueue_insert(q, rq);
+            ++q->stats.submitted;
+            spinlock_unlock_irqrestore(&q->lock, flags);
+            if (needs_worker)
+                blkqueue_kick(q);
+            return 0;
+        }
+        ++q->stats.full_waits;
+        if (q->head && !q->dispatching)
+        {
+            /* Full of pending requests nobody is running: help drain it. */
+            spinlock_unlock_irqrestore(&q->lock, flags);
+            blkqueue_dispatch(q);
+            continue;
+        }
+        /* Every slot is pending behind a running dispatch or in flight; a completion frees one. */
+        blkqueue_sleep_on(q, &q->slot_waiters, flags);
+    }
+}
+
+int blockdev_wait(struct bio *bio)
+{
+    if (!bio || !bio->dev)
+        return -1;
+    struct blk_queue *q = bio->dev->queue;
+    /* Without a queue the bio completed inside blkqueue_submit(). */
+    if (!q)
+        return bio->done ? bio->status : -1;
+
+    /*
+     * done is only trusted under the queue lock: blockdev_complete() holds
+     * it while reading waiter, so this frame cannot unwind mid-wake.
+     */
+    for (;;)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&q->lock, &flags);
+        if (bio->done)
+        {
+            bio->waiter = NULL;
+            spinlock_unlock_irqrestore(&q->lock, flags);
+            return bio->status;
+        }
+        if (q->head && !q->dispatching)
+        {
+            /* Run the queue here rather than waiting for the worker. */
+            spinlock_unlock_irqrestore(&q->lock, flags);
+            blkqueue_dispatch(q);
+            continue;
+        }
+        struct process *self = process_current();
+        if (!self)
+        {
+            /* In flight on an asynchronous driver; its interrupt completes the bio. */
+            spinlock_unlock_irqrestore(&q->lock, flags);
+            blkqueue_idle_wait();
+            continue;
+        }
+        bio->waiter = self;
+        spinlock_unlock_irqrestore(&q->lock, flags);
+        process_block_current();
+    }
+}
+
+void blockdev_complete(struct bio *bio, int status)
+{
+    if (!bio)
+        return;
+    bio->status = status < 0 ? -1 : 0;
+    if (bio->cache_bypass)
+    {
+        bio->cache_bypass = 0;
+        bcache_write_end();
+    }
+    if (bio->end_io)
+    {
+        bio->end_io(bio);
+        return;
+    }
+
+    struct blk_queue *q = bio->dev->queue;
+    if (!q)
+    {
+        bio->done = 1;
+        return;
+    }
+    uint32_t flags;
+    spinlock_lock_irqsave(&q->lock, &flags);
+    bio->done = 1;
+    struct process *waiter = bio->waiter;
+    if (waiter)
+        process_wake(waiter);
+    spinlock_unlock_irqrestore(&q->lock, flags);
+}
+
+void bio_init(struct bio *bio, struct block_device *dev, uint8_t op, uint64_t lba, uint32_t count, void *buffer)
+{
+    if (!bio)
+        return;
+    memset(bio, 0, sizeof(*bio));
+    bio->dev = dev;
+    bio->op = op;
+    bio->lba = lba;
+    bio->count = count;
+    bio->buffer = buffer;
+}
+
+int blkqueue_io(struct block_device *dev, uint8_t op, uint64_t lba, uint32_t count, void *buffer)
+{
+    if (!dev->queue)
+        return blockdev_driver_io(dev, op, lba, count, buffer);
+    struct bio bio;
+    bio_init(&bio, dev, op, lba, count, buffer);
+    if (blkqueue_submit(&bio) < 0)
+        return -1;
+    return blockdev_wait(&bio);
+}
+
+int blockdev_set_elevator(struct block_device *dev, uint8_t elevator)
+{
+    if (!dev || !dev->queue || elevator > BLOCKDEV_ELEVATOR_DEADLINE)
+        return -1;
+    struct blk_queue *q = dev->queue;
+    uint32_t flags;
+    spinlock_lock_irqsave(&q->lock, &flags);
+    if (q->elevator != elevator)
+    {
+        /* Re-queue what is pending so the list order matches the policy. */
+        struct blk_request *pending = q->head;
+        q->head = NULL;
+        q->queued = 0;
+        q->elevator = elevator;
+        q->stats.elevator = elevator;
+        while (pending)
+        {
+            struct blk_request *next = pending->next;
+            blkqueue_insert(q, pending);
+            pending = next;
+        }
+    }
+    spinlock_unlock_irqrestore(&q->lock, flags);
+    return 0;
+}
+
+int blkqueue_attach(struct block_device *dev)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&queues_lock, &flags);
+    struct blk_queue *q = NULL;
+    for (uint32_t i = 0; i < BLOCKDEV_MAX_DEVICES; ++i)
+    {
+        if (!queues[i].in_use)
+        {
+            q = &queues[i];
+            q->in_use = 1;
+            break;
+        }
+    }
+    spinlock_unlock_irqrestore(&queues_lock, flags);
+    if (!q)
+        return -1;
+
+    memset(q, 0, sizeof(*q));
+    q->in_use = 1;
+    q->dev = dev;
+    q->elevator = CONFIG_BLKQUEUE_ELEVATOR;
+    spinlock_init_named(&q->lock, "blkqueue");
+    work_init(&q->work, blkqueue_work, q, WORK_PRIORITY_NORMAL);
+    q->stats.elevator = q->elevator;
+    dev->queue = q;
+    return 0;
+}
+
+void blkqueue_detach(struct block_device *dev)
+{
+    struct blk_queue *q = dev ? dev->queue : NULL;
+    if (!q)
+        return;
+
+    for (;;)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&q->lock, &flags);
+        if (!q->head && q->in_flight == 0)
+        {
+            spinlock_unlock_irqrestore(&q->lock, flags);
+            break;
+        }
+        if (q->head && !q->dispatching)
+        {
+            spinlock_unlock_irqrestore(&q->lock, flags);
+            blkqueue_dispatch(q);
+            continue;
+        }
+        blkqueue_sleep_on(q, &q->drain_waiters, flags);
+    }
+
+    /* A worker still holding the work item finds an empty queue; the slot is static. */
+    if (q->bounce)
+    {
+        kfree(q->bounce);
+        q->bounce = NULL;
+    }
+    dev->queue = NULL;
+    q->dev = NULL;
+    q->in_use = 0;
+}
+
+void blkqueue_rebind(struct block_device *dev)
+{
+    if (dev && dev->queue)
+        dev->queue->dev = dev;
+}
+
+size_t blkqueue_snapshot(struct blkqueue_info *out, size_t capacity)
+{
+    size_t count = 0;
+    for (uint32_t i = 0; i < BLOCKDEV_MAX_DEVICES && count < capacity; ++i)
+    {
+        struct blk_queue *q = &queues[i];
+        if (!q->in_use || !q->dev)
+            continue;
+        uint32_t flags;
+        spinlock_lock_irqsave(&q->lock, &flags);
+        out[count] = q->stats;
+        out[count].queued = q->queued;
+        out[count].in_flight = q->in_flight;
+        memcpy(out[count].name, q->dev->name, BLOCKDEV_NAME_MAX);
+        spinlock_unlock_irqrestore(&q->lock, flags);
+        ++count;
+    }
+    return count;
+}
+
+void blkqueue_reset_stats(void)
+{
+    for (uint32_t i = 0; i < BLOCKDEV_MAX_DEVICES; ++i)
+    {
+        struct blk_queue *q = &queues[i];
+        uint32_t flags;
+        spinlock_lock_irqsave(&q->lock, &flags);
+        uint8_t elevator = q->stats.elevator;
+        memset(&q->stats, 0, sizeof(q->stats));
+        q->stats.elevator = elevator;
+        spinlock_unlock_irqrestore(&q->lock, flags);
+    }
+}
+
+void blkqueue_init(void)
+{
+    spinlock_init_named(&queues_lock, "blkqueue.table");
+    for (uint32_t i = 0; i < BLOCKDEV_MAX_DEVICES; ++i)
+    {
+        memset(&queues[i], 0, sizeof(queues[i]));
+        spinlock_init_named(&queues[i].lock, "blkqueue");
+    }
+}
+
+void blkqueue_start(void)
+{
+    workers_ready = 1;
+    for (uint32_t i = 0; i < BLOCKDEV_MAX_DEVICES; ++i)
+    {
+        struct blk_queue *q = &queues[i];
+        if (!q->in_use || !q->dev)
+            continue;
+        uint32_t flags;
+        spinlock_lock_irqsave(&q->lock, &flags);
+        int more = !q->dispatching && blkqueue_wake_next(q);
+        spinlock_unlock_irqrestore(&q->lock, flags);
+        if (more)
+            blkqueue_kick(q);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef BLKQUEUE_H
+#define BLKQUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "blockdev.h"
+
+/**
+ * Per-device block request queues behind blockdev_submit().
+ *
+ * Each registered device gets a queue of up to CONFIG_BLKQUEUE_DEPTH
+ * requests. A bio that continues or precedes a queued request in the same
+ * direction joins it, up to CONFIG_BLKQUEUE_MAX_MERGE_BLOCKS, so the driver
+ * sees one larger transfer through a per-queue bounce buffer. A synchronous
+ * driver is run by the threads waiting on its bios: when a dispatch ends,
+ * one waiter of the request that goes next is woken to start it. The
+ * normal-priority worker only steps in for drivers with a submit op and for
+ * requests nobody waits on. Submitters that find the queue full sleep until
+ * a request completes. Partitions get no queue and pass bios to their parent.
+ */
+
+struct blkqueue_info
+{
+    char name[BLOCKDEV_NAME_MAX];
+    uint8_t elevator;
+    uint32_t queued;
+    uint32_t in_flight;
+    uint64_t submitted;
+    /** Bios that joined an already queued request. */
+    uint64_t merged;
+    /** Requests handed to the driver, and the blocks they covered. */
+    uint64_t dispatched;
+    uint64_t dispatched_blocks;
+    uint64_t completed;
+    uint64_t errors;
+    /** Deadline requests served out of LBA order because they expired. */
+    uint64_t expired;
+    /** Submissions that found the queue full. */
+    uint64_t full_waits;
+};
+
+void blkqueue_init(void);
+/** Let submissions kick the worker; needs the work queues running. */
+void blkqueue_start(void);
+int blkqueue_attach(struct block_device *dev);
+/** Drain and release the queue of @p dev. */
+void blkqueue_detach(struct block_device *dev);
+/** Point the queue back at @p dev after the device table moved it. */
+void blkqueue_rebind(struct block_device *dev);
+int blkqueue_submit(struct bio *bio);
+/** Synchronous transfer through the queue; the buffer cache uses this. */
+int blkqueue_io(struct block_device *dev, uint8_t op, uint64_t lba, uint32_t count, void *buffer);
+size_t blkqueue_snapshot(struct blkqueue_info *out, size_t capacity);
+void blkqueue_reset_stats(void);
+
+#endif
@@ -1,12 +1,27 @@
 #include "blockdev.h"
 
+#include "bcache.h"
+#include "blkqueue.h"
+#include "spinlock.h"
+#include "proc.h"
 #include "klog.h"
 #include "string.h"
 
 #define BLOCKDEV_INLINE_CAP 8
 
+/* Lives on the waiting thread's stack while it sleeps for a device. */
+struct blockdev_io_waiter
+{
+    struct process *proc;
+    struct blockdev_io_waiter *next;
+    /* Set under io_lock once io_busy has been handed over. */
+    volatile int granted;
+};
+
 static struct block_device device_table[BLOCKDEV_MAX_DEVICES];
 static size_t device_count = 0;
+/* Guards io_busy and io_waiters of every device. */
+static spinlock_t io_lock;
 
 static int str_equals(const char *a, const char *b)
 {
@@ -69,8 +84,11 @@ static void log_device(const struct block_device *dev)
 
 void blockdev_init(void)
 {
+    spinlock_init_named(&io_lock, "blockdev.io");
     device_count = 0;
     memset(device_table, 0, sizeof(device_table));
+    blkqueue_init();
+    bcache_init();
 }
 
 int blockdev_register(const struct blockdev_descriptor *desc, struct block_device **out_dev)
@@ -91,6 +109,9 @@ int blockdev_register(const struct blockdev_descriptor *desc, struct block_devic
     slot->driver_data = desc->driver_data;
     slot->flags = desc->flags;
     slot->scanned_partitions = 0;
+    /* A partition forwards to its parent and shares the parent's queue. */
+    if (!(slot->flags & BLOCKDEV_FLAG_PARTITION) && blkqueue_attach(slot) < 0)
+        klog_warn("blockdev: no request queue; driver called directly");
 
     if (out_dev)
         *out_dev = slot;
@@ -107,9 +128,15 @@ int blockdev_unregister(const char *name)
     {
         if (!str_equals(device_table[i].name, name))
             continue;
+        /* The cache keys blocks by device pointer, and the table is about to shift. */
+        bcache_sync(NULL);
+        bcache_invalidate(NULL);
+        blkqueue_detach(&device_table[i]);
         if (i + 1 < device_count)
             memmove(&device_table[i], &device_table[i + 1], (device_count - i - 1) * sizeof(struct block_device));
         --device_count;
+        for (size_t j = i; j < device_count; ++j)
+            blkqueue_rebind(&device_table[j]);
         memset(&device_table[device_count], 0, sizeof(struct block_device));
         return 0;
     }
@@ -157,7 +184,9 @@ int blockdev_read(struct block_device *dev, uint64_t lba, uint32_t count, void *
         return -1;
     if (op_guard(dev, lba, count) < 0)
         return -1;
-    return dev->ops->read(dev, lba, count, buffer);
+    if (count == 0)
+        return 0;
+    return bcache_read(dev, lba, count, buffer);
 }
 
 int blockdev_write(struct block_device *dev, uint64_t lba, uint32_t count, const void *buffer)
@@ -168,7 +197,126 @@ int blockdev_write(struct block_device *dev, uint64_t lba, uint32_t count, const
         return -1;
     if (op_guard(dev, lba, count) < 0)
         return -1;
-    return dev->ops->write(dev, lba, count, buffer);
+    if (count == 0)
+        return 0;
+    return bcache_write(dev, lba, count, buffer);
+}
+
+int blockdev_submit(struct bio *bio)
+{
+    if (!bio || !bio->dev || !bio->buffer || bio->count == 0)
+        return -1;
+    struct block_device *dev = bio->dev;
+    if (!dev->ops)
+        return -1;
+    if (bio->op == BIO_READ ? !dev->ops->read : (bio->op != BIO_WRITE || !dev->ops->write))
+        return -1;
+    if (op_guard(dev, bio->lba, bio->count) < 0)
+        return -1;
+
+    /*
+     * The request goes under the cache: reads must see dirty cached data,
+     * writes replace it and keep stale disk reads out of it until they land.
+     */
+    bio->cache_bypass = 0;
+    if (bio->op == BIO_READ)
+    {
+        if (bcache_flush_range(dev, bio->lba, bio->count) < 0)
+            return -1;
+    }
+    else
+    {
+        bio->cache_bypass = (uint8_t)bcache_write_begin(dev, bio->lba, bio->count);
+    }
+    return blkqueue_submit(bio);
+}
+
+static void blockdev_io_acquire(struct block_device *dev)
+{
+    for (;;)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&io_lock, &flags);
+        if (!dev->io_busy)
+        {
+            dev->io_busy = 1;
+            spinlock_unlock_irqrestore(&io_lock, flags);
+            return;
+        }
+        struct process *self = process_current();
+        if (!self)
+        {
+            /* Only before the scheduler runs, when the holder cannot be preempted. */
+            spinlock_unlock_irqrestore(&io_lock, flags);
+            __asm__ __volatile__("pause");
+            continue;
+        }
+
+        struct blockdev_io_waiter waiter = { self, NULL, 0 };
+        struct blockdev_io_waiter **link = &dev->io_waiters;
+        while (*link)
+            link = &(*link)->next;
+        *link = &waiter;
+        spinlock_unlock_irqrestore(&io_lock, flags);
+
+        /* granted is only trusted under io_lock, which the releaser holds across the wake. */
+        for (;;)
+        {
+            process_block_current();
+            spinlock_lock_irqsave(&io_lock, &flags);
+            int granted = waiter.granted;
+            spinlock_unlock_irqrestore(&io_lock, flags);
+            if (granted)
+                return;
+        }
+    }
+}
+
+/* Hand the device straight to the oldest sleeper so a running thread cannot barge in. */
+static void blockdev_io_release(struct block_device *dev)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&io_lock, &flags);
+    struct blockdev_io_waiter *next = dev->io_waiters;
+    if (next)
+    {
+        dev->io_waiters = next->next;
+        next->granted = 1;
+        process_wake(next->proc);
+    }
+    else
+    {
+        dev->io_busy = 0;
+    }
+    spinlock_unlock_irqrestore(&io_lock, flags);
+}
+
+int blockdev_driver_io(struct block_device *dev, uint8_t op, uint64_t lba, uint32_t count, void *buffer)
+{
+    /* Partitions forward to their parent, which takes its own turn. */
+    int exclusive = !(dev->flags & BLOCKDEV_FLAG_PARTITION);
+    if (exclusive)
+        blockdev_io_acquire(dev);
+    int rc;
+    if (op == BIO_WRITE)
+        rc = dev->ops->write(dev, lba, count, buffer);
+    else
+        rc = dev->ops->read(dev, lba, count, buffer);
+    if (exclusive)
+        blockdev_io_release(dev);
+    return rc < 0 ? -1 : 0;
+}
+
+int blockdev_sync(struct block_device *dev)
+{
+    return bcache_sync(dev);
+}
+
+int blockdev_readahead(struct block_device *dev, uint64_t lba, uint32_t count)
+{
+    if (!dev || !dev->ops || !dev->ops->read)
+        return -1;
+    return bcache_readahead(dev, lba, count);
 }
 
 uint32_t blockdev_device_count(void)
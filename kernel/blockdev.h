@@ -16,11 +16,60 @@ enum blockdev_flags
 };
 
 struct block_device;
+struct blk_queue;
+struct process;
+struct blockdev_io_waiter;
+
+enum bio_op
+{
+    BIO_READ  = 0,
+    BIO_WRITE = 1
+};
+
+struct bio;
+/** Completion callback; may run in IRQ context and owns @p bio from then on. */
+typedef void (*bio_end_io_t)(struct bio *bio);
+
+/**
+ * One block transfer handed to blockdev_submit(). The caller owns the bio
+ * and its buffer until it completes: either end_io runs, or, when end_io is
+ * NULL, blockdev_wait() returns.
+ */
+struct bio
+{
+    struct block_device *dev;
+    uint64_t lba;
+    uint32_t count;
+    void *buffer;
+    uint8_t op;
+    volatile uint8_t done;
+    int status;
+    bio_end_io_t end_io;
+    void *private_data;
+    /* Set by blockdev_submit() on a write the buffer cache must hear the end of. */
+    uint8_t cache_bypass;
+    /* Queue-private: the sleeping waiter and the merge chain. */
+    struct process *waiter;
+    struct bio *next;
+};
+
+enum blockdev_elevator
+{
+    BLOCKDEV_ELEVATOR_FIFO     = 0,
+    /* LBA-sorted sweep; a request past its expiry is served first. */
+    BLOCKDEV_ELEVATOR_DEADLINE = 1
+};
 
 struct blockdev_ops
 {
     int (*read)(struct block_device *dev, uint64_t lba, uint32_t count, void *buffer);
     int (*write)(struct block_device *dev, uint64_t lba, uint32_t count, const void *buffer);
+    /**
+     * Optional: start @p bio and return at once, finishing it later with
+     * blockdev_complete() (typically from the IRQ handler). Drivers without
+     * it are driven synchronously through read/write, one request at a time.
+     */
+    int (*submit)(struct block_device *dev, struct bio *bio);
 };
 
 struct block_device
@@ -32,6 +81,11 @@ struct block_device
     void *driver_data;
     uint32_t flags;
     uint8_t scanned_partitions;
+    struct blk_queue *queue;
+    /* Held across each synchronous read/write call; drivers are not reentrant. */
+    uint8_t io_busy;
+    /* Threads sleeping until io_busy is handed to them, oldest first. */
+    struct blockdev_io_waiter *io_waiters;
 };
 
 struct blockdev_descriptor
@@ -51,6 +105,29 @@ struct block_device *blockdev_find(const char *name);
 size_t blockdev_enumerate(const struct block_device **out_array, size_t max_count);
 int blockdev_read(struct block_device *dev, uint64_t lba, uint32_t count, void *buffer);
 int blockdev_write(struct block_device *dev, uint64_t lba, uint32_t count, const void *buffer);
+void bio_init(struct bio *bio, struct block_device *dev, uint8_t op, uint64_t lba, uint32_t count, void *buffer);
+/**
+ * Run one synchronous read/write on the driver of @p dev. Callers take
+ * turns per device, sleeping while another thread is in the driver.
+ * @return 0, or -1 if the driver failed.
+ */
+int blockdev_driver_io(struct block_device *dev, uint8_t op, uint64_t lba, uint32_t count, void *buffer);
+/**
+ * Queue @p bio on its device without waiting. Adjacent requests in the same
+ * direction are merged into one driver transfer; the device's elevator
+ * picks the dispatch order. Blocks while the queue is full.
+ * @return 0 once queued, -1 for an invalid request.
+ */
+int blockdev_submit(struct bio *bio);
+/** Wait for a bio submitted without end_io. @return its status. */
+int blockdev_wait(struct bio *bio);
+/** Called by drivers (and the queue) when @p bio has finished. */
+void blockdev_complete(struct bio *bio, int status);
+int blockdev_set_elevator(struct block_device *dev, uint8_t elevator);
+/** Write back cached dirty blocks of @p dev, or of every device when NULL. */
+int blockdev_sync(struct block_device *dev);
+/** Hint that [lba, lba + count) will be read soon. */
+int blockdev_readahead(struct block_device *dev, uint64_t lba, uint32_t count);
 uint32_t blockdev_device_count(void);
 void blockdev_log_devices(void);
 
@@ -0,0 +1,139 @@
+#include "clock.h"
+
+#include "io.h"
+#include "klog.h"
+#include "spinlock.h"
+
+#define CPUID_EXT_MAX            0x80000000u
+#define CPUID_EXT_POWER          0x80000007u
+#define CPUID_EDX_INVARIANT_TSC  (1u << 8)
+
+/*
+ * The page is the single source of truth for both kernel and user readers,
+ * so a timestamp taken in a driver and one taken by a service through the
+ * page always compare correctly. It fills a page of its own so it could be
+ * mapped read-only into user space once paging exists.
+ */
+static union
+{
+    struct clock_time_page page;
+    uint8_t bytes[4096];
+} time_page __attribute__((aligned(4096)));
+
+static spinlock_t clock_lock;
+static int tsc_invariant = 0;
+
+static void clock_write_begin(uint32_t *flags)
+{
+    spinlock_lock_irqsave(&clock_lock, flags);
+    ++time_page.page.seq;
+    __asm__ __volatile__("" ::: "memory");
+}
+
+static void clock_write_end(uint32_t flags)
+{
+    __asm__ __volatile__("" ::: "memory");
+    ++time_page.page.seq;
+    spinlock_unlock_irqrestore(&clock_lock, flags);
+}
+
+static int clock_detect_invariant_tsc(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(CPUID_EXT_MAX, &eax, &ebx, &ecx, &edx);
+    if (eax < CPUID_EXT_POWER)
+        return 0;
+
+    cpuid(CPUID_EXT_POWER, &eax, &ebx, &ecx, &edx);
+    return (edx & CPUID_EDX_INVARIANT_TSC) ? 1 : 0;
+}
+
+void clock_init(void)
+{
+    spinlock_init_named(&clock_lock, "clock");
+    uint32_t flags;
+    clock_write_begin(&flags);
+
+    struct clock_time_page *page = &time_page.page;
+    page->flags = 0;
+    page->base_ns = 0;
+    page->coarse_ns = 0;
+    page->realtime_offset_ns = 0;
+    page->base_tsc = rdtsc();
+    page->ns_mult = tsc_ns_mult();
+    if (page->ns_mult)
+    {
+        page->flags |= CLOCK_PAGE_TSC;
+        tsc_invariant = clock_detect_invariant_tsc();
+        if (tsc_invariant)
+            page->flags |= CLOCK_PAGE_INVARIANT;
+    }
+
+    clock_write_end(flags);
+
+    if (!(page->flags & CLOCK_PAGE_TSC))
+        klog_warn("clock: no calibrated TSC; clocks advance per PIT tick");
+    else if (!tsc_invariant)
+        klog_warn("clock: TSC not invariant; rate may drift with CPU power states");
+}
+
+uint64_t clock_monotonic_ns(void)
+{
+    return clock_time_page_read(&time_page.page, CLOCK_MONOTONIC);
+}
+
+uint64_t clock_realtime_ns(void)
+{
+    return clock_time_page_read(&time_page.page, CLOCK_REALTIME);
+}
+
+void clock_set_realtime(uint64_t unix_ns)
+{
+    uint64_t now = clock_monotonic_ns();
+    uint32_t flags;
+    clock_write_begin(&flags);
+    time_page.page.realtime_offset_ns = (unix_ns > now) ? unix_ns - now : 0;
+    time_page.page.flags |= CLOCK_PAGE_REALTIME;
+    clock_write_end(flags);
+}
+
+int clock_realtime_valid(void)
+{
+    return (time_page.page.flags & CLOCK_PAGE_REALTIME) ? 1 : 0;
+}
+
+int clock_tsc_invariant(void)
+{
+    return tsc_invariant;
+}
+
+const char *clock_source_name(void)
+{
+    if (!(time_page.page.flags & CLOCK_PAGE_TSC))
+        return "pit";
+    return tsc_invariant ? "tsc-invariant" : "tsc";
+}
+
+uint64_t clock_monotonic_to_tsc(uint64_t ns)
+{
+    const struct clock_time_page *page = &time_page.page;
+    uint64_t delta = (ns > page->base_ns) ? ns - page->base_ns : 0;
+    return page->base_tsc + tsc_from_ns(delta);
+}
+
+void clock_tick(uint64_t ticks, uint32_t tick_ns)
+{
+    /* The TSC path never looks at coarse_ns; leave the sequence alone. */
+    if (time_page.page.flags & CLOCK_PAGE_TSC)
+        return;
+
+    uint32_t flags;
+    clock_write_begin(&flags);
+    time_page.page.coarse_ns = ticks * (uint64_t)tick_ns;
+    clock_write_end(flags);
+}
+
+const struct clock_time_page *clock_time_page(void)
+{
+    return &time_page.page;
+}
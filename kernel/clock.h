@@ -0,0 +1,90 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#include "tsc.h"
+
+#define CLOCK_MONOTONIC 0u
+#define CLOCK_REALTIME  1u
+
+#define CLOCK_PAGE_TSC       (1u << 0)
+#define CLOCK_PAGE_INVARIANT (1u << 1)
+#define CLOCK_PAGE_REALTIME  (1u << 2)
+
+/**
+ * @brief Clock parameters shared with user code.
+ *
+ * The kernel rewrites the page under a sequence count: @c seq is odd while
+ * an update is in progress, so readers retry until they see the same even
+ * value before and after copying the fields. With @c CLOCK_PAGE_TSC set,
+ * monotonic time is @c base_ns plus the TSC delta from @c base_tsc scaled
+ * by @c ns_mult (32.32 fixed point); otherwise @c coarse_ns, refreshed
+ * every PIT tick, is the best available value.
+ */
+struct clock_time_page
+{
+    volatile uint32_t seq;
+    uint32_t flags;
+    uint64_t base_tsc;
+    uint64_t base_ns;
+    uint64_t ns_mult;
+    uint64_t coarse_ns;
+    /** Added to monotonic time to get nanoseconds since the Unix epoch. */
+    uint64_t realtime_offset_ns;
+};
+
+/**
+ * @brief Pick the clock source and publish the time page.
+ *
+ * Call after tsc_calibrate() and before anything reads the clock.
+ */
+void clock_init(void);
+/** Nanoseconds since clock_init(); never goes backwards. */
+uint64_t clock_monotonic_ns(void);
+/** Nanoseconds since the Unix epoch, or since boot until the RTC seeds it. */
+uint64_t clock_realtime_ns(void);
+/** Step the wall clock so clock_realtime_ns() reads @p unix_ns now. */
+void clock_set_realtime(uint64_t unix_ns);
+/** @return 1 once clock_set_realtime() has run. */
+int clock_realtime_valid(void);
+/** @return 1 when CPUID reports an invariant (constant-rate) TSC. */
+int clock_tsc_invariant(void);
+/** @return the clock source name shown by diagnostics. */
+const char *clock_source_name(void);
+/** Convert a clock_monotonic_ns() value to the TSC count it occurs at. */
+uint64_t clock_monotonic_to_tsc(uint64_t ns);
+/** Refresh the tick-driven fallback; called from the PIT handler. */
+void clock_tick(uint64_t ticks, uint32_t tick_ns);
+/** @return the shared page; user code must treat it as read-only. */
+const struct clock_time_page *clock_time_page(void);
+
+/** Lock-free read of @p clock_id from a time page, as done by user code. */
+static inline uint64_t clock_time_page_read(const struct clock_time_page *page, uint32_t clock_id)
+{
+    uint32_t seq;
+    uint64_t now;
+    uint64_t offset;
+    do
+    {
+        seq = page->seq;
+        __asm__ __volatile__("" ::: "memory");
+        if (page->flags & CLOCK_PAGE_TSC)
+        {
+            uint32_t low, high;
+            __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+            uint64_t tsc = ((uint64_t)high << 32) | low;
+            now = page->base_ns + mul_u64_u64_shr32(tsc - page->base_tsc, page->ns_mult);
+        }
+        else
+        {
+            now = page->coarse_ns;
+        }
+        offset = page->realtime_offset_ns;
+        __asm__ __volatile__("" ::: "memory");
+    } while ((seq & 1u) || seq != page->seq);
+
+    return (clock_id == CLOCK_REALTIME) ? now + offset : now;
+}
+
+#endif
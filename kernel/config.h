@@ -8,10 +8,14 @@
  */
 #define CONFIG_MAX_PROCS          32
 #define CONFIG_PROC_STACK_SIZE    4096
+#define CONFIG_PROC_STACK_MIN     1024
+#define CONFIG_PROC_STACK_MAX     65536
 #define CONFIG_MSG_QUEUE_LEN      16
 #define CONFIG_MSG_DATA_MAX       256
 #define CONFIG_IPC_MAX_CHANNELS   32
-#define CONFIG_IPC_CHANNEL_QUEUE_LEN 32
+/* One kalloc page: 15 largest messages, far more small ones. */
+#define CONFIG_IPC_CHANNEL_DEFAULT_BYTES CONFIG_IPC_PAGE_SIZE
+#define CONFIG_IPC_CHANNEL_MAX_BYTES 65536
 #define CONFIG_IPC_CHANNEL_NAME_MAX 32
 #define CONFIG_IPC_CHANNEL_SUBSCRIBERS 8
 #define CONFIG_IPC_CHANNEL_WAITERS 8
@@ -28,6 +32,16 @@
 #define CONFIG_KLOG_MODULE_NAME_LEN 24
 #define CONFIG_KLOG_MAX_MODULES   32
 
+#define CONFIG_MEM_MAX_ORDER      11
+#define CONFIG_SLAB_MAX_CACHES    16
+#define CONFIG_SLAB_CACHE_LINE    64
+
+#define CONFIG_TIMER_WHEEL_BITS   6
+#define CONFIG_TIMER_WHEEL_LEVELS 4
+#define CONFIG_TIMER_HZ           250
+#define CONFIG_TICKLESS_IDLE      1
+#define CONFIG_TICKLESS_MAX_IDLE_TICKS 250
+
 #define CONFIG_CONSOLE_MAX_ROWS    64
 #define CONFIG_CONSOLE_MAX_COLS    160
 
@@ -37,10 +51,59 @@
 #define CONFIG_SCHED_MIN_PRIORITY        0
 #define CONFIG_SCHED_BASE_WEIGHT         1024u
 #define CONFIG_SCHED_DEFAULT_WEIGHT      1024u
+#define CONFIG_SCHED_DEADLINE_MAX_UTIL   90
+/* Reservation given to deadline tasks that ask for none: percent of the period, default period. */
+#define CONFIG_SCHED_DEADLINE_DEFAULT_UTIL   10u
+#define CONFIG_SCHED_DEADLINE_DEFAULT_PERIOD (CONFIG_TIMER_HZ / 10u)
+/* New threads stay on the boot CPU until they opt in with an affinity mask. */
+#define CONFIG_SCHED_DEFAULT_AFFINITY    0x1u
+/* CPUs sys_sched_affinity may grant: IPC and VFS syscalls still assume the boot CPU. */
+#define CONFIG_SCHED_SYSCALL_AFFINITY    0x1u
+#define CONFIG_SCHED_STEAL_SCAN          8
+
+#define CONFIG_MAX_CPUS                  8
+#define CONFIG_SMP_AP_STACK_SIZE         8192
+#define CONFIG_SMP_TRAMPOLINE_BASE       0x8000u
 
 #define CONFIG_SYNC_MAX_MUTEXES          32
 #define CONFIG_SYNC_MAX_SEMAPHORES       32
-#define CONFIG_SYNC_MAX_WAITERS          8
+/* How many owners a mutex waiter's priority is passed along. */
+#define CONFIG_SYNC_PI_MAX_DEPTH         4
+/* Hash buckets for futex wait queues, each with its own lock. */
+#define CONFIG_FUTEX_BUCKETS             64
+
+/* Tasklets one interrupt exit may run before the rest go to the high-priority worker. */
+#define CONFIG_TASKLET_IRQ_BUDGET        8
+
+/* Event sets in the system, and sources each one can watch. */
+#define CONFIG_EVSET_MAX                 16
+#define CONFIG_EVSET_MAX_SOURCES         16
+
+/* Processes that may hold a submission/completion ring pair, and its largest submission ring. */
+#define CONFIG_URING_MAX                 16
+#define CONFIG_URING_MAX_ENTRIES         256
+
+/* Block buffer cache: memory budget, cached block size, hash buckets (power of two). */
+#define CONFIG_BCACHE_BYTES              (256u * 1024u)
+#define CONFIG_BCACHE_BLOCK_SIZE         512u
+#define CONFIG_BCACHE_HASH_BUCKETS       128u
+/* Larger requests skip the cache; sequential reads prefetch this many blocks. */
+#define CONFIG_BCACHE_BYPASS_BLOCKS      64u
+#define CONFIG_BCACHE_READAHEAD          8u
+/* Dirty blocks are written back at least this often (PIT ticks). */
+#define CONFIG_BCACHE_WRITEBACK_TICKS    (CONFIG_TIMER_HZ * 5u)
+
+/* Block request queues: requests queued or in flight per device, largest merged transfer. */
+#define CONFIG_BLKQUEUE_DEPTH            32u
+#define CONFIG_BLKQUEUE_MAX_MERGE_BLOCKS 128u
+/* Default elevator (0 = FIFO, 1 = deadline) and how long each direction may wait (PIT ticks). */
+#define CONFIG_BLKQUEUE_ELEVATOR         1u
+#define CONFIG_BLKQUEUE_READ_EXPIRE      (CONFIG_TIMER_HZ / 2u)
+#define CONFIG_BLKQUEUE_WRITE_EXPIRE     (CONFIG_TIMER_HZ * 5u)
+
+/* Per-class lock statistics for the `locks` report; two TSC reads per acquisition. */
+#define CONFIG_LOCK_STATS         1
+#define CONFIG_LOCK_REPORT_MAX    32
 
 #define CONFIG_STRESS_SPIN_CYCLES 5000
 
@@ -3,11 +3,25 @@
 #include "debug.h"
 
 #include "memory.h"
+#include "slab.h"
 #include "proc.h"
 #include "devmgr.h"
 #include "vfs.h"
 #include "klog.h"
 #include "interrupts.h"
+#include "pit.h"
+#include "timer.h"
+#include "hrtimer.h"
+#include "workqueue.h"
+#include "clock.h"
+#include "apic.h"
+#include "tsc.h"
+#include "spinlock.h"
+#include "sync.h"
+#include "ipc.h"
+#include "syscall.h"
+#include "bcache.h"
+#include "blkqueue.h"
 
 #include <stddef.h>
 #include <stdint.h>
@@ -55,6 +69,23 @@ static void append_decimal(char *dst, size_t *pos, size_t cap, uint32_t value)
     }
 }
 
+static void append_decimal64(char *dst, size_t *pos, size_t cap, uint64_t value)
+{
+    char tmp[24];
+    size_t idx = 0;
+    do
+    {
+        uint32_t digit;
+        value = div_u64_u32(value, 10u, &digit);
+        tmp[idx++] = (char)('0' + digit);
+    } while (value > 0 && idx < sizeof(tmp));
+    while (idx > 0 && *pos + 1 < cap)
+    {
+        dst[*pos] = tmp[--idx];
+        ++(*pos);
+    }
+}
+
 static void append_hex32(char *dst, size_t *pos, size_t cap, uint32_t value)
 {
     const char digits[] = "0123456789ABCDEF";
@@ -90,7 +121,7 @@ static inline void debug_write_dr7(uint32_t value)
 
 void debug_publish_memory_info(void)
 {
-    char buffer[256];
+    char buffer[640];
     size_t pos = 0;
 
     append_text(buffer, &pos, sizeof(buffer), "Memory Statistics\n");
@@ -100,7 +131,9 @@ void debug_publish_memory_info(void)
     uint32_t free_space = (uint32_t)memory_free_bytes();
     uint32_t base = (uint32_t)memory_heap_base();
     uint32_t limit = (uint32_t)memory_heap_limit();
-    uint32_t cursor = base + used;
+
+    struct memory_stats stats;
+    memory_get_stats(&stats);
 
     append_text(buffer, &pos, sizeof(buffer), "total_bytes: ");
     append_decimal(buffer, &pos, sizeof(buffer), total);
@@ -124,14 +157,32 @@ void debug_publish_memory_info(void)
     append_hex32(buffer, &pos, sizeof(buffer), base);
     append_newline(buffer, &pos, sizeof(buffer));
 
-    append_text(buffer, &pos, sizeof(buffer), "heap_cursor: ");
-    append_hex32(buffer, &pos, sizeof(buffer), cursor);
-    append_newline(buffer, &pos, sizeof(buffer));
-
     append_text(buffer, &pos, sizeof(buffer), "heap_limit:  ");
     append_hex32(buffer, &pos, sizeof(buffer), limit);
     append_newline(buffer, &pos, sizeof(buffer));
 
+    append_text(buffer, &pos, sizeof(buffer), "map_entries: ");
+    append_decimal(buffer, &pos, sizeof(buffer), stats.map_entries);
+    append_newline(buffer, &pos, sizeof(buffer));
+
+    append_text(buffer, &pos, sizeof(buffer), "fragmentation: ");
+    append_decimal(buffer, &pos, sizeof(buffer), stats.fragmentation_pct);
+    append_text(buffer, &pos, sizeof(buffer), "%\n");
+
+    append_text(buffer, &pos, sizeof(buffer), "alloc_failures: ");
+    append_decimal(buffer, &pos, sizeof(buffer), stats.alloc_failures);
+    append_newline(buffer, &pos, sizeof(buffer));
+
+    append_text(buffer, &pos, sizeof(buffer), "free_blocks (order:count):");
+    for (uint32_t order = 0; order < MEMORY_MAX_ORDER; ++order)
+    {
+        append_char(buffer, &pos, sizeof(buffer), ' ');
+        append_decimal(buffer, &pos, sizeof(buffer), order);
+        append_char(buffer, &pos, sizeof(buffer), ':');
+        append_decimal(buffer, &pos, sizeof(buffer), stats.free_blocks[order]);
+    }
+    append_newline(buffer, &pos, sizeof(buffer));
+
     if (pos >= sizeof(buffer))
         pos = sizeof(buffer) - 1;
     buffer[pos] = '\0';
@@ -139,6 +190,282 @@ void debug_publish_memory_info(void)
     vfs_write_file("/System/meminfo", buffer, pos);
 }
 
+void debug_publish_slab_info(void)
+{
+    struct kmem_cache_info caches[CONFIG_SLAB_MAX_CACHES];
+    size_t count = kmem_cache_snapshot(caches, CONFIG_SLAB_MAX_CACHES);
+
+    vfs_write_file("/System/slabinfo", NULL, 0);
+
+    char line[160];
+    size_t pos = 0;
+    append_text(line, &pos, sizeof(line), "NAME SIZE STRIDE PER_SLAB SLABS ACTIVE TOTAL HITS MISSES FAIL\n");
+    vfs_append("/System/slabinfo", line, pos);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct kmem_cache_info *info = &caches[i];
+        pos = 0;
+        append_text(line, &pos, sizeof(line), info->name);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->object_size);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->stride);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->objects_per_slab);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->slabs);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->active_objects);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->total_objects);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->hits);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->misses);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->failures);
+        append_newline(line, &pos, sizeof(line));
+        if (pos >= sizeof(line))
+            pos = sizeof(line) - 1;
+        line[pos] = '\0';
+        vfs_append("/System/slabinfo", line, pos);
+    }
+}
+
+void debug_publish_timer_info(void)
+{
+    static const char *const work_names[WORK_PRIORITY_COUNT] = { "high", "normal", "low" };
+    char buffer[768];
+    size_t pos = 0;
+
+    struct timer_stats wheel;
+    struct hrtimer_stats hr;
+    struct pit_idle_stats idle;
+    struct workqueue_stats work;
+    timer_get_stats(&wheel);
+    hrtimer_get_stats(&hr);
+    pit_get_idle_stats(&idle);
+    workqueue_get_stats(&work);
+
+    append_text(buffer, &pos, sizeof(buffer), "event_source: ");
+    append_text(buffer, &pos, sizeof(buffer), lapic_timer_mode_name());
+    append_text(buffer, &pos, sizeof(buffer), "\ntick_hz:      ");
+    append_decimal(buffer, &pos, sizeof(buffer), pit_frequency());
+    append_text(buffer, &pos, sizeof(buffer), "\ntsc_khz:      ");
+    append_decimal(buffer, &pos, sizeof(buffer), tsc_khz());
+    append_text(buffer, &pos, sizeof(buffer), "\napic_khz:     ");
+    append_decimal(buffer, &pos, sizeof(buffer), lapic_timer_khz());
+    append_text(buffer, &pos, sizeof(buffer), "\ntickless:     ");
+    append_text(buffer, &pos, sizeof(buffer), pit_tickless_available() ? "yes" : "no");
+    append_text(buffer, &pos, sizeof(buffer), "\nclocksource:  ");
+    append_text(buffer, &pos, sizeof(buffer), clock_source_name());
+    append_text(buffer, &pos, sizeof(buffer), "\nrealtime:     ");
+    append_text(buffer, &pos, sizeof(buffer), clock_realtime_valid() ? "rtc" : "unset");
+
+    append_text(buffer, &pos, sizeof(buffer), "\nwheel:   pending ");
+    append_decimal(buffer, &pos, sizeof(buffer), wheel.pending);
+    append_text(buffer, &pos, sizeof(buffer), " fired ");
+    append_decimal(buffer, &pos, sizeof(buffer), wheel.fired);
+    append_text(buffer, &pos, sizeof(buffer), " cancelled ");
+    append_decimal(buffer, &pos, sizeof(buffer), wheel.cancelled);
+    append_text(buffer, &pos, sizeof(buffer), " cascaded ");
+    append_decimal(buffer, &pos, sizeof(buffer), wheel.cascaded);
+
+    append_text(buffer, &pos, sizeof(buffer), "\nhrtimer: pending ");
+    append_decimal(buffer, &pos, sizeof(buffer), hr.pending);
+    append_text(buffer, &pos, sizeof(buffer), " fired ");
+    append_decimal(buffer, &pos, sizeof(buffer), hr.fired);
+    append_text(buffer, &pos, sizeof(buffer), " cancelled ");
+    append_decimal(buffer, &pos, sizeof(buffer), hr.cancelled);
+    append_text(buffer, &pos, sizeof(buffer), " programmed ");
+    append_decimal(buffer, &pos, sizeof(buffer), hr.programmed);
+    append_text(buffer, &pos, sizeof(buffer), " max_late_ns ");
+    append_decimal(buffer, &pos, sizeof(buffer), hr.max_late_ns);
+
+    append_text(buffer, &pos, sizeof(buffer), "\nidle:    ticks_taken ");
+    append_decimal(buffer, &pos, sizeof(buffer), idle.periodic_ticks);
+    append_text(buffer, &pos, sizeof(buffer), " ticks_skipped ");
+    append_decimal(buffer, &pos, sizeof(buffer), idle.skipped_ticks);
+    append_text(buffer, &pos, sizeof(buffer), " tickless ");
+    append_decimal(buffer, &pos, sizeof(buffer), idle.tickless_entries);
+    append_text(buffer, &pos, sizeof(buffer), " periodic ");
+    append_decimal(buffer, &pos, sizeof(buffer), idle.periodic_halts);
+
+    append_text(buffer, &pos, sizeof(buffer), "\ntasklet: scheduled ");
+    append_decimal(buffer, &pos, sizeof(buffer), work.tasklets_scheduled);
+    append_text(buffer, &pos, sizeof(buffer), " run ");
+    append_decimal(buffer, &pos, sizeof(buffer), work.tasklets_run);
+    append_text(buffer, &pos, sizeof(buffer), " deferred ");
+    append_decimal(buffer, &pos, sizeof(buffer), work.tasklets_deferred);
+    append_text(buffer, &pos, sizeof(buffer), "\nwork:    workers ");
+    append_decimal(buffer, &pos, sizeof(buffer), work.workers);
+    for (uint32_t i = 0; i < WORK_PRIORITY_COUNT; ++i)
+    {
+        append_text(buffer, &pos, sizeof(buffer), " ");
+        append_text(buffer, &pos, sizeof(buffer), work_names[i]);
+        append_text(buffer, &pos, sizeof(buffer), " ");
+        append_decimal(buffer, &pos, sizeof(buffer), work.completed[i]);
+        append_text(buffer, &pos, sizeof(buffer), "/");
+        append_decimal(buffer, &pos, sizeof(buffer), work.queued[i]);
+    }
+    append_newline(buffer, &pos, sizeof(buffer));
+
+    if (pos >= sizeof(buffer))
+        pos = sizeof(buffer) - 1;
+    buffer[pos] = '\0';
+
+    vfs_write_file("/System/timers", buffer, pos);
+}
+
+static uint64_t average_u64(uint64_t total, uint64_t count)
+{
+    /* Scale both down until the divisor fits div_u64_u32(). */
+    while (count > 0xFFFFFFFFull)
+    {
+        total >>= 1;
+        count >>= 1;
+    }
+    return count ? div_u64_u32(total, (uint32_t)count, NULL) : 0;
+}
+
+void debug_publish_lock_info(void)
+{
+    struct lock_class_stats *stats = (struct lock_class_stats *)kalloc(sizeof(struct lock_class_stats) * CONFIG_LOCK_REPORT_MAX);
+    if (!stats)
+        return;
+    size_t count = lock_class_snapshot(stats, CONFIG_LOCK_REPORT_MAX);
+
+    vfs_write_file("/System/locks", NULL, 0);
+
+    char line[160];
+    size_t pos = 0;
+    append_text(line, &pos, sizeof(line), "NAME KIND INST ACQUIRED CONTENDED SPIN(avg/max) HOLD(avg/max) cycles\n");
+    vfs_append("/System/locks", line, pos);
+
+    for (size_t i = 0; i < count && i < CONFIG_LOCK_REPORT_MAX; ++i)
+    {
+        const struct lock_class_stats *entry = &stats[i];
+        pos = 0;
+        append_text(line, &pos, sizeof(line), entry->name);
+        append_text(line, &pos, sizeof(line), (entry->kind == LOCK_KIND_MCS) ? " mcs " : " ticket ");
+        append_decimal(line, &pos, sizeof(line), entry->instances);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), entry->acquisitions);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), entry->contended);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), average_u64(entry->spin_cycles, entry->contended));
+        append_char(line, &pos, sizeof(line), '/');
+        append_decimal64(line, &pos, sizeof(line), entry->max_spin_cycles);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), average_u64(entry->hold_cycles, entry->acquisitions));
+        append_char(line, &pos, sizeof(line), '/');
+        append_decimal64(line, &pos, sizeof(line), entry->max_hold_cycles);
+        append_newline(line, &pos, sizeof(line));
+        if (pos >= sizeof(line))
+            pos = sizeof(line) - 1;
+        line[pos] = '\0';
+        vfs_append("/System/locks", line, pos);
+    }
+
+    if (count > CONFIG_LOCK_REPORT_MAX)
+    {
+        pos = 0;
+        append_text(line, &pos, sizeof(line), "(");
+        append_decimal(line, &pos, sizeof(line), (uint32_t)(count - CONFIG_LOCK_REPORT_MAX));
+        append_text(line, &pos, sizeof(line), " more classes not shown)\n");
+        vfs_append("/System/locks", line, pos);
+    }
+    kfree(stats);
+}
+
+static void append_us_pair(char *dst, size_t *pos, size_t cap, uint64_t total_ns, uint32_t count, uint64_t max_ns)
+{
+    uint64_t avg = count ? div_u64_u32(total_ns, count, NULL) : 0;
+    append_decimal64(dst, pos, cap, div_u64_u32(avg, 1000u, NULL));
+    append_char(dst, pos, cap, '/');
+    append_decimal64(dst, pos, cap, div_u64_u32(max_ns, 1000u, NULL));
+}
+
+void debug_publish_sync_info(void)
+{
+    struct sync_mutex_stats *stats = (struct sync_mutex_stats *)kalloc(sizeof(struct sync_mutex_stats) * CONFIG_SYNC_MAX_MUTEXES);
+    if (!stats)
+        return;
+    size_t count = sync_mutex_snapshot(stats, CONFIG_SYNC_MAX_MUTEXES);
+
+    vfs_write_file("/System/sync", NULL, 0);
+
+    char line[128];
+    size_t pos = 0;
+    append_text(line, &pos, sizeof(line), "MUTEX OWNER WAITERS ACQUIRED CONTENDED WAIT_us(avg/max) HOLD_us(avg/max)\n");
+    vfs_append("/System/sync", line, pos);
+
+    for (size_t i = 0; i < count && i < CONFIG_SYNC_MAX_MUTEXES; ++i)
+    {
+        const struct sync_mutex_stats *entry = &stats[i];
+        pos = 0;
+        append_decimal(line, &pos, sizeof(line), (uint32_t)entry->id);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), (uint32_t)entry->owner);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->waiters);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->acquisitions);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->contended);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_us_pair(line, &pos, sizeof(line), entry->wait_ns, entry->contended, entry->max_wait_ns);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_us_pair(line, &pos, sizeof(line), entry->hold_ns, entry->acquisitions, entry->max_hold_ns);
+        append_newline(line, &pos, sizeof(line));
+        if (pos >= sizeof(line))
+            pos = sizeof(line) - 1;
+        line[pos] = '\0';
+        vfs_append("/System/sync", line, pos);
+    }
+    kfree(stats);
+}
+
+void debug_publish_channel_info(void)
+{
+    struct ipc_channel_stats *stats = (struct ipc_channel_stats *)kalloc(sizeof(struct ipc_channel_stats) * CONFIG_IPC_MAX_CHANNELS);
+    if (!stats)
+        return;
+    size_t count = ipc_channel_snapshot(stats, CONFIG_IPC_MAX_CHANNELS);
+
+    vfs_write_file("/System/channels", NULL, 0);
+
+    char line[128];
+    size_t pos = 0;
+    append_text(line, &pos, sizeof(line), "ID NAME MODE SUBS BYTES USED PEAK QUEUED MESSAGES DROPS BLOCKED OVERRUNS\n");
+    vfs_append("/System/channels", line, pos);
+
+    for (size_t i = 0; i < count && i < CONFIG_IPC_MAX_CHANNELS; ++i)
+    {
+        const struct ipc_channel_stats *entry = &stats[i];
+        const uint32_t values[9] = { entry->subscribers, entry->capacity, entry->used, entry->high_water, entry->queued,
+                                     entry->messages, entry->drops, entry->blocked_senders, entry->overruns };
+        pos = 0;
+        append_decimal(line, &pos, sizeof(line), (uint32_t)entry->id);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_text(line, &pos, sizeof(line), entry->name[0] ? entry->name : "-");
+        append_text(line, &pos, sizeof(line), entry->broadcast ? " bcast" : " queue");
+        for (size_t v = 0; v < 9; ++v)
+        {
+            append_char(line, &pos, sizeof(line), ' ');
+            append_decimal(line, &pos, sizeof(line), values[v]);
+        }
+        append_newline(line, &pos, sizeof(line));
+        if (pos >= sizeof(line))
+            pos = sizeof(line) - 1;
+        line[pos] = '\0';
+        vfs_append("/System/channels", line, pos);
+    }
+    kfree(stats);
+}
+
 static const char *state_name(proc_state_t state)
 {
     switch (state)
@@ -159,14 +486,16 @@ static const char *state_name(proc_state_t state)
 
 void debug_publish_task_list(void)
 {
-    struct process_info info[MAX_PROCS];
+    struct process_info *info = (struct process_info *)kalloc(sizeof(struct process_info) * MAX_PROCS);
+    if (!info)
+        return;
     size_t count = process_snapshot(info, MAX_PROCS);
 
     vfs_write_file("/System/tasks", NULL, 0);
 
     char line[160];
     size_t pos = 0;
-    append_text(line, &pos, sizeof(line), "PID STATE    KIND PRI(base/dyn) REM TICKS WAKE STACK ESP\n");
+    append_text(line, &pos, sizeof(line), "PID STATE    KIND PRI(base/dyn) REM TICKS WAKE STACK ESP CBS(q/Q/T) MISS OVR\n");
     vfs_append("/System/tasks", line, pos);
 
     for (size_t i = 0; i < count; ++i)
@@ -190,15 +519,328 @@ void debug_publish_task_list(void)
         append_char(line, &pos, sizeof(line), ' ');
         append_decimal(line, &pos, sizeof(line), (uint32_t)entry->wake_deadline);
         append_char(line, &pos, sizeof(line), ' ');
-        append_hex32(line, &pos, sizeof(line), (uint32_t)(entry->stack_pointer + entry->stack_size));
+        append_hex32(line, &pos, sizeof(line), (uint32_t)(entry->stack_base + entry->stack_size));
         append_char(line, &pos, sizeof(line), ' ');
         append_hex32(line, &pos, sizeof(line), (uint32_t)entry->stack_pointer);
+        append_char(line, &pos, sizeof(line), ' ');
+        if (entry->cbs_runtime)
+        {
+            append_decimal(line, &pos, sizeof(line), entry->cbs_budget);
+            append_char(line, &pos, sizeof(line), '/');
+            append_decimal(line, &pos, sizeof(line), entry->cbs_runtime);
+            append_char(line, &pos, sizeof(line), '/');
+            append_decimal(line, &pos, sizeof(line), entry->cbs_period);
+        }
+        else
+        {
+            append_char(line, &pos, sizeof(line), '-');
+        }
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->deadline_misses);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->budget_overruns);
         append_newline(line, &pos, sizeof(line));
         if (pos >= sizeof(line))
             pos = sizeof(line) - 1;
         line[pos] = '\0';
         vfs_append("/System/tasks", line, pos);
     }
+    kfree(info);
+}
+
+static void append_ms(char *dst, size_t *pos, size_t cap, uint64_t ns)
+{
+    append_decimal64(dst, pos, cap, div_u64_u32(ns, 1000000u, NULL));
+}
+
+static void append_latency_bucket(char *dst, size_t *pos, size_t cap, uint32_t bucket)
+{
+    if (bucket + 1u < SCHED_LATENCY_BUCKETS)
+    {
+        append_text(dst, pos, cap, "<");
+        append_decimal(dst, pos, cap, (1u << (SCHED_LATENCY_SHIFT + bucket)) / 1000u);
+    }
+    else
+    {
+        append_text(dst, pos, cap, ">=");
+        append_decimal(dst, pos, cap, (1u << (SCHED_LATENCY_SHIFT + bucket - 1u)) / 1000u);
+    }
+    append_text(dst, pos, cap, "us");
+}
+
+void debug_publish_sched_info(void)
+{
+    static const char path[] = "/System/Sched";
+    char line[160];
+    size_t pos = 0;
+
+    vfs_write_file(path, NULL, 0);
+    append_text(line, &pos, sizeof(line), "CPU PID SWITCHES HANDOFFS IDLE_ms READY STEALS\n");
+    vfs_append(path, line, pos);
+    for (uint32_t cpu = 0; cpu < CONFIG_MAX_CPUS; ++cpu)
+    {
+        struct sched_cpu_stats stats;
+        process_cpu_stats(cpu, &stats);
+        if (!stats.online)
+            continue;
+        pos = 0;
+        append_decimal(line, &pos, sizeof(line), cpu);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), (uint32_t)stats.current_pid);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), stats.context_switches);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), stats.handoffs);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_ms(line, &pos, sizeof(line), stats.idle_ns);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), stats.nr_ready);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), stats.steals);
+        append_newline(line, &pos, sizeof(line));
+        vfs_append(path, line, pos);
+    }
+
+    uint32_t hist[SCHED_LATENCY_BUCKETS];
+    process_wake_latency_histogram(hist);
+    pos = 0;
+    append_text(line, &pos, sizeof(line), "\nwake-to-run latency:\n");
+    vfs_append(path, line, pos);
+    for (uint32_t b = 0; b < SCHED_LATENCY_BUCKETS; ++b)
+    {
+        if (!hist[b])
+            continue;
+        pos = 0;
+        append_text(line, &pos, sizeof(line), "  ");
+        append_latency_bucket(line, &pos, sizeof(line), b);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), hist[b]);
+        append_newline(line, &pos, sizeof(line));
+        vfs_append(path, line, pos);
+    }
+
+    struct process_info *info = (struct process_info *)kalloc(sizeof(struct process_info) * MAX_PROCS);
+    if (!info)
+        return;
+    size_t count = process_snapshot(info, MAX_PROCS);
+
+    pos = 0;
+    append_text(line, &pos, sizeof(line), "\nPID STATE CPU RUN_ms WAIT_ms VCSW ICSW WAKEUPS LAT(avg/max)us\n");
+    vfs_append(path, line, pos);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct process_info *entry = &info[i];
+        pos = 0;
+        append_decimal(line, &pos, sizeof(line), (uint32_t)entry->pid);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_text(line, &pos, sizeof(line), state_name(entry->state));
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->cpu);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_ms(line, &pos, sizeof(line), entry->run_ns);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_ms(line, &pos, sizeof(line), entry->wait_ns);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->voluntary_switches);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->involuntary_switches);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->wakeups);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), entry->wake_latency_avg_ns / 1000u);
+        append_char(line, &pos, sizeof(line), '/');
+        append_decimal(line, &pos, sizeof(line), entry->wake_latency_max_ns / 1000u);
+        append_newline(line, &pos, sizeof(line));
+        vfs_append(path, line, pos);
+    }
+    kfree(info);
+}
+
+static void append_syscall_bucket(char *dst, size_t *pos, size_t cap, uint32_t bucket)
+{
+    if (bucket + 1u < SYSCALL_LATENCY_BUCKETS)
+    {
+        append_text(dst, pos, cap, "<");
+        append_decimal(dst, pos, cap, 1u << (SYSCALL_LATENCY_SHIFT + bucket));
+    }
+    else
+    {
+        append_text(dst, pos, cap, ">=");
+        append_decimal(dst, pos, cap, 1u << (SYSCALL_LATENCY_SHIFT + bucket - 1u));
+    }
+}
+
+void debug_publish_syscall_info(void)
+{
+    static const char path[] = "/System/Syscalls";
+    struct syscall_stats *stats = (struct syscall_stats *)kalloc(sizeof(struct syscall_stats) * SYSCALL_TABLE_SIZE);
+    if (!stats)
+        return;
+    size_t count = syscall_stats_snapshot(stats, SYSCALL_TABLE_SIZE);
+
+    vfs_write_file(path, NULL, 0);
+
+    char line[320];
+    size_t pos = 0;
+    append_text(line, &pos, sizeof(line), "NR NAME CALLS ERRORS CYCLES(avg/max)\n");
+    vfs_append(path, line, pos);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct syscall_stats *entry = &stats[i];
+        pos = 0;
+        append_decimal(line, &pos, sizeof(line), entry->number);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_text(line, &pos, sizeof(line), entry->name ? entry->name : "-");
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), entry->calls);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), entry->errors);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), average_u64(entry->cycles, entry->calls));
+        append_char(line, &pos, sizeof(line), '/');
+        append_decimal64(line, &pos, sizeof(line), entry->max_cycles);
+        append_newline(line, &pos, sizeof(line));
+        vfs_append(path, line, pos);
+    }
+
+    pos = 0;
+    append_text(line, &pos, sizeof(line), "\nlatency (cycles: calls):\n");
+    vfs_append(path, line, pos);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct syscall_stats *entry = &stats[i];
+        if (!entry->calls)
+            continue;
+        pos = 0;
+        append_text(line, &pos, sizeof(line), "  ");
+        append_text(line, &pos, sizeof(line), entry->name ? entry->name : "-");
+        for (uint32_t b = 0; b < SYSCALL_LATENCY_BUCKETS; ++b)
+        {
+            if (!entry->latency_hist[b])
+                continue;
+            append_char(line, &pos, sizeof(line), ' ');
+            append_syscall_bucket(line, &pos, sizeof(line), b);
+            append_char(line, &pos, sizeof(line), ':');
+            append_decimal(line, &pos, sizeof(line), entry->latency_hist[b]);
+        }
+        append_newline(line, &pos, sizeof(line));
+        if (pos >= sizeof(line))
+            pos = sizeof(line) - 1;
+        vfs_append(path, line, pos);
+    }
+    kfree(stats);
+
+    struct process_info *info = (struct process_info *)kalloc(sizeof(struct process_info) * MAX_PROCS);
+    if (!info)
+        return;
+    count = process_snapshot(info, MAX_PROCS);
+
+    pos = 0;
+    append_text(line, &pos, sizeof(line), "\nPID KIND SYSCALLS CYCLES(avg)\n");
+    vfs_append(path, line, pos);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct process_info *entry = &info[i];
+        if (!entry->syscalls)
+            continue;
+        pos = 0;
+        append_decimal(line, &pos, sizeof(line), (uint32_t)entry->pid);
+        append_text(line, &pos, sizeof(line), (entry->kind == THREAD_KIND_USER) ? " user " : " kernel ");
+        append_decimal(line, &pos, sizeof(line), entry->syscalls);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), average_u64(entry->syscall_cycles, entry->syscalls));
+        append_newline(line, &pos, sizeof(line));
+        vfs_append(path, line, pos);
+    }
+    kfree(info);
+}
+
+void debug_publish_bcache_info(void)
+{
+    struct bcache_stats stats;
+    bcache_get_stats(&stats);
+
+    char buffer[384];
+    size_t pos = 0;
+    append_text(buffer, &pos, sizeof(buffer), "Buffer Cache\n");
+    append_text(buffer, &pos, sizeof(buffer), "buffers: ");
+    append_decimal(buffer, &pos, sizeof(buffer), stats.buffers);
+    append_text(buffer, &pos, sizeof(buffer), " used: ");
+    append_decimal(buffer, &pos, sizeof(buffer), stats.used);
+    append_text(buffer, &pos, sizeof(buffer), " dirty: ");
+    append_decimal(buffer, &pos, sizeof(buffer), stats.dirty);
+    append_newline(buffer, &pos, sizeof(buffer));
+
+    append_text(buffer, &pos, sizeof(buffer), "hits: ");
+    append_decimal64(buffer, &pos, sizeof(buffer), stats.hits);
+    append_text(buffer, &pos, sizeof(buffer), " misses: ");
+    append_decimal64(buffer, &pos, sizeof(buffer), stats.misses);
+    append_text(buffer, &pos, sizeof(buffer), " hit_rate: ");
+    append_decimal64(buffer, &pos, sizeof(buffer), average_u64(stats.hits * 100u, stats.hits + stats.misses));
+    append_text(buffer, &pos, sizeof(buffer), "%\n");
+
+    append_text(buffer, &pos, sizeof(buffer), "evictions: ");
+    append_decimal64(buffer, &pos, sizeof(buffer), stats.evictions);
+    append_text(buffer, &pos, sizeof(buffer), " writebacks: ");
+    append_decimal64(buffer, &pos, sizeof(buffer), stats.writebacks);
+    append_newline(buffer, &pos, sizeof(buffer));
+
+    append_text(buffer, &pos, sizeof(buffer), "readahead: ");
+    append_decimal64(buffer, &pos, sizeof(buffer), stats.readahead);
+    append_text(buffer, &pos, sizeof(buffer), " bypassed: ");
+    append_decimal64(buffer, &pos, sizeof(buffer), stats.bypassed);
+    append_newline(buffer, &pos, sizeof(buffer));
+
+    if (pos >= sizeof(buffer))
+        pos = sizeof(buffer) - 1;
+    buffer[pos] = '\0';
+    vfs_write_file("/System/bcache", buffer, pos);
+}
+
+void debug_publish_blkqueue_info(void)
+{
+    static const char path[] = "/System/blkqueue";
+    struct blkqueue_info queues[BLOCKDEV_MAX_DEVICES];
+    size_t count = blkqueue_snapshot(queues, BLOCKDEV_MAX_DEVICES);
+
+    vfs_write_file(path, NULL, 0);
+
+    char line[224];
+    size_t pos = 0;
+    append_text(line, &pos, sizeof(line), "DEVICE ELEVATOR QUEUED INFLIGHT SUBMITTED MERGED DISPATCHED BLOCKS/REQ COMPLETED ERRORS EXPIRED FULL\n");
+    vfs_append(path, line, pos);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct blkqueue_info *info = &queues[i];
+        pos = 0;
+        append_text(line, &pos, sizeof(line), info->name);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_text(line, &pos, sizeof(line), info->elevator == BLOCKDEV_ELEVATOR_DEADLINE ? "deadline" : "fifo");
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->queued);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal(line, &pos, sizeof(line), info->in_flight);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), info->submitted);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), info->merged);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), info->dispatched);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), average_u64(info->dispatched_blocks, info->dispatched));
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), info->completed);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), info->errors);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), info->expired);
+        append_char(line, &pos, sizeof(line), ' ');
+        append_decimal64(line, &pos, sizeof(line), info->full_waits);
+        append_newline(line, &pos, sizeof(line));
+        if (pos >= sizeof(line))
+            pos = sizeof(line) - 1;
+        vfs_append(path, line, pos);
+    }
 }
 
 static void append_flags(char *dst, size_t *pos, size_t cap, uint32_t flags)
@@ -296,6 +938,15 @@ void debug_trap_init(void)
 void debug_publish_all(void)
 {
     debug_publish_memory_info();
+    debug_publish_slab_info();
+    debug_publish_timer_info();
+    debug_publish_lock_info();
+    debug_publish_sync_info();
+    debug_publish_channel_info();
     debug_publish_task_list();
+    debug_publish_sched_info();
+    debug_publish_syscall_info();
+    debug_publish_bcache_info();
+    debug_publish_blkqueue_info();
     debug_publish_device_list();
 }
@@ -2,7 +2,16 @@
 #define DEBUG_H
 
 void debug_publish_memory_info(void);
+void debug_publish_slab_info(void);
+void debug_publish_timer_info(void);
+void debug_publish_lock_info(void);
+void debug_publish_sync_info(void);
+void debug_publish_channel_info(void);
 void debug_publish_task_list(void);
+void debug_publish_sched_info(void);
+void debug_publish_syscall_info(void);
+void debug_publish_bcache_info(void);
+void debug_publish_blkqueue_info(void);
 void debug_publish_device_list(void);
 void debug_publish_all(void);
 void debug_trap_init(void);
@@ -0,0 +1,360 @@
+#include "evset.h"
+
+#include "spinlock.h"
+#include "proc.h"
+#include "ipc.h"
+#include "net_socket.h"
+#include "timer.h"
+#include "interrupts.h"
+#include "pit.h"
+#include "config.h"
+#include "uaccess.h"
+
+struct evset;
+
+struct evset_source_entry
+{
+    uint8_t used;
+    uint8_t kind;
+    int32_t id;
+    uint32_t cookie;
+    struct evset *set;
+    /* IRQ events or timer expirations not yet reported. */
+    volatile uint32_t pending;
+    volatile uint32_t data;
+    struct timer timer;
+};
+
+struct evset
+{
+    int used;
+    int id;
+    struct process *owner;
+    /* Set by the owner before its last readiness check, so producers know to wake it. */
+    volatile uint32_t waiting;
+    struct evset_source_entry sources[CONFIG_EVSET_MAX_SOURCES];
+};
+
+static spinlock_t evset_lock;
+static struct evset sets[CONFIG_EVSET_MAX];
+static int next_set_id = 1;
+/* Sources of each kind being watched; lets evset_notify() skip the scan when none are. */
+static volatile uint32_t watchers[EVSET_SOURCE_COUNT];
+
+static void evset_wake_owner(struct evset *set)
+{
+    if (set->waiting && set->owner)
+        process_wake(set->owner);
+}
+
+/* Timers re-arm themselves and never take evset_lock, since removal cancels them while holding it. */
+static void evset_timer_expired(void *data)
+{
+    struct evset_source_entry *entry = (struct evset_source_entry *)data;
+    if (!entry->used)
+        return;
+    timer_arm(&entry->timer, (uint32_t)entry->id);
+    __sync_fetch_and_add(&entry->pending, 1u);
+    evset_wake_owner(entry->set);
+}
+
+/* The caller's set @p set_id; only its owner may use it. */
+static struct evset *evset_lookup(int set_id)
+{
+    struct process *self = process_current();
+    if (!self || set_id <= 0)
+        return NULL;
+
+    for (size_t i = 0; i < CONFIG_EVSET_MAX; ++i)
+    {
+        if (sets[i].used && sets[i].id == set_id)
+            return (sets[i].owner == self) ? &sets[i] : NULL;
+    }
+    return NULL;
+}
+
+static void evset_release_source(struct evset_source_entry *entry)
+{
+    entry->used = 0;
+    if (entry->kind == EVSET_SOURCE_TIMER)
+        timer_cancel(&entry->timer);
+    __sync_fetch_and_sub(&watchers[entry->kind], 1u);
+}
+
+void evset_init(void)
+{
+    spinlock_init_named(&evset_lock, "evset");
+    for (size_t i = 0; i < CONFIG_EVSET_MAX; ++i)
+    {
+        sets[i].used = 0;
+        sets[i].id = 0;
+        sets[i].owner = NULL;
+        sets[i].waiting = 0;
+        for (size_t j = 0; j < CONFIG_EVSET_MAX_SOURCES; ++j)
+        {
+            sets[i].sources[j].used = 0;
+            sets[i].sources[j].set = &sets[i];
+            timer_init(&sets[i].sources[j].timer, evset_timer_expired, &sets[i].sources[j]);
+        }
+    }
+    for (size_t k = 0; k < EVSET_SOURCE_COUNT; ++k)
+        watchers[k] = 0;
+}
+
+int evset_create(void)
+{
+    struct process *self = process_current();
+    if (!self)
+        return -1;
+
+    int id = -1;
+    uint32_t flags;
+    spinlock_lock_irqsave(&evset_lock, &flags);
+    for (size_t i = 0; i < CONFIG_EVSET_MAX; ++i)
+    {
+        if (sets[i].used)
+            continue;
+        sets[i].used = 1;
+        sets[i].id = next_set_id++;
+        sets[i].owner = self;
+        sets[i].waiting = 0;
+        id = sets[i].id;
+        break;
+    }
+    spinlock_unlock_irqrestore(&evset_lock, flags);
+    return id;
+}
+
+/* Whether @p kind / @p id names something the caller may watch. */
+static int evset_source_valid(struct process *self, uint32_t kind, int32_t id)
+{
+    switch (kind)
+    {
+    case EVSET_SOURCE_CHANNEL:
+        return ipc_channel_ready(self, id) >= 0;
+    case EVSET_SOURCE_MAILBOX:
+    case EVSET_SOURCE_CALLS:
+        return 1;
+    case EVSET_SOURCE_IRQ:
+        return id >= 0 && id < (int32_t)IRQ_MAX_LINES;
+    case EVSET_SOURCE_NET:
+        return net_poll(id) >= 0;
+    case EVSET_SOURCE_TIMER:
+        return id > 0;
+    default:
+        return 0;
+    }
+}
+
+int evset_add(int set_id, uint32_t kind, int32_t id, uint32_t cookie)
+{
+    struct evset *set = evset_lookup(set_id);
+    if (!set)
+        return -1;
+    if (kind == EVSET_SOURCE_MAILBOX || kind == EVSET_SOURCE_CALLS)
+        id = set->owner->pid;
+    if (!evset_source_valid(set->owner, kind, id))
+        return -1;
+
+    int result = -1;
+    uint32_t flags;
+    spinlock_lock_irqsave(&evset_lock, &flags);
+    struct evset_source_entry *free_entry = NULL;
+    for (size_t i = 0; i < CONFIG_EVSET_MAX_SOURCES; ++i)
+    {
+        struct evset_source_entry *entry = &set->sources[i];
+        if (entry->used && entry->kind == kind && entry->id == id)
+        {
+            entry->cookie = cookie;
+            free_entry = NULL;
+            result = 0;
+            break;
+        }
+        if (!entry->used && !free_entry)
+            free_entry = entry;
+    }
+    if (free_entry)
+    {
+        free_entry->kind = (uint8_t)kind;
+        free_entry->id = id;
+        free_entry->cookie = cookie;
+        free_entry->pending = 0;
+        free_entry->data = 0;
+        free_entry->used = 1;
+        __sync_fetch_and_add(&watchers[kind], 1u);
+        if (kind == EVSET_SOURCE_TIMER)
+            timer_arm(&free_entry->timer, (uint32_t)id);
+        result = 0;
+    }
+    spinlock_unlock_irqrestore(&evset_lock, flags);
+    return result;
+}
+
+int evset_remove(int set_id, uint32_t kind, int32_t id)
+{
+    struct evset *set = evset_lookup(set_id);
+    if (!set)
+        return -1;
+    if (kind == EVSET_SOURCE_MAILBOX || kind == EVSET_SOURCE_CALLS)
+        id = set->owner->pid;
+
+    int result = -1;
+    uint32_t flags;
+    spinlock_lock_irqsave(&evset_lock, &flags);
+    for (size_t i = 0; i < CONFIG_EVSET_MAX_SOURCES; ++i)
+    {
+        struct evset_source_entry *entry = &set->sources[i];
+        if (entry->used && entry->kind == kind && entry->id == id)
+        {
+            evset_release_source(entry);
+            result = 0;
+            break;
+        }
+    }
+    spinlock_unlock_irqrestore(&evset_lock, flags);
+    return result;
+}
+
+/*
+ * Copy the sources that are ready now out to @p events. Runs in the owner,
+ * which alone edits the set.
+ * @return events stored, or -EFAULT if @p events could not be written.
+ */
+static int evset_collect(struct evset *set, struct evset_event *events, size_t max)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < CONFIG_EVSET_MAX_SOURCES && count < max; ++i)
+    {
+        struct evset_source_entry *entry = &set->sources[i];
+        if (!entry->used)
+            continue;
+
+        int ready = 0;
+        uint32_t data = 0;
+        switch (entry->kind)
+        {
+        case EVSET_SOURCE_CHANNEL:
+            ready = ipc_channel_ready(set->owner, entry->id);
+            break;
+        case EVSET_SOURCE_MAILBOX:
+            ready = ipc_mailbox_pending(set->owner);
+            break;
+        case EVSET_SOURCE_CALLS:
+            ready = ipc_call_pending(set->owner);
+            break;
+        case EVSET_SOURCE_NET:
+            ready = net_poll(entry->id);
+            break;
+        case EVSET_SOURCE_IRQ:
+        case EVSET_SOURCE_TIMER:
+            data = entry->data;
+            ready = (int)__sync_lock_test_and_set(&entry->pending, 0u);
+            break;
+        default:
+            break;
+        }
+        if (ready <= 0)
+            continue;
+
+        struct evset_event event;
+        event.kind = entry->kind;
+        event.id = entry->id;
+        event.cookie = entry->cookie;
+        event.count = (uint32_t)ready;
+        event.data = data;
+        if (copy_to_user(&events[count], &event, sizeof(event)) < 0)
+            return -EFAULT;
+        ++count;
+    }
+    return (int)count;
+}
+
+int evset_wait(int set_id, struct evset_event *events, size_t max, uint32_t timeout_ticks)
+{
+    struct evset *set = evset_lookup(set_id);
+    if (!set || !events || max == 0)
+        return -1;
+
+    uint64_t deadline = timeout_ticks ? get_ticks() + (uint64_t)timeout_ticks : 0;
+    int count;
+    for (;;)
+    {
+        /* Locked exchange: a producer that publishes after this sees the flag and wakes us. */
+        __sync_lock_test_and_set(&set->waiting, 1u);
+        count = evset_collect(set, events, max);
+        if (count != 0)
+            break;
+
+        uint32_t remaining = 0;
+        if (deadline)
+        {
+            uint64_t now = get_ticks();
+            if (now >= deadline)
+                break;
+            remaining = (uint32_t)(deadline - now);
+        }
+        process_block_timeout(remaining);
+    }
+    set->waiting = 0;
+    return count;
+}
+
+void evset_notify(uint32_t kind, int32_t id, uint32_t data)
+{
+    if (kind >= EVSET_SOURCE_COUNT || !watchers[kind])
+        return;
+
+    struct process *wake[CONFIG_EVSET_MAX];
+    size_t wake_count = 0;
+    uint32_t flags;
+    spinlock_lock_irqsave(&evset_lock, &flags);
+    for (size_t i = 0; i < CONFIG_EVSET_MAX; ++i)
+    {
+        struct evset *set = &sets[i];
+        if (!set->used)
+            continue;
+        int hit = 0;
+        for (size_t j = 0; j < CONFIG_EVSET_MAX_SOURCES; ++j)
+        {
+            struct evset_source_entry *entry = &set->sources[j];
+            if (!entry->used || entry->kind != kind || entry->id != id)
+                continue;
+            if (kind == EVSET_SOURCE_IRQ)
+            {
+                entry->data = data;
+                __sync_fetch_and_add(&entry->pending, 1u);
+            }
+            hit = 1;
+        }
+        if (hit && set->waiting)
+            wake[wake_count++] = set->owner;
+    }
+    spinlock_unlock_irqrestore(&evset_lock, flags);
+
+    for (size_t i = 0; i < wake_count; ++i)
+        process_wake(wake[i]);
+}
+
+void evset_process_cleanup(struct process *proc)
+{
+    if (!proc)
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&evset_lock, &flags);
+    for (size_t i = 0; i < CONFIG_EVSET_MAX; ++i)
+    {
+        struct evset *set = &sets[i];
+        if (!set->used || set->owner != proc)
+            continue;
+        for (size_t j = 0; j < CONFIG_EVSET_MAX_SOURCES; ++j)
+        {
+            if (set->sources[j].used)
+                evset_release_source(&set->sources[j]);
+        }
+        set->used = 0;
+        set->owner = NULL;
+        set->waiting = 0;
+    }
+    spinlock_unlock_irqrestore(&evset_lock, flags);
+}
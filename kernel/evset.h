@@ -0,0 +1,40 @@
+#ifndef EVSET_H
+#define EVSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "evset_types.h"
+
+struct process;
+
+/**
+ * Event sets let one thread sleep on several sources at once.
+ *
+ * Channels, mailboxes, queued callers and sockets are level triggered: the wait asks each
+ * of them whether data is queued, and their producers call evset_notify()
+ * so a sleeping owner wakes. IRQ lines and timers have no queue of their
+ * own here; their events are counted in the set and reported (and reset)
+ * by the next wait. Only the thread that created a set may change or wait
+ * on it.
+ */
+
+void evset_init(void);
+/** @return a new set owned by the caller, or -1. */
+int evset_create(void);
+/** Watch @p kind / @p id, reporting @p cookie with its events. */
+int evset_add(int set_id, uint32_t kind, int32_t id, uint32_t cookie);
+int evset_remove(int set_id, uint32_t kind, int32_t id);
+/**
+ * @brief Sleep until at least one source is ready, then report every ready one.
+ *
+ * @param timeout_ticks PIT ticks to wait; 0 waits until something is ready.
+ * @return the number of events written to @p events (0 on timeout), -EFAULT
+ *         if @p events could not be written, or -1.
+ */
+int evset_wait(int set_id, struct evset_event *events, size_t max, uint32_t timeout_ticks);
+/** Called by event producers after new data became visible; safe from interrupt context. */
+void evset_notify(uint32_t kind, int32_t id, uint32_t data);
+void evset_process_cleanup(struct process *proc);
+
+#endif
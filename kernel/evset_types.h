@@ -0,0 +1,37 @@
+#ifndef EVSET_TYPES_H
+#define EVSET_TYPES_H
+
+#include <stdint.h>
+
+/** Event sources an event set can watch; the meaning of the id depends on the kind. */
+enum evset_source
+{
+    /** IPC channel id; ready while the caller has a message to receive. */
+    EVSET_SOURCE_CHANNEL = 0,
+    /** The caller's own mailbox (id ignored); ready while a message is waiting. */
+    EVSET_SOURCE_MAILBOX = 1,
+    /** IRQ line; reports events passed to irq_dispatch_event() since the last wait. */
+    EVSET_SOURCE_IRQ = 2,
+    /** Raw network socket handle; ready while frames are queued. */
+    EVSET_SOURCE_NET = 3,
+    /** Periodic timer; the id is the period in ticks. Reports expirations since the last wait. */
+    EVSET_SOURCE_TIMER = 4,
+    /** ipc_call() callers queued on the caller (id ignored); take them with sys_ipc_accept(). */
+    EVSET_SOURCE_CALLS = 5,
+    EVSET_SOURCE_COUNT
+};
+
+/** One ready source, as filled in by sys_evset_wait(). */
+struct evset_event
+{
+    uint32_t kind;
+    int32_t id;
+    /** Value given when the source was added. */
+    uint32_t cookie;
+    /** Queued messages, frames or callers, or IRQ events / timer expirations since the last wait. */
+    uint32_t count;
+    /** Latest IRQ payload; 0 for other kinds. */
+    uint32_t data;
+};
+
+#endif
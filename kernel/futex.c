@@ -0,0 +1,178 @@
+#include "futex.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "config.h"
+#include "uaccess.h"
+
+#include <stddef.h>
+
+/* Lives on the waiting thread's stack for as long as it is queued. */
+struct futex_waiter
+{
+    struct process *proc;
+    volatile uint32_t *addr;
+    struct futex_waiter *next;
+    /* Set by futex_wake() once the waiter has been unlinked. */
+    volatile int woken;
+};
+
+struct futex_bucket
+{
+    spinlock_t lock;
+    struct futex_waiter *head;
+    struct futex_waiter *tail;
+};
+
+static struct futex_bucket buckets[CONFIG_FUTEX_BUCKETS];
+static struct futex_stats stats;
+
+static struct futex_bucket *futex_bucket_for(volatile uint32_t *addr)
+{
+    uint32_t key = (uint32_t)(uintptr_t)addr >> 2;
+    key ^= key >> 7;
+    key *= 0x9E3779B1u;
+    return &buckets[(key >> 16) % CONFIG_FUTEX_BUCKETS];
+}
+
+static int futex_address_valid(volatile uint32_t *addr)
+{
+    uintptr_t value = (uintptr_t)addr;
+    if (value == 0 || (value & 3u) != 0)
+        return 0;
+    return value + sizeof(uint32_t) <= CONFIG_USER_SPACE_LIMIT;
+}
+
+static void futex_unlink(struct futex_bucket *bucket, struct futex_waiter *waiter)
+{
+    struct futex_waiter *prev = NULL;
+    for (struct futex_waiter *cur = bucket->head; cur; prev = cur, cur = cur->next)
+    {
+        if (cur != waiter)
+            continue;
+        if (prev)
+            prev->next = cur->next;
+        else
+            bucket->head = cur->next;
+        if (bucket->tail == cur)
+            bucket->tail = prev;
+        cur->next = NULL;
+        return;
+    }
+}
+
+void futex_init(void)
+{
+    for (uint32_t i = 0; i < CONFIG_FUTEX_BUCKETS; ++i)
+    {
+        spinlock_init_named(&buckets[i].lock, "futex.bucket");
+        buckets[i].head = NULL;
+        buckets[i].tail = NULL;
+    }
+    stats = (struct futex_stats){0};
+}
+
+int futex_wait(volatile uint32_t *addr, uint32_t expected, uint32_t timeout_ticks)
+{
+    if (!futex_address_valid(addr))
+        return -1;
+    struct process *self = process_current();
+    if (!self)
+        return -1;
+
+    struct futex_bucket *bucket = futex_bucket_for(addr);
+    struct futex_waiter waiter = { self, addr, NULL, 0 };
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&bucket->lock, &flags);
+    __sync_fetch_and_add(&stats.waits, 1u);
+    uint32_t current;
+    if (get_user_u32(&current, addr) < 0)
+    {
+        spinlock_unlock_irqrestore(&bucket->lock, flags);
+        return -EFAULT;
+    }
+    if (current != expected)
+    {
+        spinlock_unlock_irqrestore(&bucket->lock, flags);
+        __sync_fetch_and_add(&stats.mismatches, 1u);
+        return 0;
+    }
+    if (bucket->tail)
+        bucket->tail->next = &waiter;
+    else
+        bucket->head = &waiter;
+    bucket->tail = &waiter;
+    spinlock_unlock_irqrestore(&bucket->lock, flags);
+
+    /*
+     * woken is only trusted under the bucket lock: the waker holds it across
+     * process_wake(), so this frame cannot unwind while still being woken.
+     */
+    for (;;)
+    {
+        int timed_out = process_block_timeout(timeout_ticks);
+
+        spinlock_lock_irqsave(&bucket->lock, &flags);
+        if (waiter.woken)
+        {
+            spinlock_unlock_irqrestore(&bucket->lock, flags);
+            return 0;
+        }
+        if (timed_out)
+        {
+            futex_unlink(bucket, &waiter);
+            spinlock_unlock_irqrestore(&bucket->lock, flags);
+            __sync_fetch_and_add(&stats.timeouts, 1u);
+            return 1;
+        }
+        spinlock_unlock_irqrestore(&bucket->lock, flags);
+    }
+}
+
+int futex_wake(volatile uint32_t *addr, uint32_t count)
+{
+    if (!futex_address_valid(addr))
+        return -1;
+
+    struct futex_bucket *bucket = futex_bucket_for(addr);
+    int woken = 0;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&bucket->lock, &flags);
+    struct futex_waiter *prev = NULL;
+    struct futex_waiter *cur = bucket->head;
+    while (cur && (uint32_t)woken < count)
+    {
+        struct futex_waiter *next = cur->next;
+        if (cur->addr != addr)
+        {
+            prev = cur;
+            cur = next;
+            continue;
+        }
+
+        if (prev)
+            prev->next = next;
+        else
+            bucket->head = next;
+        if (bucket->tail == cur)
+            bucket->tail = prev;
+        cur->next = NULL;
+        cur->woken = 1;
+        process_wake(cur->proc);
+        ++woken;
+        cur = next;
+    }
+    spinlock_unlock_irqrestore(&bucket->lock, flags);
+
+    __sync_fetch_and_add(&stats.wakes, 1u);
+    __sync_fetch_and_add(&stats.woken, (uint32_t)woken);
+    return woken;
+}
+
+void futex_get_stats(struct futex_stats *out)
+{
+    if (!out)
+        return;
+    *out = stats;
+}
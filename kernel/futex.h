@@ -0,0 +1,38 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <stdint.h>
+
+/**
+ * @brief Kernel entries made through the futex syscalls since boot.
+ *
+ * An uncontended user lock never shows up here; `bench futex` uses the
+ * difference between two snapshots to count the slow-path trips.
+ */
+struct futex_stats
+{
+    uint32_t waits;
+    /** Waits that returned at once because the word no longer held the expected value. */
+    uint32_t mismatches;
+    uint32_t timeouts;
+    uint32_t wakes;
+    uint32_t woken;
+};
+
+void futex_init(void);
+/**
+ * @brief Sleep while the word at @p addr still holds @p expected.
+ *
+ * The comparison is made under the hash-bucket lock that futex_wake() takes,
+ * so a wake issued after the caller changed the word cannot be missed.
+ *
+ * @param timeout_ticks PIT ticks to wait; 0 waits until woken.
+ * @return 0 after a wake or a value mismatch, 1 on timeout, -1 on a bad address,
+ *         -EFAULT if the word could not be read.
+ */
+int futex_wait(volatile uint32_t *addr, uint32_t expected, uint32_t timeout_ticks);
+/** @return the number of waiters on @p addr that were woken, at most @p count. */
+int futex_wake(volatile uint32_t *addr, uint32_t count);
+void futex_get_stats(struct futex_stats *out);
+
+#endif
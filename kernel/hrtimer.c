@@ -0,0 +1,206 @@
+#include "hrtimer.h"
+
+#include "apic.h"
+#include "clock.h"
+#include "spinlock.h"
+
+#include <stddef.h>
+
+/*
+ * Pending hrtimers are kept in a list sorted by expiry. Only the head is
+ * programmed into the hardware, so arming a later timer costs a walk but no
+ * device access, and the interrupt handler pops from the front. The number
+ * of armed hrtimers is bounded by sleepers and drivers, which keeps the walk
+ * short; coarse timeouts belong on the tick-driven timer wheel instead.
+ */
+
+static struct hrtimer *queue_head = NULL;
+static spinlock_t hrtimer_lock;
+static struct hrtimer_stats stats;
+static int oneshot_hw = 0;
+
+static void hrtimer_program(void)
+{
+    if (!oneshot_hw)
+        return;
+
+    if (queue_head)
+    {
+        lapic_timer_arm(clock_monotonic_to_tsc(queue_head->expires_ns));
+        ++stats.programmed;
+    }
+    else
+    {
+        lapic_timer_disarm();
+    }
+}
+
+static void hrtimer_unlink(struct hrtimer *timer)
+{
+    if (timer->prev)
+        timer->prev->next = timer->next;
+    else
+        queue_head = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+static void hrtimer_expire(int rearm)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&hrtimer_lock, &flags);
+
+    uint64_t now = hrtimer_now_ns();
+    while (queue_head && queue_head->expires_ns <= now)
+    {
+        struct hrtimer *timer = queue_head;
+        hrtimer_unlink(timer);
+        timer->pending = 0;
+        --stats.pending;
+        ++stats.fired;
+        uint64_t late = now - timer->expires_ns;
+        if (late > stats.max_late_ns)
+            stats.max_late_ns = (late > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)late;
+        rearm = 1;
+
+        hrtimer_callback_t callback = timer->callback;
+        void *data = timer->data;
+        spinlock_unlock_irqrestore(&hrtimer_lock, flags);
+        callback(data);
+        spinlock_lock_irqsave(&hrtimer_lock, &flags);
+        now = hrtimer_now_ns();
+    }
+
+    if (rearm)
+        hrtimer_program();
+
+    spinlock_unlock_irqrestore(&hrtimer_lock, flags);
+}
+
+static void hrtimer_interrupt(struct regs *frame)
+{
+    (void)frame;
+    lapic_eoi();
+    /* Always re-arm: a one-shot count can round to slightly before the head. */
+    hrtimer_expire(1);
+}
+
+void hrtimer_system_init(void)
+{
+    spinlock_init_named(&hrtimer_lock, "hrtimer");
+    queue_head = NULL;
+    stats.pending = 0;
+    stats.fired = 0;
+    stats.cancelled = 0;
+    stats.programmed = 0;
+    stats.max_late_ns = 0;
+
+    oneshot_hw = (lapic_timer_mode() != LAPIC_TIMER_NONE);
+    if (oneshot_hw)
+        lapic_timer_set_handler(hrtimer_interrupt);
+}
+
+uint64_t hrtimer_now_ns(void)
+{
+    return clock_monotonic_ns();
+}
+
+void hrtimer_init(struct hrtimer *timer, hrtimer_callback_t callback, void *data)
+{
+    if (!timer)
+        return;
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->expires_ns = 0;
+    timer->callback = callback;
+    timer->data = data;
+    timer->pending = 0;
+}
+
+void hrtimer_start_at(struct hrtimer *timer, uint64_t expires_ns)
+{
+    if (!timer || !timer->callback)
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&hrtimer_lock, &flags);
+
+    struct hrtimer *old_head = queue_head;
+    if (timer->pending)
+        hrtimer_unlink(timer);
+    else
+        ++stats.pending;
+    timer->expires_ns = expires_ns;
+    timer->pending = 1;
+
+    struct hrtimer *prev = NULL;
+    struct hrtimer *iter = queue_head;
+    while (iter && iter->expires_ns <= expires_ns)
+    {
+        prev = iter;
+        iter = iter->next;
+    }
+    timer->prev = prev;
+    timer->next = iter;
+    if (iter)
+        iter->prev = timer;
+    if (prev)
+        prev->next = timer;
+    else
+        queue_head = timer;
+
+    if (queue_head != old_head || queue_head == timer)
+        hrtimer_program();
+
+    spinlock_unlock_irqrestore(&hrtimer_lock, flags);
+}
+
+void hrtimer_start(struct hrtimer *timer, uint64_t delay_ns)
+{
+    hrtimer_start_at(timer, hrtimer_now_ns() + delay_ns);
+}
+
+int hrtimer_cancel(struct hrtimer *timer)
+{
+    if (!timer)
+        return 0;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&hrtimer_lock, &flags);
+    int was_pending = timer->pending;
+    if (was_pending)
+    {
+        int was_head = (queue_head == timer);
+        hrtimer_unlink(timer);
+        timer->pending = 0;
+        --stats.pending;
+        ++stats.cancelled;
+        if (was_head)
+            hrtimer_program();
+    }
+    spinlock_unlock_irqrestore(&hrtimer_lock, flags);
+    return was_pending;
+}
+
+void hrtimer_run_expired(void)
+{
+    hrtimer_expire(0);
+}
+
+int hrtimer_is_oneshot(void)
+{
+    return oneshot_hw;
+}
+
+void hrtimer_get_stats(struct hrtimer_stats *out)
+{
+    if (!out)
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&hrtimer_lock, &flags);
+    *out = stats;
+    spinlock_unlock_irqrestore(&hrtimer_lock, flags);
+}
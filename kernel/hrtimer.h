@@ -0,0 +1,49 @@
+#ifndef HRTIMER_H
+#define HRTIMER_H
+
+#include <stdint.h>
+
+typedef void (*hrtimer_callback_t)(void *data);
+
+/**
+ * @brief One-shot nanosecond timer.
+ *
+ * Expiries are programmed into the local APIC (TSC-deadline or one-shot
+ * mode). Without an APIC the queue is serviced from the PIT tick, so the
+ * API keeps working at tick resolution. Callbacks run in interrupt context.
+ */
+struct hrtimer
+{
+    struct hrtimer *next;
+    struct hrtimer *prev;
+    uint64_t expires_ns;
+    hrtimer_callback_t callback;
+    void *data;
+    uint8_t pending;
+};
+
+struct hrtimer_stats
+{
+    uint32_t pending;
+    uint32_t fired;
+    uint32_t cancelled;
+    uint32_t programmed;
+    /** Largest observed lateness of a callback, in nanoseconds. */
+    uint32_t max_late_ns;
+};
+
+void hrtimer_system_init(void);
+/** Expiry timebase; the same clock as clock_monotonic_ns(). */
+uint64_t hrtimer_now_ns(void);
+void hrtimer_init(struct hrtimer *timer, hrtimer_callback_t callback, void *data);
+void hrtimer_start(struct hrtimer *timer, uint64_t delay_ns);
+void hrtimer_start_at(struct hrtimer *timer, uint64_t expires_ns);
+/** @return 1 if the timer was pending and is now disarmed, 0 otherwise. */
+int hrtimer_cancel(struct hrtimer *timer);
+/** Run every expired timer; called from the APIC timer vector and the PIT tick. */
+void hrtimer_run_expired(void);
+/** @return 1 when expiries are delivered by a one-shot hardware timer. */
+int hrtimer_is_oneshot(void);
+void hrtimer_get_stats(struct hrtimer_stats *out);
+
+#endif
@@ -1,7 +1,9 @@
 #include "interrupts.h"
 #include "pic.h"
 #include "vga.h"
-#include "pit.h"
+#include "clock.h"
+#include "workqueue.h"
+#include "evset.h"
 
 #include <stdint.h>
 #include <stddef.h>
@@ -26,6 +28,15 @@ static struct idt_ptr idt_descriptor;
 
 static isr_callback_t isr_handlers[32];
 
+struct exception_table_entry
+{
+    uint32_t insn;
+    uint32_t fixup;
+};
+
+extern const struct exception_table_entry __ex_table_start[];
+extern const struct exception_table_entry __ex_table_end[];
+
 struct irq_shared_entry
 {
     irq_shared_handler_t handler;
@@ -40,6 +51,7 @@ struct irq_dispatch_slot
 };
 
 static struct irq_dispatch_slot irq_table[IRQ_MAX_LINES];
+static irq_callback_t local_handlers[IRQ_LOCAL_VECTORS];
 static spinlock_t irq_table_lock;
 
 extern void isr0(void);
@@ -92,6 +104,10 @@ extern void irq12(void);
 extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
+extern void irq_local240(void);
+extern void irq_local241(void);
+extern void irq_local242(void);
+extern void irq_local255(void);
 
 extern void idt_flush(uint32_t);
 
@@ -172,12 +188,16 @@ void idt_init(void)
     idt_set_gate(45, (uint32_t)irq13, 0x08, 0x8E);
     idt_set_gate(46, (uint32_t)irq14, 0x08, 0x8E);
     idt_set_gate(47, (uint32_t)irq15, 0x08, 0x8E);
+    idt_set_gate(IRQ_VECTOR_LAPIC_TIMER, (uint32_t)irq_local240, 0x08, 0x8E);
+    idt_set_gate(IRQ_VECTOR_IPI_RESCHEDULE, (uint32_t)irq_local241, 0x08, 0x8E);
+    idt_set_gate(IRQ_VECTOR_IPI_TICK, (uint32_t)irq_local242, 0x08, 0x8E);
+    idt_set_gate(IRQ_VECTOR_LAPIC_SPURIOUS, (uint32_t)irq_local255, 0x08, 0x8E);
     idt_set_gate(0x80, (uint32_t)isr128, 0x08, 0xEE);
 
     for (size_t i = 0; i < 32; ++i)
         isr_handlers[i] = NULL;
 
-    spinlock_init(&irq_table_lock);
+    spinlock_init_named(&irq_table_lock, "irq.table");
     for (size_t i = 0; i < IRQ_MAX_LINES; ++i)
     {
         irq_table[i].primary = NULL;
@@ -189,10 +209,17 @@ void idt_init(void)
         for (size_t m = 0; m < IRQ_MAX_MAILBOX_SUBSCRIBERS; ++m)
             irq_table[i].mailboxes[m] = NULL;
     }
+    for (size_t i = 0; i < IRQ_LOCAL_VECTORS; ++i)
+        local_handlers[i] = NULL;
 
     idt_flush((uint32_t)&idt_descriptor);
 }
 
+void idt_load(void)
+{
+    idt_flush((uint32_t)&idt_descriptor);
+}
+
 static const char *exception_messages[32] = {
     "Divide-by-zero", "Debug", "Non-maskable interrupt", "Breakpoint",
     "Overflow", "Bound range", "Invalid opcode", "Device not available",
@@ -219,11 +246,28 @@ static void vga_write_hex32(uint32_t value)
     vga_write_line(buffer);
 }
 
+/* A fault on an instruction listed in __ex_table resumes at its fixup rather than halting. */
+static int exception_fixup(struct regs *frame)
+{
+    for (const struct exception_table_entry *entry = __ex_table_start; entry < __ex_table_end; ++entry)
+    {
+        if (entry->insn == frame->eip)
+        {
+            frame->eip = entry->fixup;
+            return 1;
+        }
+    }
+    return 0;
+}
+
 void isr_handler(struct regs *frame)
 {
     uint32_t int_no = frame->int_no;
     if (int_no < 32)
     {
+        if ((int_no == 13 || int_no == 14) && exception_fixup(frame))
+            return;
+
         if (isr_handlers[int_no])
         {
             isr_handlers[int_no](frame);
@@ -265,6 +309,11 @@ void irq_handler(struct regs *frame)
     {
         uint8_t irq = (uint8_t)(vector - 32);
         struct irq_dispatch_slot *slot = &irq_table[irq];
+        /*
+         * Acknowledge first: a handler may preempt the running task, and
+         * that task can resume much later or on another CPU.
+         */
+        pic_send_eoi(irq);
         if (slot->primary)
             slot->primary(frame);
 
@@ -273,9 +322,15 @@ void irq_handler(struct regs *frame)
             if (slot->shared[i].handler)
                 slot->shared[i].handler(frame, slot->shared[i].context);
         }
-
-        pic_send_eoi(irq);
     }
+    else if (vector >= IRQ_LOCAL_VECTOR_BASE && vector < IRQ_LOCAL_VECTOR_BASE + IRQ_LOCAL_VECTORS)
+    {
+        irq_callback_t handler = local_handlers[vector - IRQ_LOCAL_VECTOR_BASE];
+        if (handler)
+            handler(frame);
+    }
+
+    tasklet_irq_exit();
 }
 
 void isr_install_handler(int num, isr_callback_t handler)
@@ -296,6 +351,12 @@ void irq_install_handler(int irq, irq_callback_t handler)
     }
 }
 
+void irq_install_local_handler(uint8_t vector, irq_callback_t handler)
+{
+    if (vector >= IRQ_LOCAL_VECTOR_BASE)
+        local_handlers[vector - IRQ_LOCAL_VECTOR_BASE] = handler;
+}
+
 void irq_uninstall_handler(int irq)
 {
     if (irq >= 0 && irq < 16)
@@ -370,7 +431,7 @@ void irq_mailbox_init(struct irq_mailbox *box)
     box->head = 0;
     box->tail = 0;
     box->count = 0;
-    spinlock_init(&box->lock);
+    spinlock_init_named(&box->lock, "irq.mailbox");
 }
 
 int irq_mailbox_subscribe(int irq, struct irq_mailbox *box)
@@ -503,11 +564,12 @@ void irq_dispatch_event(int irq, uint32_t data)
     struct irq_event event;
     event.irq = (uint8_t)irq;
     event.data = data;
-    event.timestamp = (uint32_t)get_ticks();
+    event.timestamp_ns = clock_monotonic_ns();
 
     for (size_t i = 0; i < IRQ_MAX_MAILBOX_SUBSCRIBERS; ++i)
     {
         if (targets[i])
             mailbox_push(targets[i], &event);
     }
+    evset_notify(EVSET_SOURCE_IRQ, irq, data);
 }
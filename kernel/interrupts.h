@@ -10,11 +10,20 @@
 #define IRQ_MAX_MAILBOX_SUBSCRIBERS 4
 #define IRQ_MAILBOX_CAPACITY 32
 
+/* Vectors delivered by the local APIC rather than the 8259. */
+#define IRQ_LOCAL_VECTOR_BASE     0xF0
+#define IRQ_LOCAL_VECTORS         16
+#define IRQ_VECTOR_LAPIC_TIMER    0xF0
+#define IRQ_VECTOR_IPI_RESCHEDULE 0xF1
+#define IRQ_VECTOR_IPI_TICK       0xF2
+#define IRQ_VECTOR_LAPIC_SPURIOUS 0xFF
+
 struct irq_event
 {
     uint8_t irq;
     uint32_t data;
-    uint32_t timestamp;
+    /** clock_monotonic_ns() when the interrupt was dispatched. */
+    uint64_t timestamp_ns;
 };
 
 struct irq_mailbox
@@ -54,9 +63,13 @@ typedef void (*irq_callback_t)(struct regs *frame);
 typedef void (*irq_shared_handler_t)(struct regs *frame, void *context);
 
 void idt_init(void);
+/** Load the shared IDT on an application processor. */
+void idt_load(void);
 void isr_install_handler(int num, isr_callback_t handler);
 void irq_install_handler(int irq, irq_callback_t handler);
 void irq_uninstall_handler(int irq);
+/** Handlers for local APIC vectors must send their own EOI. */
+void irq_install_local_handler(uint8_t vector, irq_callback_t handler);
 int irq_register_shared_handler(int irq, irq_shared_handler_t handler, void *context);
 int irq_unregister_shared_handler(int irq, irq_shared_handler_t handler, void *context);
 
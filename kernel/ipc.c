@@ -3,12 +3,19 @@
 #include "proc.h"
 #include "spinlock.h"
 #include "klog.h"
+#include "memory.h"
+#include "pit.h"
+#include "futex.h"
+#include "ipc_ring.h"
+#include "evset.h"
+#include "uaccess.h"
 
 #include <stddef.h>
 #include <stdint.h>
 
 #define IPC_CHANNEL_FLAG_KERNEL 0x1u
 #define IPC_INVALID_PID (-1)
+#define IPC_SHARE_FLAG_RING 0x1u
 
 struct ipc_share_record
 {
@@ -22,17 +29,19 @@ struct ipc_share_record
 
 static spinlock_t capability_lock;
 static spinlock_t share_lock;
+/* Guards every proc->ipc_mailbox pointer and the mailbox reference counts. */
+static spinlock_t mailbox_alloc_lock;
 
 static struct ipc_share_record share_table[CONFIG_IPC_MAX_SHARED_REGIONS];
+static struct ipc_ring_stats ring_stats;
 static int ipc_initialized = 0;
 
-static void buffer_copy(uint8_t *dst, const uint8_t *src, size_t length)
+/* Either side may be a caller's buffer that the syscall layer only range-checked. */
+static int buffer_copy(uint8_t *dst, const uint8_t *src, size_t length)
 {
     if (!dst || !src || length == 0)
-        return;
-
-    for (size_t i = 0; i < length; ++i)
-        dst[i] = src[i];
+        return 0;
+    return uaccess_copy(dst, src, length) ? -EFAULT : 0;
 }
 
 static void mailbox_init(struct ipc_mailbox_state *mailbox)
@@ -40,7 +49,7 @@ static void mailbox_init(struct ipc_mailbox_state *mailbox)
     if (!mailbox)
         return;
 
-    spinlock_init(&mailbox->lock);
+    mcs_lock_init_named(&mailbox->lock, "ipc.mailbox");
     mailbox->count = 0;
     mailbox->waiter_count = 0;
 
@@ -56,29 +65,65 @@ static void mailbox_init(struct ipc_mailbox_state *mailbox)
         mailbox->waiters[i] = IPC_INVALID_PID;
 }
 
-static void mailbox_clear(struct ipc_mailbox_state *mailbox)
+/* @return @p proc's mailbox, created on first use, with a reference the caller drops with mailbox_put(). */
+static struct ipc_mailbox_state *mailbox_acquire(struct process *proc)
 {
-    if (!mailbox)
-        return;
-
-    uint32_t flags;
-    spinlock_lock_irqsave(&mailbox->lock, &flags);
-
-    mailbox->count = 0;
-    mailbox->waiter_count = 0;
+    if (!proc)
+        return NULL;
 
-    for (size_t i = 0; i < CONFIG_MSG_QUEUE_LEN; ++i)
+    struct ipc_mailbox_state *fresh = NULL;
+    for (;;)
     {
-        mailbox->slots[i].used = 0;
-        mailbox->slots[i].sender = 0;
-        mailbox->slots[i].flags = 0;
-        mailbox->slots[i].size = 0;
+        uint32_t flags;
+        spinlock_lock_irqsave(&mailbox_alloc_lock, &flags);
+        struct ipc_mailbox_state *mailbox = proc->ipc_mailbox;
+        if (!mailbox && fresh)
+        {
+            /* The process holds the first reference until mailbox_release(). */
+            fresh->refs = 1;
+            proc->ipc_mailbox = fresh;
+            mailbox = fresh;
+            fresh = NULL;
+        }
+        if (mailbox)
+            ++mailbox->refs;
+        spinlock_unlock_irqrestore(&mailbox_alloc_lock, flags);
+
+        if (mailbox)
+        {
+            if (fresh)
+                kfree(fresh);
+            return mailbox;
+        }
+        fresh = (struct ipc_mailbox_state *)kalloc(sizeof(struct ipc_mailbox_state));
+        if (!fresh)
+            return NULL;
+        mailbox_init(fresh);
     }
+}
 
-    for (size_t i = 0; i < CONFIG_IPC_ENDPOINT_WAITERS; ++i)
-        mailbox->waiters[i] = IPC_INVALID_PID;
+static void mailbox_put(struct ipc_mailbox_state *mailbox)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&mailbox_alloc_lock, &flags);
+    int last = (--mailbox->refs == 0);
+    spinlock_unlock_irqrestore(&mailbox_alloc_lock, flags);
 
-    spinlock_unlock_irqrestore(&mailbox->lock, flags);
+    if (last)
+        kfree(mailbox);
+}
+
+/* A sender still holding a reference keeps the mailbox alive until it is done. */
+static void mailbox_release(struct process *proc)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&mailbox_alloc_lock, &flags);
+    struct ipc_mailbox_state *mailbox = proc->ipc_mailbox;
+    proc->ipc_mailbox = NULL;
+    spinlock_unlock_irqrestore(&mailbox_alloc_lock, flags);
+
+    if (mailbox)
+        mailbox_put(mailbox);
 }
 
 static int mailbox_push_waiter(struct ipc_mailbox_state *mailbox, pid_t pid)
@@ -112,14 +157,52 @@ static pid_t mailbox_pop_waiter(struct ipc_mailbox_state *mailbox)
     return value;
 }
 
+static void mailbox_remove_waiter(struct ipc_mailbox_state *mailbox, pid_t pid)
+{
+    if (!mailbox)
+        return;
+
+    for (uint8_t i = 0; i < mailbox->waiter_count; ++i)
+    {
+        if (mailbox->waiters[i] == pid)
+        {
+            for (uint8_t j = i + 1; j < mailbox->waiter_count; ++j)
+                mailbox->waiters[j - 1] = mailbox->waiters[j];
+            mailbox->waiters[mailbox->waiter_count - 1] = IPC_INVALID_PID;
+            --mailbox->waiter_count;
+            break;
+        }
+    }
+}
+
+/* Ticks left until @p deadline, or 0 (block forever) when no deadline is set. */
+static uint32_t timeout_remaining(uint64_t deadline, int *expired)
+{
+    *expired = 0;
+    if (deadline == 0)
+        return 0;
+
+    uint64_t now = get_ticks();
+    if (now >= deadline)
+    {
+        *expired = 1;
+        return 0;
+    }
+    return (uint32_t)(deadline - now);
+}
+
 static int mailbox_try_dequeue(struct process *proc, pid_t source, struct ipc_mailbox_slot *out)
 {
     if (!proc || !out)
         return 0;
 
-    struct ipc_mailbox_state *mailbox = &proc->ipc_mailbox;
+    struct ipc_mailbox_state *mailbox = proc->ipc_mailbox;
+    if (!mailbox)
+        return 0;
+
     uint32_t flags;
-    spinlock_lock_irqsave(&mailbox->lock, &flags);
+    struct mcs_node node;
+    mcs_lock_irqsave(&mailbox->lock, &node, &flags);
 
     int match_index = -1;
     for (uint8_t i = 0; i < mailbox->count; ++i)
@@ -146,7 +229,7 @@ static int mailbox_try_dequeue(struct process *proc, pid_t source, struct ipc_ma
         mailbox->slots[mailbox->count].size = 0;
     }
 
-    spinlock_unlock_irqrestore(&mailbox->lock, flags);
+    mcs_unlock_irqrestore(&mailbox->lock, &node, flags);
     return (match_index >= 0);
 }
 
@@ -155,14 +238,18 @@ static int mailbox_enqueue(struct process *target, pid_t sender, const uint8_t *
     if (!target)
         return -1;
 
-    struct ipc_mailbox_state *mailbox = &target->ipc_mailbox;
+    struct ipc_mailbox_state *mailbox = mailbox_acquire(target);
+    if (!mailbox)
+        return -1;
 
     uint32_t irq_flags;
-    spinlock_lock_irqsave(&mailbox->lock, &irq_flags);
+    struct mcs_node node;
+    mcs_lock_irqsave(&mailbox->lock, &node, &irq_flags);
 
     if (mailbox->count >= CONFIG_MSG_QUEUE_LEN)
     {
-        spinlock_unlock_irqrestore(&mailbox->lock, irq_flags);
+        mcs_unlock_irqrestore(&mailbox->lock, &node, irq_flags);
+        mailbox_put(mailbox);
         return -1;
     }
 
@@ -178,7 +265,8 @@ static int mailbox_enqueue(struct process *target, pid_t sender, const uint8_t *
 
     pid_t wake_pid = mailbox_pop_waiter(mailbox);
 
-    spinlock_unlock_irqrestore(&mailbox->lock, irq_flags);
+    mcs_unlock_irqrestore(&mailbox->lock, &node, irq_flags);
+    mailbox_put(mailbox);
 
     if (wake_pid > 0)
     {
@@ -186,6 +274,7 @@ static int mailbox_enqueue(struct process *target, pid_t sender, const uint8_t *
         if (wake_proc)
             process_wake(wake_proc);
     }
+    evset_notify(EVSET_SOURCE_MAILBOX, target->pid, 0);
 
     return (int)size;
 }
@@ -309,12 +398,105 @@ static void share_drop_for_pid(pid_t pid)
     spinlock_unlock_irqrestore(&share_lock, lock_flags);
 }
 
+static void rendezvous_init(struct ipc_rendezvous *rv)
+{
+    spinlock_init_named(&rv->lock, "ipc.call");
+    rv->callers_head = NULL;
+    rv->callers_tail = NULL;
+    rv->accepted = NULL;
+    rv->receiving = 0;
+    rv->recv_buffer = NULL;
+    rv->recv_max = 0;
+    rv->recv_client = IPC_INVALID_PID;
+    rv->recv_size = 0;
+    rv->call_next = NULL;
+    rv->call_server = NULL;
+    rv->call_request = NULL;
+    rv->call_request_size = 0;
+    rv->call_reply = NULL;
+    rv->call_reply_max = 0;
+    rv->call_reply_size = 0;
+    rv->call_done = 0;
+}
+
+/*
+ * Server lock held: copy @p caller's request straight from its buffer into
+ * @p buffer and park the caller on the accepted list until the reply.
+ */
+static int rendezvous_accept(struct ipc_rendezvous *rv, struct process *caller, void *buffer, size_t max)
+{
+    struct ipc_rendezvous *call = &caller->ipc_rv;
+    size_t to_copy = (call->call_request_size < max) ? call->call_request_size : max;
+    buffer_copy((uint8_t *)buffer, (const uint8_t *)call->call_request, to_copy);
+
+    call->call_next = rv->accepted;
+    rv->accepted = caller;
+    return (int)call->call_request_size;
+}
+
+/* Server lock held: unlink @p caller from whichever server list holds it. */
+static int rendezvous_unlink(struct ipc_rendezvous *rv, struct process *caller)
+{
+    struct process *prev = NULL;
+    for (struct process *cur = rv->accepted; cur; prev = cur, cur = cur->ipc_rv.call_next)
+    {
+        if (cur != caller)
+            continue;
+        if (prev)
+            prev->ipc_rv.call_next = cur->ipc_rv.call_next;
+        else
+            rv->accepted = cur->ipc_rv.call_next;
+        cur->ipc_rv.call_next = NULL;
+        return 1;
+    }
+
+    prev = NULL;
+    for (struct process *cur = rv->callers_head; cur; prev = cur, cur = cur->ipc_rv.call_next)
+    {
+        if (cur != caller)
+            continue;
+        if (prev)
+            prev->ipc_rv.call_next = cur->ipc_rv.call_next;
+        else
+            rv->callers_head = cur->ipc_rv.call_next;
+        if (rv->callers_tail == cur)
+            rv->callers_tail = prev;
+        cur->ipc_rv.call_next = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+/* Server lock held: fail every queued and accepted caller of an exiting server. */
+static void rendezvous_abort_callers(struct ipc_rendezvous *rv)
+{
+    struct process *lists[2] = { rv->callers_head, rv->accepted };
+    rv->callers_head = NULL;
+    rv->callers_tail = NULL;
+    rv->accepted = NULL;
+    rv->receiving = 0;
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        struct process *cur = lists[i];
+        while (cur)
+        {
+            struct process *next = cur->ipc_rv.call_next;
+            cur->ipc_rv.call_next = NULL;
+            cur->ipc_rv.call_reply_size = -1;
+            cur->ipc_rv.call_done = 1;
+            process_wake(cur);
+            cur = next;
+        }
+    }
+}
+
 void ipc_attach_process(struct process *proc)
 {
     if (!proc)
         return;
 
-    mailbox_init(&proc->ipc_mailbox);
+    proc->ipc_mailbox = NULL;
 
     for (size_t i = 0; i < CONFIG_IPC_CAPACITY_PER_PROC; ++i)
     {
@@ -331,6 +513,7 @@ void ipc_attach_process(struct process *proc)
     }
     proc->ipc_share_count = 0;
     proc->ipc_waiting = 0;
+    rendezvous_init(&proc->ipc_rv);
 }
 
 void ipc_detach_process(struct process *proc)
@@ -338,7 +521,7 @@ void ipc_detach_process(struct process *proc)
     if (!proc)
         return;
 
-    mailbox_clear(&proc->ipc_mailbox);
+    mailbox_release(proc);
 
     if (!ipc_initialized)
     {
@@ -382,6 +565,38 @@ void ipc_detach_process(struct process *proc)
     proc->ipc_waiting = 0;
 }
 
+int ipc_mailbox_pending(struct process *proc)
+{
+    if (!proc)
+        return 0;
+
+    int pending = 0;
+    struct ipc_mailbox_state *mailbox = proc->ipc_mailbox;
+    if (mailbox)
+    {
+        uint32_t flags;
+        struct mcs_node node;
+        mcs_lock_irqsave(&mailbox->lock, &node, &flags);
+        pending = mailbox->count;
+        mcs_unlock_irqrestore(&mailbox->lock, &node, flags);
+    }
+    return pending;
+}
+
+int ipc_call_pending(struct process *proc)
+{
+    if (!proc)
+        return 0;
+
+    int pending = 0;
+    uint32_t flags;
+    spinlock_lock_irqsave(&proc->ipc_rv.lock, &flags);
+    for (struct process *caller = proc->ipc_rv.callers_head; caller; caller = caller->ipc_rv.call_next)
+        ++pending;
+    spinlock_unlock_irqrestore(&proc->ipc_rv.lock, flags);
+    return pending;
+}
+
 int ipc_send(pid_t target, const void *msg, size_t size)
 {
     if (!ipc_initialized)
@@ -403,17 +618,24 @@ int ipc_send(pid_t target, const void *msg, size_t size)
         return -1;
 
     uint8_t buffer[CONFIG_MSG_DATA_MAX];
-    if (size > 0 && msg)
-    {
-        const uint8_t *source = (const uint8_t *)msg;
-        buffer_copy(buffer, source, size);
-    }
+    if (size > 0 && msg && buffer_copy(buffer, (const uint8_t *)msg, size) < 0)
+        return -EFAULT;
 
     pid_t sender_pid = sender_proc ? sender_proc->pid : 0;
     return mailbox_enqueue(target_proc, sender_pid, (size > 0) ? buffer : NULL, size, 0);
 }
 
 int ipc_recv(pid_t source, void *buffer, size_t max)
+{
+    return ipc_recv_timeout(source, buffer, max, 0);
+}
+
+int ipc_recv_timeout(pid_t source, void *buffer, size_t max, uint32_t timeout_ticks)
+{
+    return ipc_recv_from(source, buffer, max, timeout_ticks, NULL);
+}
+
+int ipc_recv_from(pid_t source, void *buffer, size_t max, uint32_t timeout_ticks, pid_t *out_sender)
 {
     if (!ipc_initialized)
         return -1;
@@ -424,6 +646,12 @@ int ipc_recv(pid_t source, void *buffer, size_t max)
 
     if (max > 0 && !buffer)
         return -1;
+    /* Probed before anything is dequeued so a bad pointer cannot lose a message. */
+    pid_t no_sender = IPC_INVALID_PID;
+    if (out_sender && buffer_copy((uint8_t *)out_sender, (const uint8_t *)&no_sender, sizeof(no_sender)) < 0)
+        return -EFAULT;
+
+    uint64_t deadline = timeout_ticks ? get_ticks() + (uint64_t)timeout_ticks : 0;
 
     for (;;)
     {
@@ -437,32 +665,235 @@ int ipc_recv(pid_t source, void *buffer, size_t max)
             }
 
             size_t to_copy = (message.size < max) ? message.size : max;
-            if (buffer && to_copy > 0)
-                buffer_copy((uint8_t *)buffer, message.data, to_copy);
-
             proc->ipc_waiting = 0;
+            if (buffer && to_copy > 0 && buffer_copy((uint8_t *)buffer, message.data, to_copy) < 0)
+                return -EFAULT;
+            if (out_sender && buffer_copy((uint8_t *)out_sender, (const uint8_t *)&message.sender, sizeof(message.sender)) < 0)
+                return -EFAULT;
             return (int)message.size;
         }
 
         if (proc->kind == THREAD_KIND_KERNEL)
             return 0;
 
-        struct ipc_mailbox_state *mailbox = &proc->ipc_mailbox;
+        int expired;
+        uint32_t remaining = timeout_remaining(deadline, &expired);
+        if (expired)
+            return 0;
+
+        struct ipc_mailbox_state *mailbox = mailbox_acquire(proc);
+        if (!mailbox)
+            return -1;
+
         uint32_t flags;
-        spinlock_lock_irqsave(&mailbox->lock, &flags);
+        struct mcs_node node;
+        mcs_lock_irqsave(&mailbox->lock, &node, &flags);
         int enqueued = mailbox_push_waiter(mailbox, proc->pid);
-        spinlock_unlock_irqrestore(&mailbox->lock, flags);
+        mcs_unlock_irqrestore(&mailbox->lock, &node, flags);
 
         if (!enqueued)
+        {
+            mailbox_put(mailbox);
             return -1;
+        }
 
         proc->ipc_waiting = 1;
-        process_block_current();
+        int timed_out = process_block_timeout(remaining);
         proc->ipc_waiting = 0;
+
+        if (timed_out)
+        {
+            mcs_lock_irqsave(&mailbox->lock, &node, &flags);
+            mailbox_remove_waiter(mailbox, proc->pid);
+            mcs_unlock_irqrestore(&mailbox->lock, &node, flags);
+        }
+        mailbox_put(mailbox);
     }
 }
 
-int ipc_share(pid_t target, void *addr, size_t pages)
+/*
+ * Synchronous call: the request is copied once, from the caller's buffer
+ * into the server's, and when the server is already waiting the CPU passes
+ * straight to it through process_handoff() instead of a wakeup.
+ */
+int ipc_call(pid_t target, const void *request, size_t request_size, void *reply, size_t reply_max)
+{
+    if (!ipc_initialized)
+        return -1;
+    if (target <= 0)
+        return -1;
+    if ((request_size > 0 && !request) || (reply_max > 0 && !reply))
+        return -1;
+
+    struct process *self = process_current();
+    struct process *server = process_lookup(target);
+    if (!self || !server || server == self)
+        return -1;
+    if (!capability_check(self, target, IPC_RIGHT_SEND) || !capability_check(server, self->pid, IPC_RIGHT_RECV))
+        return -1;
+
+    struct ipc_rendezvous *call = &self->ipc_rv;
+    call->call_next = NULL;
+    call->call_server = server;
+    call->call_request = request;
+    call->call_request_size = request_size;
+    call->call_reply = reply;
+    call->call_reply_max = reply_max;
+    call->call_reply_size = -1;
+    call->call_done = 0;
+
+    struct ipc_rendezvous *rv = &server->ipc_rv;
+    uint32_t flags;
+    spinlock_lock_irqsave(&rv->lock, &flags);
+    int direct = rv->receiving;
+    if (direct)
+    {
+        rv->recv_size = rendezvous_accept(rv, self, rv->recv_buffer, rv->recv_max);
+        rv->recv_client = self->pid;
+        rv->receiving = 0;
+    }
+    else
+    {
+        if (rv->callers_tail)
+            rv->callers_tail->ipc_rv.call_next = self;
+        else
+            rv->callers_head = self;
+        rv->callers_tail = self;
+    }
+    spinlock_unlock_irqrestore(&rv->lock, flags);
+
+    if (direct && process_handoff(server) < 0)
+        process_wake(server);
+    else if (!direct)
+        evset_notify(EVSET_SOURCE_CALLS, server->pid, 0);
+
+    self->ipc_waiting = 1;
+    while (!call->call_done)
+        process_block_current();
+    self->ipc_waiting = 0;
+    call->call_server = NULL;
+    return call->call_reply_size;
+}
+
+int ipc_reply_wait(pid_t client, const void *reply, size_t reply_size, pid_t *out_client, void *buffer, size_t max)
+{
+    if (!ipc_initialized)
+        return -1;
+    if ((reply_size > 0 && !reply) || (max > 0 && !buffer))
+        return -1;
+
+    struct process *self = process_current();
+    if (!self)
+        return -1;
+    /* Probed before anything is replied to or accepted, which cannot be undone. */
+    pid_t none = IPC_INVALID_PID;
+    if (out_client && buffer_copy((uint8_t *)out_client, (const uint8_t *)&none, sizeof(none)) < 0)
+        return -EFAULT;
+
+    struct ipc_rendezvous *rv = &self->ipc_rv;
+    struct process *replied = NULL;
+    uint32_t flags;
+    spinlock_lock_irqsave(&rv->lock, &flags);
+
+    if (client > 0)
+    {
+        struct process *caller = process_lookup(client);
+        if (!caller || !rendezvous_unlink(rv, caller))
+        {
+            spinlock_unlock_irqrestore(&rv->lock, flags);
+            return -1;
+        }
+        struct ipc_rendezvous *call = &caller->ipc_rv;
+        size_t to_copy = (reply_size < call->call_reply_max) ? reply_size : call->call_reply_max;
+        buffer_copy((uint8_t *)call->call_reply, (const uint8_t *)reply, to_copy);
+        call->call_reply_size = (int)to_copy;
+        call->call_done = 1;
+        replied = caller;
+    }
+
+    if (!out_client)
+    {
+        spinlock_unlock_irqrestore(&rv->lock, flags);
+        if (replied)
+            process_wake(replied);
+        return 0;
+    }
+
+    struct process *next = rv->callers_head;
+    if (next)
+    {
+        rv->callers_head = next->ipc_rv.call_next;
+        if (!rv->callers_head)
+            rv->callers_tail = NULL;
+        int size = rendezvous_accept(rv, next, buffer, max);
+        spinlock_unlock_irqrestore(&rv->lock, flags);
+        if (replied)
+            process_wake(replied);
+        pid_t client_pid = next->pid;
+        if (buffer_copy((uint8_t *)out_client, (const uint8_t *)&client_pid, sizeof(client_pid)) < 0)
+            return -EFAULT;
+        return size;
+    }
+
+    rv->recv_buffer = buffer;
+    rv->recv_max = max;
+    rv->recv_client = IPC_INVALID_PID;
+    rv->recv_size = 0;
+    rv->receiving = 1;
+    spinlock_unlock_irqrestore(&rv->lock, flags);
+
+    /* Nobody else to serve: run the client we just answered on our time. */
+    if (replied && process_handoff(replied) < 0)
+        process_wake(replied);
+
+    self->ipc_waiting = 1;
+    while (rv->receiving)
+        process_block_current();
+    self->ipc_waiting = 0;
+
+    pid_t client_pid = rv->recv_client;
+    if (buffer_copy((uint8_t *)out_client, (const uint8_t *)&client_pid, sizeof(client_pid)) < 0)
+        return -EFAULT;
+    return rv->recv_size;
+}
+
+int ipc_accept(pid_t *out_client, void *buffer, size_t max)
+{
+    if (!ipc_initialized)
+        return -1;
+    if (!out_client || (max > 0 && !buffer))
+        return -1;
+
+    struct process *self = process_current();
+    if (!self)
+        return -1;
+
+    /* Probed first: a caller taken off the queue must not be lost to a bad pointer. */
+    pid_t none = IPC_INVALID_PID;
+    if (buffer_copy((uint8_t *)out_client, (const uint8_t *)&none, sizeof(none)) < 0)
+        return -EFAULT;
+
+    struct ipc_rendezvous *rv = &self->ipc_rv;
+    uint32_t flags;
+    spinlock_lock_irqsave(&rv->lock, &flags);
+    struct process *next = rv->callers_head;
+    if (!next)
+    {
+        spinlock_unlock_irqrestore(&rv->lock, flags);
+        return -1;
+    }
+    rv->callers_head = next->ipc_rv.call_next;
+    if (!rv->callers_head)
+        rv->callers_tail = NULL;
+    int size = rendezvous_accept(rv, next, buffer, max);
+    pid_t client = next->pid;
+    spinlock_unlock_irqrestore(&rv->lock, flags);
+
+    buffer_copy((uint8_t *)out_client, (const uint8_t *)&client, sizeof(client));
+    return size;
+}
+
+static int share_create(pid_t target, void *addr, size_t pages, uint32_t record_flags)
 {
     if (!ipc_initialized)
         return -1;
@@ -513,7 +944,7 @@ int ipc_share(pid_t target, void *addr, size_t pages)
     share_table[slot].target = target;
     share_table[slot].addr = base;
     share_table[slot].pages = pages;
-    share_table[slot].flags = 0;
+    share_table[slot].flags = record_flags;
 
     if (share_attach_to_process(owner, slot) < 0 || share_attach_to_process(target_proc, slot) < 0)
     {
@@ -530,7 +961,121 @@ int ipc_share(pid_t target, void *addr, size_t pages)
     }
 
     spinlock_unlock_irqrestore(&share_lock, flags);
-    return 0;
+    return slot;
+}
+
+int ipc_share(pid_t target, void *addr, size_t pages)
+{
+    return share_create(target, addr, pages, 0);
+}
+
+/* Header of ring @p ring_id, provided the caller is one of its two ends. */
+static struct ipc_ring_header *ring_lookup(int ring_id)
+{
+    if (!ipc_initialized || ring_id < 0 || ring_id >= CONFIG_IPC_MAX_SHARED_REGIONS)
+        return NULL;
+
+    struct process *self = process_current();
+    if (!self)
+        return NULL;
+
+    struct ipc_ring_header *ring = NULL;
+    uint32_t flags;
+    spinlock_lock_irqsave(&share_lock, &flags);
+    struct ipc_share_record *record = &share_table[ring_id];
+    if (record->used && (record->flags & IPC_SHARE_FLAG_RING) &&
+        (record->owner == self->pid || record->target == self->pid || self->kind == THREAD_KIND_KERNEL))
+        ring = (struct ipc_ring_header *)record->addr;
+    spinlock_unlock_irqrestore(&share_lock, flags);
+
+    if (ring && ring->magic != IPC_RING_MAGIC)
+        return NULL;
+    return ring;
+}
+
+int ipc_ring_create(pid_t peer, void *addr, size_t pages, uint32_t slot_size, uint32_t ring_flags)
+{
+    if (slot_size == 0)
+        return -1;
+
+    int ring_id = share_create(peer, addr, pages, IPC_SHARE_FLAG_RING);
+    if (ring_id < 0)
+        return -1;
+
+    struct ipc_ring_header *ring = (struct ipc_ring_header *)addr;
+    ring->magic = 0;
+    if (ipc_ring_format(ring, pages * (size_t)CONFIG_IPC_PAGE_SIZE, slot_size, ring_flags & IPC_RING_MPSC) == 0)
+    {
+        struct process *self = process_current();
+        struct process *target_proc = process_lookup(peer);
+        uint32_t flags;
+        spinlock_lock_irqsave(&share_lock, &flags);
+        share_detach_from_process(self, ring_id);
+        share_detach_from_process(target_proc, ring_id);
+        share_table[ring_id].used = 0;
+        share_table[ring_id].owner = IPC_INVALID_PID;
+        share_table[ring_id].target = IPC_INVALID_PID;
+        share_table[ring_id].addr = 0;
+        share_table[ring_id].pages = 0;
+        share_table[ring_id].flags = 0;
+        spinlock_unlock_irqrestore(&share_lock, flags);
+        return -1;
+    }
+    return ring_id;
+}
+
+void *ipc_ring_attach(int ring_id)
+{
+    return ring_lookup(ring_id);
+}
+
+int ipc_ring_doorbell(int ring_id)
+{
+    struct ipc_ring_header *ring = ring_lookup(ring_id);
+    if (!ring)
+        return -1;
+
+    __sync_fetch_and_add(&ring_stats.doorbells, 1u);
+    __sync_fetch_and_add(&ring->doorbell, 1u);
+    return futex_wake(&ring->doorbell, 1u);
+}
+
+/*
+ * The consumer announces itself in consumer_waiting with a locked exchange
+ * before its last look at the ring; the producer publishes its slot and then
+ * takes consumer_waiting back to 0 with another exchange. One of the two
+ * always sees the other, so a message is never left behind a sleeping
+ * consumer, and only the producer that clears the flag rings the doorbell.
+ */
+int ipc_ring_wait(int ring_id, uint32_t timeout_ticks)
+{
+    struct ipc_ring_header *ring = ring_lookup(ring_id);
+    if (!ring)
+        return -1;
+
+    __sync_fetch_and_add(&ring_stats.waits, 1u);
+    int result = 0;
+    for (;;)
+    {
+        uint32_t seen = ring->doorbell;
+        __sync_lock_test_and_set(&ring->consumer_waiting, 1u);
+        if (!ipc_ring_empty(ring))
+            break;
+
+        __sync_fetch_and_add(&ring_stats.sleeps, 1u);
+        result = futex_wait(&ring->doorbell, seen, timeout_ticks);
+        if (result != 0)
+            break;
+    }
+    ring->consumer_waiting = 0;
+    return result;
+}
+
+void ipc_ring_get_stats(struct ipc_ring_stats *out)
+{
+    if (!out)
+        return;
+    *out = ring_stats;
 }
 
 int ipc_cap_grant(pid_t owner, pid_t target, uint32_t rights)
@@ -636,14 +1181,32 @@ int ipc_cap_query(pid_t owner, pid_t target, uint32_t *rights_out)
     return 0;
 }
 
-struct ipc_message_slot
+#define CHANNEL_RECORD_PAD 0xFFu
+
+/*
+ * Header of one message in a channel's byte ring; the payload follows,
+ * padded to four bytes. A record never wraps: when it would run past the
+ * end, the sender fills the tail with a CHANNEL_RECORD_PAD record (or leaves
+ * a gap too short for a header) and starts over at offset 0.
+ */
+struct channel_record
 {
     uint32_t header;
     uint32_t type;
-    uint32_t size;
-    uint32_t flags;
     int32_t sender_pid;
-    uint8_t data[CONFIG_MSG_DATA_MAX];
+    uint16_t size;
+    uint8_t flags;
+    /** Broadcast channels: subscribers that have not read the record yet. */
+    uint8_t refs;
+};
+
+/* Where one broadcast subscriber will read next. */
+struct channel_cursor
+{
+    uint32_t offset;
+    uint32_t seq;
+    /** Messages dropped under this subscriber since its last receive. */
+    uint32_t lost;
 };
 
 struct ipc_channel
@@ -652,13 +1215,29 @@ struct ipc_channel
     int id;
     uint32_t flags;
     char name[CONFIG_IPC_CHANNEL_NAME_MAX];
-    struct ipc_message_slot queue[CONFIG_IPC_CHANNEL_QUEUE_LEN];
-    uint8_t head;
-    uint8_t tail;
-    uint8_t count;
+    uint8_t *ring;
+    uint32_t ring_bytes;
+    uint32_t head;
+    uint32_t tail;
+    /** Bytes between head and tail, including padding. */
+    uint32_t used_bytes;
+    uint32_t count;
+    /** Sequence numbers of the oldest queued record and of the next one sent. */
+    uint32_t head_seq;
+    uint32_t next_seq;
+    uint32_t high_water;
+    uint32_t messages;
+    uint32_t drops;
+    uint32_t blocked_senders;
+    /** Broadcast records discarded before every subscriber had read them. */
+    uint32_t overruns;
     struct process *waiters[CONFIG_IPC_CHANNEL_WAITERS];
     uint8_t waiter_count;
+    /** Senders sleeping with IPC_SEND_WAIT until a receive frees room. */
+    struct process *send_waiters[CONFIG_IPC_CHANNEL_WAITERS];
+    uint8_t send_waiter_count;
     struct process *subscribers[CONFIG_IPC_CHANNEL_SUBSCRIBERS];
+    struct channel_cursor cursors[CONFIG_IPC_CHANNEL_SUBSCRIBERS];
     uint8_t subscriber_count;
     spinlock_t lock;
 };
@@ -743,28 +1322,193 @@ static void process_remove_channel(struct process *proc, int channel_id)
     }
 }
 
+static void waiter_list_remove(struct process **list, uint8_t *count, struct process *proc)
+{
+    for (uint8_t i = 0; i < *count; ++i)
+    {
+        if (list[i] == proc)
+        {
+            for (uint8_t j = i + 1; j < *count; ++j)
+                list[j - 1] = list[j];
+            list[*count - 1] = NULL;
+            --*count;
+            break;
+        }
+    }
+}
+
+static struct process *waiter_list_pop(struct process **list, uint8_t *count)
+{
+    if (*count == 0)
+        return NULL;
+
+    struct process *first = list[0];
+    waiter_list_remove(list, count, first);
+    return first;
+}
+
 static void channel_remove_waiter(struct ipc_channel *channel, struct process *proc)
 {
     if (!channel || !proc)
         return;
 
-    for (uint8_t i = 0; i < channel->waiter_count; ++i)
+    waiter_list_remove(channel->waiters, &channel->waiter_count, proc);
+    waiter_list_remove(channel->send_waiters, &channel->send_waiter_count, proc);
+}
+
+static uint32_t channel_record_bytes(size_t size)
+{
+    return (uint32_t)(sizeof(struct channel_record) + ((size + 3u) & ~(size_t)3u));
+}
+
+/* Offset for a record of @p need bytes, or -1 when the ring lacks room. Caller holds the lock. */
+static int channel_reserve(struct ipc_channel *channel, uint32_t need)
+{
+    uint32_t cap = channel->ring_bytes;
+    uint32_t tail = channel->tail;
+
+    if (channel->used_bytes == cap || tail < channel->head)
+        return (channel->head - tail >= need) ? (int)tail : -1;
+
+    if (cap - tail >= need)
+        return (int)tail;
+    if (channel->head < need)
+        return -1;
+
+    /* Skip the end of the ring; the receiver recognises the gap the same way. */
+    if (cap - tail >= sizeof(struct channel_record))
+        ((struct channel_record *)(channel->ring + tail))->flags = CHANNEL_RECORD_PAD;
+    channel->used_bytes += cap - tail;
+    channel->tail = 0;
+    return 0;
+}
+
+/* Offset of the record at or after @p offset, stepping over padding at the end of the ring. */
+static uint32_t channel_record_offset(const struct ipc_channel *channel, uint32_t offset)
+{
+    uint32_t cap = channel->ring_bytes;
+    if (cap - offset < sizeof(struct channel_record) ||
+        ((const struct channel_record *)(channel->ring + offset))->flags == CHANNEL_RECORD_PAD)
+        return 0;
+    return offset;
+}
+
+static uint32_t channel_next_offset(const struct ipc_channel *channel, uint32_t offset, const struct channel_record *record)
+{
+    offset += channel_record_bytes(record->size);
+    return (offset == channel->ring_bytes) ? 0 : offset;
+}
+
+/* Oldest record, releasing any padding ahead of it. Caller holds the lock. */
+static struct channel_record *channel_front(struct ipc_channel *channel)
+{
+    uint32_t offset = channel_record_offset(channel, channel->head);
+    if (offset != channel->head)
+    {
+        channel->used_bytes -= channel->ring_bytes - channel->head;
+        channel->head = 0;
+    }
+    return (struct channel_record *)(channel->ring + channel->head);
+}
+
+static void channel_drop_front(struct ipc_channel *channel)
+{
+    struct channel_record *record = channel_front(channel);
+    channel->used_bytes -= channel_record_bytes(record->size);
+    channel->head = channel_next_offset(channel, channel->head, record);
+    --channel->count;
+    ++channel->head_seq;
+    if (channel->count == 0)
+    {
+        channel->head = 0;
+        channel->tail = 0;
+        channel->used_bytes = 0;
+    }
+}
+
+/* Free leading broadcast records every subscriber has read; @return 1 if room was made. */
+static int channel_reclaim(struct ipc_channel *channel)
+{
+    int freed = 0;
+    while (channel->count > 0 && channel_front(channel)->refs == 0)
+    {
+        channel_drop_front(channel);
+        freed = 1;
+    }
+    return freed;
+}
+
+/* Drop-oldest overrun: discard the head record, moving readers still on it past it. */
+static void channel_overrun_front(struct ipc_channel *channel)
+{
+    uint32_t dropped_seq = channel->head_seq;
+    channel_drop_front(channel);
+    ++channel->overruns;
+    for (uint8_t i = 0; i < channel->subscriber_count; ++i)
+    {
+        struct channel_cursor *cursor = &channel->cursors[i];
+        if (cursor->seq != dropped_seq)
+            continue;
+        cursor->seq = dropped_seq + 1u;
+        cursor->offset = channel->head;
+        ++cursor->lost;
+    }
+}
+
+static int channel_subscriber_index(const struct ipc_channel *channel, const struct process *proc)
+{
+    for (uint8_t i = 0; i < channel->subscriber_count; ++i)
     {
-        if (channel->waiters[i] == proc)
+        if (channel->subscribers[i] == proc)
+            return (int)i;
+    }
+    return -1;
+}
+
+/*
+ * Remove @p proc from the subscriber list, giving back its references on
+ * records it never read. Caller holds the lock.
+ * @return 1 when that made room in the ring.
+ */
+static int channel_remove_subscriber(struct ipc_channel *channel, struct process *proc)
+{
+    int index = channel_subscriber_index(channel, proc);
+    if (index < 0)
+        return 0;
+
+    int freed = 0;
+    if (channel->flags & IPC_CHANNEL_BROADCAST)
+    {
+        struct channel_cursor *cursor = &channel->cursors[index];
+        uint32_t offset = cursor->offset;
+        for (uint32_t seq = cursor->seq; seq != channel->next_seq; ++seq)
         {
-            for (uint8_t j = i + 1; j < channel->waiter_count; ++j)
-                channel->waiters[j - 1] = channel->waiters[j];
-            channel->waiters[channel->waiter_count - 1] = NULL;
-            --channel->waiter_count;
-            break;
+            offset = channel_record_offset(channel, offset);
+            struct channel_record *record = (struct channel_record *)(channel->ring + offset);
+            if (record->refs)
+                --record->refs;
+            offset = channel_next_offset(channel, offset, record);
         }
     }
+
+    for (uint8_t j = (uint8_t)(index + 1); j < channel->subscriber_count; ++j)
+    {
+        channel->subscribers[j - 1] = channel->subscribers[j];
+        channel->cursors[j - 1] = channel->cursors[j];
+    }
+    channel->subscribers[channel->subscriber_count - 1] = NULL;
+    --channel->subscriber_count;
+
+    if (channel->flags & IPC_CHANNEL_BROADCAST)
+        freed = channel_reclaim(channel);
+    return freed;
 }
 
 void ipc_system_init(void)
 {
-    spinlock_init(&capability_lock);
-    spinlock_init(&share_lock);
+    spinlock_init_named(&capability_lock, "ipc.capability");
+    spinlock_init_named(&share_lock, "ipc.share");
+    spinlock_init_named(&mailbox_alloc_lock, "ipc.mailbox_alloc");
 
     for (size_t i = 0; i < CONFIG_IPC_MAX_SHARED_REGIONS; ++i)
     {
@@ -785,22 +1529,21 @@ void ipc_system_init(void)
         channel_table[i].id = 0;
         channel_table[i].flags = 0;
         channel_table[i].name[0] = '\0';
+        channel_table[i].ring = NULL;
+        channel_table[i].ring_bytes = 0;
         channel_table[i].head = 0;
         channel_table[i].tail = 0;
+        channel_table[i].used_bytes = 0;
         channel_table[i].count = 0;
         channel_table[i].waiter_count = 0;
+        channel_table[i].send_waiter_count = 0;
         channel_table[i].subscriber_count = 0;
-        spinlock_init(&channel_table[i].lock);
-        for (size_t j = 0; j < CONFIG_IPC_CHANNEL_QUEUE_LEN; ++j)
-        {
-            channel_table[i].queue[j].header = 0;
-            channel_table[i].queue[j].type = 0;
-            channel_table[i].queue[j].size = 0;
-            channel_table[i].queue[j].flags = 0;
-            channel_table[i].queue[j].sender_pid = -1;
-        }
+        spinlock_init_named(&channel_table[i].lock, "ipc.channel");
         for (size_t w = 0; w < CONFIG_IPC_CHANNEL_WAITERS; ++w)
+        {
             channel_table[i].waiters[w] = NULL;
+            channel_table[i].send_waiters[w] = NULL;
+        }
         for (size_t s = 0; s < CONFIG_IPC_CHANNEL_SUBSCRIBERS; ++s)
             channel_table[i].subscribers[s] = NULL;
     }
@@ -813,10 +1556,21 @@ void ipc_system_init(void)
         "svc.logger",
         "svc.scheduler"
     };
+    /* Sized for their traffic: log records are large, scheduler events are a few bytes each. */
+    const uint32_t service_bytes[IPC_SERVICE_COUNT] = {
+        CONFIG_IPC_CHANNEL_DEFAULT_BYTES,
+        CONFIG_IPC_CHANNEL_DEFAULT_BYTES,
+        CONFIG_IPC_CHANNEL_DEFAULT_BYTES * 4u,
+        CONFIG_IPC_CHANNEL_DEFAULT_BYTES
+    };
 
     for (int svc = 0; svc < IPC_SERVICE_COUNT; ++svc)
     {
-        int id = ipc_channel_create(service_names[svc], 0, IPC_CHANNEL_FLAG_KERNEL);
+        /* Event streams fan out to every listener; a slow one loses the oldest events, never blocks the kernel. */
+        uint32_t channel_flags = IPC_CHANNEL_FLAG_KERNEL;
+        if (svc != IPC_SERVICE_MODULE_LOADER)
+            channel_flags |= IPC_CHANNEL_BROADCAST;
+        int id = ipc_channel_create_sized(service_names[svc], 0, channel_flags, service_bytes[svc]);
         if (id < 0)
         {
             klog_error("ipc: failed to create service channel");
@@ -833,6 +1587,24 @@ void ipc_system_init(void)
 
 int ipc_channel_create(const char *name, size_t name_len, uint32_t flags)
 {
+    return ipc_channel_create_sized(name, name_len, flags, 0);
+}
+
+int ipc_channel_create_sized(const char *name, size_t name_len, uint32_t flags, uint32_t ring_bytes)
+{
+    if (ring_bytes == 0)
+        ring_bytes = CONFIG_IPC_CHANNEL_DEFAULT_BYTES;
+    if (ring_bytes > CONFIG_IPC_CHANNEL_MAX_BYTES)
+        ring_bytes = CONFIG_IPC_CHANNEL_MAX_BYTES;
+    ring_bytes = (ring_bytes + 3u) & ~3u;
+    /* Whatever the hint, one largest message must fit. */
+    if (ring_bytes < channel_record_bytes(CONFIG_MSG_DATA_MAX))
+        ring_bytes = channel_record_bytes(CONFIG_MSG_DATA_MAX);
+
+    uint8_t *ring = (uint8_t *)kalloc(ring_bytes);
+    if (!ring)
+        return -1;
+
     for (size_t i = 0; i < CONFIG_IPC_MAX_CHANNELS; ++i)
     {
         if (channel_table[i].used)
@@ -841,10 +1613,21 @@ int ipc_channel_create(const char *name, size_t name_len, uint32_t flags)
         channel_table[i].used = 1;
         channel_table[i].id = next_channel_id++;
         channel_table[i].flags = flags;
+        channel_table[i].ring = ring;
+        channel_table[i].ring_bytes = ring_bytes;
         channel_table[i].head = 0;
         channel_table[i].tail = 0;
+        channel_table[i].used_bytes = 0;
         channel_table[i].count = 0;
+        channel_table[i].head_seq = 0;
+        channel_table[i].next_seq = 0;
+        channel_table[i].high_water = 0;
+        channel_table[i].messages = 0;
+        channel_table[i].drops = 0;
+        channel_table[i].blocked_senders = 0;
+        channel_table[i].overruns = 0;
         channel_table[i].waiter_count = 0;
+        channel_table[i].send_waiter_count = 0;
         channel_table[i].subscriber_count = 0;
 
         size_t effective_len = name_len;
@@ -858,6 +1641,7 @@ int ipc_channel_create(const char *name, size_t name_len, uint32_t flags)
         return channel_table[i].id;
     }
 
+    kfree(ring);
     return -1;
 }
 
@@ -892,6 +1676,11 @@ int ipc_channel_join(struct process *proc, int channel_id)
         return -1;
     }
 
+    /* A new broadcast subscriber sees only messages sent from now on. */
+    struct channel_cursor *cursor = &channel->cursors[channel->subscriber_count];
+    cursor->offset = channel->tail;
+    cursor->seq = channel->next_seq;
+    cursor->lost = 0;
     channel->subscribers[channel->subscriber_count++] = proc;
     spinlock_unlock_irqrestore(&channel->lock, flags);
     return 0;
@@ -910,29 +1699,18 @@ int ipc_channel_leave(struct process *proc, int channel_id)
 
     uint32_t flags;
     spinlock_lock_irqsave(&channel->lock, &flags);
-
-    for (uint8_t i = 0; i < channel->subscriber_count; ++i)
-    {
-        if (channel->subscribers[i] == proc)
-        {
-            for (uint8_t j = i + 1; j < channel->subscriber_count; ++j)
-                channel->subscribers[j - 1] = channel->subscribers[j];
-            channel->subscribers[channel->subscriber_count - 1] = NULL;
-            --channel->subscriber_count;
-            break;
-        }
-    }
-
+    int freed = channel_remove_subscriber(channel, proc);
     channel_remove_waiter(channel, proc);
-
+    struct process *sender = freed ? waiter_list_pop(channel->send_waiters, &channel->send_waiter_count) : NULL;
     spinlock_unlock_irqrestore(&channel->lock, flags);
+
+    if (sender)
+        process_wake(sender);
     return 0;
 }
 
 int ipc_channel_send(int channel_id, int sender_pid, uint32_t header, uint32_t type, const void *data, size_t size, uint32_t flags)
 {
-    (void)flags;
-
     if (size > CONFIG_MSG_DATA_MAX)
         return -1;
 
@@ -951,52 +1729,104 @@ int ipc_channel_send(int channel_id, int sender_pid, uint32_t header, uint32_t t
             return -1;
     }
 
-    uint32_t irq_flags;
-    spinlock_lock_irqsave(&channel->lock, &irq_flags);
+    int broadcast = (channel->flags & IPC_CHANNEL_BROADCAST) != 0;
+    int drop_oldest = broadcast && !(channel->flags & IPC_CHANNEL_OVERRUN_BLOCK);
+    /* Only a sender running in its own context may sleep for room. */
+    int may_block = ((flags & IPC_SEND_WAIT) || (broadcast && !drop_oldest)) && sender_proc && sender_proc == process_current();
+    uint32_t need = channel_record_bytes(size);
+    int counted_block = 0;
 
-    if (channel->count >= CONFIG_IPC_CHANNEL_QUEUE_LEN)
+    uint32_t irq_flags;
+    int offset;
+    for (;;)
     {
+        spinlock_lock_irqsave(&channel->lock, &irq_flags);
+        if (counted_block)
+            waiter_list_remove(channel->send_waiters, &channel->send_waiter_count, sender_proc);
+        if (broadcast && channel->subscriber_count == 0)
+        {
+            /* Nobody is listening, so there is nothing to keep. */
+            ++channel->messages;
+            spinlock_unlock_irqrestore(&channel->lock, irq_flags);
+            return (int)size;
+        }
+        offset = channel_reserve(channel, need);
+        while (offset < 0 && drop_oldest && channel->count > 0)
+        {
+            channel_overrun_front(channel);
+            offset = channel_reserve(channel, need);
+        }
+        if (offset >= 0)
+            break;
+
+        if (!may_block || channel->send_waiter_count >= CONFIG_IPC_CHANNEL_WAITERS)
+        {
+            ++channel->drops;
+            spinlock_unlock_irqrestore(&channel->lock, irq_flags);
+            return -1;
+        }
+        if (!counted_block)
+        {
+            ++channel->blocked_senders;
+            counted_block = 1;
+        }
+        channel->send_waiters[channel->send_waiter_count++] = sender_proc;
         spinlock_unlock_irqrestore(&channel->lock, irq_flags);
-        return -1;
+        process_block_current();
     }
 
-    struct ipc_message_slot *slot = &channel->queue[channel->tail];
-    slot->header = header;
-    slot->type = type;
-    slot->size = (uint32_t)size;
-    slot->flags = flags;
-    slot->sender_pid = sender_pid;
+    struct channel_record *record = (struct channel_record *)(channel->ring + offset);
+    record->header = header;
+    record->type = type;
+    record->sender_pid = sender_pid;
+    record->size = (uint16_t)size;
+    record->flags = (uint8_t)(flags & ~IPC_SEND_WAIT);
+    record->refs = broadcast ? channel->subscriber_count : 0;
     if (size > 0 && data)
+        buffer_copy((uint8_t *)(record + 1), (const uint8_t *)data, size);
+
+    /* Subscribers that had read everything pick up here. */
+    for (uint8_t i = 0; broadcast && i < channel->subscriber_count; ++i)
     {
-        const uint8_t *src = (const uint8_t *)data;
-        for (size_t i = 0; i < size; ++i)
-            slot->data[i] = src[i];
+        if (channel->cursors[i].seq == channel->next_seq)
+            channel->cursors[i].offset = (uint32_t)offset;
     }
 
-    channel->tail = (uint8_t)((channel->tail + 1) % CONFIG_IPC_CHANNEL_QUEUE_LEN);
+    channel->tail = (uint32_t)offset + need;
+    if (channel->tail == channel->ring_bytes)
+        channel->tail = 0;
+    channel->used_bytes += need;
     ++channel->count;
-
-    struct process *wakeup_proc = NULL;
-    if (channel->waiter_count > 0)
+    ++channel->next_seq;
+    ++channel->messages;
+    if (channel->used_bytes > channel->high_water)
+        channel->high_water = channel->used_bytes;
+
+    /* Unicast hands the message to one receiver; broadcast collects every sleeper and wakes them in one pass. */
+    struct process *wake[CONFIG_IPC_CHANNEL_WAITERS];
+    uint8_t wake_count = 0;
+    while (channel->waiter_count > 0 && (broadcast || wake_count == 0))
     {
-        wakeup_proc = channel->waiters[0];
-        for (uint8_t i = 1; i < channel->waiter_count; ++i)
-            channel->waiters[i - 1] = channel->waiters[i];
-        channel->waiters[channel->waiter_count - 1] = NULL;
-        --channel->waiter_count;
-        if (wakeup_proc)
-            wakeup_proc->wait_channel = -1;
+        struct process *proc = waiter_list_pop(channel->waiters, &channel->waiter_count);
+        proc->wait_channel = -1;
+        wake[wake_count++] = proc;
     }
 
     spinlock_unlock_irqrestore(&channel->lock, irq_flags);
 
-    if (wakeup_proc)
-        process_wake(wakeup_proc);
+    for (uint8_t i = 0; i < wake_count; ++i)
+        process_wake(wake[i]);
+    evset_notify(EVSET_SOURCE_CHANNEL, channel_id, 0);
 
     return (int)size;
 }
 
 int ipc_channel_receive(struct process *proc, int channel_id, struct ipc_message *out, void *buffer, size_t buffer_len, uint32_t flags)
+{
+    return ipc_channel_receive_timeout(proc, channel_id, out, buffer, buffer_len, flags, 0);
+}
+
+int ipc_channel_receive_timeout(struct process *proc, int channel_id, struct ipc_message *out, void *buffer, size_t buffer_len, uint32_t flags, uint32_t timeout_ticks)
 {
     if (!proc)
         return -1;
@@ -1008,45 +1838,79 @@ int ipc_channel_receive(struct process *proc, int channel_id, struct ipc_message
     if (!process_has_channel(proc, channel_id) && !(channel->flags & IPC_CHANNEL_FLAG_KERNEL))
         return -1;
 
+    int broadcast = (channel->flags & IPC_CHANNEL_BROADCAST) != 0;
+    uint64_t deadline = timeout_ticks ? get_ticks() + (uint64_t)timeout_ticks : 0;
+
     for (;;)
     {
         uint32_t irq_flags;
         spinlock_lock_irqsave(&channel->lock, &irq_flags);
 
-        if (channel->count > 0)
+        struct channel_cursor *cursor = NULL;
+        if (broadcast)
         {
-            struct ipc_message_slot *slot = &channel->queue[channel->head];
-            channel->head = (uint8_t)((channel->head + 1) % CONFIG_IPC_CHANNEL_QUEUE_LEN);
-            --channel->count;
+            int index = channel_subscriber_index(channel, proc);
+            if (index < 0)
+            {
+                spinlock_unlock_irqrestore(&channel->lock, irq_flags);
+                return -1;
+            }
+            cursor = &channel->cursors[index];
+        }
+
+        if (cursor ? cursor->seq != channel->next_seq : channel->count > 0)
+        {
+            uint32_t offset = cursor ? channel_record_offset(channel, cursor->offset) : 0;
+            struct channel_record *record = cursor ? (struct channel_record *)(channel->ring + offset) : channel_front(channel);
 
             if (out)
             {
-                out->header = slot->header;
-                out->type = slot->type;
-                out->sender_pid = slot->sender_pid;
-                out->size = slot->size;
+                out->header = record->header;
+                out->type = record->type;
+                out->sender_pid = record->sender_pid;
+                out->size = record->size;
                 out->data = buffer;
             }
 
-            size_t copy_len = local_min(slot->size, buffer_len);
-            if (slot->size > buffer_len && out)
+            size_t copy_len = local_min(record->size, buffer_len);
+            if (record->size > buffer_len && out)
                 out->header |= IPC_MESSAGE_TRUNCATED;
 
             if (buffer && copy_len > 0)
+                buffer_copy((uint8_t *)buffer, (const uint8_t *)(record + 1), copy_len);
+
+            int freed = 1;
+            if (cursor)
+            {
+                if (cursor->lost && out)
+                    out->header |= IPC_MESSAGE_OVERRUN;
+                cursor->lost = 0;
+                cursor->offset = channel_next_offset(channel, offset, record);
+                ++cursor->seq;
+                if (record->refs)
+                    --record->refs;
+                freed = channel_reclaim(channel);
+            }
+            else
             {
-                uint8_t *dst = (uint8_t *)buffer;
-                for (size_t i = 0; i < copy_len; ++i)
-                    dst[i] = slot->data[i];
+                channel_drop_front(channel);
             }
 
+            struct process *sender = freed ? waiter_list_pop(channel->send_waiters, &channel->send_waiter_count) : NULL;
             spinlock_unlock_irqrestore(&channel->lock, irq_flags);
+            if (sender)
+                process_wake(sender);
             proc->wait_channel = -1;
             return 1;
         }
 
-        if (flags & IPC_RECV_NONBLOCK)
+        int expired;
+        uint32_t remaining = timeout_remaining(deadline, &expired);
+        if ((flags & IPC_RECV_NONBLOCK) || expired)
         {
+            channel_remove_waiter(channel, proc);
             spinlock_unlock_irqrestore(&channel->lock, irq_flags);
+            proc->wait_channel = -1;
             return 0;
         }
 
@@ -1072,21 +1936,74 @@ int ipc_channel_receive(struct process *proc, int channel_id, struct ipc_message
         }
 
         spinlock_unlock_irqrestore(&channel->lock, irq_flags);
-        process_block_current();
+        process_block_timeout(remaining);
     }
 }
 
-int ipc_channel_peek(int channel_id)
+int ipc_channel_ready(struct process *proc, int channel_id)
 {
     struct ipc_channel *channel = find_channel(channel_id);
-    if (!channel)
+    if (!channel || !proc)
+        return -1;
+    if (!process_has_channel(proc, channel_id) && !(channel->flags & IPC_CHANNEL_FLAG_KERNEL))
         return -1;
 
+    int ready = -1;
     uint32_t flags;
     spinlock_lock_irqsave(&channel->lock, &flags);
-    int has_message = (channel->count > 0) ? 1 : 0;
+    if (channel->flags & IPC_CHANNEL_BROADCAST)
+    {
+        int index = channel_subscriber_index(channel, proc);
+        if (index >= 0)
+            ready = (int)(channel->next_seq - channel->cursors[index].seq);
+    }
+    else
+    {
+        ready = (int)channel->count;
+    }
     spinlock_unlock_irqrestore(&channel->lock, flags);
-    return has_message;
+    return ready;
+}
+
+int ipc_channel_peek(struct process *proc, int channel_id)
+{
+    /* Broadcast subscribers see the records past their own cursor, as in receive. */
+    int ready = ipc_channel_ready(proc, channel_id);
+    if (ready < 0)
+        return -1;
+    return ready > 0 ? 1 : 0;
+}
+
+size_t ipc_channel_snapshot(struct ipc_channel_stats *out, size_t capacity)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < CONFIG_IPC_MAX_CHANNELS; ++i)
+    {
+        struct ipc_channel *channel = &channel_table[i];
+        if (!channel->used)
+            continue;
+        if (out && count < capacity)
+        {
+            struct ipc_channel_stats *entry = &out[count];
+            uint32_t flags;
+            spinlock_lock_irqsave(&channel->lock, &flags);
+            entry->id = channel->id;
+            channel_name_copy(entry->name, sizeof(entry->name), channel->name, sizeof(channel->name));
+            entry->capacity = channel->ring_bytes;
+            entry->used = channel->used_bytes;
+            entry->high_water = channel->high_water;
+            entry->queued = channel->count;
+            entry->messages = channel->messages;
+            entry->drops = channel->drops;
+            entry->blocked_senders = channel->blocked_senders;
+            entry->overruns = channel->overruns;
+            entry->subscribers = channel->subscriber_count;
+            entry->broadcast = (channel->flags & IPC_CHANNEL_BROADCAST) != 0;
+            spinlock_unlock_irqrestore(&channel->lock, flags);
+        }
+        ++count;
+    }
+    return count;
 }
 
 int ipc_get_service_channel(enum ipc_service_channel service)
@@ -1106,6 +2023,21 @@ void ipc_process_cleanup(struct process *proc)
     if (!proc)
         return;
 
+    uint32_t flags;
+    struct ipc_rendezvous *rv = &proc->ipc_rv;
+    spinlock_lock_irqsave(&rv->lock, &flags);
+    rendezvous_abort_callers(rv);
+    spinlock_unlock_irqrestore(&rv->lock, flags);
+
+    struct process *server = rv->call_server;
+    if (server && !rv->call_done)
+    {
+        spinlock_lock_irqsave(&server->ipc_rv.lock, &flags);
+        rendezvous_unlink(&server->ipc_rv, proc);
+        spinlock_unlock_irqrestore(&server->ipc_rv.lock, flags);
+    }
+    rv->call_server = NULL;
+
     ipc_detach_process(proc);
 
     for (uint8_t slot = 0; slot < proc->channel_count; ++slot)
@@ -1117,22 +2049,13 @@ void ipc_process_cleanup(struct process *proc)
 
         uint32_t flags;
         spinlock_lock_irqsave(&channel->lock, &flags);
-
-        for (uint8_t i = 0; i < channel->subscriber_count; ++i)
-        {
-            if (channel->subscribers[i] == proc)
-            {
-                for (uint8_t j = i + 1; j < channel->subscriber_count; ++j)
-                    channel->subscribers[j - 1] = channel->subscribers[j];
-                channel->subscribers[channel->subscriber_count - 1] = NULL;
-                --channel->subscriber_count;
-                break;
-            }
-        }
-
+        int freed = channel_remove_subscriber(channel, proc);
         channel_remove_waiter(channel, proc);
-
+        struct process *sender = freed ? waiter_list_pop(channel->send_waiters, &channel->send_waiter_count) : NULL;
         spinlock_unlock_irqrestore(&channel->lock, flags);
+
+        if (sender)
+            process_wake(sender);
     }
 
     for (uint8_t i = 0; i < CONFIG_PROCESS_CHANNEL_SLOTS; ++i)
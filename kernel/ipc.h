@@ -6,25 +6,146 @@
 
 struct process;
 
+/**
+ * @brief Kernel entries made for ring channels since boot.
+ *
+ * Messages themselves never pass through the kernel; these only count the
+ * doorbells producers rang and the times a consumer had to wait.
+ */
+struct ipc_ring_stats
+{
+    uint32_t doorbells;
+    uint32_t waits;
+    /** Waits that found the ring still empty and slept. */
+    uint32_t sleeps;
+};
+
 void ipc_system_init(void);
 void ipc_attach_process(struct process *proc);
 void ipc_detach_process(struct process *proc);
 
 int ipc_send(pid_t target, const void *msg, size_t size);
 int ipc_recv(pid_t source, void *buffer, size_t max);
+/** Like ipc_recv() but gives up after @p timeout_ticks (0 = wait forever) and returns 0. */
+int ipc_recv_timeout(pid_t source, void *buffer, size_t max, uint32_t timeout_ticks);
+/** Like ipc_recv_timeout() and also stores the sender's pid in @p out_sender when non-NULL. */
+int ipc_recv_from(pid_t source, void *buffer, size_t max, uint32_t timeout_ticks, pid_t *out_sender);
+/** @return messages waiting in @p proc's mailbox; ipc_call() callers are not counted. */
+int ipc_mailbox_pending(struct process *proc);
+/** @return ipc_call() callers queued on @p proc and not yet accepted. */
+int ipc_call_pending(struct process *proc);
+/** @return the share id of the new region, or -1. */
 int ipc_share(pid_t target, void *addr, size_t pages);
 
+/**
+ * @brief Share @p pages at @p addr with @p peer and lay an ipc_ring_header over them.
+ *
+ * Both sides then move messages through the slots directly (see ipc_ring.h);
+ * the kernel is only entered to sleep on an empty ring or to wake a
+ * consumer that does.
+ *
+ * @param slot_size largest message the ring must hold, in bytes.
+ * @param ring_flags IPC_RING_MPSC when more than one thread produces.
+ * @return the ring id, or -1.
+ */
+int ipc_ring_create(pid_t peer, void *addr, size_t pages, uint32_t slot_size, uint32_t ring_flags);
+/** @return the header of ring @p ring_id, or NULL unless the caller is one of its ends. */
+void *ipc_ring_attach(int ring_id);
+/** Wake the consumer parked in ipc_ring_wait(); producers call it only when ipc_ring_commit() says so. */
+int ipc_ring_doorbell(int ring_id);
+/**
+ * @brief Sleep until ring @p ring_id holds a message.
+ *
+ * @param timeout_ticks PIT ticks per sleep; 0 waits until a doorbell.
+ * @return 0 once the ring is non-empty, 1 on timeout, -1 on a bad id.
+ */
+int ipc_ring_wait(int ring_id, uint32_t timeout_ticks);
+void ipc_ring_get_stats(struct ipc_ring_stats *out);
+
+/**
+ * @brief Send @p request to @p target and sleep until it replies.
+ *
+ * If the server is already blocked in ipc_reply_wait() the request lands
+ * directly in its buffer and this CPU switches straight to it; otherwise the
+ * caller queues in arrival order.
+ *
+ * @return bytes copied into @p reply, or -1 on error or if the server exits.
+ */
+int ipc_call(pid_t target, const void *request, size_t request_size, void *reply, size_t reply_max);
+/**
+ * @brief Server side of ipc_call(): answer @p client, then wait for the next call.
+ *
+ * Pass @p client <= 0 to only wait. With @p out_client NULL the reply is sent
+ * and the call returns 0 without waiting. When no caller is queued the CPU
+ * goes straight back to the client just answered.
+ *
+ * @return size of the next request (it may exceed @p max; the copy is cut
+ *         short), with its sender in *@p out_client, -EFAULT if
+ *         @p out_client cannot be written, or -1 on error.
+ */
+int ipc_reply_wait(pid_t client, const void *reply, size_t reply_size, pid_t *out_client, void *buffer, size_t max);
+/**
+ * @brief Take the oldest queued ipc_call() without blocking.
+ *
+ * For servers that multiplex calls with other sources through an event set;
+ * answer the caller with ipc_reply_wait(client, ..., NULL, NULL, 0).
+ *
+ * @return size of the request with its sender in *@p out_client, or -1 if
+ *         no caller is queued.
+ */
+int ipc_accept(pid_t *out_client, void *buffer, size_t max);
+
 int ipc_cap_grant(pid_t owner, pid_t target, uint32_t rights);
 int ipc_cap_revoke(pid_t owner, pid_t target, uint32_t rights);
 int ipc_cap_query(pid_t owner, pid_t target, uint32_t *rights_out);
 
+/**
+ * @brief Back-pressure counters for one channel, as reported in /System/channels.
+ *
+ * Byte counts include record headers and padding.
+ */
+struct ipc_channel_stats
+{
+    int id;
+    char name[CONFIG_IPC_CHANNEL_NAME_MAX];
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t high_water;
+    uint32_t queued;
+    uint32_t messages;
+    /** Sends refused because the ring was full. */
+    uint32_t drops;
+    /** Sends that slept until a receive made room. */
+    uint32_t blocked_senders;
+    /** Broadcast messages dropped before every subscriber had read them. */
+    uint32_t overruns;
+    uint32_t subscribers;
+    int broadcast;
+};
+
 /* Legacy channel-based IPC (to be retired). */
+/** Create a channel whose ring holds CONFIG_IPC_CHANNEL_DEFAULT_BYTES of messages. */
 int ipc_channel_create(const char *name, size_t name_len, uint32_t flags);
+/**
+ * @brief Create a channel queueing up to @p ring_bytes of variable-length records.
+ *
+ * Each message costs a 16-byte header plus its payload rounded up to four
+ * bytes, so a ring fits many small events or a few large ones. 0 picks the
+ * default; the size is clamped to CONFIG_IPC_CHANNEL_MAX_BYTES and to at
+ * least one CONFIG_MSG_DATA_MAX message.
+ */
+int ipc_channel_create_sized(const char *name, size_t name_len, uint32_t flags, uint32_t ring_bytes);
 int ipc_channel_join(struct process *proc, int channel_id);
 int ipc_channel_leave(struct process *proc, int channel_id);
 int ipc_channel_send(int channel_id, int sender_pid, uint32_t header, uint32_t type, const void *data, size_t size, uint32_t flags);
 int ipc_channel_receive(struct process *proc, int channel_id, struct ipc_message *out, void *buffer, size_t buffer_len, uint32_t flags);
-int ipc_channel_peek(int channel_id);
+int ipc_channel_receive_timeout(struct process *proc, int channel_id, struct ipc_message *out, void *buffer, size_t buffer_len, uint32_t flags, uint32_t timeout_ticks);
+/** @return 1 if ipc_channel_receive() would return a message to @p proc now, 0 if not, -1 on error. */
+int ipc_channel_peek(struct process *proc, int channel_id);
+/** @return messages @p proc could receive from the channel now, or -1 if it may not receive there. */
+int ipc_channel_ready(struct process *proc, int channel_id);
+/** @return the number of channels in use, copying up to @p capacity of them. */
+size_t ipc_channel_snapshot(struct ipc_channel_stats *out, size_t capacity);
 int ipc_get_service_channel(enum ipc_service_channel service);
 int ipc_is_initialized(void);
 void ipc_process_cleanup(struct process *proc);
@@ -0,0 +1,179 @@
+#ifndef IPC_RING_H
+#define IPC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IPC_RING_MAGIC     0x474E4952u
+#define IPC_RING_CACHELINE 64u
+/** Producers claim slots with a compare-and-swap; without it there must be one producer. */
+#define IPC_RING_MPSC      (1u << 0)
+
+/**
+ * @brief Ring channel header at the start of a region shared with ipc_share().
+ *
+ * Slots follow the header, each @c slot_size bytes and cache-line aligned.
+ * Every slot carries a sequence number: @c pos while free for the producer
+ * that claims position @c pos, @c pos + 1 once that producer has filled it,
+ * and @c pos + slot_count after the consumer hands it back. Producers and the
+ * consumer only ever exchange slots this way, so neither side takes a lock
+ * or enters the kernel to move data. The producer, consumer and doorbell
+ * fields sit on separate cache lines so the two sides do not ping-pong one
+ * line on every message.
+ */
+struct ipc_ring_header
+{
+    uint32_t magic;
+    uint32_t flags;
+    uint32_t slot_size;
+    /** Power of two. */
+    uint32_t slot_count;
+    uint8_t pad0[IPC_RING_CACHELINE - 16u];
+
+    /** Next position a producer will claim. */
+    volatile uint32_t tail;
+    uint8_t pad1[IPC_RING_CACHELINE - 4u];
+
+    /** Next position the consumer will read. */
+    volatile uint32_t head;
+    uint8_t pad2[IPC_RING_CACHELINE - 4u];
+
+    /** Set by the consumer before it sleeps in the kernel; the first producer to clear it rings the doorbell. */
+    volatile uint32_t consumer_waiting;
+    /** Bumped by the kernel on each doorbell; the consumer sleeps on it. */
+    volatile uint32_t doorbell;
+    uint8_t pad3[IPC_RING_CACHELINE - 8u];
+};
+
+struct ipc_ring_slot
+{
+    volatile uint32_t seq;
+    uint32_t length;
+    uint8_t data[];
+};
+
+static inline struct ipc_ring_slot *ipc_ring_slot_at(struct ipc_ring_header *ring, uint32_t pos)
+{
+    uint8_t *base = (uint8_t *)ring + sizeof(struct ipc_ring_header);
+    return (struct ipc_ring_slot *)(base + (size_t)(pos & (ring->slot_count - 1u)) * ring->slot_size);
+}
+
+/** Payload bytes one slot can hold. */
+static inline uint32_t ipc_ring_slot_capacity(const struct ipc_ring_header *ring)
+{
+    return ring->slot_size - (uint32_t)sizeof(struct ipc_ring_slot);
+}
+
+/**
+ * @brief Lay out a ring over @p bytes of memory at @p ring.
+ *
+ * @p slot_size is rounded up to a whole number of cache lines and the slot
+ * count down to a power of two.
+ * @return the slot count, or 0 if not even two slots fit.
+ */
+static inline uint32_t ipc_ring_format(struct ipc_ring_header *ring, size_t bytes, uint32_t slot_size, uint32_t flags)
+{
+    slot_size += (uint32_t)sizeof(struct ipc_ring_slot);
+    slot_size = (slot_size + IPC_RING_CACHELINE - 1u) & ~(IPC_RING_CACHELINE - 1u);
+    if (bytes < sizeof(struct ipc_ring_header) + 2u * (size_t)slot_size)
+        return 0;
+
+    uint32_t fit = (uint32_t)((bytes - sizeof(struct ipc_ring_header)) / slot_size);
+    uint32_t count = 1u;
+    while ((count << 1) <= fit)
+        count <<= 1;
+
+    ring->flags = flags;
+    ring->slot_size = slot_size;
+    ring->slot_count = count;
+    ring->tail = 0;
+    ring->head = 0;
+    ring->consumer_waiting = 0;
+    ring->doorbell = 0;
+    for (uint32_t i = 0; i < count; ++i)
+        ipc_ring_slot_at(ring, i)->seq = i;
+    __sync_synchronize();
+    ring->magic = IPC_RING_MAGIC;
+    return count;
+}
+
+/**
+ * @brief Claim the next free slot so the producer can build the message in place.
+ *
+ * @return the slot, or NULL while the ring is full. *@p pos_out identifies
+ *         the claim for ipc_ring_commit().
+ */
+static inline struct ipc_ring_slot *ipc_ring_reserve(struct ipc_ring_header *ring, uint32_t *pos_out)
+{
+    uint32_t pos = ring->tail;
+    for (;;)
+    {
+        struct ipc_ring_slot *slot = ipc_ring_slot_at(ring, pos);
+        int32_t diff = (int32_t)(slot->seq - pos);
+        if (diff < 0)
+            return NULL;
+        if (diff > 0)
+        {
+            pos = ring->tail;
+            continue;
+        }
+
+        if (!(ring->flags & IPC_RING_MPSC))
+        {
+            ring->tail = pos + 1u;
+            *pos_out = pos;
+            return slot;
+        }
+        uint32_t seen = __sync_val_compare_and_swap(&ring->tail, pos, pos + 1u);
+        if (seen == pos)
+        {
+            *pos_out = pos;
+            return slot;
+        }
+        pos = seen;
+    }
+}
+
+/**
+ * @brief Publish a reserved slot holding @p length bytes.
+ *
+ * @return 1 when the consumer is parked in the kernel and needs the doorbell.
+ *         The caller claims the flag, so only one post per sleep traps.
+ */
+static inline int ipc_ring_commit(struct ipc_ring_header *ring, struct ipc_ring_slot *slot, uint32_t pos, uint32_t length)
+{
+    slot->length = length;
+    __asm__ __volatile__("" ::: "memory");
+    slot->seq = pos + 1u;
+    /* xchg is a full fence on x86, ordering the publish before the check; pairs with the consumer's xchg. */
+    __asm__ __volatile__("" ::: "memory");
+    return __sync_lock_test_and_set(&ring->consumer_waiting, 0u) != 0;
+}
+
+/** @return the oldest filled slot, or NULL while the ring is empty. */
+static inline struct ipc_ring_slot *ipc_ring_peek(struct ipc_ring_header *ring)
+{
+    uint32_t pos = ring->head;
+    struct ipc_ring_slot *slot = ipc_ring_slot_at(ring, pos);
+    if (slot->seq != pos + 1u)
+        return NULL;
+    __asm__ __volatile__("" ::: "memory");
+    return slot;
+}
+
+/** Hand the slot returned by ipc_ring_peek() back to the producers. */
+static inline void ipc_ring_release(struct ipc_ring_header *ring, struct ipc_ring_slot *slot)
+{
+    uint32_t pos = ring->head;
+    __asm__ __volatile__("" ::: "memory");
+    slot->seq = pos + ring->slot_count;
+    ring->head = pos + 1u;
+}
+
+static inline int ipc_ring_empty(struct ipc_ring_header *ring)
+{
+    uint32_t pos = ring->head;
+    return ipc_ring_slot_at(ring, pos)->seq != pos + 1u;
+}
+
+#endif
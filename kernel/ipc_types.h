@@ -32,7 +32,21 @@ struct ipc_message
 };
 
 #define IPC_RECV_NONBLOCK 0x1u
+/** Channel send: sleep until the ring has room instead of failing. */
+#define IPC_SEND_WAIT 0x2u
 #define IPC_MESSAGE_TRUNCATED 0x1u
+/** Set on a broadcast receive when older messages were dropped before this subscriber read them. */
+#define IPC_MESSAGE_OVERRUN 0x2u
+
+/**
+ * Channel creation flags. A broadcast channel keeps one copy of each message
+ * and gives every subscriber its own read cursor; a record is freed once all
+ * of them have read it. When a slow subscriber fills the ring the oldest
+ * message is dropped for it, or with IPC_CHANNEL_OVERRUN_BLOCK the sender
+ * sleeps until it catches up.
+ */
+#define IPC_CHANNEL_BROADCAST     0x2u
+#define IPC_CHANNEL_OVERRUN_BLOCK 0x4u
 
 struct ipc_raw_message
 {
@@ -3,6 +3,7 @@
 
 .global irq0, irq1, irq2, irq3, irq4, irq5, irq6, irq7
 .global irq8, irq9, irq10, irq11, irq12, irq13, irq14, irq15
+.global irq_local240, irq_local241, irq_local242, irq_local255
 .global irq_common_stub
 
 .extern irq_handler
@@ -32,6 +33,18 @@ IRQ_ENTRY 13
 IRQ_ENTRY 14
 IRQ_ENTRY 15
 
+.macro IRQ_LOCAL_ENTRY vector
+irq_local\vector:
+    pushl $0
+    pushl $\vector
+    jmp irq_common_stub
+.endm
+
+IRQ_LOCAL_ENTRY 240
+IRQ_LOCAL_ENTRY 241
+IRQ_LOCAL_ENTRY 242
+IRQ_LOCAL_ENTRY 255
+
 irq_common_stub:
     pushl %ds
     pushl %es
@@ -43,7 +56,6 @@ irq_common_stub:
     mov %ax, %ds
     mov %ax, %es
     mov %ax, %fs
-    mov %ax, %gs
 
     mov %esp, %eax
     pushl %eax
@@ -51,7 +63,8 @@ irq_common_stub:
     add $4, %esp
 
     popa
-    popl %gs
+    /* %gs holds this CPU's per-CPU selector; never restore another CPU's. */
+    addl $4, %esp
     popl %fs
     popl %es
     popl %ds
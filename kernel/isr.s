@@ -69,14 +69,14 @@ isr_common_stub:
     mov %ax, %ds
     mov %ax, %es
     mov %ax, %fs
-    mov %ax, %gs
 
     mov %esp, %eax
     pushl %eax
     call isr_handler
     add $4, %esp
 
-    popl %gs
+    /* %gs holds this CPU's per-CPU selector; never restore another CPU's. */
+    addl $4, %esp
     popl %fs
     popl %es
     popl %ds
@@ -1,12 +1,14 @@
 #include "keyboard.h"
 #include "interrupts.h"
 #include "io.h"
+#include "workqueue.h"
 
 #include <stddef.h>
 #include <stdint.h>
 
 #define KB_DATA_PORT 0x60
 #define KB_BUFFER_SIZE 256
+#define KB_RAW_SIZE 64
 
 static volatile char buffer[KB_BUFFER_SIZE];
 static volatile uint32_t head = 0;
@@ -14,6 +16,12 @@ static volatile uint32_t tail = 0;
 static volatile int shift_active = 0;
 static volatile int extended_active = 0;
 
+/* Scancodes read by the top half, waiting for the translation tasklet. */
+static volatile uint8_t raw_codes[KB_RAW_SIZE];
+static volatile uint32_t raw_head = 0;
+static volatile uint32_t raw_tail = 0;
+static struct tasklet translate_tasklet;
+
 static const char keymap[128] = {
     0, 27, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b', '\t',
     'q', 'w', 'e', 'r', 't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\n', 0, 'a', 's',
@@ -164,12 +172,34 @@ static void keyboard_handle_scancode(uint8_t scancode)
     }
 }
 
+static void raw_push(uint8_t scancode)
+{
+    uint32_t next = (raw_head + 1U) % KB_RAW_SIZE;
+    if (next != raw_tail)
+    {
+        raw_codes[raw_head] = scancode;
+        raw_head = next;
+    }
+}
+
+/* Bottom half: keymap lookup, modifier state and mailbox dispatch. */
+static void keyboard_translate(void *data)
+{
+    (void)data;
+    while (raw_tail != raw_head)
+    {
+        uint8_t scancode = raw_codes[raw_tail];
+        raw_tail = (raw_tail + 1U) % KB_RAW_SIZE;
+        keyboard_handle_scancode(scancode);
+    }
+}
+
 static void keyboard_irq_handler(struct regs *frame)
 {
     (void)frame;
 
-    uint8_t scancode = inb(KB_DATA_PORT);
-    keyboard_handle_scancode(scancode);
+    raw_push(inb(KB_DATA_PORT));
+    tasklet_schedule(&translate_tasklet);
 }
 
 void kb_init(void)
@@ -178,6 +208,9 @@ void kb_init(void)
     tail = 0;
     shift_active = 0;
     extended_active = 0;
+    raw_head = 0;
+    raw_tail = 0;
+    tasklet_init(&translate_tasklet, keyboard_translate, NULL);
     irq_install_handler(1, keyboard_irq_handler);
 }
 
@@ -197,8 +230,12 @@ int kb_poll(void)
     if ((status & 0x01u) == 0u)
         return 0;
 
-    uint8_t scancode = inb(KB_DATA_PORT);
-    keyboard_handle_scancode(scancode);
+    /* Queue behind any codes the IRQ path has not translated yet, keeping order. */
+    uint32_t flags;
+    __asm__ __volatile__("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+    raw_push(inb(KB_DATA_PORT));
+    keyboard_translate(NULL);
+    __asm__ __volatile__("push %0; popf" :: "r"(flags) : "memory");
     return 1;
 }
 
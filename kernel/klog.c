@@ -6,6 +6,7 @@
 #include "service.h"
 #include "service_types.h"
 #include "vfs.h"
+#include "clock.h"
 
 #ifndef CONFIG_KLOG_CAPACITY
 #error "CONFIG_KLOG_CAPACITY must be defined in config.h"
@@ -178,11 +179,12 @@ struct klog_ipc_event
     uint32_t seq;
     uint8_t level;
     uint8_t reserved[3];
+    uint64_t timestamp_ns;
     char module[CONFIG_KLOG_MODULE_NAME_LEN];
     char text[CONFIG_KLOG_ENTRY_LEN];
 };
 
-static void klog_publish_channel(uint32_t seq, uint8_t level, const char *module, const char *text)
+static void klog_publish_channel(uint32_t seq, uint64_t timestamp_ns, uint8_t level, const char *module, const char *text)
 {
     if (!ipc_is_initialized() || !text)
         return;
@@ -190,6 +192,7 @@ static void klog_publish_channel(uint32_t seq, uint8_t level, const char *module
     payload.seq = seq;
     payload.level = level;
     payload.reserved[0] = payload.reserved[1] = payload.reserved[2] = 0;
+    payload.timestamp_ns = timestamp_ns;
     string_copy(payload.module, sizeof(payload.module), module);
 
     size_t i = 0;
@@ -338,10 +341,11 @@ int klog_module_get_level(const char *module)
     return level;
 }
 
-static void klog_store_entry(const char *module, int level, const char *message, uint32_t seq_value, char *scratch_text, char *scratch_module)
+static void klog_store_entry(const char *module, int level, const char *message, uint32_t seq_value, uint64_t timestamp_ns, char *scratch_text, char *scratch_module)
 {
     struct klog_entry *slot = &klog_buffer[klog_head];
     slot->seq = seq_value;
+    slot->timestamp_ns = timestamp_ns;
     slot->level = (uint8_t)level;
     string_copy(slot->module, sizeof(slot->module), module);
 
@@ -407,6 +411,18 @@ static void append_u32(char *dst, size_t *pos, size_t cap, uint32_t value)
     }
 }
 
+/* Seconds since boot with microsecond digits, e.g. "12.000345". */
+static void append_timestamp(char *dst, size_t *pos, size_t cap, uint64_t ns)
+{
+    uint32_t rem_ns = 0;
+    uint64_t seconds = div_u64_u32(ns, 1000000000u, &rem_ns);
+    append_u32(dst, pos, cap, (uint32_t)seconds);
+    append_char(dst, pos, cap, '.');
+    uint32_t micros = rem_ns / 1000u;
+    for (uint32_t div = 100000u; div > 0; div /= 10u)
+        append_char(dst, pos, cap, (char)('0' + (micros / div) % 10u));
+}
+
 static void append_level_name(char *dst, size_t *pos, size_t cap, uint8_t level)
 {
     const char *name = klog_level_name(level);
@@ -438,6 +454,8 @@ void klog_refresh_proc_sink(void)
         append_u32(line, &pos, sizeof(line), entries[i].seq);
         append_char(line, &pos, sizeof(line), ']');
         append_char(line, &pos, sizeof(line), ' ');
+        append_timestamp(line, &pos, sizeof(line), entries[i].timestamp_ns);
+        append_char(line, &pos, sizeof(line), ' ');
         append_level_name(line, &pos, sizeof(line), entries[i].level);
         append_char(line, &pos, sizeof(line), ' ');
         append_char(line, &pos, sizeof(line), '(');
@@ -485,12 +503,13 @@ void klog_emit_tagged(const char *module, int level, const char *message)
 
     uint32_t flags = save_and_cli();
     uint32_t seq_value = klog_sequence++;
+    uint64_t timestamp_ns = clock_monotonic_ns();
     char text_copy[CONFIG_KLOG_ENTRY_LEN];
     char module_copy[CONFIG_KLOG_MODULE_NAME_LEN];
-    klog_store_entry(tag, level, message, seq_value, text_copy, module_copy);
+    klog_store_entry(tag, level, message, seq_value, timestamp_ns, text_copy, module_copy);
     restore_flags(flags);
 
-    klog_publish_channel(seq_value, (uint8_t)level, module_copy, text_copy);
+    klog_publish_channel(seq_value, timestamp_ns, (uint8_t)level, module_copy, text_copy);
     if (proc_sink_enabled)
         klog_refresh_proc_sink();
 }
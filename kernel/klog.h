@@ -26,6 +26,8 @@ struct klog_entry
 {
     uint32_t seq;
     uint8_t level;
+    /** clock_monotonic_ns() when the entry was logged. */
+    uint64_t timestamp_ns;
     char module[CONFIG_KLOG_MODULE_NAME_LEN];
     char text[CONFIG_KLOG_ENTRY_LEN];
 };
@@ -16,9 +16,21 @@
 #include "devmgr.h"
 #include "ipc.h"
 #include "pit.h"
+#include "timer.h"
+#include "hrtimer.h"
+#include "apic.h"
+#include "tsc.h"
+#include "clock.h"
+#include "smp.h"
 #include "debug.h"
 #include "sync.h"
+#include "futex.h"
+#include "evset.h"
+#include "uring.h"
+#include "workqueue.h"
 #include "blockdev.h"
+#include "bcache.h"
+#include "blkqueue.h"
 #include "partition.h"
 #include "volmgr.h"
 #include "bios_fallback.h"
@@ -223,6 +235,7 @@ static void init_extra_fat_disks(const struct boot_info *info)
 
 void kmain(void)
 {
+    smp_early_init();
     memory_init();
     blockdev_init();
     partition_init();
@@ -278,11 +291,23 @@ void kmain(void)
     }
 
     idt_init();
+    workqueue_init();
     debug_trap_init();
     klog_info("kernel: IDT configured");
     pic_init();
     klog_info("kernel: PIC configured");
-    pit_init(250);
+    if (tsc_calibrate() == 0)
+        klog_info("kernel: TSC calibrated");
+    else
+        klog_warn("kernel: TSC unusable; timers limited to PIT resolution");
+    clock_init();
+    if (lapic_init() == 0)
+        klog_info("kernel: local APIC timer online");
+    else
+        klog_warn("kernel: no local APIC timer; using periodic PIT");
+    timer_system_init();
+    hrtimer_system_init();
+    pit_init(CONFIG_TIMER_HZ);
     klog_info("kernel: PIT started");
     klog_info("kernel: service manager ready");
     ipc_system_init();
@@ -299,10 +324,19 @@ void kmain(void)
     klog_info("kernel: volume manager ready");
     process_system_init();
     klog_info("kernel: process system initialized");
+    workqueue_start_workers();
+    klog_info("kernel: deferred-work threads started");
+    blkqueue_start();
+    bcache_start_writeback();
     sync_init();
+    futex_init();
+    evset_init();
+    uring_init();
     klog_info("kernel: sync primitives ready");
     syscall_init();
     klog_info("kernel: syscall layer ready");
+    if (smp_init() > 1u)
+        klog_info("kernel: SMP scheduling enabled");
 
     uint32_t svc_rights = IPC_RIGHT_SEND | IPC_RIGHT_RECV;
     service_register(SYSTEM_SERVICE_FSD, "fsd", user_fsd, svc_rights);
@@ -1,22 +1,365 @@
 #include "memory.h"
 
+#include "spinlock.h"
+#include "vbe.h"
+
 #include <stdint.h>
 
-#define HEAP_START_ADDR ((uint8_t *)0x00300000)
-#define HEAP_SIZE_BYTES (0x00100000)
+/*
+ * Physical page allocator.
+ *
+ * Stage 2 hands us the BIOS E820 map through boot_info. Every usable page
+ * above the kernel image is tracked by a page_frame record and handed out by
+ * a binary buddy allocator. Free blocks are linked through their first bytes,
+ * so the only fixed overhead is the frame array carved from the first usable
+ * region large enough to hold it.
+ */
+
+#define HEAP_FLOOR_ADDR    0x00300000u
+#define HEAP_FALLBACK_SIZE 0x00100000u
+#define MEMORY_ADDR_LIMIT  0xFFFFF000ull
 
-static uint8_t *heap_ptr = HEAP_START_ADDR;
-static uint8_t *const heap_end = HEAP_START_ADDR + HEAP_SIZE_BYTES;
+enum page_frame_state
+{
+    PAGE_FRAME_RESERVED = 0,
+    PAGE_FRAME_AVAILABLE,
+    PAGE_FRAME_FREE,
+    PAGE_FRAME_ALLOCATED,
+    PAGE_FRAME_TAIL
+};
 
-static size_t align_up(size_t value, size_t alignment)
+struct page_frame
 {
-    size_t mask = alignment - 1;
+    uint8_t state;
+    uint8_t order;
+    uint16_t reserved;
+    uint32_t pages;
+};
+
+struct free_block
+{
+    struct free_block *next;
+    struct free_block *prev;
+};
+
+extern uint8_t __kernel_end[];
+
+static struct page_frame *frames = NULL;
+static size_t frame_count = 0;
+static uintptr_t span_base = 0;
+static uintptr_t span_end = 0;
+static size_t usable_pages = 0;
+static size_t free_pages = 0;
+static struct free_block *free_lists[MEMORY_MAX_ORDER];
+static uint32_t free_counts[MEMORY_MAX_ORDER];
+static uint32_t map_entry_count = 0;
+static uint32_t alloc_failures = 0;
+static spinlock_t heap_lock;
+
+static struct memory_map_entry fallback_map[1];
+
+static uintptr_t align_up(uintptr_t value, uintptr_t alignment)
+{
+    uintptr_t mask = alignment - 1;
     return (value + mask) & ~mask;
 }
 
+static uintptr_t align_down(uintptr_t value, uintptr_t alignment)
+{
+    return value & ~(alignment - 1);
+}
+
+static uintptr_t pfn_to_addr(size_t pfn)
+{
+    return span_base + (uintptr_t)pfn * MEMORY_PAGE_SIZE;
+}
+
+static int addr_to_pfn(uintptr_t addr, size_t *out)
+{
+    if (addr < span_base || addr >= span_end)
+        return 0;
+    if ((addr - span_base) & (MEMORY_PAGE_SIZE - 1u))
+        return 0;
+    *out = (addr - span_base) / MEMORY_PAGE_SIZE;
+    return 1;
+}
+
+static int clip_entry(const struct memory_map_entry *entry, uintptr_t floor, uintptr_t *lo, uintptr_t *hi)
+{
+    uint64_t start = entry->base;
+    uint64_t end = entry->base + entry->length;
+    if (end <= start)
+        return 0;
+    if (start < floor)
+        start = floor;
+    if (end > MEMORY_ADDR_LIMIT)
+        end = MEMORY_ADDR_LIMIT;
+    if (end <= start)
+        return 0;
+
+    *lo = align_up((uintptr_t)start, MEMORY_PAGE_SIZE);
+    *hi = align_down((uintptr_t)end, MEMORY_PAGE_SIZE);
+    return *hi > *lo;
+}
+
+static void free_list_push(size_t pfn, unsigned int order)
+{
+    struct free_block *block = (struct free_block *)pfn_to_addr(pfn);
+    block->prev = NULL;
+    block->next = free_lists[order];
+    if (block->next)
+        block->next->prev = block;
+    free_lists[order] = block;
+
+    frames[pfn].state = PAGE_FRAME_FREE;
+    frames[pfn].order = (uint8_t)order;
+    ++free_counts[order];
+    free_pages += (size_t)1u << order;
+}
+
+static void free_list_remove(size_t pfn, unsigned int order)
+{
+    struct free_block *block = (struct free_block *)pfn_to_addr(pfn);
+    if (block->prev)
+        block->prev->next = block->next;
+    else
+        free_lists[order] = block->next;
+    if (block->next)
+        block->next->prev = block->prev;
+
+    frames[pfn].state = PAGE_FRAME_TAIL;
+    --free_counts[order];
+    free_pages -= (size_t)1u << order;
+}
+
+static void buddy_free(size_t pfn, unsigned int order)
+{
+    while (order + 1u < MEMORY_MAX_ORDER)
+    {
+        size_t buddy = pfn ^ ((size_t)1u << order);
+        if (buddy >= frame_count)
+            break;
+        if (frames[buddy].state != PAGE_FRAME_FREE || frames[buddy].order != order)
+            break;
+        free_list_remove(buddy, order);
+        if (buddy < pfn)
+        {
+            frames[pfn].state = PAGE_FRAME_TAIL;
+            pfn = buddy;
+        }
+        ++order;
+    }
+    free_list_push(pfn, order);
+}
+
+static void free_range(size_t pfn, size_t count)
+{
+    while (count > 0)
+    {
+        unsigned int order = 0;
+        while (order + 1u < MEMORY_MAX_ORDER)
+        {
+            size_t next = (size_t)1u << (order + 1u);
+            if ((pfn & (next - 1u)) != 0 || next > count)
+                break;
+            ++order;
+        }
+        buddy_free(pfn, order);
+        pfn += (size_t)1u << order;
+        count -= (size_t)1u << order;
+    }
+}
+
+static int buddy_alloc(unsigned int order, size_t *out)
+{
+    unsigned int current = order;
+    while (current < MEMORY_MAX_ORDER && !free_lists[current])
+        ++current;
+    if (current >= MEMORY_MAX_ORDER)
+        return 0;
+
+    size_t pfn = ((uintptr_t)free_lists[current] - span_base) / MEMORY_PAGE_SIZE;
+    free_list_remove(pfn, current);
+
+    while (current > order)
+    {
+        --current;
+        free_list_push(pfn + ((size_t)1u << current), current);
+    }
+
+    *out = pfn;
+    return 1;
+}
+
+static unsigned int order_for_pages(size_t pages)
+{
+    unsigned int order = 0;
+    while (((size_t)1u << order) < pages)
+        ++order;
+    return order;
+}
+
+static void mark_range(uintptr_t lo, uintptr_t hi, uint8_t state)
+{
+    if (hi <= span_base || lo >= span_end)
+        return;
+    if (lo < span_base)
+        lo = span_base;
+    if (hi > span_end)
+        hi = span_end;
+
+    size_t first = (align_down(lo, MEMORY_PAGE_SIZE) - span_base) / MEMORY_PAGE_SIZE;
+    size_t last = (align_up(hi, MEMORY_PAGE_SIZE) - span_base) / MEMORY_PAGE_SIZE;
+    for (size_t pfn = first; pfn < last && pfn < frame_count; ++pfn)
+        frames[pfn].state = state;
+}
+
+static int range_overlaps_reserved(const struct memory_map_entry *map, size_t count, uintptr_t lo, uintptr_t hi)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (map[i].type == MEMORY_REGION_USABLE)
+            continue;
+        uint64_t start = map[i].base;
+        uint64_t end = map[i].base + map[i].length;
+        if (start < (uint64_t)hi && end > (uint64_t)lo)
+            return 1;
+    }
+    return 0;
+}
+
 void memory_init(void)
 {
-    heap_ptr = HEAP_START_ADDR;
+    spinlock_init_named(&heap_lock, "heap");
+    for (unsigned int i = 0; i < MEMORY_MAX_ORDER; ++i)
+    {
+        free_lists[i] = NULL;
+        free_counts[i] = 0;
+    }
+    frames = NULL;
+    frame_count = 0;
+    usable_pages = 0;
+    free_pages = 0;
+    alloc_failures = 0;
+
+    uintptr_t floor = align_up((uintptr_t)__kernel_end, MEMORY_PAGE_SIZE);
+    if (floor < HEAP_FLOOR_ADDR)
+        floor = HEAP_FLOOR_ADDR;
+
+    const struct boot_info *info = boot_info_get();
+    const struct memory_map_entry *map = NULL;
+    size_t map_count = 0;
+    if (info && info->mem_map_ptr && info->mem_map_count)
+    {
+        map = (const struct memory_map_entry *)(uintptr_t)info->mem_map_ptr;
+        map_count = info->mem_map_count;
+    }
+
+    span_base = 0;
+    span_end = 0;
+    for (size_t i = 0; i < map_count; ++i)
+    {
+        uintptr_t lo;
+        uintptr_t hi;
+        if (map[i].type != MEMORY_REGION_USABLE || !clip_entry(&map[i], floor, &lo, &hi))
+            continue;
+        if (span_end == 0 || lo < span_base)
+            span_base = lo;
+        if (hi > span_end)
+            span_end = hi;
+    }
+
+    if (span_end == 0)
+    {
+        /* No E820 data: fall back to the legacy fixed heap window. */
+        fallback_map[0].base = floor;
+        fallback_map[0].length = HEAP_FALLBACK_SIZE;
+        fallback_map[0].type = MEMORY_REGION_USABLE;
+        fallback_map[0].attributes = 1;
+        map = fallback_map;
+        map_count = 1;
+        span_base = floor;
+        span_end = floor + HEAP_FALLBACK_SIZE;
+    }
+    map_entry_count = (uint32_t)map_count;
+
+    /*
+     * Buddy alignment is by frame number, so start the span on a max-order
+     * boundary; the frames below the first usable page stay reserved.
+     */
+    span_base = align_down(span_base, (uintptr_t)MEMORY_PAGE_SIZE << (MEMORY_MAX_ORDER - 1u));
+    frame_count = (span_end - span_base) / MEMORY_PAGE_SIZE;
+    size_t meta_bytes = align_up(frame_count * sizeof(struct page_frame), MEMORY_PAGE_SIZE);
+
+    for (size_t i = 0; i < map_count && !frames; ++i)
+    {
+        uintptr_t lo;
+        uintptr_t hi;
+        if (map[i].type != MEMORY_REGION_USABLE || !clip_entry(&map[i], floor, &lo, &hi))
+            continue;
+        if (hi - lo <= meta_bytes)
+            continue;
+        if (range_overlaps_reserved(map, map_count, lo, lo + meta_bytes))
+            continue;
+        frames = (struct page_frame *)lo;
+    }
+
+    if (!frames)
+    {
+        frame_count = 0;
+        span_end = span_base;
+        return;
+    }
+
+    for (size_t pfn = 0; pfn < frame_count; ++pfn)
+    {
+        frames[pfn].state = PAGE_FRAME_RESERVED;
+        frames[pfn].order = 0;
+        frames[pfn].reserved = 0;
+        frames[pfn].pages = 0;
+    }
+
+    for (size_t i = 0; i < map_count; ++i)
+    {
+        uintptr_t lo;
+        uintptr_t hi;
+        if (map[i].type == MEMORY_REGION_USABLE && clip_entry(&map[i], floor, &lo, &hi))
+            mark_range(lo, hi, PAGE_FRAME_AVAILABLE);
+    }
+
+    for (size_t i = 0; i < map_count; ++i)
+    {
+        if (map[i].type == MEMORY_REGION_USABLE || map[i].base >= MEMORY_ADDR_LIMIT)
+            continue;
+        uint64_t end = map[i].base + map[i].length;
+        if (end > MEMORY_ADDR_LIMIT)
+            end = MEMORY_ADDR_LIMIT;
+        mark_range((uintptr_t)map[i].base, (uintptr_t)end, PAGE_FRAME_RESERVED);
+    }
+
+    mark_range((uintptr_t)frames, (uintptr_t)frames + meta_bytes, PAGE_FRAME_RESERVED);
+    if (info && info->fat_ptr && info->fat_size)
+        mark_range(info->fat_ptr, info->fat_ptr + info->fat_size, PAGE_FRAME_RESERVED);
+    if (info && info->magic == BOOT_INFO_MAGIC && info->fb_phys && info->fb_size)
+        mark_range(info->fb_phys, info->fb_phys + info->fb_size, PAGE_FRAME_RESERVED);
+
+    size_t pfn = 0;
+    while (pfn < frame_count)
+    {
+        if (frames[pfn].state != PAGE_FRAME_AVAILABLE)
+        {
+            ++pfn;
+            continue;
+        }
+
+        size_t run = pfn;
+        while (run < frame_count && frames[run].state == PAGE_FRAME_AVAILABLE)
+            frames[run++].state = PAGE_FRAME_TAIL;
+
+        usable_pages += run - pfn;
+        free_range(pfn, run - pfn);
+        pfn = run;
+    }
 }
 
 void *kalloc(size_t size)
@@ -24,13 +367,29 @@ void *kalloc(size_t size)
     if (size == 0)
         return NULL;
 
-    size = align_up(size, 16);
-    if (heap_ptr + size > heap_end)
+    size_t pages = (size + MEMORY_PAGE_SIZE - 1u) / MEMORY_PAGE_SIZE;
+    unsigned int order = order_for_pages(pages);
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&heap_lock, &flags);
+
+    size_t pfn;
+    if (order >= MEMORY_MAX_ORDER || !buddy_alloc(order, &pfn))
+    {
+        ++alloc_failures;
+        spinlock_unlock_irqrestore(&heap_lock, flags);
         return NULL;
+    }
+
+    size_t block_pages = (size_t)1u << order;
+    if (pages < block_pages)
+        free_range(pfn + pages, block_pages - pages);
+
+    frames[pfn].state = PAGE_FRAME_ALLOCATED;
+    frames[pfn].pages = (uint32_t)pages;
 
-    void *result = heap_ptr;
-    heap_ptr += size;
-    return result;
+    spinlock_unlock_irqrestore(&heap_lock, flags);
+    return (void *)pfn_to_addr(pfn);
 }
 
 void *kalloc_zero(size_t size)
@@ -45,30 +404,87 @@ void *kalloc_zero(size_t size)
     return ptr;
 }
 
+void *kalloc_pages(unsigned int order)
+{
+    if (order >= MEMORY_MAX_ORDER)
+        return NULL;
+    return kalloc((size_t)MEMORY_PAGE_SIZE << order);
+}
+
+void kfree(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    size_t pfn;
+    if (!addr_to_pfn((uintptr_t)ptr, &pfn))
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&heap_lock, &flags);
+
+    if (frames[pfn].state != PAGE_FRAME_ALLOCATED)
+    {
+        spinlock_unlock_irqrestore(&heap_lock, flags);
+        return;
+    }
+
+    size_t pages = frames[pfn].pages;
+    frames[pfn].state = PAGE_FRAME_TAIL;
+    frames[pfn].pages = 0;
+    free_range(pfn, pages);
+
+    spinlock_unlock_irqrestore(&heap_lock, flags);
+}
+
 size_t memory_total_bytes(void)
 {
-    return HEAP_SIZE_BYTES;
+    return usable_pages * MEMORY_PAGE_SIZE;
 }
 
 size_t memory_used_bytes(void)
 {
-    return (size_t)(heap_ptr - HEAP_START_ADDR);
+    return (usable_pages - free_pages) * MEMORY_PAGE_SIZE;
 }
 
 size_t memory_free_bytes(void)
 {
-    size_t used = memory_used_bytes();
-    if (used >= HEAP_SIZE_BYTES)
-        return 0;
-    return HEAP_SIZE_BYTES - used;
+    return free_pages * MEMORY_PAGE_SIZE;
 }
 
 uintptr_t memory_heap_base(void)
 {
-    return (uintptr_t)HEAP_START_ADDR;
+    return span_base;
 }
 
 uintptr_t memory_heap_limit(void)
 {
-    return (uintptr_t)heap_end;
+    return span_end;
+}
+
+void memory_get_stats(struct memory_stats *out)
+{
+    if (!out)
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&heap_lock, &flags);
+
+    out->total_pages = usable_pages;
+    out->free_pages = free_pages;
+    out->largest_free_order = 0;
+    for (unsigned int i = 0; i < MEMORY_MAX_ORDER; ++i)
+    {
+        out->free_blocks[i] = free_counts[i];
+        if (free_counts[i])
+            out->largest_free_order = i;
+    }
+
+    /* Share of free memory that cannot satisfy a maximum-order request. */
+    uint32_t top_pages = free_counts[MEMORY_MAX_ORDER - 1u] << (MEMORY_MAX_ORDER - 1u);
+    out->fragmentation_pct = free_pages ? (uint32_t)(100u - (top_pages * 100u) / (uint32_t)free_pages) : 0u;
+    out->map_entries = map_entry_count;
+    out->alloc_failures = alloc_failures;
+
+    spinlock_unlock_irqrestore(&heap_lock, flags);
 }
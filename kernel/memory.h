@@ -4,14 +4,52 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "config.h"
+
+#define MEMORY_PAGE_SIZE 4096u
+#define MEMORY_MAX_ORDER CONFIG_MEM_MAX_ORDER
+
+/* BIOS E820 range types as reported by stage 2. */
+enum memory_region_type
+{
+    MEMORY_REGION_USABLE = 1,
+    MEMORY_REGION_RESERVED = 2,
+    MEMORY_REGION_ACPI_RECLAIM = 3,
+    MEMORY_REGION_ACPI_NVS = 4,
+    MEMORY_REGION_BAD = 5
+};
+
+struct memory_map_entry
+{
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;
+    uint32_t attributes;
+} __attribute__((packed));
+
+struct memory_stats
+{
+    size_t total_pages;
+    size_t free_pages;
+    uint32_t free_blocks[MEMORY_MAX_ORDER];
+    uint32_t largest_free_order;
+    uint32_t fragmentation_pct;
+    uint32_t map_entries;
+    uint32_t alloc_failures;
+};
+
 void memory_init(void);
 void *kalloc(size_t size);
 void *kalloc_zero(size_t size);
+/** @return 2^order pages aligned to their own size, or NULL. */
+void *kalloc_pages(unsigned int order);
+void kfree(void *ptr);
 
 size_t memory_total_bytes(void);
 size_t memory_used_bytes(void);
 size_t memory_free_bytes(void);
 uintptr_t memory_heap_base(void);
 uintptr_t memory_heap_limit(void);
+void memory_get_stats(struct memory_stats *out);
 
 #endif
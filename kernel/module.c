@@ -423,13 +423,19 @@ static int load_module_internal(const char *label, const uint8_t *image, size_t
         else
         {
             if (sec->sh_offset + sec->sh_size > size)
+            {
+                kfree(module_mem);
                 return -1;
+            }
             memcpy(dest, image + sec->sh_offset, sec->sh_size);
         }
     }
 
     if (apply_relocations(image, size, module_mem, sections, section_offsets, hdr->e_shnum) != 0)
+    {
+        kfree(module_mem);
         return -1;
+    }
 
     const Elf32_Sym *symtab = NULL;
     size_t sym_count = 0;
@@ -451,11 +457,17 @@ static int load_module_internal(const char *label, const uint8_t *image, size_t
     }
 
     if (!symtab || !strtab)
+    {
+        kfree(module_mem);
         return -1;
+    }
 
     const struct module_info *info = find_module_info(image, sections, section_offsets, symtab, sym_count, strtab, module_mem);
     if (!info)
+    {
+        kfree(module_mem);
         return -1;
+    }
 
     module_handle_t *handle = &module_table[module_count];
     zero_handle(handle);
@@ -465,6 +477,7 @@ static int load_module_internal(const char *label, const uint8_t *image, size_t
     {
         emit_log(KLOG_WARN, "module: already loaded ", handle->meta.name);
         zero_handle(handle);
+        kfree(module_mem);
         return -1;
     }
 
@@ -585,6 +598,7 @@ int module_unload(const char *name)
         handle->meta.initialized = 0;
         emit_log(KLOG_INFO, "module: unloaded ", handle->meta.name);
         module_send_event(MODULE_EVENT_UNLOADED, handle, 0);
+        kfree((void *)handle->meta.base);
 
         size_t remaining = module_count - i - 1;
         if (remaining > 0)
@@ -6,6 +6,9 @@
 #include "proc.h"
 #include "ipc.h"
 #include "pit.h"
+#include "timer.h"
+#include "hrtimer.h"
+#include "clock.h"
 #include "fat16.h"
 #include "keyboard.h"
 #include "vbe.h"
@@ -17,10 +20,21 @@
 #include "bios_fallback.h"
 #include "volmgr.h"
 #include "service.h"
+#include "memory.h"
+#include "slab.h"
+#include "workqueue.h"
+#include "evset.h"
 
 static const struct kernel_symbol builtin_symbols[] = {
     { "klog_emit", (uintptr_t)&klog_emit },
     { "klog_emit_tagged", (uintptr_t)&klog_emit_tagged },
+    { "kalloc", (uintptr_t)&kalloc },
+    { "kalloc_zero", (uintptr_t)&kalloc_zero },
+    { "kalloc_pages", (uintptr_t)&kalloc_pages },
+    { "kfree", (uintptr_t)&kfree },
+    { "kmem_cache_create", (uintptr_t)&kmem_cache_create },
+    { "kmem_cache_alloc", (uintptr_t)&kmem_cache_alloc },
+    { "kmem_cache_free", (uintptr_t)&kmem_cache_free },
     { "ramfs_write", (uintptr_t)&ramfs_write },
     { "ramfs_read", (uintptr_t)&ramfs_read },
     { "ramfs_write_file", (uintptr_t)&ramfs_write_file },
@@ -34,6 +48,10 @@ static const struct kernel_symbol builtin_symbols[] = {
     { "ipc_send", (uintptr_t)&ipc_send },
     { "ipc_recv", (uintptr_t)&ipc_recv },
     { "ipc_share", (uintptr_t)&ipc_share },
+    { "ipc_ring_create", (uintptr_t)&ipc_ring_create },
+    { "ipc_ring_attach", (uintptr_t)&ipc_ring_attach },
+    { "ipc_ring_doorbell", (uintptr_t)&ipc_ring_doorbell },
+    { "ipc_ring_wait", (uintptr_t)&ipc_ring_wait },
     { "ipc_cap_grant", (uintptr_t)&ipc_cap_grant },
     { "ipc_cap_revoke", (uintptr_t)&ipc_cap_revoke },
     { "ipc_cap_query", (uintptr_t)&ipc_cap_query },
@@ -44,15 +62,34 @@ static const struct kernel_symbol builtin_symbols[] = {
     { "service_pid", (uintptr_t)&service_pid },
     { "service_grant_capabilities", (uintptr_t)&service_grant_capabilities },
     { "ipc_channel_create", (uintptr_t)&ipc_channel_create },
+    { "ipc_channel_create_sized", (uintptr_t)&ipc_channel_create_sized },
     { "ipc_channel_join", (uintptr_t)&ipc_channel_join },
     { "ipc_channel_leave", (uintptr_t)&ipc_channel_leave },
     { "ipc_channel_send", (uintptr_t)&ipc_channel_send },
     { "ipc_channel_receive", (uintptr_t)&ipc_channel_receive },
     { "ipc_get_service_channel", (uintptr_t)&ipc_get_service_channel },
+    { "evset_create", (uintptr_t)&evset_create },
+    { "evset_add", (uintptr_t)&evset_add },
+    { "evset_remove", (uintptr_t)&evset_remove },
+    { "evset_wait", (uintptr_t)&evset_wait },
+    { "evset_notify", (uintptr_t)&evset_notify },
     { "process_create", (uintptr_t)&process_create },
     { "process_create_kernel", (uintptr_t)&process_create_kernel },
     { "get_ticks", (uintptr_t)&get_ticks },
     { "pit_init", (uintptr_t)&pit_init },
+    { "timer_init", (uintptr_t)&timer_init },
+    { "timer_arm", (uintptr_t)&timer_arm },
+    { "timer_arm_at", (uintptr_t)&timer_arm_at },
+    { "timer_cancel", (uintptr_t)&timer_cancel },
+    { "pit_frequency", (uintptr_t)&pit_frequency },
+    { "pit_tickless_available", (uintptr_t)&pit_tickless_available },
+    { "hrtimer_now_ns", (uintptr_t)&hrtimer_now_ns },
+    { "hrtimer_init", (uintptr_t)&hrtimer_init },
+    { "hrtimer_start", (uintptr_t)&hrtimer_start },
+    { "hrtimer_cancel", (uintptr_t)&hrtimer_cancel },
+    { "clock_monotonic_ns", (uintptr_t)&clock_monotonic_ns },
+    { "clock_realtime_ns", (uintptr_t)&clock_realtime_ns },
+    { "clock_set_realtime", (uintptr_t)&clock_set_realtime },
     { "fat16_ready", (uintptr_t)&fat16_ready },
     { "fat16_type", (uintptr_t)&fat16_type },
     { "fat16_ls", (uintptr_t)&fat16_ls },
@@ -73,6 +110,10 @@ static const struct kernel_symbol builtin_symbols[] = {
     { "devmgr_refresh_ramfs", (uintptr_t)&devmgr_refresh_ramfs },
     { "irq_register_shared_handler", (uintptr_t)&irq_register_shared_handler },
     { "irq_unregister_shared_handler", (uintptr_t)&irq_unregister_shared_handler },
+    { "work_init", (uintptr_t)&work_init },
+    { "workqueue_queue", (uintptr_t)&workqueue_queue },
+    { "tasklet_init", (uintptr_t)&tasklet_init },
+    { "tasklet_schedule", (uintptr_t)&tasklet_schedule },
     { "irq_mailbox_init", (uintptr_t)&irq_mailbox_init },
     { "irq_mailbox_subscribe", (uintptr_t)&irq_mailbox_subscribe },
     { "irq_mailbox_unsubscribe", (uintptr_t)&irq_mailbox_unsubscribe },
@@ -86,6 +127,13 @@ static const struct kernel_symbol builtin_symbols[] = {
     { "blockdev_register", (uintptr_t)&blockdev_register },
     { "blockdev_read", (uintptr_t)&blockdev_read },
     { "blockdev_write", (uintptr_t)&blockdev_write },
+    { "blockdev_sync", (uintptr_t)&blockdev_sync },
+    { "blockdev_readahead", (uintptr_t)&blockdev_readahead },
+    { "bio_init", (uintptr_t)&bio_init },
+    { "blockdev_submit", (uintptr_t)&blockdev_submit },
+    { "blockdev_wait", (uintptr_t)&blockdev_wait },
+    { "blockdev_complete", (uintptr_t)&blockdev_complete },
+    { "blockdev_set_elevator", (uintptr_t)&blockdev_set_elevator },
     { "blockdev_find", (uintptr_t)&blockdev_find },
     { "blockdev_enumerate", (uintptr_t)&blockdev_enumerate },
     { "blockdev_log_devices", (uintptr_t)&blockdev_log_devices },
@@ -3,6 +3,7 @@
 #include "net.h"
 #include "spinlock.h"
 #include "string.h"
+#include "evset.h"
 
 #define NET_SOCKET_CAPACITY 4
 #define NET_SOCKET_QUEUE 8
@@ -49,7 +50,7 @@ void net_socket_system_init(void)
         g_sockets[i].head = 0;
         g_sockets[i].tail = 0;
         g_sockets[i].count = 0;
-        spinlock_init(&g_sockets[i].lock);
+        spinlock_init_named(&g_sockets[i].lock, "net.socket");
     }
 }
 
@@ -121,6 +122,19 @@ int net_recv(int sock_handle, void *buf, size_t max)
     return (int)copied;
 }
 
+int net_poll(int sock_handle)
+{
+    struct net_raw_socket *sock = resolve_socket(sock_handle);
+    if (!sock)
+        return -1;
+
+    uint32_t flags = 0;
+    spinlock_lock_irqsave(&sock->lock, &flags);
+    int count = (int)sock->count;
+    spinlock_unlock_irqrestore(&sock->lock, flags);
+    return count;
+}
+
 int net_close(int sock_handle)
 {
     struct net_raw_socket *sock = resolve_socket(sock_handle);
@@ -167,5 +181,6 @@ void net_socket_notify_frame(struct net_device *dev, const uint8_t *frame, size_
         sock->tail = (sock->tail + 1u) % NET_SOCKET_QUEUE;
         ++sock->count;
         spinlock_unlock_irqrestore(&sock->lock, flags);
+        evset_notify(EVSET_SOURCE_NET, (int32_t)(i + 1), (uint32_t)length);
     }
 }
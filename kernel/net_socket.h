@@ -9,6 +9,8 @@ struct net_device;
 int net_open(void);
 int net_send(int sock, const void *data, size_t size);
 int net_recv(int sock, void *buf, size_t max);
+/** @return frames queued on @p sock, or -1 for a bad handle. */
+int net_poll(int sock);
 int net_close(int sock);
 
 void net_socket_system_init(void);
@@ -1,7 +1,7 @@
 #include "partition.h"
 
 #include "klog.h"
-#include "memory.h"
+#include "slab.h"
 #include "string.h"
 
 #define MBR_SIGNATURE_OFFSET 510
@@ -26,6 +26,8 @@ struct partition_data
     uint64_t lba_length;
 };
 
+static struct kmem_cache *partition_cache = NULL;
+
 static void append_number(char *dst, size_t cap, uint32_t value)
 {
     if (!dst || cap == 0)
@@ -91,7 +93,8 @@ static int partition_write(struct block_device *device, uint64_t lba, uint32_t c
 
 static const struct blockdev_ops partition_ops = {
     partition_read,
-    partition_write
+    partition_write,
+    NULL
 };
 
 void partition_init(void)
@@ -126,7 +129,9 @@ void partition_scan_device(struct block_device *device)
         if (entry->type == 0 || entry->lba_length == 0)
             continue;
 
-        struct partition_data *pdata = (struct partition_data *)kalloc(sizeof(struct partition_data));
+        if (!partition_cache)
+            partition_cache = kmem_cache_create("partition", sizeof(struct partition_data), 0, NULL);
+        struct partition_data *pdata = (struct partition_data *)kmem_cache_alloc(partition_cache);
         if (!pdata)
             continue;
         pdata->parent = device;
@@ -146,7 +151,10 @@ void partition_scan_device(struct block_device *device)
         desc.flags = BLOCKDEV_FLAG_PARTITION;
 
         if (blockdev_register(&desc, NULL) < 0)
+        {
+            kmem_cache_free(partition_cache, pdata);
             continue;
+        }
     }
 
     device->scanned_partitions = 1;
@@ -1,7 +1,13 @@
 #include "pit.h"
 #include "io.h"
 #include "interrupts.h"
+#include "pic.h"
 #include "proc.h"
+#include "clock.h"
+#include "timer.h"
+#include "hrtimer.h"
+#include "tsc.h"
+#include "smp.h"
 
 #define PIT_CHANNEL0 0x40
 #define PIT_COMMAND 0x43
@@ -9,20 +15,51 @@
 #define PIT_FREQUENCY 1193180U
 
 static volatile uint64_t ticks = 0;
+static uint32_t tick_hz = 0;
+static uint32_t tick_ns = 0;
+/* TSC at the last accounted tick, real or caught up after tickless idle. */
+static volatile uint64_t last_tick_tsc = 0;
+/* Set after a tickless period so a PIT edge latched while masked is not counted twice. */
+static volatile int tick_resync = 0;
+static struct hrtimer idle_wakeup;
+static struct pit_idle_stats idle_stats;
 
 static void pit_irq_handler(struct regs *frame)
 {
     (void)frame;
+    uint64_t now_tsc = rdtsc();
+    if (tick_resync)
+    {
+        tick_resync = 0;
+        if (tsc_khz() && tsc_to_ns(now_tsc - last_tick_tsc) < tick_ns / 2u)
+            return;
+    }
+
     ++ticks;
+    last_tick_tsc = now_tsc;
+    ++idle_stats.periodic_ticks;
+    clock_tick(ticks, tick_ns);
+    timer_tick(ticks);
+    hrtimer_run_expired();
+    process_smp_tick();
     process_scheduler_tick();
 }
 
+static void idle_wakeup_expired(void *data)
+{
+    (void)data;
+}
+
 void pit_init(uint32_t frequency)
 {
     if (frequency == 0)
         frequency = 100;
 
     uint32_t divisor = PIT_FREQUENCY / frequency;
+    tick_hz = frequency;
+    tick_ns = 1000000000u / frequency;
+    last_tick_tsc = rdtsc();
+    hrtimer_init(&idle_wakeup, idle_wakeup_expired, NULL);
 
     irq_install_handler(0, pit_irq_handler);
 
@@ -35,3 +72,86 @@ uint64_t get_ticks(void)
 {
     return ticks;
 }
+
+uint32_t pit_frequency(void)
+{
+    return tick_hz;
+}
+
+uint32_t pit_tick_ns(void)
+{
+    return tick_ns;
+}
+
+int pit_tickless_available(void)
+{
+    /* APs get their ticks forwarded from this one, so keep it while they run. */
+    return CONFIG_TICKLESS_IDLE && hrtimer_is_oneshot() && tsc_khz() && tick_ns && !smp_other_cpus_busy();
+}
+
+/*
+ * Credit the ticks that elapsed while the PIT was masked, so get_ticks()
+ * and the timer wheel carry on as if it had kept running.
+ */
+static void pit_idle_catch_up(void)
+{
+    uint64_t elapsed_ns = tsc_to_ns(rdtsc() - last_tick_tsc);
+    uint64_t missed = div_u64_u32(elapsed_ns, tick_ns, NULL);
+    if (missed == 0)
+        return;
+
+    ticks += missed;
+    last_tick_tsc += tsc_from_ns(missed * tick_ns);
+    idle_stats.skipped_ticks += (uint32_t)missed;
+    timer_tick(ticks);
+}
+
+void pit_idle_halt(void)
+{
+    __asm__ __volatile__("cli");
+
+    if (!pit_tickless_available())
+    {
+        ++idle_stats.periodic_halts;
+        __asm__ __volatile__("sti\n\thlt");
+        return;
+    }
+
+    uint64_t now_tick = ticks;
+    uint64_t next_tick = timer_next_expiry();
+    uint64_t limit = now_tick + CONFIG_TICKLESS_MAX_IDLE_TICKS;
+    if (next_tick > limit)
+        next_tick = limit;
+
+    /* Nothing to gain when the next periodic tick is also the next event. */
+    if (next_tick <= now_tick + 1u)
+    {
+        ++idle_stats.periodic_halts;
+        __asm__ __volatile__("sti\n\thlt");
+        return;
+    }
+
+    pic_set_mask(0);
+    uint64_t last_tick_ns = hrtimer_now_ns() - tsc_to_ns(rdtsc() - last_tick_tsc);
+    hrtimer_start_at(&idle_wakeup, last_tick_ns + (next_tick - now_tick) * (uint64_t)tick_ns);
+    ++idle_stats.tickless_entries;
+
+    /* sti takes effect after hlt starts, so a wakeup cannot slip in between. */
+    __asm__ __volatile__("sti\n\thlt\n\tcli");
+
+    hrtimer_cancel(&idle_wakeup);
+    pit_idle_catch_up();
+    tick_resync = 1;
+    pic_clear_mask(0);
+    /* Let work woken by the catch-up or the waking interrupt preempt idle. */
+    process_scheduler_tick();
+    __asm__ __volatile__("sti");
+}
+
+void pit_get_idle_stats(struct pit_idle_stats *out)
+{
+    if (!out)
+        return;
+
+    *out = idle_stats;
+}
@@ -3,7 +3,32 @@
 
 #include <stdint.h>
 
+#include "config.h"
+
+struct pit_idle_stats
+{
+    /** PIT interrupts actually taken. */
+    uint32_t periodic_ticks;
+    /** Ticks accounted after tickless idle instead of being interrupted for. */
+    uint32_t skipped_ticks;
+    uint32_t tickless_entries;
+    /** Idle halts that kept the periodic tick running. */
+    uint32_t periodic_halts;
+};
+
 void pit_init(uint32_t frequency);
 uint64_t get_ticks(void);
+uint32_t pit_frequency(void);
+uint32_t pit_tick_ns(void);
+int pit_tickless_available(void);
+/**
+ * @brief Halt the CPU from the idle thread until the next event.
+ *
+ * With a one-shot timer available the periodic tick is stopped and the CPU
+ * sleeps until the next timer-wheel expiry (capped at
+ * CONFIG_TICKLESS_MAX_IDLE_TICKS); otherwise this is a plain sti; hlt.
+ */
+void pit_idle_halt(void);
+void pit_get_idle_stats(struct pit_idle_stats *out);
 
 #endif
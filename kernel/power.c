@@ -1,6 +1,7 @@
 #include "power.h"
 
 #include "io.h"
+#include "blockdev.h"
 #include "klog.h"
 
 #include <stdint.h>
@@ -14,6 +15,8 @@ static void write_port(uint16_t port, uint16_t value)
 void power_shutdown(void)
 {
     klog_info("power: shutdown requested");
+    if (blockdev_sync(NULL) < 0)
+        klog_warn("power: buffer cache write-back failed");
 
     /* Signal ACPI and legacy QEMU/Bochs power-off paths. */
     write_port(0x604, 0x2000);
@@ -7,9 +7,20 @@
 #include "config.h"
 #include "spinlock.h"
 #include "ipc_types.h"
+#include "timer.h"
+#include "hrtimer.h"
 
 #define MAX_PROCS       CONFIG_MAX_PROCS
 #define PROC_STACK_SIZE CONFIG_PROC_STACK_SIZE
+#define SCHED_UTIL_SCALE 1024u
+
+/*
+ * Wake-to-run latency histogram: bucket 0 counts wakeups served in under
+ * 2^SCHED_LATENCY_SHIFT ns, bucket b those in [2^(b+SHIFT-1), 2^(b+SHIFT))
+ * ns, and the last bucket everything slower.
+ */
+#define SCHED_LATENCY_BUCKETS 16u
+#define SCHED_LATENCY_SHIFT   10u
 
 typedef enum
 {
@@ -37,11 +48,23 @@ typedef enum
 
 typedef void (*process_entry_t)(void);
 
+struct sync_mutex;
+struct process;
+
 struct context
 {
     uint32_t esp;
 };
 
+/** Intrusive red-black tree link used by the fair-share run queue. */
+struct sched_rb_node
+{
+    struct sched_rb_node *parent;
+    struct sched_rb_node *left;
+    struct sched_rb_node *right;
+    uint8_t red;
+};
+
 struct ipc_mailbox_slot
 {
     uint8_t used;
@@ -53,11 +76,46 @@ struct ipc_mailbox_slot
 
 struct ipc_mailbox_state
 {
-    spinlock_t lock;
+    /* MCS: every send and receive to this process contends here. */
+    mcs_lock_t lock;
     struct ipc_mailbox_slot slots[CONFIG_MSG_QUEUE_LEN];
     uint8_t count;
     pid_t waiters[CONFIG_IPC_ENDPOINT_WAITERS];
     uint8_t waiter_count;
+    /* One for the owning process, one per thread using it through mailbox_acquire(). */
+    uint32_t refs;
+};
+
+/**
+ * @brief Synchronous call/reply state of one process.
+ *
+ * The first block is the server side, guarded by @c lock; the call_* fields
+ * describe this process's own outstanding ipc_call() and are written by the
+ * server it called, under that server's lock.
+ */
+struct ipc_rendezvous
+{
+    spinlock_t lock;
+    /** Callers not yet accepted, oldest first, linked through call_next. */
+    struct process *callers_head;
+    struct process *callers_tail;
+    /** Accepted callers still waiting for their reply. */
+    struct process *accepted;
+    /** Set while blocked in ipc_reply_wait() with no caller queued. */
+    volatile uint8_t receiving;
+    void *recv_buffer;
+    size_t recv_max;
+    volatile pid_t recv_client;
+    volatile int recv_size;
+
+    struct process *call_next;
+    struct process *call_server;
+    const void *call_request;
+    size_t call_request_size;
+    void *call_reply;
+    size_t call_reply_max;
+    volatile int call_reply_size;
+    volatile uint8_t call_done;
 };
 
 struct ipc_cap_entry
@@ -78,7 +136,8 @@ struct process
     int pid;
     proc_state_t state;
     struct context ctx;
-    uint8_t stack[PROC_STACK_SIZE];
+    /** Out-of-line kernel stack; the lowest words hold an overflow guard. */
+    uint8_t *stack;
     size_t stack_size;
     int channel_slots[CONFIG_PROCESS_CHANNEL_SLOTS];
     uint8_t channel_count;
@@ -96,18 +155,85 @@ struct process
     uint64_t sched_deadline;
     /** Virtual runtime used by fair-share selection. */
     uint64_t vruntime;
+    /** CBS reservation: runtime ticks per period (0 = no budget). */
+    uint32_t cbs_runtime;
+    uint32_t cbs_period;
+    /** Ticks left in the current server period. */
+    uint32_t cbs_budget;
+    /** Admitted utilisation, scaled by SCHED_UTIL_SCALE; guarded by the process table lock, like the global total. */
+    uint32_t cbs_util;
+    uint64_t cbs_missed_deadline;
+    uint32_t deadline_misses;
+    uint32_t budget_overruns;
     uint8_t on_run_queue;
+    /** Which ready structure currently links this process. */
+    uint8_t run_class;
+    /** Position in the deadline heap while queued there. */
+    uint32_t deadline_slot;
+    struct sched_rb_node fair_node;
+    /** Priority queue the FIFO links below belong to while queued there. */
+    uint8_t run_priority;
     uint32_t time_slice_ticks;
     uint32_t time_slice_remaining;
     uint64_t wake_deadline;
+    /** Wakes the process when a timed block expires. */
+    struct timer sleep_timer;
+    /** Sub-tick wakeups for process_sleep_ns(). */
+    struct hrtimer sleep_hrtimer;
+    uint8_t timed_out;
+    /** CPU whose run queue owns this process; its lock guards the scheduling fields. */
+    uint8_t cpu;
+    /** Set from being picked until its CPU's scheduler is back off its stack. */
+    uint8_t on_cpu;
+    /** A wake arrived while not WAITING; the next interruptible block returns at once. */
+    uint8_t wake_pending;
+    /** Guard page found overwritten; CPU 0 kills the task before it runs again. */
+    uint8_t stack_overflowed;
+    /** Bit n allows CPU n. */
+    uint32_t cpu_affinity;
+    uint32_t migrations;
+    /*
+     * Accounting, in TSC cycles unless named _ns. Only the scheduler loop of
+     * the CPU running the task and wakers holding its run-queue lock write
+     * these, so the cost is two TSC reads per context switch.
+     */
+    uint64_t acct_run_cycles;
+    uint64_t acct_wait_cycles;
+    uint64_t acct_switch_in_tsc;
+    /** When the task last became READY; 0 while not waiting for a CPU. */
+    uint64_t acct_ready_tsc;
+    /** When a wakeup made it READY; 0 unless the next run ends a wakeup. */
+    uint64_t acct_wake_tsc;
+    uint64_t acct_wake_latency_ns;
+    uint32_t acct_wake_latency_max_ns;
+    uint32_t acct_wakeups;
+    uint32_t acct_voluntary;
+    uint32_t acct_involuntary;
+    uint32_t wake_latency_hist[SCHED_LATENCY_BUCKETS];
+    /** Syscalls made and TSC cycles spent in them; only the task itself writes these. */
+    uint32_t syscalls;
+    uint64_t syscall_cycles;
+    /** Set while a mutex waiter lends this task its urgency; the saved fields restore it. */
+    uint8_t pi_boosted;
+    uint8_t pi_saved_policy;
+    uint64_t pi_saved_deadline;
+    uint32_t pi_saved_cbs_runtime;
+    uint32_t pi_saved_cbs_period;
+    uint32_t pi_saved_cbs_budget;
+    /** How far boosts pulled vruntime forward; added back when the boost ends. */
+    uint64_t pi_vruntime_credit;
+    /** Mutex this task waits for, so a boost can follow a chain of owners. */
+    struct sync_mutex *pi_blocked_on;
     struct process *next_run;
-    struct process *next_sleep;
+    struct process *prev_run;
     process_entry_t entry;
-    struct ipc_mailbox_state ipc_mailbox;
+    /** Allocated on first delivery; NULL while the mailbox was never used. */
+    struct ipc_mailbox_state *ipc_mailbox;
     struct ipc_cap_entry ipc_caps[CONFIG_IPC_CAPACITY_PER_PROC];
     uint8_t ipc_cap_count;
     struct ipc_share_link ipc_shares[CONFIG_IPC_MAX_SHARED_PER_PROC];
     uint8_t ipc_share_count;
+    struct ipc_rendezvous ipc_rv;
 };
 
 struct process_info
@@ -123,11 +249,62 @@ struct process_info
   /*removed duplicate variables*/ 
   
     uint64_t vruntime;
+    uint32_t cbs_runtime;
+    uint32_t cbs_period;
+    uint32_t cbs_budget;
+    uint32_t deadline_misses;
+    uint32_t budget_overruns;
     uint32_t time_slice_remaining;
     uint32_t time_slice_ticks;
     uint64_t wake_deadline;
     uintptr_t stack_pointer;
+    uintptr_t stack_base;
     size_t stack_size;
+    uint32_t cpu;
+    uint32_t cpu_affinity;
+    uint32_t migrations;
+    /** Time on a CPU and time READY but waiting for one, including the current stretch. */
+    uint64_t run_ns;
+    uint64_t wait_ns;
+    /** Switches away while blocking or exiting, and while still runnable. */
+    uint32_t voluntary_switches;
+    uint32_t involuntary_switches;
+    uint32_t wakeups;
+    uint32_t wake_latency_avg_ns;
+    uint32_t wake_latency_max_ns;
+    uint32_t wake_latency_hist[SCHED_LATENCY_BUCKETS];
+    uint32_t syscalls;
+    uint64_t syscall_cycles;
+};
+
+struct sched_cpu_stats
+{
+    uint32_t online;
+    uint32_t apic_id;
+    /** PID running now, 0 while idle. */
+    int current_pid;
+    uint32_t nr_ready;
+    uint32_t nr_migratable;
+    /** Tasks this CPU pulled from others while idle. */
+    uint32_t steals;
+    /** Tasks that arrived by stealing or by wakeup placement. */
+    uint32_t migrations_in;
+    uint32_t ipi_resched;
+    uint32_t ipi_tick;
+    uint32_t context_switches;
+    uint32_t handoffs;
+    /** Time spent in the idle thread, including the current stretch. */
+    uint64_t idle_ns;
+};
+
+struct sched_bench_result
+{
+    uint32_t tasks;
+    uint32_t rounds;
+    /** Total TSC cycles for `rounds` pick+requeue operations. */
+    uint64_t fair_cycles;
+    uint64_t deadline_cycles;
+    uint64_t linear_cycles;
 };
 
 void process_system_init(void);
@@ -136,8 +313,29 @@ int process_create_kernel(void (*entry)(void), size_t stack_size);
 void process_yield(void);
 void process_exit(int code);
 void process_block_current(void);
+/**
+ * @brief Block the current process until woken or @p ticks elapse.
+ *
+ * @param ticks Timeout in PIT ticks; 0 blocks without a timeout.
+ * @return 1 if the timeout expired, 0 if the process was woken.
+ */
+int process_block_timeout(uint32_t ticks);
 void process_wake(struct process *proc);
+/**
+ * @brief Switch from the caller straight to the blocked @p target.
+ *
+ * Skips the run queues and the scheduler loop: @p target becomes RUNNING on
+ * this CPU with the rest of the caller's time slice, and the caller blocks
+ * as in process_block_current() until woken.
+ *
+ * @return 0 once the caller runs again, -1 if @p target is not WAITING,
+ *         is still switching out elsewhere, or may not run here. Nothing
+ *         changes on failure, so the caller can fall back to process_wake().
+ */
+int process_handoff(struct process *target);
 void process_sleep(uint32_t ticks);
+/** Sleep with nanosecond resolution on the high-resolution timer. */
+void process_sleep_ns(uint64_t ns);
 void process_schedule(void);
 struct process *process_current(void);
 struct process *process_lookup(int pid);
@@ -145,6 +343,15 @@ void process_debug_list(void);
 int process_count(void);
 size_t process_snapshot(struct process_info *out, size_t max_entries);
 void process_scheduler_tick(void);
+/** Reschedule IPI: evict a task whose affinity no longer allows this CPU. */
+void process_scheduler_ipi(void);
+/** Called from the PIT tick on the boot CPU to forward ticks and kick idle APs. */
+void process_smp_tick(void);
+/** Create the idle thread for application processor @p cpu; 0 on success. */
+int process_cpu_init(uint32_t cpu);
+void process_cpu_stats(uint32_t cpu, struct sched_cpu_stats *out);
+/** Sum the wake-to-run latency histograms of all CPUs into @p out. */
+void process_wake_latency_histogram(uint32_t out[SCHED_LATENCY_BUCKETS]);
 /**
  * @brief Configure scheduling policy for a process.
  *
@@ -152,9 +359,46 @@ void process_scheduler_tick(void);
  * @param policy SCHED_POLICY_FAIR or SCHED_POLICY_DEADLINE.
  * @param weight Fair-share weight (0 uses default).
  * @param deadline_ticks Absolute deadline tick (0 clears).
- * @return 0 on success, -1 on error.
+ * @param runtime_ticks CBS budget per period for deadline tasks; 0 admits a
+ *        default of CONFIG_SCHED_DEADLINE_DEFAULT_UTIL percent of the period.
+ * @param period_ticks CBS period; 0 uses the relative deadline, or
+ *        CONFIG_SCHED_DEADLINE_DEFAULT_PERIOD without one.
+ * @param affinity CPU mask as for process_set_affinity(); 0 leaves it unchanged.
+ * @return 0 on success, -1 on error or when admitting the reservation
+ *         would push deadline utilisation past CONFIG_SCHED_DEADLINE_MAX_UTIL.
+ */
+int process_set_scheduler(int pid, uint8_t policy, uint32_t weight, uint64_t deadline_ticks, uint32_t runtime_ticks, uint32_t period_ticks, uint32_t affinity);
+/**
+ * @brief Restrict a process to the CPUs in @p mask (bit n = CPU n).
+ *
+ * A queued process is re-placed at once; one running on a CPU the mask
+ * excludes is moved at its next switch.
+ *
+ * @return 0 on success, -1 if the process is unknown or no CPU in the
+ *         mask is online.
+ */
+int process_set_affinity(int pid, uint32_t mask);
+/**
+ * @brief Priority inheritance: let @p owner run at least as urgently as @p donor.
+ *
+ * The owner takes the donor's deadline and CBS reservation when the
+ * deadline is earlier (entering the deadline class if needed), its dynamic
+ * priority when higher and, in the fair class, its vruntime when smaller.
+ * A queued owner is requeued.
+ */
+void process_inherit(struct process *owner, const struct process *donor);
+/** Drop inherited urgency: restore the saved policy and reservation, and give back borrowed vruntime. */
+void process_inherit_reset(struct process *owner);
+/**
+ * @brief Time the ready-queue structures against a synthetic task set.
+ *
+ * Builds private fair and deadline queues holding @p tasks fake processes
+ * and measures pick-and-requeue cost, plus a linear scan for comparison.
+ * The live run queues are not touched.
+ *
+ * @return 0 on success, -1 on allocation failure or bad arguments.
  */
-int process_set_scheduler(int pid, uint8_t policy, uint32_t weight, uint64_t deadline_ticks);
+int process_sched_bench(uint32_t tasks, uint32_t rounds, struct sched_bench_result *out);
 
 /* IPC helpers exposed to syscall layer */
 /* Legacy IPC entry points removed in favour of channel system */
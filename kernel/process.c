@@ -1,10 +1,17 @@
 #include "proc.h"
 #include "ipc.h"
+#include "evset.h"
+#include "uring.h"
 #include "service.h"
 #include "vga.h"
 #include "klog.h"
 #include "pit.h"
 #include "debug.h"
+#include "memory.h"
+#include "slab.h"
+#include "io.h"
+#include "smp.h"
+#include "tsc.h"
 
 #include <stddef.h>
 #include <stdint.h>
@@ -23,21 +30,86 @@ extern void context_switch(struct context *old_ctx, struct context *new_ctx);
 #define SCHED_PRIORITY_MIN    CONFIG_SCHED_MIN_PRIORITY
 #define SCHED_PRIORITY_MAX    (CONFIG_SCHED_PRIORITY_LEVELS - 1)
 
+#define SCHED_CBS_MAX_PERIOD   (1u << 20)
+#define SCHED_DEADLINE_UTIL_LIMIT ((CONFIG_SCHED_DEADLINE_MAX_UTIL * SCHED_UTIL_SCALE) / 100u)
+
+#define PROC_STACK_GUARD_WORDS 4u
+#define PROC_STACK_GUARD_MAGIC 0x5AFE57ACu
+
 struct run_queue
 {
 	struct process *head;
 	struct process *tail;
 };
 
-static struct process processes[MAX_PROCS];
-static struct run_queue ready_queues[SCHED_PRIORITY_LEVELS];
-static uint32_t ready_bitmap = 0;
-static struct context scheduler_ctx;
-static struct process *current_process = NULL;
-static struct process *idle_process = NULL;
-static struct process *sleep_list = NULL;
+/*
+ * Ready processes live in exactly one structure: fair-share tasks in a
+ * vruntime-ordered red-black tree with a cached leftmost node, deadline tasks
+ * in a binary min-heap keyed by absolute deadline, and everything else in the
+ * per-priority FIFO queues. All links are intrusive, so picking the next task
+ * and unlinking an arbitrary one never walks the other ready tasks.
+ */
+enum sched_run_class
+{
+	SCHED_RUN_NONE = 0,
+	SCHED_RUN_FIFO,
+	SCHED_RUN_FAIR,
+	SCHED_RUN_DEADLINE
+};
+
+struct sched_rb_root
+{
+	struct sched_rb_node *root;
+	struct sched_rb_node *leftmost;
+	uint32_t count;
+};
+
+struct sched_heap
+{
+	struct process **items;
+	uint32_t count;
+	uint32_t capacity;
+};
+
+#define fair_node_entry(node) ((struct process *)((uint8_t *)(node) - offsetof(struct process, fair_node)))
+
+/*
+ * Every CPU schedules from its own run queue under its own lock. A process's
+ * state, on_run_queue, on_cpu, wake_pending and cpu fields belong to the
+ * lock of the run queue its cpu field names; moving a process between CPUs
+ * takes both locks in index order.
+ */
+struct sched_cpu
+{
+	spinlock_t lock;
+	uint32_t index;
+	struct run_queue ready_queues[SCHED_PRIORITY_LEVELS];
+	uint32_t ready_bitmap;
+	struct sched_rb_root fair_tree;
+	struct process *deadline_slots[MAX_PROCS];
+	struct sched_heap deadline_heap;
+	/** Queued tasks, and how many of them another CPU may take. */
+	uint32_t nr_ready;
+	uint32_t nr_migratable;
+	struct context scheduler_ctx;
+	struct process *idle_process;
+	int scheduler_active;
+	uint32_t steals;
+	uint32_t migrations_in;
+	uint32_t context_switches;
+	/** Direct switches made by process_handoff(), also counted in context_switches. */
+	uint32_t handoffs;
+	/** Task a handoff just left, finished by scheduler_finish_handoff() on the new stack. */
+	struct process *handoff_prev;
+	uint32_t wake_latency_hist[SCHED_LATENCY_BUCKETS];
+};
+
+static struct process *process_table[MAX_PROCS];
+static spinlock_t process_table_lock;
+static struct kmem_cache *process_cache = NULL;
+static struct sched_cpu sched_cpus[CONFIG_MAX_CPUS];
+static uint32_t deadline_util_total = 0;
 static int next_pid = 1;
-static int scheduler_active = 0;
 static int scheduler_channel_id = -1;
 
 enum scheduler_event_type
@@ -57,10 +129,15 @@ struct scheduler_event
 };
 
 static int int_to_string(int value, char *out);
+static void format_process_event(const char *prefix, int pid, char *buffer, size_t cap);
 static void log_process_event(const char *prefix, int pid);
 static void zero_memory(void *ptr, size_t size);
 static void scheduler_send_event(uint8_t action, int pid, int value, proc_state_t state);
 static struct process *alloc_process_slot(void);
+static void release_process_slot(struct process *proc_exec);
+static void stack_guard_install(struct process *proc_exec);
+static int stack_guard_intact(const struct process *proc_exec);
+static void process_terminate(struct process *proc_exec, int code);
 static uint32_t *stack_align(uint32_t *ptr);
 static void thread_bootstrap(void) __attribute__((noreturn, naked));
 static void thread_entry_trampoline(void) __attribute__((used));
@@ -71,20 +148,23 @@ static void scheduler_reset_priority(struct process *proc_exec);
 static void scheduler_demote_priority(struct process *proc_exec);
 static void scheduler_boost_priority(struct process *proc_exec);
 static void scheduler_arm_timeslice(struct process *proc_exec);
-static void scheduler_enqueue_ready(struct process *proc_exec);
-static struct process *scheduler_dequeue_next(void);
-static void scheduler_remove_from_ready(struct process *proc_exec);
-static struct process *scheduler_pick_deadline(void);
-static struct process *scheduler_pick_fair(void);
-static struct process *scheduler_select_next(void);
+static void scheduler_enqueue_ready(struct sched_cpu *rq, struct process *proc_exec);
+static struct process *scheduler_dequeue_next(struct sched_cpu *rq);
+static void scheduler_remove_from_ready(struct sched_cpu *rq, struct process *proc_exec);
+static struct process *scheduler_pick_deadline(struct sched_cpu *rq);
+static struct process *scheduler_pick_fair(struct sched_cpu *rq);
+static struct process *scheduler_select_next(struct sched_cpu *rq);
+static void scheduler_enqueue_task(struct process *proc_exec);
 static void scheduler_account_runtime(struct process *proc_exec);
-static void scheduler_insert_sleep(struct process *proc_exec);
-static void scheduler_remove_from_sleep(struct process *proc_exec);
-static void wake_sleepers(uint64_t now);
+static void process_timer_expired(void *data);
+static void scheduler_cbs_wakeup(struct process *proc_exec, uint64_t now);
+static int scheduler_cbs_charge(struct process *proc_exec, uint64_t now);
 static void scheduler_preempt_running(int demote_priority);
+static void scheduler_finish_handoff(void);
 static void reclaim_zombie(struct process *proc_exec);
 static struct process *scheduler_create_thread(process_entry_t entry, size_t stack_size, thread_kind_t kind, uint8_t base_priority, int emit_event, int is_idle);
 static void idle_thread(void);
+static int scheduler_install_idle(uint32_t cpu);
 static uint8_t scheduler_default_user_priority(void);
 static uint8_t scheduler_default_kernel_priority(void);
 
@@ -131,25 +211,21 @@ static int int_to_string(int value, char *out)
 	return idx;
 }
 
-static void log_process_event(const char *prefix, int pid)
+static void format_process_event(const char *prefix, int pid, char *buffer, size_t cap)
 {
-	if (!prefix)
-		return;
-
-	char buffer[32];
 	int idx = 0;
 
-	while (prefix[idx] && idx < (int)(sizeof(buffer) - 1))
+	while (prefix[idx] && idx < (int)(cap - 1))
 	{
 		buffer[idx] = prefix[idx];
 		++idx;
 	}
 
-	if (idx < (int)(sizeof(buffer) - 1))
+	if (idx < (int)(cap - 1))
 	{
 		char num[12];
 		int num_len = int_to_string(pid, num);
-		int room = (int)sizeof(buffer) - 1 - idx;
+		int room = (int)cap - 1 - idx;
 		if (num_len > room)
 			num_len = room;
 		for (int i = 0; i < num_len; ++i)
@@ -157,6 +233,15 @@ static void log_process_event(const char *prefix, int pid)
 	}
 
 	buffer[idx] = '\0';
+}
+
+static void log_process_event(const char *prefix, int pid)
+{
+	if (!prefix)
+		return;
+
+	char buffer[32];
+	format_process_event(prefix, pid, buffer, sizeof(buffer));
 	klog_debug(buffer);
 }
 
@@ -169,27 +254,94 @@ static void zero_memory(void *ptr, size_t size)
 
 static struct process *alloc_process_slot(void)
 {
+	if (!process_cache)
+		return NULL;
+
+	struct process *proc_exec = (struct process *)kmem_cache_alloc(process_cache);
+	if (!proc_exec)
+		return NULL;
+
+	zero_memory(proc_exec, sizeof(struct process));
+	proc_exec->pid = -1;
+	proc_exec->state = PROC_UNUSED;
+	proc_exec->stack = NULL;
+	proc_exec->stack_size = 0;
+	proc_exec->wait_channel = -1;
+	proc_exec->ipc_waiting = 0;
+	proc_exec->sched_policy = SCHED_POLICY_FAIR;
+	proc_exec->sched_weight = CONFIG_SCHED_DEFAULT_WEIGHT;
+	proc_exec->sched_deadline = 0;
+	proc_exec->vruntime = 0;
+	for (size_t slot = 0; slot < CONFIG_PROCESS_CHANNEL_SLOTS; ++slot)
+		proc_exec->channel_slots[slot] = -1;
+
+	uint32_t flags;
+	int index = -1;
+	spinlock_lock_irqsave(&process_table_lock, &flags);
+	for (int i = 0; i < MAX_PROCS; ++i)
+	{
+		if (!process_table[i])
+		{
+			index = i;
+			break;
+		}
+	}
+	if (index >= 0)
+		process_table[index] = proc_exec;
+	spinlock_unlock_irqrestore(&process_table_lock, flags);
+	if (index < 0)
+	{
+		kmem_cache_free(process_cache, proc_exec);
+		return NULL;
+	}
+
+	ipc_attach_process(proc_exec);
+	return proc_exec;
+}
+
+static void release_process_slot(struct process *proc_exec)
+{
+	uint32_t flags;
+	spinlock_lock_irqsave(&process_table_lock, &flags);
 	for (int i = 0; i < MAX_PROCS; ++i)
 	{
-		if (processes[i].state == PROC_UNUSED || processes[i].state == PROC_ZOMBIE)
+		if (process_table[i] == proc_exec)
 		{
-			zero_memory(&processes[i], sizeof(struct process));
-			processes[i].pid = -1;
-			processes[i].state = PROC_UNUSED;
-			processes[i].stack_size = PROC_STACK_SIZE;
-			processes[i].wait_channel = -1;
-			processes[i].ipc_waiting = 0;
-			processes[i].sched_policy = SCHED_POLICY_FAIR;
-			processes[i].sched_weight = CONFIG_SCHED_DEFAULT_WEIGHT;
-			processes[i].sched_deadline = 0;
-			processes[i].vruntime = 0;
-			for (size_t slot = 0; slot < CONFIG_PROCESS_CHANNEL_SLOTS; ++slot)
-				processes[i].channel_slots[slot] = -1;
-			ipc_attach_process(&processes[i]);
-			return &processes[i];
+			process_table[i] = NULL;
+			break;
 		}
 	}
-	return NULL;
+	spinlock_unlock_irqrestore(&process_table_lock, flags);
+
+	/* Drops a mailbox a late sender may have created after exit. */
+	ipc_detach_process(proc_exec);
+
+	if (proc_exec->stack)
+		kfree(proc_exec->stack);
+	proc_exec->stack = NULL;
+	proc_exec->pid = -1;
+	proc_exec->state = PROC_UNUSED;
+	kmem_cache_free(process_cache, proc_exec);
+}
+
+static void stack_guard_install(struct process *proc_exec)
+{
+	uint32_t *guard = (uint32_t *)proc_exec->stack;
+	for (uint32_t i = 0; i < PROC_STACK_GUARD_WORDS; ++i)
+		guard[i] = PROC_STACK_GUARD_MAGIC;
+}
+
+static int stack_guard_intact(const struct process *proc_exec)
+{
+	const uint32_t *guard = (const uint32_t *)proc_exec->stack;
+	if (!guard)
+		return 1;
+	for (uint32_t i = 0; i < PROC_STACK_GUARD_WORDS; ++i)
+	{
+		if (guard[i] != PROC_STACK_GUARD_MAGIC)
+			return 0;
+	}
+	return 1;
 }
 
 static uint32_t *stack_align(uint32_t *ptr)
@@ -272,306 +424,931 @@ static void scheduler_arm_timeslice(struct process *proc_exec)
 	proc_exec->time_slice_remaining = proc_exec->time_slice_ticks;
 }
 
-static void scheduler_enqueue_ready(struct process *proc_exec)
+static void rb_rotate_left(struct sched_rb_root *tree, struct sched_rb_node *node)
 {
-	if (!proc_exec || proc_exec == idle_process)
-		return;
-	if (proc_exec->on_run_queue)
-		return;
+	struct sched_rb_node *pivot = node->right;
+	node->right = pivot->left;
+	if (pivot->left)
+		pivot->left->parent = node;
+	pivot->parent = node->parent;
+	if (!node->parent)
+		tree->root = pivot;
+	else if (node == node->parent->left)
+		node->parent->left = pivot;
+	else
+		node->parent->right = pivot;
+	pivot->left = node;
+	node->parent = pivot;
+}
 
-	uint8_t priority = scheduler_clamp_priority(proc_exec->dynamic_priority);
-	struct run_queue *queue = &ready_queues[priority];
+static void rb_rotate_right(struct sched_rb_root *tree, struct sched_rb_node *node)
+{
+	struct sched_rb_node *pivot = node->left;
+	node->left = pivot->right;
+	if (pivot->right)
+		pivot->right->parent = node;
+	pivot->parent = node->parent;
+	if (!node->parent)
+		tree->root = pivot;
+	else if (node == node->parent->right)
+		node->parent->right = pivot;
+	else
+		node->parent->left = pivot;
+	pivot->right = node;
+	node->parent = pivot;
+}
 
-	proc_exec->next_run = NULL;
-	if (!queue->head)
-	{
-		queue->head = proc_exec;
-		queue->tail = proc_exec;
-	}
+static void rb_transplant(struct sched_rb_root *tree, struct sched_rb_node *old_node, struct sched_rb_node *new_node)
+{
+	if (!old_node->parent)
+		tree->root = new_node;
+	else if (old_node == old_node->parent->left)
+		old_node->parent->left = new_node;
 	else
+		old_node->parent->right = new_node;
+	if (new_node)
+		new_node->parent = old_node->parent;
+}
+
+static struct sched_rb_node *rb_next(struct sched_rb_node *node)
+{
+	if (node->right)
 	{
-		queue->tail->next_run = proc_exec;
-		queue->tail = proc_exec;
+		node = node->right;
+		while (node->left)
+			node = node->left;
+		return node;
 	}
-
-	ready_bitmap |= (1u << priority);
-	proc_exec->on_run_queue = 1;
+	while (node->parent && node == node->parent->right)
+		node = node->parent;
+	return node->parent;
 }
 
-static void scheduler_remove_from_ready(struct process *proc_exec)
+static void rb_insert_fixup(struct sched_rb_root *tree, struct sched_rb_node *node)
 {
-	if (!proc_exec)
-		return;
-
-	for (int priority = SCHED_PRIORITY_MIN; priority <= SCHED_PRIORITY_MAX; ++priority)
+	while (node->parent && node->parent->red)
 	{
-		struct run_queue *queue = &ready_queues[priority];
-		struct process *prev = NULL;
-		struct process *iter = queue->head;
-		while (iter)
+		struct sched_rb_node *parent = node->parent;
+		struct sched_rb_node *grand = parent->parent;
+		if (parent == grand->left)
 		{
-			if (iter == proc_exec)
+			struct sched_rb_node *uncle = grand->right;
+			if (uncle && uncle->red)
 			{
-				if (prev)
-					prev->next_run = iter->next_run;
-				else
-					queue->head = iter->next_run;
-
-				if (queue->tail == iter)
-					queue->tail = prev;
-
-				if (!queue->head)
-					ready_bitmap &= ~(1u << priority);
-
-				iter->next_run = NULL;
-				iter->on_run_queue = 0;
-				return;
+				parent->red = 0;
+				uncle->red = 0;
+				grand->red = 1;
+				node = grand;
+				continue;
+			}
+			if (node == parent->right)
+			{
+				node = parent;
+				rb_rotate_left(tree, node);
+				parent = node->parent;
+			}
+			parent->red = 0;
+			grand->red = 1;
+			rb_rotate_right(tree, grand);
+		}
+		else
+		{
+			struct sched_rb_node *uncle = grand->left;
+			if (uncle && uncle->red)
+			{
+				parent->red = 0;
+				uncle->red = 0;
+				grand->red = 1;
+				node = grand;
+				continue;
 			}
-			prev = iter;
-			iter = iter->next_run;
+			if (node == parent->left)
+			{
+				node = parent;
+				rb_rotate_right(tree, node);
+				parent = node->parent;
+			}
+			parent->red = 0;
+			grand->red = 1;
+			rb_rotate_left(tree, grand);
 		}
 	}
+	tree->root->red = 0;
 }
 
-static struct process *scheduler_dequeue_next(void)
+static void rb_erase_fixup(struct sched_rb_root *tree, struct sched_rb_node *node, struct sched_rb_node *parent)
 {
-	for (int priority = SCHED_PRIORITY_MIN; priority <= SCHED_PRIORITY_MAX; ++priority)
+	while (node != tree->root && (!node || !node->red))
 	{
-		if ((ready_bitmap & (1u << priority)) == 0u)
-			continue;
-
-		struct run_queue *queue = &ready_queues[priority];
-		struct process *proc_exec = queue->head;
-		if (!proc_exec)
+		if (node == parent->left)
 		{
-			ready_bitmap &= ~(1u << priority);
-			queue->tail = NULL;
-			continue;
+			struct sched_rb_node *sibling = parent->right;
+			if (sibling->red)
+			{
+				sibling->red = 0;
+				parent->red = 1;
+				rb_rotate_left(tree, parent);
+				sibling = parent->right;
+			}
+			if ((!sibling->left || !sibling->left->red) && (!sibling->right || !sibling->right->red))
+			{
+				sibling->red = 1;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+			if (!sibling->right || !sibling->right->red)
+			{
+				sibling->left->red = 0;
+				sibling->red = 1;
+				rb_rotate_right(tree, sibling);
+				sibling = parent->right;
+			}
+			sibling->red = parent->red;
+			parent->red = 0;
+			if (sibling->right)
+				sibling->right->red = 0;
+			rb_rotate_left(tree, parent);
+			node = tree->root;
 		}
-
-		queue->head = proc_exec->next_run;
-		if (!queue->head)
+		else
 		{
-			queue->tail = NULL;
-			ready_bitmap &= ~(1u << priority);
+			struct sched_rb_node *sibling = parent->left;
+			if (sibling->red)
+			{
+				sibling->red = 0;
+				parent->red = 1;
+				rb_rotate_right(tree, parent);
+				sibling = parent->left;
+			}
+			if ((!sibling->left || !sibling->left->red) && (!sibling->right || !sibling->right->red))
+			{
+				sibling->red = 1;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+			if (!sibling->left || !sibling->left->red)
+			{
+				sibling->right->red = 0;
+				sibling->red = 1;
+				rb_rotate_left(tree, sibling);
+				sibling = parent->left;
+			}
+			sibling->red = parent->red;
+			parent->red = 0;
+			if (sibling->left)
+				sibling->left->red = 0;
+			rb_rotate_right(tree, parent);
+			node = tree->root;
 		}
-
-		proc_exec->next_run = NULL;
-		proc_exec->on_run_queue = 0;
-		return proc_exec;
 	}
-	return NULL;
+	if (node)
+		node->red = 0;
 }
 
-static struct process *scheduler_pick_deadline(void)
+static void fair_tree_insert(struct sched_rb_root *tree, struct process *proc_exec)
 {
-	struct process *best = NULL;
-	uint64_t best_deadline = 0;
+	struct sched_rb_node *node = &proc_exec->fair_node;
+	struct sched_rb_node *parent = NULL;
+	struct sched_rb_node **link = &tree->root;
+	int leftmost = 1;
 
-	for (int priority = SCHED_PRIORITY_MIN; priority <= SCHED_PRIORITY_MAX; ++priority)
+	/* Equal vruntimes go right so ties keep FIFO order. */
+	while (*link)
 	{
-		struct run_queue *queue = &ready_queues[priority];
-		for (struct process *iter = queue->head; iter; iter = iter->next_run)
+		parent = *link;
+		if (proc_exec->vruntime < fair_node_entry(parent)->vruntime)
 		{
-			if (iter->sched_policy != SCHED_POLICY_DEADLINE || iter->sched_deadline == 0)
-				continue;
-			if (!best || iter->sched_deadline < best_deadline)
-			{
-				best = iter;
-				best_deadline = iter->sched_deadline;
-			}
+			link = &parent->left;
+		}
+		else
+		{
+			link = &parent->right;
+			leftmost = 0;
 		}
 	}
 
-	if (best)
-		scheduler_remove_from_ready(best);
-	return best;
+	node->parent = parent;
+	node->left = NULL;
+	node->right = NULL;
+	node->red = 1;
+	*link = node;
+	if (leftmost)
+		tree->leftmost = node;
+	++tree->count;
+	rb_insert_fixup(tree, node);
 }
 
-static struct process *scheduler_pick_fair(void)
+static void fair_tree_remove(struct sched_rb_root *tree, struct process *proc_exec)
 {
-	struct process *best = NULL;
-	uint64_t best_vr = 0;
+	struct sched_rb_node *node = &proc_exec->fair_node;
+	if (tree->leftmost == node)
+		tree->leftmost = rb_next(node);
 
-	for (int priority = SCHED_PRIORITY_MIN; priority <= SCHED_PRIORITY_MAX; ++priority)
+	struct sched_rb_node *child;
+	struct sched_rb_node *child_parent;
+	uint8_t removed_red = node->red;
+
+	if (!node->left)
+	{
+		child = node->right;
+		child_parent = node->parent;
+		rb_transplant(tree, node, node->right);
+	}
+	else if (!node->right)
+	{
+		child = node->left;
+		child_parent = node->parent;
+		rb_transplant(tree, node, node->left);
+	}
+	else
 	{
-		struct run_queue *queue = &ready_queues[priority];
-		for (struct process *iter = queue->head; iter; iter = iter->next_run)
+		struct sched_rb_node *successor = node->right;
+		while (successor->left)
+			successor = successor->left;
+		removed_red = successor->red;
+		child = successor->right;
+		if (successor->parent == node)
 		{
-			if (iter->sched_policy != SCHED_POLICY_FAIR)
-				continue;
-			if (!best || iter->vruntime < best_vr)
-			{
-				best = iter;
-				best_vr = iter->vruntime;
-			}
+			child_parent = successor;
 		}
+		else
+		{
+			child_parent = successor->parent;
+			rb_transplant(tree, successor, successor->right);
+			successor->right = node->right;
+			successor->right->parent = successor;
+		}
+		rb_transplant(tree, node, successor);
+		successor->left = node->left;
+		successor->left->parent = successor;
+		successor->red = node->red;
 	}
 
-	if (best)
-		scheduler_remove_from_ready(best);
-	return best;
+	--tree->count;
+	if (!removed_red)
+		rb_erase_fixup(tree, child, child_parent);
+
+	node->parent = NULL;
+	node->left = NULL;
+	node->right = NULL;
 }
 
-static struct process *scheduler_select_next(void)
+static void deadline_heap_place(struct sched_heap *heap, uint32_t index, struct process *proc_exec)
 {
-	struct process *proc_exec = scheduler_pick_deadline();
-	if (proc_exec)
-		return proc_exec;
-	proc_exec = scheduler_pick_fair();
-	if (proc_exec)
-		return proc_exec;
-	return scheduler_dequeue_next();
+	heap->items[index] = proc_exec;
+	proc_exec->deadline_slot = index;
 }
 
-static void scheduler_account_runtime(struct process *proc_exec)
+static void deadline_heap_sift_up(struct sched_heap *heap, uint32_t index)
 {
-	if (!proc_exec || proc_exec == idle_process)
-		return;
-	if (proc_exec->sched_policy != SCHED_POLICY_FAIR)
-		return;
-
-	uint32_t used = proc_exec->time_slice_ticks;
-	if (proc_exec->time_slice_remaining <= proc_exec->time_slice_ticks)
-		used -= proc_exec->time_slice_remaining;
+	struct process *proc_exec = heap->items[index];
+	while (index > 0)
+	{
+		uint32_t parent = (index - 1u) >> 1;
+		if (heap->items[parent]->sched_deadline <= proc_exec->sched_deadline)
+			break;
+		deadline_heap_place(heap, index, heap->items[parent]);
+		index = parent;
+	}
+	deadline_heap_place(heap, index, proc_exec);
+}
 
-	if (used == 0)
-		return;
+static void deadline_heap_sift_down(struct sched_heap *heap, uint32_t index)
+{
+	struct process *proc_exec = heap->items[index];
+	for (;;)
+	{
+		uint32_t child = (index << 1) + 1u;
+		if (child >= heap->count)
+			break;
+		if (child + 1u < heap->count && heap->items[child + 1u]->sched_deadline < heap->items[child]->sched_deadline)
+			++child;
+		if (proc_exec->sched_deadline <= heap->items[child]->sched_deadline)
+			break;
+		deadline_heap_place(heap, index, heap->items[child]);
+		index = child;
+	}
+	deadline_heap_place(heap, index, proc_exec);
+}
 
-	uint32_t weight = proc_exec->sched_weight ? proc_exec->sched_weight : CONFIG_SCHED_DEFAULT_WEIGHT;
-	uint64_t scaled = ((uint64_t)used * (uint64_t)CONFIG_SCHED_BASE_WEIGHT) / (uint64_t)weight;
-	if (scaled == 0)
-		scaled = 1;
-	proc_exec->vruntime += scaled;
+static int deadline_heap_insert(struct sched_heap *heap, struct process *proc_exec)
+{
+	if (heap->count >= heap->capacity)
+		return -1;
+	heap->items[heap->count] = proc_exec;
+	deadline_heap_sift_up(heap, heap->count++);
+	return 0;
 }
 
-static void scheduler_insert_sleep(struct process *proc_exec)
+static void deadline_heap_remove(struct sched_heap *heap, struct process *proc_exec)
 {
-	if (!proc_exec)
+	uint32_t index = proc_exec->deadline_slot;
+	if (index >= heap->count || heap->items[index] != proc_exec)
 		return;
 
-	scheduler_remove_from_sleep(proc_exec);
-
-	if (!sleep_list || proc_exec->wake_deadline < sleep_list->wake_deadline)
+	struct process *last = heap->items[--heap->count];
+	heap->items[heap->count] = NULL;
+	if (last != proc_exec)
 	{
-		proc_exec->next_sleep = sleep_list;
-		sleep_list = proc_exec;
-		return;
+		deadline_heap_place(heap, index, last);
+		if (index > 0 && heap->items[(index - 1u) >> 1]->sched_deadline > last->sched_deadline)
+			deadline_heap_sift_up(heap, index);
+		else
+			deadline_heap_sift_down(heap, index);
 	}
+}
 
-	struct process *iter = sleep_list;
-	while (iter->next_sleep && iter->next_sleep->wake_deadline <= proc_exec->wake_deadline)
-		iter = iter->next_sleep;
+static struct sched_cpu *this_rq(void)
+{
+	return &sched_cpus[smp_cpu_id()];
+}
 
-	proc_exec->next_sleep = iter->next_sleep;
-	iter->next_sleep = proc_exec;
+static int scheduler_is_idle(const struct process *proc_exec)
+{
+	return proc_exec && proc_exec->pid == 0;
 }
 
-static void scheduler_remove_from_sleep(struct process *proc_exec)
+static uint32_t scheduler_irq_save(void)
 {
-	if (!proc_exec || !sleep_list)
-		return;
+	uint32_t flags;
+	__asm__ __volatile__("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+	return flags;
+}
 
-	if (sleep_list == proc_exec)
-	{
-		sleep_list = proc_exec->next_sleep;
-		proc_exec->next_sleep = NULL;
-		return;
-	}
+static void scheduler_irq_restore(uint32_t flags)
+{
+	__asm__ __volatile__("push %0\n\tpopf" : : "r"(flags) : "memory", "cc");
+}
 
-	struct process *prev = sleep_list;
-	struct process *iter = sleep_list->next_sleep;
-	while (iter)
+/* Lock the run queue that owns @p proc_exec, following it if it migrates meanwhile. */
+static struct sched_cpu *task_rq_lock(struct process *proc_exec, uint32_t *flags)
+{
+	*flags = scheduler_irq_save();
+	for (;;)
 	{
-		if (iter == proc_exec)
-		{
-			prev->next_sleep = iter->next_sleep;
-			iter->next_sleep = NULL;
-			return;
-		}
-		prev = iter;
-		iter = iter->next_sleep;
+		struct sched_cpu *rq = &sched_cpus[proc_exec->cpu];
+		spinlock_lock(&rq->lock);
+		if (rq == &sched_cpus[proc_exec->cpu])
+			return rq;
+		spinlock_unlock(&rq->lock);
 	}
 }
 
-static void wake_sleepers(uint64_t now)
+static void task_rq_unlock(struct sched_cpu *rq, uint32_t flags)
 {
-	while (sleep_list && sleep_list->wake_deadline <= now)
+	spinlock_unlock(&rq->lock);
+	scheduler_irq_restore(flags);
+}
+
+static void scheduler_lock_pair(struct sched_cpu *first, struct sched_cpu *second)
+{
+	if (first == second)
 	{
-		struct process *proc_exec = sleep_list;
-		sleep_list = proc_exec->next_sleep;
-		proc_exec->next_sleep = NULL;
-		proc_exec->wake_deadline = 0;
-		scheduler_boost_priority(proc_exec);
-		proc_exec->state = PROC_READY;
-		scheduler_enqueue_ready(proc_exec);
+		spinlock_lock(&first->lock);
+		return;
+	}
+	if (first->index > second->index)
+	{
+		struct sched_cpu *swap = first;
+		first = second;
+		second = swap;
 	}
+	spinlock_lock(&first->lock);
+	spinlock_lock(&second->lock);
 }
 
-static void scheduler_preempt_running(int demote_priority)
+static void scheduler_unlock_pair(struct sched_cpu *first, struct sched_cpu *second)
 {
-	struct process *proc_exec = current_process;
-	if (!proc_exec)
+	spinlock_unlock(&first->lock);
+	if (first != second)
+		spinlock_unlock(&second->lock);
+}
+
+/* Deadline tasks stay where they were admitted; their EDF order is per CPU. */
+static int scheduler_migratable(const struct sched_cpu *rq, const struct process *proc_exec)
+{
+	return proc_exec->sched_policy != SCHED_POLICY_DEADLINE && (proc_exec->cpu_affinity & ~(1u << rq->index)) != 0u;
+}
+
+static void scheduler_note_dequeued(struct sched_cpu *rq, struct process *proc_exec)
+{
+	--rq->nr_ready;
+	if (scheduler_migratable(rq, proc_exec))
+		--rq->nr_migratable;
+}
+
+static void scheduler_enqueue_ready(struct sched_cpu *rq, struct process *proc_exec)
+{
+	if (!proc_exec || scheduler_is_idle(proc_exec))
+		return;
+	if (proc_exec->on_run_queue)
+		return;
+
+	++rq->nr_ready;
+	if (scheduler_migratable(rq, proc_exec))
+		++rq->nr_migratable;
+
+	if (proc_exec->sched_policy == SCHED_POLICY_DEADLINE && proc_exec->sched_deadline != 0 &&
+		deadline_heap_insert(&rq->deadline_heap, proc_exec) == 0)
+	{
+		proc_exec->run_class = SCHED_RUN_DEADLINE;
+		proc_exec->on_run_queue = 1;
 		return;
+	}
 
-	if (proc_exec == idle_process)
+	if (proc_exec->sched_policy == SCHED_POLICY_FAIR)
 	{
-		context_switch(&proc_exec->ctx, &scheduler_ctx);
-		proc_exec->state = PROC_RUNNING;
+		fair_tree_insert(&rq->fair_tree, proc_exec);
+		proc_exec->run_class = SCHED_RUN_FAIR;
+		proc_exec->on_run_queue = 1;
 		return;
 	}
 
-	if (demote_priority)
-		scheduler_demote_priority(proc_exec);
+	uint8_t priority = scheduler_clamp_priority(proc_exec->dynamic_priority);
+	struct run_queue *queue = &rq->ready_queues[priority];
 
-	proc_exec->state = PROC_READY;
-	scheduler_enqueue_ready(proc_exec);
-	context_switch(&proc_exec->ctx, &scheduler_ctx);
-	proc_exec->state = PROC_RUNNING;
+	proc_exec->next_run = NULL;
+	proc_exec->prev_run = queue->tail;
+	if (!queue->head)
+		queue->head = proc_exec;
+	else
+		queue->tail->next_run = proc_exec;
+	queue->tail = proc_exec;
+
+	rq->ready_bitmap |= (1u << priority);
+	proc_exec->run_priority = priority;
+	proc_exec->run_class = SCHED_RUN_FIFO;
+	proc_exec->on_run_queue = 1;
 }
 
-static void reclaim_zombie(struct process *proc_exec)
+static void scheduler_remove_from_ready(struct sched_cpu *rq, struct process *proc_exec)
 {
-	if (!proc_exec || proc_exec->state != PROC_ZOMBIE)
+	if (!proc_exec || !proc_exec->on_run_queue)
 		return;
 
-	int pid = proc_exec->pid;
-	int exit_code = proc_exec->exit_code;
+	scheduler_note_dequeued(rq, proc_exec);
 
-	scheduler_remove_from_sleep(proc_exec);
-	proc_exec->on_run_queue = 0;
-	proc_exec->next_run = NULL;
+	if (proc_exec->run_class == SCHED_RUN_FAIR)
+	{
+		fair_tree_remove(&rq->fair_tree, proc_exec);
+		proc_exec->run_class = SCHED_RUN_NONE;
+		proc_exec->on_run_queue = 0;
+		return;
+	}
 
-	proc_exec->pid = -1;
-	proc_exec->state = PROC_UNUSED;
-	proc_exec->channel_count = 0;
-	proc_exec->wait_channel = -1;
-	proc_exec->ipc_waiting = 0;
-	proc_exec->exit_code = 0;
-	proc_exec->ctx.esp = 0;
-	proc_exec->entry = NULL;
-	proc_exec->time_slice_ticks = 0;
-	proc_exec->time_slice_remaining = 0;
+	if (proc_exec->run_class == SCHED_RUN_DEADLINE)
+	{
+		deadline_heap_remove(&rq->deadline_heap, proc_exec);
+		proc_exec->run_class = SCHED_RUN_NONE;
+		proc_exec->on_run_queue = 0;
+		return;
+	}
+
+	uint8_t priority = proc_exec->run_priority;
+	struct run_queue *queue = &rq->ready_queues[priority];
+	if (proc_exec->prev_run)
+		proc_exec->prev_run->next_run = proc_exec->next_run;
+	else
+		queue->head = proc_exec->next_run;
+	if (proc_exec->next_run)
+		proc_exec->next_run->prev_run = proc_exec->prev_run;
+	else
+		queue->tail = proc_exec->prev_run;
+
+	if (!queue->head)
+		rq->ready_bitmap &= ~(1u << priority);
+
+	proc_exec->next_run = NULL;
+	proc_exec->prev_run = NULL;
+	proc_exec->on_run_queue = 0;
+	proc_exec->run_class = SCHED_RUN_NONE;
+}
+
+static struct process *scheduler_dequeue_next(struct sched_cpu *rq)
+{
+	for (int priority = SCHED_PRIORITY_MIN; priority <= SCHED_PRIORITY_MAX; ++priority)
+	{
+		if ((rq->ready_bitmap & (1u << priority)) == 0u)
+			continue;
+
+		struct run_queue *queue = &rq->ready_queues[priority];
+		struct process *proc_exec = queue->head;
+		if (!proc_exec)
+		{
+			rq->ready_bitmap &= ~(1u << priority);
+			queue->tail = NULL;
+			continue;
+		}
+
+		queue->head = proc_exec->next_run;
+		if (queue->head)
+		{
+			queue->head->prev_run = NULL;
+		}
+		else
+		{
+			queue->tail = NULL;
+			rq->ready_bitmap &= ~(1u << priority);
+		}
+
+		scheduler_note_dequeued(rq, proc_exec);
+		proc_exec->next_run = NULL;
+		proc_exec->on_run_queue = 0;
+		proc_exec->run_class = SCHED_RUN_NONE;
+		return proc_exec;
+	}
+	return NULL;
+}
+
+static struct process *scheduler_pick_deadline(struct sched_cpu *rq)
+{
+	if (rq->deadline_heap.count == 0)
+		return NULL;
+
+	struct process *best = rq->deadline_heap.items[0];
+	scheduler_remove_from_ready(rq, best);
+	return best;
+}
+
+static struct process *scheduler_pick_fair(struct sched_cpu *rq)
+{
+	if (!rq->fair_tree.leftmost)
+		return NULL;
+
+	struct process *best = fair_node_entry(rq->fair_tree.leftmost);
+	scheduler_remove_from_ready(rq, best);
+	return best;
+}
+
+static struct process *scheduler_select_next(struct sched_cpu *rq)
+{
+	struct process *proc_exec = scheduler_pick_deadline(rq);
+	if (proc_exec)
+		return proc_exec;
+	proc_exec = scheduler_pick_fair(rq);
+	if (proc_exec)
+		return proc_exec;
+	return scheduler_dequeue_next(rq);
+}
+
+static int scheduler_cpu_idle(uint32_t cpu)
+{
+	struct cpu_local *local = smp_cpu(cpu);
+	return sched_cpus[cpu].nr_ready == 0u && local->current == local->idle;
+}
+
+/* Prefer the previous CPU while it idles, then any idle CPU, then the shortest queue. */
+static uint32_t scheduler_select_cpu(const struct process *proc_exec)
+{
+	uint32_t allowed = proc_exec->cpu_affinity & smp_online_mask();
+	uint32_t prev = proc_exec->cpu;
+	if (allowed == 0u)
+		return 0;
+	if ((allowed & (1u << prev)) && scheduler_cpu_idle(prev))
+		return prev;
+
+	uint32_t best = prev;
+	uint32_t best_load = 0xFFFFFFFFu;
+	for (uint32_t cpu = 0; cpu < CONFIG_MAX_CPUS; ++cpu)
+	{
+		if (!(allowed & (1u << cpu)))
+			continue;
+		if (scheduler_cpu_idle(cpu))
+			return cpu;
+		uint32_t load = sched_cpus[cpu].nr_ready;
+		if (load < best_load || (load == best_load && cpu == prev))
+		{
+			best = cpu;
+			best_load = load;
+		}
+	}
+	return best;
+}
+
+/*
+ * Queue a READY process that is neither queued nor on a CPU. It goes to
+ * the CPU scheduler_select_cpu() picks, which gets a reschedule IPI if it
+ * is remote and idling.
+ */
+static void scheduler_enqueue_task(struct process *proc_exec)
+{
+	uint32_t flags = scheduler_irq_save();
+	uint32_t target = scheduler_select_cpu(proc_exec);
+	struct sched_cpu *dst = &sched_cpus[target];
+	struct sched_cpu *src;
+	for (;;)
+	{
+		src = &sched_cpus[proc_exec->cpu];
+		scheduler_lock_pair(src, dst);
+		if (src == &sched_cpus[proc_exec->cpu])
+			break;
+		scheduler_unlock_pair(src, dst);
+	}
+
+	int queued = 0;
+	if (proc_exec->state == PROC_READY && !proc_exec->on_run_queue && !proc_exec->on_cpu)
+	{
+		if (src != dst)
+		{
+			proc_exec->cpu = target;
+			++proc_exec->migrations;
+			++dst->migrations_in;
+		}
+		scheduler_enqueue_ready(dst, proc_exec);
+		queued = 1;
+	}
+	scheduler_unlock_pair(src, dst);
+
+	struct cpu_local *local = smp_cpu(target);
+	if (queued && target != smp_cpu_id() && local->current == local->idle)
+		smp_send_reschedule(target);
+	scheduler_irq_restore(flags);
+}
+
+static void scheduler_mark_running(struct process *proc_exec)
+{
+	proc_exec->state = PROC_RUNNING;
+	proc_exec->on_cpu = 1;
+}
+
+/* Some other CPU holds queued work this one may be allowed to take. */
+static int scheduler_steal_pending(uint32_t cpu)
+{
+	uint32_t online = smp_online_mask();
+	for (uint32_t i = 0; i < CONFIG_MAX_CPUS; ++i)
+	{
+		if (i != cpu && (online & (1u << i)) && sched_cpus[i].nr_migratable != 0u)
+			return 1;
+	}
+	return 0;
+}
+
+static struct process *scheduler_find_stealable(struct sched_cpu *victim, uint32_t cpu)
+{
+	uint32_t mask = 1u << cpu;
+	struct sched_rb_node *node = victim->fair_tree.leftmost;
+	for (uint32_t scanned = 0; node && scanned < CONFIG_SCHED_STEAL_SCAN; ++scanned)
+	{
+		struct process *proc_exec = fair_node_entry(node);
+		if (proc_exec->cpu_affinity & mask)
+			return proc_exec;
+		node = rb_next(node);
+	}
+
+	for (int priority = SCHED_PRIORITY_MIN; priority <= SCHED_PRIORITY_MAX; ++priority)
+	{
+		for (struct process *iter = victim->ready_queues[priority].head; iter; iter = iter->next_run)
+		{
+			if (iter->cpu_affinity & mask)
+				return iter;
+		}
+	}
+	return NULL;
+}
+
+/* Idle-time balancing: pull one queued task that may run here off the next busy CPU. */
+static struct process *scheduler_steal(struct sched_cpu *rq)
+{
+	uint32_t online = smp_online_mask();
+	for (uint32_t step = 1; step < CONFIG_MAX_CPUS; ++step)
+	{
+		uint32_t index = (rq->index + step) % CONFIG_MAX_CPUS;
+		if (!(online & (1u << index)))
+			continue;
+		struct sched_cpu *victim = &sched_cpus[index];
+		if (victim->nr_migratable == 0u)
+			continue;
+
+		scheduler_lock_pair(rq, victim);
+		struct process *proc_exec = scheduler_find_stealable(victim, rq->index);
+		if (proc_exec)
+		{
+			scheduler_remove_from_ready(victim, proc_exec);
+			proc_exec->cpu = rq->index;
+			++proc_exec->migrations;
+			++rq->migrations_in;
+			++rq->steals;
+			scheduler_mark_running(proc_exec);
+		}
+		scheduler_unlock_pair(rq, victim);
+		if (proc_exec)
+			return proc_exec;
+	}
+	return NULL;
+}
+
+static uint32_t scheduler_latency_bucket(uint64_t ns)
+{
+	if (ns < (1u << SCHED_LATENCY_SHIFT))
+		return 0;
+	uint32_t clamped = (ns > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (uint32_t)ns;
+	uint32_t bucket = (31u - (uint32_t)__builtin_clz(clamped)) - (SCHED_LATENCY_SHIFT - 1u);
+	return (bucket < SCHED_LATENCY_BUCKETS) ? bucket : SCHED_LATENCY_BUCKETS - 1u;
+}
+
+/* The task was just picked; it is RUNNING, so only this CPU touches these fields. */
+static void scheduler_account_switch_in(struct sched_cpu *rq, struct process *proc_exec, uint64_t now)
+{
+	++rq->context_switches;
+	proc_exec->acct_switch_in_tsc = now;
+	if (proc_exec->acct_ready_tsc)
+	{
+		proc_exec->acct_wait_cycles += now - proc_exec->acct_ready_tsc;
+		proc_exec->acct_ready_tsc = 0;
+	}
+	if (!proc_exec->acct_wake_tsc)
+		return;
+
+	uint64_t latency = tsc_to_ns(now - proc_exec->acct_wake_tsc);
+	proc_exec->acct_wake_tsc = 0;
+	uint32_t bucket = scheduler_latency_bucket(latency);
+	++proc_exec->wake_latency_hist[bucket];
+	++rq->wake_latency_hist[bucket];
+	++proc_exec->acct_wakeups;
+	proc_exec->acct_wake_latency_ns += latency;
+	if (latency > proc_exec->acct_wake_latency_max_ns)
+		proc_exec->acct_wake_latency_max_ns = (latency > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (uint32_t)latency;
+}
+
+/*
+ * Called with the task's run-queue lock held, so a wakeup racing with the
+ * switch has either stamped acct_wake_tsc already or will find it WAITING.
+ */
+static void scheduler_account_switch_out(struct process *proc_exec, uint64_t now)
+{
+	proc_exec->acct_run_cycles += now - proc_exec->acct_switch_in_tsc;
+	if (scheduler_is_idle(proc_exec))
+		return;
+
+	if (proc_exec->state == PROC_READY && !proc_exec->acct_wake_tsc)
+	{
+		++proc_exec->acct_involuntary;
+		proc_exec->acct_ready_tsc = now;
+	}
+	else
+	{
+		++proc_exec->acct_voluntary;
+	}
+}
+
+static void scheduler_account_runtime(struct process *proc_exec)
+{
+	if (!proc_exec || scheduler_is_idle(proc_exec))
+		return;
+	if (proc_exec->sched_policy != SCHED_POLICY_FAIR)
+		return;
+
+	uint32_t used = proc_exec->time_slice_ticks;
+	if (proc_exec->time_slice_remaining <= proc_exec->time_slice_ticks)
+		used -= proc_exec->time_slice_remaining;
+
+	if (used == 0)
+		return;
+
+	uint32_t weight = proc_exec->sched_weight ? proc_exec->sched_weight : CONFIG_SCHED_DEFAULT_WEIGHT;
+	uint64_t scaled = ((uint64_t)used * (uint64_t)CONFIG_SCHED_BASE_WEIGHT) / (uint64_t)weight;
+	if (scaled == 0)
+		scaled = 1;
+	proc_exec->vruntime += scaled;
+}
+
+/*
+ * Constant-bandwidth server rules. A reserved deadline task may consume
+ * cbs_runtime ticks per cbs_period. Exhausting the budget postpones its
+ * deadline by one period and refills it, which drops the task behind other
+ * work instead of letting it monopolise the CPU. On wakeup the current
+ * (deadline, budget) pair is kept only if it would not exceed the reserved
+ * bandwidth; otherwise a fresh period starts now.
+ */
+static void scheduler_cbs_wakeup(struct process *proc_exec, uint64_t now)
+{
+	if (proc_exec->sched_policy != SCHED_POLICY_DEADLINE || proc_exec->cbs_runtime == 0)
+		return;
+
+	uint64_t deadline = proc_exec->sched_deadline;
+	if (deadline > now &&
+		(uint64_t)proc_exec->cbs_budget * proc_exec->cbs_period <= (deadline - now) * proc_exec->cbs_runtime)
+		return;
+
+	proc_exec->sched_deadline = now + proc_exec->cbs_period;
+	proc_exec->cbs_budget = proc_exec->cbs_runtime;
+}
+
+/* Charge one tick to the running task; returns 1 when it must yield the CPU. */
+static int scheduler_cbs_charge(struct process *proc_exec, uint64_t now)
+{
+	if (proc_exec->sched_policy != SCHED_POLICY_DEADLINE || proc_exec->cbs_runtime == 0)
+		return 0;
+
+	if (now > proc_exec->sched_deadline && proc_exec->cbs_missed_deadline != proc_exec->sched_deadline)
+	{
+		++proc_exec->deadline_misses;
+		proc_exec->cbs_missed_deadline = proc_exec->sched_deadline;
+	}
+
+	if (proc_exec->cbs_budget > 0)
+		--proc_exec->cbs_budget;
+	if (proc_exec->cbs_budget > 0)
+		return 0;
+
+	++proc_exec->budget_overruns;
+	proc_exec->sched_deadline += proc_exec->cbs_period;
+	proc_exec->cbs_budget = proc_exec->cbs_runtime;
+	return 1;
+}
+
+/*
+ * WAITING -> READY under the owner's run-queue lock. Returns 1 when the
+ * caller must queue the task; a task still switching out on its CPU is
+ * requeued by that CPU's scheduler instead.
+ */
+static int scheduler_make_ready(struct process *proc_exec)
+{
+	scheduler_boost_priority(proc_exec);
+	scheduler_cbs_wakeup(proc_exec, get_ticks());
+	proc_exec->state = PROC_READY;
+	proc_exec->acct_ready_tsc = rdtsc();
+	proc_exec->acct_wake_tsc = proc_exec->acct_ready_tsc;
+	return !proc_exec->on_cpu;
+}
+
+/* Timer callback: runs from the PIT or APIC timer interrupt when a timed block expires. */
+static void process_timer_expired(void *data)
+{
+	struct process *proc_exec = (struct process *)data;
+	if (!proc_exec)
+		return;
+
+	uint32_t flags;
+	struct sched_cpu *rq = task_rq_lock(proc_exec, &flags);
+	if (proc_exec->state != PROC_WAITING)
+	{
+		task_rq_unlock(rq, flags);
+		return;
+	}
+
+	proc_exec->timed_out = 1;
 	proc_exec->wake_deadline = 0;
-	proc_exec->kind = THREAD_KIND_KERNEL;
-	proc_exec->base_priority = scheduler_clamp_priority(SCHED_PRIORITY_MAX);
-	proc_exec->dynamic_priority = proc_exec->base_priority;
-	proc_exec->sched_policy = SCHED_POLICY_FAIR;
-	proc_exec->sched_weight = CONFIG_SCHED_DEFAULT_WEIGHT;
-	proc_exec->sched_deadline = 0;
-	proc_exec->vruntime = 0;
-	for (size_t slot = 0; slot < CONFIG_PROCESS_CHANNEL_SLOTS; ++slot)
-		proc_exec->channel_slots[slot] = -1;
-	ipc_attach_process(proc_exec);
+	int enqueue = scheduler_make_ready(proc_exec);
+	task_rq_unlock(rq, flags);
+	if (enqueue)
+		scheduler_enqueue_task(proc_exec);
+}
+
+/* Switch to this CPU's scheduler; it requeues the task once off its stack. */
+static void scheduler_preempt_running(int demote_priority)
+{
+	struct process *proc_exec = cpu_current();
+	if (!proc_exec)
+		return;
+
+	struct sched_cpu *rq = this_rq();
+	uint32_t flags = scheduler_irq_save();
+	if (!scheduler_is_idle(proc_exec))
+	{
+		if (demote_priority)
+			scheduler_demote_priority(proc_exec);
+
+		spinlock_lock(&rq->lock);
+		if (proc_exec->state == PROC_RUNNING)
+			proc_exec->state = PROC_READY;
+		spinlock_unlock(&rq->lock);
+	}
+
+	context_switch(&proc_exec->ctx, &rq->scheduler_ctx);
+	scheduler_irq_restore(flags);
+}
+
+static void reclaim_zombie(struct process *proc_exec)
+{
+	if (!proc_exec || proc_exec->state != PROC_ZOMBIE)
+		return;
+
+	int pid = proc_exec->pid;
+	int exit_code = proc_exec->exit_code;
+
+	timer_cancel(&proc_exec->sleep_timer);
+	hrtimer_cancel(&proc_exec->sleep_hrtimer);
+	proc_exec->on_run_queue = 0;
+	proc_exec->next_run = NULL;
+	proc_exec->prev_run = NULL;
+
+	release_process_slot(proc_exec);
 
 	scheduler_send_event(SCHED_EVENT_RECLAIM, pid, exit_code, PROC_UNUSED);
 }
 
 static int acquire_pid(void)
 {
+	uint32_t flags;
+	spinlock_lock_irqsave(&process_table_lock, &flags);
 	if (next_pid <= 0)
 		next_pid = 1;
-	return next_pid++;
+	int pid = next_pid++;
+	spinlock_unlock_irqrestore(&process_table_lock, flags);
+	return pid;
 }
 
 static uint8_t scheduler_default_user_priority(void)
@@ -589,7 +1366,7 @@ static uint8_t scheduler_default_kernel_priority(void)
 
 static void thread_entry_trampoline(void)
 {
-	struct process *proc_exec = current_process;
+	struct process *proc_exec = cpu_current();
 	if (proc_exec && proc_exec->entry)
 		proc_exec->entry();
 }
@@ -612,13 +1389,26 @@ static struct process *scheduler_create_thread(process_entry_t entry, size_t sta
 	if (!entry)
 		return NULL;
 
-	if (stack_size == 0 || stack_size > PROC_STACK_SIZE)
+	if (stack_size == 0)
 		stack_size = PROC_STACK_SIZE;
+	if (stack_size < CONFIG_PROC_STACK_MIN)
+		stack_size = CONFIG_PROC_STACK_MIN;
+	if (stack_size > CONFIG_PROC_STACK_MAX)
+		stack_size = CONFIG_PROC_STACK_MAX;
+	stack_size = (stack_size + 15u) & ~(size_t)15u;
 
 	struct process *proc_exec = alloc_process_slot();
 	if (!proc_exec)
 		return NULL;
 
+	proc_exec->stack = (uint8_t *)kalloc(stack_size);
+	if (!proc_exec->stack)
+	{
+		release_process_slot(proc_exec);
+		return NULL;
+	}
+	stack_guard_install(proc_exec);
+
 	proc_exec->kind = kind;
 	proc_exec->base_priority = scheduler_clamp_priority(base_priority);
 	proc_exec->dynamic_priority = proc_exec->base_priority;
@@ -634,7 +1424,17 @@ static struct process *scheduler_create_thread(process_entry_t entry, size_t sta
 	proc_exec->on_run_queue = 0;
 	proc_exec->wake_deadline = 0;
 	proc_exec->next_run = NULL;
-	proc_exec->next_sleep = NULL;
+	proc_exec->prev_run = NULL;
+	proc_exec->timed_out = 0;
+	proc_exec->cpu = 0;
+	proc_exec->on_cpu = 0;
+	proc_exec->wake_pending = 0;
+	proc_exec->stack_overflowed = 0;
+	proc_exec->cpu_affinity = CONFIG_SCHED_DEFAULT_AFFINITY;
+	proc_exec->migrations = 0;
+	proc_exec->acct_ready_tsc = rdtsc();
+	timer_init(&proc_exec->sleep_timer, process_timer_expired, proc_exec);
+	hrtimer_init(&proc_exec->sleep_hrtimer, process_timer_expired, proc_exec);
 	proc_exec->channel_count = 0;
 	proc_exec->wait_channel = -1;
 	proc_exec->exit_code = 0;
@@ -654,16 +1454,10 @@ static struct process *scheduler_create_thread(process_entry_t entry, size_t sta
 	*--sp = 0u;
 	proc_exec->ctx.esp = (uint32_t)sp;
 
+	/* Idle threads are installed on their CPU by scheduler_install_idle(). */
+	scheduler_arm_timeslice(proc_exec);
 	if (!is_idle)
-	{
-		scheduler_arm_timeslice(proc_exec);
-		scheduler_enqueue_ready(proc_exec);
-	}
-	else
-	{
-		scheduler_arm_timeslice(proc_exec);
-		idle_process = proc_exec;
-	}
+		scheduler_enqueue_task(proc_exec);
 
 	if (emit_event && proc_exec->pid > 0)
 	{
@@ -677,54 +1471,95 @@ static struct process *scheduler_create_thread(process_entry_t entry, size_t sta
 static void idle_thread(void)
 {
 	for (;;)
-		__asm__ __volatile__("sti\n\thlt");
+	{
+		struct sched_cpu *rq = this_rq();
+		if (rq->index == 0u)
+		{
+			/* The boot CPU owns the PIT and may stop it while idle. */
+			if (rq->nr_ready)
+				scheduler_preempt_running(0);
+			else
+				pit_idle_halt();
+			continue;
+		}
+
+		__asm__ __volatile__("cli");
+		if (!rq->nr_ready)
+			__asm__ __volatile__("sti\n\thlt\n\tcli");
+		/* Only IPIs reach an AP, so every wakeup is worth a trip through the scheduler. */
+		scheduler_preempt_running(0);
+		__asm__ __volatile__("sti");
+	}
+}
+
+static int scheduler_install_idle(uint32_t cpu)
+{
+	/* Interrupts, tasklets and timer callbacks all run on the idle stack. */
+	struct process *idle = scheduler_create_thread(idle_thread, PROC_STACK_SIZE, THREAD_KIND_KERNEL, SCHED_PRIORITY_MAX, 0, 1);
+	if (!idle)
+		return -1;
+
+	idle->cpu = cpu;
+	idle->cpu_affinity = 1u << cpu;
+	sched_cpus[cpu].idle_process = idle;
+	smp_cpu(cpu)->idle = idle;
+	return 0;
 }
 
 void process_system_init(void)
 {
+	spinlock_init_named(&process_table_lock, "sched.proc_table");
 	for (int i = 0; i < MAX_PROCS; ++i)
+		process_table[i] = NULL;
+
+	if (!process_cache)
+		process_cache = kmem_cache_create("process", sizeof(struct process), 0, NULL);
+
+	for (uint32_t cpu = 0; cpu < CONFIG_MAX_CPUS; ++cpu)
 	{
-		processes[i].pid = -1;
-		processes[i].state = PROC_UNUSED;
-		processes[i].stack_size = PROC_STACK_SIZE;
-		processes[i].channel_count = 0;
-		processes[i].wait_channel = -1;
-		processes[i].ipc_waiting = 0;
-		processes[i].exit_code = 0;
-		processes[i].on_run_queue = 0;
-		processes[i].sched_policy = SCHED_POLICY_FAIR;
-		processes[i].sched_weight = CONFIG_SCHED_DEFAULT_WEIGHT;
-		processes[i].sched_deadline = 0;
-		processes[i].vruntime = 0;
-		processes[i].next_run = NULL;
-		processes[i].next_sleep = NULL;
-		processes[i].wake_deadline = 0;
-		processes[i].time_slice_ticks = 0;
-		processes[i].time_slice_remaining = 0;
-		for (size_t slot = 0; slot < CONFIG_PROCESS_CHANNEL_SLOTS; ++slot)
-			processes[i].channel_slots[slot] = -1;
-		ipc_attach_process(&processes[i]);
-	}
-
-	for (int i = 0; i < SCHED_PRIORITY_LEVELS; ++i)
-	{
-		ready_queues[i].head = NULL;
-		ready_queues[i].tail = NULL;
-	}
-
-	ready_bitmap = 0;
-	scheduler_ctx.esp = 0;
-	current_process = NULL;
-	idle_process = NULL;
-	sleep_list = NULL;
+		struct sched_cpu *rq = &sched_cpus[cpu];
+		spinlock_init_named(&rq->lock, "sched.runqueue");
+		rq->index = cpu;
+		for (int i = 0; i < SCHED_PRIORITY_LEVELS; ++i)
+		{
+			rq->ready_queues[i].head = NULL;
+			rq->ready_queues[i].tail = NULL;
+		}
+
+		rq->ready_bitmap = 0;
+		rq->fair_tree.root = NULL;
+		rq->fair_tree.leftmost = NULL;
+		rq->fair_tree.count = 0;
+		for (int i = 0; i < MAX_PROCS; ++i)
+			rq->deadline_slots[i] = NULL;
+		rq->deadline_heap.items = rq->deadline_slots;
+		rq->deadline_heap.count = 0;
+		rq->deadline_heap.capacity = MAX_PROCS;
+		rq->nr_ready = 0;
+		rq->nr_migratable = 0;
+		rq->scheduler_ctx.esp = 0;
+		rq->idle_process = NULL;
+		rq->scheduler_active = 0;
+		rq->steals = 0;
+		rq->migrations_in = 0;
+	}
+
+	deadline_util_total = 0;
+	cpu_this()->current = NULL;
 	next_pid = 1;
-	scheduler_active = 0;
 	scheduler_channel_id = ipc_is_initialized() ? ipc_get_service_channel(IPC_SERVICE_SCHEDULER) : -1;
 
-	if (!scheduler_create_thread(idle_thread, PROC_STACK_SIZE, THREAD_KIND_KERNEL, SCHED_PRIORITY_MAX, 0, 1))
+	if (scheduler_install_idle(0) < 0)
 		klog_error("scheduler: failed to create idle thread");
 }
 
+int process_cpu_init(uint32_t cpu)
+{
+	if (cpu == 0u || cpu >= CONFIG_MAX_CPUS)
+		return -1;
+	return scheduler_install_idle(cpu);
+}
+
 struct process *process_lookup(int pid)
 {
 	if (pid <= 0)
@@ -732,8 +1567,9 @@ struct process *process_lookup(int pid)
 
 	for (int i = 0; i < MAX_PROCS; ++i)
 	{
-		if (processes[i].pid == pid && processes[i].state != PROC_UNUSED)
-			return &processes[i];
+		struct process *proc_exec = process_table[i];
+		if (proc_exec && proc_exec->pid == pid && proc_exec->state != PROC_UNUSED)
+			return proc_exec;
 	}
 	return NULL;
 }
@@ -758,10 +1594,10 @@ int process_create_kernel(void (*entry)(void), size_t stack_size)
 
 struct process *process_current(void)
 {
-	return current_process;
+	return cpu_current();
 }
 
-int process_set_scheduler(int pid, uint8_t policy, uint32_t weight, uint64_t deadline_ticks)
+int process_set_scheduler(int pid, uint8_t policy, uint32_t weight, uint64_t deadline_ticks, uint32_t runtime_ticks, uint32_t period_ticks, uint32_t affinity)
 {
 	struct process *proc_exec = NULL;
 	if (pid <= 0)
@@ -775,129 +1611,659 @@ int process_set_scheduler(int pid, uint8_t policy, uint32_t weight, uint64_t dea
 	if (policy != SCHED_POLICY_FAIR && policy != SCHED_POLICY_DEADLINE)
 		return -1;
 
+	uint64_t now = get_ticks();
+	uint64_t deadline = deadline_ticks;
+	if (deadline != 0 && deadline < now)
+		deadline = now + deadline_ticks;
+
+	if (affinity != 0u && !(affinity & smp_online_mask()))
+		return -1;
+
+	uint32_t util = 0;
+	if (policy == SCHED_POLICY_DEADLINE)
+	{
+		if (period_ticks == 0 && deadline > now && deadline - now <= SCHED_CBS_MAX_PERIOD)
+			period_ticks = (uint32_t)(deadline - now);
+		if (runtime_ticks == 0)
+		{
+			/* Without a budget the task would outrank every fair task unchecked. */
+			if (period_ticks == 0)
+				period_ticks = CONFIG_SCHED_DEADLINE_DEFAULT_PERIOD;
+			if (period_ticks <= SCHED_CBS_MAX_PERIOD)
+				runtime_ticks = (period_ticks * CONFIG_SCHED_DEADLINE_DEFAULT_UTIL) / 100u;
+			if (runtime_ticks == 0)
+				runtime_ticks = 1;
+		}
+		if (period_ticks == 0 || period_ticks > SCHED_CBS_MAX_PERIOD || runtime_ticks > period_ticks)
+			return -1;
+
+		util = (runtime_ticks * SCHED_UTIL_SCALE) / period_ticks;
+		if (util == 0)
+			util = 1;
+		if (deadline == 0)
+			deadline = now + period_ticks;
+	}
+	else
+	{
+		runtime_ticks = 0;
+		period_ticks = 0;
+	}
+
+	/* Admission is global: CBS budgets are charged per tick on whichever CPU runs the task. */
+	uint32_t table_flags;
+	spinlock_lock_irqsave(&process_table_lock, &table_flags);
+	if (util != 0 && deadline_util_total - proc_exec->cbs_util + util > SCHED_DEADLINE_UTIL_LIMIT)
+	{
+		spinlock_unlock_irqrestore(&process_table_lock, table_flags);
+		return -1;
+	}
+	deadline_util_total = deadline_util_total - proc_exec->cbs_util + util;
+	proc_exec->cbs_util = util;
+	spinlock_unlock_irqrestore(&process_table_lock, table_flags);
+
+	uint32_t flags;
+	struct sched_cpu *rq = task_rq_lock(proc_exec, &flags);
+	proc_exec->cbs_runtime = runtime_ticks;
+	proc_exec->cbs_period = period_ticks;
+	proc_exec->cbs_budget = runtime_ticks;
+	proc_exec->cbs_missed_deadline = 0;
+
+	/* The key of a queued task changes, so relink it under the new one. */
+	int requeue = proc_exec->on_run_queue;
+	if (requeue)
+		scheduler_remove_from_ready(rq, proc_exec);
+
 	if (policy == SCHED_POLICY_FAIR)
 	{
 		uint32_t effective = weight ? weight : CONFIG_SCHED_DEFAULT_WEIGHT;
 		proc_exec->sched_policy = SCHED_POLICY_FAIR;
 		proc_exec->sched_weight = effective;
 		proc_exec->sched_deadline = 0;
-		return 0;
+	}
+	else
+	{
+		proc_exec->sched_policy = SCHED_POLICY_DEADLINE;
+		proc_exec->sched_weight = weight ? weight : CONFIG_SCHED_DEFAULT_WEIGHT;
+		proc_exec->sched_deadline = deadline;
 	}
 
-	uint64_t now = get_ticks();
-	uint64_t deadline = deadline_ticks;
-	if (deadline != 0 && deadline < now)
-		deadline = now + deadline_ticks;
+	if (requeue)
+		scheduler_enqueue_ready(rq, proc_exec);
+	task_rq_unlock(rq, flags);
 
-	proc_exec->sched_policy = SCHED_POLICY_DEADLINE;
-	proc_exec->sched_weight = weight ? weight : CONFIG_SCHED_DEFAULT_WEIGHT;
-	proc_exec->sched_deadline = deadline;
+	if (affinity != 0u)
+		return process_set_affinity(proc_exec->pid, affinity);
 	return 0;
 }
 
-void process_wake(struct process *proc_exec)
+int process_set_affinity(int pid, uint32_t mask)
+{
+	struct process *proc_exec = (pid <= 0) ? process_current() : process_lookup(pid);
+	if (!proc_exec || scheduler_is_idle(proc_exec))
+		return -1;
+
+	if (CONFIG_MAX_CPUS < 32)
+		mask &= (1u << CONFIG_MAX_CPUS) - 1u;
+	if (!(mask & smp_online_mask()))
+		return -1;
+
+	uint32_t flags;
+	struct sched_cpu *rq = task_rq_lock(proc_exec, &flags);
+	/* Unlink first so nr_migratable is recounted under the new mask. */
+	int requeue = proc_exec->on_run_queue;
+	if (requeue)
+		scheduler_remove_from_ready(rq, proc_exec);
+	proc_exec->cpu_affinity = mask;
+	int evict = proc_exec->on_cpu && !(mask & (1u << proc_exec->cpu));
+	uint32_t running_on = proc_exec->cpu;
+	task_rq_unlock(rq, flags);
+
+	if (requeue)
+		scheduler_enqueue_task(proc_exec);
+	if (evict)
+	{
+		if (proc_exec == process_current())
+			process_yield();
+		else
+			smp_send_reschedule(running_on);
+	}
+	return 0;
+}
+
+/*
+ * The saved policy, deadline and CBS reservation come from before the
+ * first boost, so nested boosts from several waiters unwind in one step.
+ * A deadline boost runs on the donor's reservation, so it stays bounded;
+ * vruntime pulled forward is recorded and handed back on reset.
+ */
+void process_inherit(struct process *owner, const struct process *donor)
 {
-	if (!proc_exec || proc_exec->state != PROC_WAITING)
+	if (!owner || !donor || owner == donor || scheduler_is_idle(owner))
 		return;
 
-	scheduler_remove_from_sleep(proc_exec);
-	scheduler_boost_priority(proc_exec);
-	proc_exec->state = PROC_READY;
-	scheduler_enqueue_ready(proc_exec);
+	uint32_t flags;
+	struct sched_cpu *rq = task_rq_lock(owner, &flags);
+	if (owner->state == PROC_ZOMBIE || owner->state == PROC_UNUSED)
+	{
+		task_rq_unlock(rq, flags);
+		return;
+	}
+
+	int queued = owner->on_run_queue;
+	if (queued)
+		scheduler_remove_from_ready(rq, owner);
+
+	if (!owner->pi_boosted)
+	{
+		owner->pi_boosted = 1;
+		owner->pi_saved_policy = owner->sched_policy;
+		owner->pi_saved_deadline = owner->sched_deadline;
+		owner->pi_saved_cbs_runtime = owner->cbs_runtime;
+		owner->pi_saved_cbs_period = owner->cbs_period;
+		owner->pi_saved_cbs_budget = owner->cbs_budget;
+		owner->pi_vruntime_credit = 0;
+	}
+
+	if (donor->sched_policy == SCHED_POLICY_DEADLINE && donor->sched_deadline != 0 &&
+		(owner->sched_policy != SCHED_POLICY_DEADLINE || owner->sched_deadline == 0 ||
+		 donor->sched_deadline < owner->sched_deadline))
+	{
+		owner->sched_policy = SCHED_POLICY_DEADLINE;
+		owner->sched_deadline = donor->sched_deadline;
+		owner->cbs_runtime = donor->cbs_runtime;
+		owner->cbs_period = donor->cbs_period;
+		owner->cbs_budget = donor->cbs_budget;
+	}
+	if (donor->dynamic_priority < owner->dynamic_priority)
+		owner->dynamic_priority = donor->dynamic_priority;
+	if (owner->sched_policy == SCHED_POLICY_FAIR && donor->vruntime < owner->vruntime)
+	{
+		owner->pi_vruntime_credit += owner->vruntime - donor->vruntime;
+		owner->vruntime = donor->vruntime;
+	}
+
+	if (queued)
+		scheduler_enqueue_ready(rq, owner);
+	task_rq_unlock(rq, flags);
 }
 
-void process_block_current(void)
+void process_inherit_reset(struct process *owner)
+{
+	if (!owner)
+		return;
+
+	uint32_t flags;
+	struct sched_cpu *rq = task_rq_lock(owner, &flags);
+	if (!owner->pi_boosted)
+	{
+		task_rq_unlock(rq, flags);
+		return;
+	}
+
+	int queued = owner->on_run_queue;
+	if (queued)
+		scheduler_remove_from_ready(rq, owner);
+
+	owner->sched_policy = owner->pi_saved_policy;
+	owner->sched_deadline = owner->pi_saved_deadline;
+	owner->cbs_runtime = owner->pi_saved_cbs_runtime;
+	owner->cbs_period = owner->pi_saved_cbs_period;
+	owner->cbs_budget = owner->pi_saved_cbs_budget;
+	owner->vruntime += owner->pi_vruntime_credit;
+	owner->pi_vruntime_credit = 0;
+	scheduler_reset_priority(owner);
+	owner->pi_boosted = 0;
+
+	if (queued)
+		scheduler_enqueue_ready(rq, owner);
+	task_rq_unlock(rq, flags);
+}
+
+int process_sched_bench(uint32_t tasks, uint32_t rounds, struct sched_bench_result *out)
+{
+	if (!out || tasks == 0 || rounds == 0)
+		return -1;
+
+	struct process *pool = (struct process *)kalloc_zero((size_t)tasks * sizeof(struct process));
+	struct process **slots = (struct process **)kalloc((size_t)tasks * sizeof(struct process *));
+	if (!pool || !slots)
+	{
+		kfree(pool);
+		kfree(slots);
+		return -1;
+	}
+
+	struct sched_rb_root tree = { NULL, NULL, 0 };
+	struct sched_heap heap = { slots, 0, tasks };
+	uint32_t seed = 0x2545F491u;
+	for (uint32_t i = 0; i < tasks; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		pool[i].vruntime = seed & 0xFFFFu;
+		pool[i].sched_deadline = (seed >> 16) + 1u;
+		fair_tree_insert(&tree, &pool[i]);
+		deadline_heap_insert(&heap, &pool[i]);
+	}
+
+	/* Each round mimics one switch: take the best task, charge it, requeue. */
+	uint64_t start = rdtsc();
+	for (uint32_t r = 0; r < rounds; ++r)
+	{
+		struct process *best = fair_node_entry(tree.leftmost);
+		fair_tree_remove(&tree, best);
+		best->vruntime += (r & 7u) + 1u;
+		fair_tree_insert(&tree, best);
+	}
+	out->fair_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t r = 0; r < rounds; ++r)
+	{
+		struct process *best = heap.items[0];
+		deadline_heap_remove(&heap, best);
+		best->sched_deadline += (r & 15u) + 1u;
+		deadline_heap_insert(&heap, best);
+	}
+	out->deadline_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t r = 0; r < rounds; ++r)
+	{
+		struct process *best = &pool[0];
+		for (uint32_t i = 1; i < tasks; ++i)
+		{
+			if (pool[i].vruntime < best->vruntime)
+				best = &pool[i];
+		}
+		best->vruntime += (r & 7u) + 1u;
+	}
+	out->linear_cycles = rdtsc() - start;
+
+	out->tasks = tasks;
+	out->rounds = rounds;
+	kfree(slots);
+	kfree(pool);
+	return 0;
+}
+
+void process_wake(struct process *proc_exec)
 {
-	struct process *proc_exec = current_process;
-	if (!proc_exec || proc_exec == idle_process)
+	if (!proc_exec)
+		return;
+
+	uint32_t flags;
+	struct sched_cpu *rq = task_rq_lock(proc_exec, &flags);
+	if (proc_exec->state != PROC_WAITING)
+	{
+		/*
+		 * The target may be on another CPU between checking its wait
+		 * condition and blocking; make that block return at once.
+		 */
+		if (proc_exec->state == PROC_READY || proc_exec->state == PROC_RUNNING)
+			proc_exec->wake_pending = 1;
+		task_rq_unlock(rq, flags);
 		return;
+	}
+
+	timer_cancel(&proc_exec->sleep_timer);
+	hrtimer_cancel(&proc_exec->sleep_hrtimer);
+	proc_exec->wake_deadline = 0;
+	int enqueue = scheduler_make_ready(proc_exec);
+	task_rq_unlock(rq, flags);
+	if (enqueue)
+		scheduler_enqueue_task(proc_exec);
+}
+
+/*
+ * Common body of the blocking calls; returns 1 when the timeout fired. An
+ * interruptible block returns straight away if a wake arrived since the
+ * caller last checked its condition. The timer is armed under the run-queue
+ * lock so an early expiry on another CPU still finds the task WAITING.
+ */
+static int scheduler_block(uint32_t ticks, uint64_t ns, int interruptible)
+{
+	struct process *proc_exec = cpu_current();
+	if (!proc_exec || scheduler_is_idle(proc_exec))
+		return 0;
 
+	uint32_t flags;
+	struct sched_cpu *rq = task_rq_lock(proc_exec, &flags);
+	if (interruptible && proc_exec->wake_pending)
+	{
+		proc_exec->wake_pending = 0;
+		task_rq_unlock(rq, flags);
+		return 0;
+	}
+
+	proc_exec->timed_out = 0;
 	proc_exec->state = PROC_WAITING;
 	proc_exec->time_slice_remaining = 0;
-	context_switch(&proc_exec->ctx, &scheduler_ctx);
-	proc_exec->state = PROC_RUNNING;
+	if (ticks > 0u)
+	{
+		proc_exec->wake_deadline = get_ticks() + (uint64_t)ticks;
+		timer_arm(&proc_exec->sleep_timer, ticks);
+	}
+	if (ns > 0u)
+		hrtimer_start(&proc_exec->sleep_hrtimer, ns);
+	spinlock_unlock(&rq->lock);
+
+	context_switch(&proc_exec->ctx, &rq->scheduler_ctx);
+	scheduler_finish_handoff();
+	scheduler_irq_restore(flags);
+
+	if (ticks > 0u)
+		timer_cancel(&proc_exec->sleep_timer);
+	if (ns > 0u)
+		hrtimer_cancel(&proc_exec->sleep_hrtimer);
+	proc_exec->wake_deadline = 0;
+	int timed_out = proc_exec->timed_out;
+	proc_exec->timed_out = 0;
+	return timed_out;
 }
 
-void process_sleep(uint32_t ticks)
+void process_block_current(void)
 {
-	struct process *proc_exec = current_process;
-	if (!proc_exec || proc_exec == idle_process)
-		return;
+	scheduler_block(0, 0, 1);
+}
 
+int process_block_timeout(uint32_t ticks)
+{
+	return scheduler_block(ticks, 0, 1);
+}
+
+void process_sleep(uint32_t ticks)
+{
 	if (ticks == 0u)
 		ticks = 1u;
 
-	uint64_t now = get_ticks();
-	proc_exec->wake_deadline = now + (uint64_t)ticks;
-	proc_exec->state = PROC_WAITING;
-	proc_exec->time_slice_remaining = 0;
-	scheduler_insert_sleep(proc_exec);
-	context_switch(&proc_exec->ctx, &scheduler_ctx);
-	proc_exec->state = PROC_RUNNING;
+	scheduler_block(ticks, 0, 0);
+}
+
+void process_sleep_ns(uint64_t ns)
+{
+	scheduler_block(0, ns, 0);
 }
 
 void process_yield(void)
 {
-	struct process *proc_exec = current_process;
-	if (!proc_exec || proc_exec == idle_process)
+	struct process *proc_exec = cpu_current();
+	if (!proc_exec || scheduler_is_idle(proc_exec))
 		return;
 
+	uint32_t flags;
+	struct sched_cpu *rq = task_rq_lock(proc_exec, &flags);
 	scheduler_reset_priority(proc_exec);
 	proc_exec->state = PROC_READY;
 	proc_exec->time_slice_remaining = 0;
-	scheduler_enqueue_ready(proc_exec);
-	context_switch(&proc_exec->ctx, &scheduler_ctx);
-	proc_exec->state = PROC_RUNNING;
+	spinlock_unlock(&rq->lock);
+
+	context_switch(&proc_exec->ctx, &rq->scheduler_ctx);
+	scheduler_irq_restore(flags);
 }
 
-void process_exit(int code)
+static void process_terminate(struct process *proc_exec, int code)
 {
-	struct process *proc_exec = current_process;
-	if (!proc_exec)
-		return;
-
 	ipc_process_cleanup(proc_exec);
- 	service_handle_exit(proc_exec->pid);
+	evset_process_cleanup(proc_exec);
+	uring_process_cleanup(proc_exec);
+	service_handle_exit(proc_exec->pid);
+
+	timer_cancel(&proc_exec->sleep_timer);
+	hrtimer_cancel(&proc_exec->sleep_hrtimer);
+
+	uint32_t flags;
+	spinlock_lock_irqsave(&process_table_lock, &flags);
+	deadline_util_total -= proc_exec->cbs_util;
+	proc_exec->cbs_util = 0;
+	spinlock_unlock_irqrestore(&process_table_lock, flags);
 
-	scheduler_remove_from_sleep(proc_exec);
+	struct sched_cpu *rq = task_rq_lock(proc_exec, &flags);
+	scheduler_remove_from_ready(rq, proc_exec);
 	proc_exec->on_run_queue = 0;
 	proc_exec->next_run = NULL;
-
+	proc_exec->prev_run = NULL;
 	proc_exec->exit_code = code;
 	proc_exec->state = PROC_ZOMBIE;
+	task_rq_unlock(rq, flags);
+
 	log_process_event("process: exit pid ", proc_exec->pid);
 	scheduler_send_event(SCHED_EVENT_EXIT, proc_exec->pid, code, proc_exec->state);
 	debug_publish_task_list();
-	context_switch(&proc_exec->ctx, &scheduler_ctx);
+}
+
+void process_exit(int code)
+{
+	struct process *proc_exec = cpu_current();
+	if (!proc_exec)
+		return;
+
+	/* Teardown touches IPC, the VFS and klog, which still assume one CPU. */
+	while (smp_cpu_id() != 0u)
+	{
+		uint32_t flags;
+		struct sched_cpu *rq = task_rq_lock(proc_exec, &flags);
+		proc_exec->cpu_affinity = 1u;
+		task_rq_unlock(rq, flags);
+		process_yield();
+	}
+
+	process_terminate(proc_exec, code);
+	context_switch(&proc_exec->ctx, &this_rq()->scheduler_ctx);
 
 	for (;;)
 		__asm__ __volatile__("hlt");
 }
 
+/* Back on the scheduler stack: queue the task that just ran if it is still runnable. */
+static void scheduler_put_prev(struct sched_cpu *rq, struct process *proc_exec, uint64_t now)
+{
+	if (scheduler_is_idle(proc_exec))
+	{
+		scheduler_account_switch_out(proc_exec, now);
+		proc_exec->on_cpu = 0;
+		return;
+	}
+
+	spinlock_lock(&rq->lock);
+	scheduler_account_switch_out(proc_exec, now);
+	proc_exec->on_cpu = 0;
+	int migrate = 0;
+	if (proc_exec->state == PROC_READY && !proc_exec->on_run_queue)
+	{
+		if (proc_exec->cpu_affinity & (1u << rq->index))
+			scheduler_enqueue_ready(rq, proc_exec);
+		else
+			migrate = 1;
+	}
+	spinlock_unlock(&rq->lock);
+
+	if (migrate)
+		scheduler_enqueue_task(proc_exec);
+}
+
+/* Scheduler loop: kill a task whose stack guard was overwritten. */
+static void scheduler_kill_overflowed(struct process *victim)
+{
+	char message[48];
+	format_process_event("process: stack overflow pid ", victim->pid, message, sizeof(message));
+	klog_error(message);
+	process_terminate(victim, -1);
+}
+
+/*
+ * Killing a task touches IPC, the VFS and klog, which still assume one CPU
+ * (see process_exit()), so an AP only marks an overflowed task and sends it
+ * to CPU 0, which kills it when it next picks it. @return 1 if @p next was
+ * just picked but must not run here.
+ */
+static int scheduler_reap_overflowed(struct sched_cpu *rq, struct process *next)
+{
+	if (!next->stack_overflowed)
+		return 0;
+
+	if (rq->index == 0u)
+	{
+		scheduler_kill_overflowed(next);
+		next->on_cpu = 0;
+		int pid = next->pid;
+		reclaim_zombie(next);
+		log_process_event("process: reclaimed pid ", pid);
+		debug_publish_task_list();
+		return 1;
+	}
+
+	/* Its affinity was changed back since it was marked; send it on again. */
+	uint32_t flags;
+	struct sched_cpu *owner = task_rq_lock(next, &flags);
+	next->cpu_affinity = 1u;
+	next->state = PROC_READY;
+	next->on_cpu = 0;
+	task_rq_unlock(owner, flags);
+	scheduler_enqueue_task(next);
+	return 1;
+}
+
+/* First thing on the new stack after process_handoff(): the old task is off its own now. */
+static void scheduler_finish_handoff(void)
+{
+	struct sched_cpu *rq = this_rq();
+	struct process *prev = rq->handoff_prev;
+	if (!prev)
+		return;
+
+	rq->handoff_prev = NULL;
+	scheduler_put_prev(rq, prev, rdtsc());
+}
+
+int process_handoff(struct process *target)
+{
+	struct process *proc_exec = cpu_current();
+	if (!proc_exec || !target || target == proc_exec)
+		return -1;
+	if (scheduler_is_idle(proc_exec) || scheduler_is_idle(target))
+		return -1;
+
+	uint32_t flags = scheduler_irq_save();
+	struct sched_cpu *rq = this_rq();
+	struct sched_cpu *src;
+	for (;;)
+	{
+		src = &sched_cpus[target->cpu];
+		scheduler_lock_pair(rq, src);
+		if (src == &sched_cpus[target->cpu])
+			break;
+		scheduler_unlock_pair(rq, src);
+	}
+
+	if (!rq->scheduler_active || target->state != PROC_WAITING || target->on_cpu || target->stack_overflowed ||
+		!(target->cpu_affinity & (1u << rq->index)))
+	{
+		scheduler_unlock_pair(rq, src);
+		scheduler_irq_restore(flags);
+		return -1;
+	}
+
+	timer_cancel(&target->sleep_timer);
+	hrtimer_cancel(&target->sleep_hrtimer);
+	target->wake_deadline = 0;
+	scheduler_make_ready(target);
+	if (src != rq)
+	{
+		target->cpu = (uint8_t)rq->index;
+		++target->migrations;
+		++rq->migrations_in;
+	}
+	scheduler_mark_running(target);
+
+	/* The target runs out the caller's slice rather than starting a fresh one. */
+	scheduler_account_runtime(proc_exec);
+	uint32_t slice = proc_exec->time_slice_remaining ? proc_exec->time_slice_remaining : 1u;
+	target->time_slice_ticks = slice;
+	target->time_slice_remaining = slice;
+	proc_exec->time_slice_remaining = 0;
+
+	/* A wake that beat us here leaves the caller runnable instead of blocked. */
+	if (proc_exec->wake_pending)
+	{
+		proc_exec->wake_pending = 0;
+		proc_exec->state = PROC_READY;
+		proc_exec->acct_wake_tsc = rdtsc();
+	}
+	else
+	{
+		proc_exec->state = PROC_WAITING;
+	}
+
+	rq->handoff_prev = proc_exec;
+	++rq->handoffs;
+	cpu_this()->current = target;
+	scheduler_account_switch_in(rq, target, rdtsc());
+	scheduler_unlock_pair(rq, src);
+
+	context_switch(&proc_exec->ctx, &target->ctx);
+	scheduler_finish_handoff();
+	scheduler_irq_restore(flags);
+	return 0;
+}
+
 void process_schedule(void)
 {
-	if (scheduler_active)
+	struct sched_cpu *rq = this_rq();
+	struct cpu_local *cpu = cpu_this();
+	if (rq->scheduler_active || !rq->idle_process)
 		return;
 
-	scheduler_active = 1;
+	/* The loop runs with interrupts off; each task's saved flags bring its own IF. */
+	__asm__ __volatile__("cli");
+	rq->scheduler_active = 1;
 
 	while (1)
 	{
-		wake_sleepers(get_ticks());
+		spinlock_lock(&rq->lock);
+		struct process *next = scheduler_select_next(rq);
+		if (next)
+			scheduler_mark_running(next);
+		spinlock_unlock(&rq->lock);
 
-		struct process *next = scheduler_select_next();
 		if (!next)
-			next = idle_process;
+			next = scheduler_steal(rq);
+		if (!next)
+		{
+			next = rq->idle_process;
+			scheduler_mark_running(next);
+		}
+		if (scheduler_reap_overflowed(rq, next))
+			continue;
 
-		current_process = next;
-		next->state = PROC_RUNNING;
+		cpu->current = next;
 		scheduler_arm_timeslice(next);
+		scheduler_account_switch_in(rq, next, rdtsc());
 
-		context_switch(&scheduler_ctx, &next->ctx);
+		context_switch(&rq->scheduler_ctx, &next->ctx);
 
-		struct process *finished = current_process;
+		uint64_t switched_out = rdtsc();
+		struct process *finished = cpu->current;
 		scheduler_account_runtime(finished);
-		if (finished && finished->state == PROC_ZOMBIE)
+		if (finished->state != PROC_ZOMBIE && !stack_guard_intact(finished))
+		{
+			if (scheduler_is_idle(finished))
+			{
+				stack_guard_install(finished);
+			}
+			else if (rq->index == 0u)
+			{
+				scheduler_kill_overflowed(finished);
+			}
+			else
+			{
+				uint32_t flags;
+				struct sched_cpu *owner = task_rq_lock(finished, &flags);
+				finished->stack_overflowed = 1;
+				finished->cpu_affinity = 1u;
+				task_rq_unlock(owner, flags);
+			}
+		}
+		if (finished->state == PROC_ZOMBIE)
 		{
 			int pid = finished->pid;
 			reclaim_zombie(finished);
@@ -905,11 +2271,15 @@ void process_schedule(void)
 				log_process_event("process: reclaimed pid ", pid);
 			debug_publish_task_list();
 		}
+		else
+		{
+			scheduler_put_prev(rq, finished, switched_out);
+			/* A blocked victim has to reach CPU 0's run queue to be killed. */
+			if (finished->stack_overflowed)
+				process_wake(finished);
+		}
 
-		if (finished && finished->state == PROC_READY && finished != idle_process && !finished->on_run_queue)
-			scheduler_enqueue_ready(finished);
-
-		current_process = NULL;
+		cpu->current = NULL;
 	}
 }
 
@@ -918,7 +2288,8 @@ int process_count(void)
 	int total = 0;
 	for (int i = 0; i < MAX_PROCS; ++i)
 	{
-		if (processes[i].state != PROC_UNUSED && processes[i].pid > 0)
+		struct process *proc_exec = process_table[i];
+		if (proc_exec && proc_exec->state != PROC_UNUSED && proc_exec->pid > 0)
 			++total;
 	}
 	return total;
@@ -930,10 +2301,11 @@ size_t process_snapshot(struct process_info *out, size_t max_entries)
 		return 0;
 
 	size_t count = 0;
+	uint64_t now = rdtsc();
 	for (int i = 0; i < MAX_PROCS && count < max_entries; ++i)
 	{
-		struct process *proc_exec = &processes[i];
-		if (proc_exec->state == PROC_UNUSED || proc_exec->pid <= 0)
+		struct process *proc_exec = process_table[i];
+		if (!proc_exec || proc_exec->state == PROC_UNUSED || proc_exec->pid <= 0)
 			continue;
 
 		struct process_info *slot = &out[count++];
@@ -946,11 +2318,42 @@ size_t process_snapshot(struct process_info *out, size_t max_entries)
 		slot->sched_weight = proc_exec->sched_weight;
 		slot->sched_deadline = proc_exec->sched_deadline;
 		slot->vruntime = proc_exec->vruntime;
+		slot->cbs_runtime = proc_exec->cbs_runtime;
+		slot->cbs_period = proc_exec->cbs_period;
+		slot->cbs_budget = proc_exec->cbs_budget;
+		slot->deadline_misses = proc_exec->deadline_misses;
+		slot->budget_overruns = proc_exec->budget_overruns;
 		slot->time_slice_remaining = proc_exec->time_slice_remaining;
 		slot->time_slice_ticks = proc_exec->time_slice_ticks;
 		slot->wake_deadline = proc_exec->wake_deadline;
 		slot->stack_pointer = proc_exec->ctx.esp;
+		slot->stack_base = (uintptr_t)proc_exec->stack;
 		slot->stack_size = proc_exec->stack_size;
+		slot->cpu = proc_exec->cpu;
+		slot->cpu_affinity = proc_exec->cpu_affinity;
+		slot->migrations = proc_exec->migrations;
+
+		/* Unlocked reads; a stretch in progress is counted up to now. */
+		uint64_t run = proc_exec->acct_run_cycles;
+		if (proc_exec->on_cpu && proc_exec->acct_switch_in_tsc)
+			run += now - proc_exec->acct_switch_in_tsc;
+		uint64_t wait = proc_exec->acct_wait_cycles;
+		uint64_t ready_since = proc_exec->acct_ready_tsc;
+		if (ready_since && ready_since < now)
+			wait += now - ready_since;
+		slot->run_ns = tsc_to_ns(run);
+		slot->wait_ns = tsc_to_ns(wait);
+		slot->voluntary_switches = proc_exec->acct_voluntary;
+		slot->involuntary_switches = proc_exec->acct_involuntary;
+		slot->wakeups = proc_exec->acct_wakeups;
+		slot->wake_latency_avg_ns = proc_exec->acct_wakeups
+			? (uint32_t)div_u64_u32(proc_exec->acct_wake_latency_ns, proc_exec->acct_wakeups, NULL)
+			: 0;
+		slot->wake_latency_max_ns = proc_exec->acct_wake_latency_max_ns;
+		for (uint32_t b = 0; b < SCHED_LATENCY_BUCKETS; ++b)
+			slot->wake_latency_hist[b] = proc_exec->wake_latency_hist[b];
+		slot->syscalls = proc_exec->syscalls;
+		slot->syscall_cycles = proc_exec->syscall_cycles;
 	}
 
 	return count;
@@ -966,9 +2369,12 @@ void process_debug_list(void)
 		"ZOMBIE"
 	};
 
-	struct process_info snapshot[MAX_PROCS];
+	/* A full snapshot no longer fits comfortably on a 4 KiB thread stack. */
+	struct process_info *snapshot = (struct process_info *)kalloc(sizeof(struct process_info) * MAX_PROCS);
+	if (!snapshot)
+		return;
 	size_t count = process_snapshot(snapshot, MAX_PROCS);
-	vga_write_line("PID  STATE    KIND  PRI(base/dyn)  REM  TICKS");
+	vga_write_line("PID  STATE    KIND  CPU  PRI(base/dyn)  REM  TICKS");
 	for (size_t i = 0; i < count; ++i)
 	{
 		const struct process_info *info = &snapshot[i];
@@ -986,6 +2392,9 @@ void process_debug_list(void)
 		buffer[idx++] = (info->kind == THREAD_KIND_USER) ? 'U' : 'K';
 		buffer[idx++] = ' ';
 		buffer[idx++] = ' ';
+		idx += int_to_string((int)info->cpu, buffer + idx);
+		buffer[idx++] = ' ';
+		buffer[idx++] = ' ';
 		idx += int_to_string((int)info->base_priority, buffer + idx);
 		buffer[idx++] = '/';
 		idx += int_to_string((int)info->dynamic_priority, buffer + idx);
@@ -998,31 +2407,114 @@ void process_debug_list(void)
 		buffer[idx] = '\0';
 		vga_write_line(buffer);
 	}
+	kfree(snapshot);
 }
 
 void process_scheduler_tick(void)
 {
-	if (!scheduler_active)
+	struct sched_cpu *rq = this_rq();
+	if (!rq->scheduler_active)
 		return;
 
 	uint64_t now = get_ticks();
-	wake_sleepers(now);
 
-	struct process *proc_exec = current_process;
+	struct process *proc_exec = cpu_current();
 	if (!proc_exec)
 		return;
 
-	if (proc_exec == idle_process)
+	if (scheduler_is_idle(proc_exec))
 	{
-		if (ready_bitmap != 0u)
+		if (rq->nr_ready || scheduler_steal_pending(rq->index))
 			scheduler_preempt_running(0);
 		return;
 	}
 
+	if (scheduler_cbs_charge(proc_exec, now))
+	{
+		scheduler_preempt_running(0);
+		return;
+	}
+
 	if (proc_exec->time_slice_remaining > 0)
 		--proc_exec->time_slice_remaining;
 
 	if (proc_exec->time_slice_remaining == 0)
 		scheduler_preempt_running(1);
 }
-/* New scheduler implementation will be inserted here */
+
+void process_scheduler_ipi(void)
+{
+	struct sched_cpu *rq = this_rq();
+	struct process *proc_exec = cpu_current();
+	/* Idle loops recheck their queue after every wakeup on their own. */
+	if (!rq->scheduler_active || !proc_exec || scheduler_is_idle(proc_exec))
+		return;
+
+	if (!(proc_exec->cpu_affinity & (1u << rq->index)))
+		scheduler_preempt_running(0);
+}
+
+void process_smp_tick(void)
+{
+	uint32_t online = smp_online_mask();
+	for (uint32_t cpu = 1; cpu < CONFIG_MAX_CPUS; ++cpu)
+	{
+		if (!(online & (1u << cpu)))
+			continue;
+
+		struct cpu_local *local = smp_cpu(cpu);
+		if (local->current != local->idle)
+			smp_send_tick(cpu);
+		else if (sched_cpus[cpu].nr_ready || scheduler_steal_pending(cpu))
+			smp_send_reschedule(cpu);
+	}
+}
+
+void process_cpu_stats(uint32_t cpu, struct sched_cpu_stats *out)
+{
+	if (!out)
+		return;
+
+	zero_memory(out, sizeof(*out));
+	struct cpu_local *local = smp_cpu(cpu);
+	if (!local || !(smp_online_mask() & (1u << cpu)))
+		return;
+
+	struct sched_cpu *rq = &sched_cpus[cpu];
+	out->online = 1;
+	out->apic_id = local->apic_id;
+	out->nr_ready = rq->nr_ready;
+	out->nr_migratable = rq->nr_migratable;
+	out->steals = rq->steals;
+	out->migrations_in = rq->migrations_in;
+	out->ipi_resched = local->ipi_resched;
+	out->ipi_tick = local->ipi_tick;
+	struct process *running = local->current;
+	out->current_pid = (running && running != local->idle) ? running->pid : 0;
+	out->context_switches = rq->context_switches;
+	out->handoffs = rq->handoffs;
+
+	struct process *idle = rq->idle_process;
+	if (idle)
+	{
+		uint64_t cycles = idle->acct_run_cycles;
+		if (running == idle && idle->acct_switch_in_tsc)
+			cycles += rdtsc() - idle->acct_switch_in_tsc;
+		out->idle_ns = tsc_to_ns(cycles);
+	}
+}
+
+void process_wake_latency_histogram(uint32_t out[SCHED_LATENCY_BUCKETS])
+{
+	if (!out)
+		return;
+
+	for (uint32_t b = 0; b < SCHED_LATENCY_BUCKETS; ++b)
+		out[b] = 0;
+	for (uint32_t cpu = 0; cpu < CONFIG_MAX_CPUS; ++cpu)
+	{
+		for (uint32_t b = 0; b < SCHED_LATENCY_BUCKETS; ++b)
+			out[b] += sched_cpus[cpu].wake_latency_hist[b];
+	}
+}
+
@@ -43,7 +43,7 @@ static const char *service_tag(const struct service_entry *svc)
 
 void service_system_init(void)
 {
-    spinlock_init(&service_lock);
+    spinlock_init_named(&service_lock, "service");
     for (size_t i = 0; i < SYSTEM_SERVICE_COUNT; ++i)
     {
         service_table[i].id = (enum system_service)i;
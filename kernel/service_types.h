@@ -12,4 +12,12 @@ enum system_service
     SYSTEM_SERVICE_COUNT
 };
 
+/** Status a service sends back for a request it does not implement. */
+#define SERVICE_STATUS_UNSUPPORTED (-1)
+
+struct service_reply
+{
+    int32_t status;
+};
+
 #endif
@@ -6,6 +6,9 @@
 #include "keyboard.h"
 #include "vfs.h"
 #include "pit.h"
+#include "timer.h"
+#include "hrtimer.h"
+#include "clock.h"
 #include "io.h"
 #include "proc.h"
 #include "fat16.h"
@@ -13,16 +16,25 @@
 #include "klog.h"
 #include "module.h"
 #include "memory.h"
+#include "slab.h"
 #include "power.h"
 #include "devmgr.h"
 #include "debug.h"
 #include "vbe.h"
 #include "volmgr.h"
+#include "blockdev.h"
+#include "blkqueue.h"
 #include "net.h"
 #include "arp.h"
 #include "ipv4.h"
 #include "icmp.h"
 #include "pic.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "sync.h"
+#include "futex.h"
+#include "ipc.h"
+#include "user/syslib.h"
 
 #define SHELL_PROMPT "proOS >> "
 #define INPUT_MAX 256
@@ -762,6 +774,32 @@ static void write_u64(uint64_t value, char *out)
     out[index] = '\0';
 }
 
+/* Writes @p us as milliseconds with three decimals, e.g. "1.042". */
+static void format_us_as_ms(uint32_t us, char *out)
+{
+    write_u64((uint64_t)(us / 1000u), out);
+    size_t len = str_len(out);
+    uint32_t frac = us % 1000u;
+    out[len++] = '.';
+    out[len++] = (char)('0' + frac / 100u);
+    out[len++] = (char)('0' + (frac / 10u) % 10u);
+    out[len++] = (char)('0' + frac % 10u);
+    out[len] = '\0';
+}
+
+/* Writes @p ns as seconds with microsecond digits, e.g. "12.000345". */
+static void format_ns_as_seconds(uint64_t ns, char *out)
+{
+    uint32_t rem_ns = 0;
+    write_u64(u64_divmod(ns, 1000000000U, &rem_ns), out);
+    size_t len = str_len(out);
+    uint32_t micros = rem_ns / 1000u;
+    out[len++] = '.';
+    for (uint32_t div = 100000u; div > 0; div /= 10u)
+        out[len++] = (char)('0' + (micros / div) % 10u);
+    out[len] = '\0';
+}
+
 static void write_hex32(uint32_t value, char *out)
 {
     static const char digits[] = "0123456789ABCDEF";
@@ -912,7 +950,31 @@ static void shell_flush_icmp_notifications(void)
     }
 }
 
-static int shell_ping_wait_for_arp(struct net_device *dev, const uint8_t target[4], uint64_t deadline)
+/* One-shot deadline backed by the kernel timer wheel; stop it before it goes out of scope. */
+struct shell_timeout
+{
+    struct timer timer;
+    volatile int expired;
+};
+
+static void shell_timeout_expired(void *data)
+{
+    ((struct shell_timeout *)data)->expired = 1;
+}
+
+static void shell_timeout_start(struct shell_timeout *timeout, uint32_t ticks)
+{
+    timeout->expired = 0;
+    timer_init(&timeout->timer, shell_timeout_expired, timeout);
+    timer_arm(&timeout->timer, ticks);
+}
+
+static void shell_timeout_stop(struct shell_timeout *timeout)
+{
+    timer_cancel(&timeout->timer);
+}
+
+static int shell_ping_wait_for_arp(struct net_device *dev, const uint8_t target[4], const struct shell_timeout *timeout)
 {
     if (!dev || !target)
         return -1;
@@ -924,8 +986,7 @@ static int shell_ping_wait_for_arp(struct net_device *dev, const uint8_t target[
         if (arp_cache_lookup(dev, target, mac_dummy))
             return 1;
 
-        uint64_t now = get_ticks();
-        if (now >= deadline)
+        if (timeout->expired)
             break;
 
         int events = net_poll_devices();
@@ -944,7 +1005,7 @@ static int shell_ping_wait_for_arp(struct net_device *dev, const uint8_t target[
     return arp_cache_lookup(dev, target, mac_dummy) ? 1 : 0;
 }
 
-static int shell_ping_transmit(struct net_device *dev, const uint8_t target[4], uint16_t identifier, uint16_t sequence, uint64_t deadline, uint64_t *sent_tick)
+static int shell_ping_transmit(struct net_device *dev, const uint8_t target[4], uint16_t identifier, uint16_t sequence, const struct shell_timeout *timeout, uint64_t *sent_ns)
 {
     if (!dev || !target)
         return -1;
@@ -954,39 +1015,42 @@ static int shell_ping_transmit(struct net_device *dev, const uint8_t target[4],
         int rc = icmp_send_echo_request(dev, target, identifier, sequence);
         if (rc == 0)
         {
-            if (sent_tick)
-                *sent_tick = get_ticks();
+            if (sent_ns)
+                *sent_ns = clock_monotonic_ns();
             return 1;
         }
 
         if (rc < 0)
             return -1;
 
-        int arp_status = shell_ping_wait_for_arp(dev, target, deadline);
+        int arp_status = shell_ping_wait_for_arp(dev, target, timeout);
         if (arp_status <= 0)
             return arp_status;
     }
 }
 
-static int shell_ping_wait_for_reply(uint16_t identifier, uint16_t sequence, uint64_t send_tick, uint64_t deadline, uint32_t *rtt_ms, uint8_t src_ipv4[4])
+static uint32_t shell_ping_rtt_us(uint64_t send_ns)
+{
+    uint64_t now = clock_monotonic_ns();
+    if (now < send_ns)
+        now = send_ns;
+    uint32_t remainder = 0;
+    uint64_t us = u64_divmod(now - send_ns, 1000U, &remainder);
+    return (us > UINT32_MAX) ? UINT32_MAX : (uint32_t)us;
+}
+
+static int shell_ping_wait_for_reply(uint16_t identifier, uint16_t sequence, uint64_t send_ns, const struct shell_timeout *timeout, uint32_t *rtt_us, uint8_t src_ipv4[4])
 {
     while (1)
     {
         if (icmp_take_echo_reply(identifier, sequence, src_ipv4))
         {
-            uint64_t now = get_ticks();
-            if (now < send_tick)
-                now = send_tick;
-            if (rtt_ms)
-            {
-                uint64_t ticks_elapsed = now - send_tick;
-                *rtt_ms = (uint32_t)(ticks_elapsed * 10u);
-            }
+            if (rtt_us)
+                *rtt_us = shell_ping_rtt_us(send_ns);
             return 1;
         }
 
-        uint64_t now = get_ticks();
-        if (now >= deadline)
+        if (timeout->expired)
             break;
 
         int events = net_poll_devices();
@@ -995,14 +1059,8 @@ static int shell_ping_wait_for_reply(uint16_t identifier, uint16_t sequence, uin
 
         if (icmp_take_echo_reply(identifier, sequence, src_ipv4))
         {
-            uint64_t recv_tick = get_ticks();
-            if (recv_tick < send_tick)
-                recv_tick = send_tick;
-            if (rtt_ms)
-            {
-                uint64_t ticks_elapsed = recv_tick - send_tick;
-                *rtt_ms = (uint32_t)(ticks_elapsed * 10u);
-            }
+            if (rtt_us)
+                *rtt_us = shell_ping_rtt_us(send_ns);
             return 1;
         }
 
@@ -1156,8 +1214,23 @@ static void command_help(void)
     vga_write_line("  logs <name> - view logs (kernel|net|ipc)");
     vga_write_line("  kdlvl [lvl] - adjust log verbosity");
     vga_write_line("  tasks  - list processes");
+    vga_write_line("  tasks -l - live CPU, wait and latency view");
     vga_write_line("  proc_count - show active process count");
     vga_write_line("  spawn <n> - stress process creation");
+    vga_write_line("  bench sched [n] - time run-queue picks");
+    vga_write_line("  bench sleep - measure hrtimer sleep overshoot");
+    vga_write_line("  bench smp [n] - CPU-bound speedup across CPUs");
+    vga_write_line("  bench futex [n] - sys_mutex vs futex lock contention");
+    vga_write_line("  bench ipc [n] - send/recv vs call/reply round trips");
+    vga_write_line("  bench ring [n] - mailbox vs shared-memory ring streaming");
+    vga_write_line("  bench syscall [n] - int 0x80 vs sysenter null syscalls");
+    vga_write_line("  bench uring [n] - one trap per call vs batched submission ring");
+    vga_write_line("  timers - timer sources and statistics");
+    vga_write_line("  locks [reset] - lock contention statistics");
+    vga_write_line("  sysstat [reset] - per-syscall call counts and latency");
+    vga_write_line("  bcache [sync] - block buffer cache statistics / flush");
+    vga_write_line("  blkq [reset|<dev> fifo|deadline] - block request queues / elevator");
+    vga_write_line("  channels - IPC channel queue usage and back-pressure");
     vga_write_line("  devs   - list devices");
     vga_write_line("  shutdown - power off the system");
 }
@@ -1234,6 +1307,7 @@ static void command_echo(char *args)
 static void command_mem(void)
 {
     debug_publish_memory_info();
+    debug_publish_slab_info();
     vga_write_line("Memory info:");
     print_ptr_line("heap base", memory_heap_base());
     print_ptr_line("heap limit", memory_heap_limit());
@@ -1241,9 +1315,67 @@ static void command_mem(void)
     print_size_line("heap used", memory_used_bytes());
     print_size_line("heap free", memory_free_bytes());
 
+    struct memory_stats stats;
+    memory_get_stats(&stats);
+    {
+        char line[96];
+        char num_buf[32];
+        size_t pos = 0;
+        buffer_append(line, &pos, sizeof(line), "  fragmentation: ");
+        write_u64((uint64_t)stats.fragmentation_pct, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        buffer_append(line, &pos, sizeof(line), "%  map entries: ");
+        write_u64((uint64_t)stats.map_entries, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        buffer_append(line, &pos, sizeof(line), "  failures: ");
+        write_u64((uint64_t)stats.alloc_failures, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        line[pos] = '\0';
+        vga_write_line(line);
+
+        pos = 0;
+        buffer_append(line, &pos, sizeof(line), "  free blocks:");
+        for (uint32_t order = 0; order < MEMORY_MAX_ORDER; ++order)
+        {
+            buffer_append(line, &pos, sizeof(line), " ");
+            write_u64((uint64_t)order, num_buf);
+            buffer_append(line, &pos, sizeof(line), num_buf);
+            buffer_append(line, &pos, sizeof(line), ":");
+            write_u64((uint64_t)stats.free_blocks[order], num_buf);
+            buffer_append(line, &pos, sizeof(line), num_buf);
+        }
+        line[pos] = '\0';
+        vga_write_line(line);
+
+        struct kmem_cache_info caches[CONFIG_SLAB_MAX_CACHES];
+        size_t cache_count = kmem_cache_snapshot(caches, CONFIG_SLAB_MAX_CACHES);
+        for (size_t i = 0; i < cache_count; ++i)
+        {
+            pos = 0;
+            buffer_append(line, &pos, sizeof(line), "  slab ");
+            buffer_append(line, &pos, sizeof(line), caches[i].name);
+            buffer_append(line, &pos, sizeof(line), ": ");
+            write_u64((uint64_t)caches[i].active_objects, num_buf);
+            buffer_append(line, &pos, sizeof(line), num_buf);
+            buffer_append(line, &pos, sizeof(line), "/");
+            write_u64((uint64_t)caches[i].total_objects, num_buf);
+            buffer_append(line, &pos, sizeof(line), num_buf);
+            buffer_append(line, &pos, sizeof(line), " objs  hits ");
+            write_u64((uint64_t)caches[i].hits, num_buf);
+            buffer_append(line, &pos, sizeof(line), num_buf);
+            buffer_append(line, &pos, sizeof(line), "  misses ");
+            write_u64((uint64_t)caches[i].misses, num_buf);
+            buffer_append(line, &pos, sizeof(line), num_buf);
+            line[pos] = '\0';
+            vga_write_line(line);
+        }
+    }
+
     uint64_t ticks = get_ticks();
     uint32_t centis = 0;
-    uint64_t seconds = u64_divmod(ticks, 100U, &centis);
+    uint32_t hz = pit_frequency() ? pit_frequency() : 100U;
+    uint64_t seconds = u64_divmod(ticks, hz, &centis);
+    centis = (centis * 100U) / hz;
 
     char sec_buf[32];
     char centi_buf[4];
@@ -1839,7 +1971,7 @@ static void command_mod_list(void)
 
 static void release_module_buffer(void *buffer)
 {
-    (void)buffer;
+    kfree(buffer);
 }
 
 static int append_kmd_extension(char *path, size_t capacity)
@@ -2304,9 +2436,194 @@ static void command_mod(const char *args)
 static void command_proc_list(void)
 {
     debug_publish_task_list();
+    debug_publish_sched_info();
     process_debug_list();
 }
 
+#define TASKS_LIVE_REFRESH_MS 1000u
+#define TASKS_LIVE_POLL_MS    50u
+
+static void tasks_live_pad(char *line, size_t *pos, size_t cap, size_t column)
+{
+    while (*pos < column && *pos + 1 < cap)
+        line[(*pos)++] = ' ';
+}
+
+static void tasks_live_append_u64(char *line, size_t *pos, size_t cap, uint64_t value)
+{
+    char num_buf[32];
+    write_u64(value, num_buf);
+    buffer_append(line, pos, cap, num_buf);
+}
+
+/* Sleeps about @p ms; returns 1 as soon as a key arrives. */
+static int tasks_live_wait(uint32_t ms)
+{
+    uint32_t step_ticks = (pit_frequency() * TASKS_LIVE_POLL_MS) / 1000u;
+    if (step_ticks == 0)
+        step_ticks = 1;
+    for (uint32_t waited = 0; waited < ms; waited += TASKS_LIVE_POLL_MS)
+    {
+        char c = kb_getchar();
+        if (!c && kb_poll())
+            c = kb_getchar();
+        if (c)
+            return 1;
+        process_sleep(step_ticks);
+    }
+    return 0;
+}
+
+static const struct process_info *tasks_live_find(const struct process_info *info, size_t count, int pid)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (info[i].pid == pid)
+            return &info[i];
+    }
+    return NULL;
+}
+
+/* Per-interval CPU share in tenths of a percent. */
+static uint32_t tasks_live_permille(uint64_t part_ns, uint64_t total_ns)
+{
+    if (total_ns == 0)
+        return 0;
+    while (total_ns > 0xFFFFFFFFull)
+    {
+        part_ns >>= 1;
+        total_ns >>= 1;
+    }
+    uint64_t permille = u64_divmod(part_ns * 1000u, (uint32_t)total_ns, NULL);
+    return (permille > 1000u) ? 1000u : (uint32_t)permille;
+}
+
+static void tasks_live_append_percent(char *line, size_t *pos, size_t cap, uint32_t permille)
+{
+    tasks_live_append_u64(line, pos, cap, permille / 10u);
+    char frac[3] = { '.', (char)('0' + permille % 10u), '\0' };
+    buffer_append(line, pos, cap, frac);
+}
+
+/* top-like view over process_snapshot(): CPU share per refresh interval, worst first. */
+static void command_tasks_live(void)
+{
+    struct process_info *prev = (struct process_info *)kalloc(sizeof(struct process_info) * MAX_PROCS);
+    struct process_info *cur = (struct process_info *)kalloc(sizeof(struct process_info) * MAX_PROCS);
+    if (!prev || !cur)
+    {
+        kfree(prev);
+        kfree(cur);
+        vga_write_line("tasks: out of memory");
+        return;
+    }
+
+    uint64_t prev_idle[CONFIG_MAX_CPUS];
+    for (uint32_t cpu = 0; cpu < CONFIG_MAX_CPUS; ++cpu)
+    {
+        struct sched_cpu_stats stats;
+        process_cpu_stats(cpu, &stats);
+        prev_idle[cpu] = stats.idle_ns;
+    }
+    size_t prev_count = process_snapshot(prev, MAX_PROCS);
+    uint64_t prev_ns = clock_monotonic_ns();
+
+    while (!tasks_live_wait(TASKS_LIVE_REFRESH_MS))
+    {
+        size_t count = process_snapshot(cur, MAX_PROCS);
+        uint64_t now_ns = clock_monotonic_ns();
+        uint64_t elapsed = now_ns - prev_ns;
+
+        vga_clear();
+        char line[128];
+        size_t pos = 0;
+        buffer_append(line, &pos, sizeof(line), "tasks -l: ");
+        tasks_live_append_u64(line, &pos, sizeof(line), (uint64_t)count);
+        buffer_append(line, &pos, sizeof(line), " tasks, press any key to quit");
+        line[pos] = '\0';
+        vga_write_line(line);
+
+        pos = 0;
+        for (uint32_t cpu = 0; cpu < CONFIG_MAX_CPUS; ++cpu)
+        {
+            struct sched_cpu_stats stats;
+            process_cpu_stats(cpu, &stats);
+            if (!stats.online)
+                continue;
+            uint64_t idle = stats.idle_ns - prev_idle[cpu];
+            prev_idle[cpu] = stats.idle_ns;
+            buffer_append(line, &pos, sizeof(line), "cpu");
+            tasks_live_append_u64(line, &pos, sizeof(line), cpu);
+            buffer_append(line, &pos, sizeof(line), " ");
+            tasks_live_append_percent(line, &pos, sizeof(line),
+                                      1000u - tasks_live_permille(idle, elapsed));
+            buffer_append(line, &pos, sizeof(line), "%  ");
+        }
+        line[pos] = '\0';
+        vga_write_line(line);
+        vga_write_line("PID  STATE    CPU  %CPU   RUN_ms   WAIT_ms  VCSW    ICSW    LAT avg/max us");
+
+        /* Selection by CPU share, busiest first; at most MAX_PROCS rows. */
+        uint8_t shown[MAX_PROCS];
+        for (size_t i = 0; i < count; ++i)
+            shown[i] = 0;
+        for (size_t row = 0; row < count; ++row)
+        {
+            size_t best = count;
+            uint64_t best_delta = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (shown[i])
+                    continue;
+                const struct process_info *old = tasks_live_find(prev, prev_count, cur[i].pid);
+                uint64_t delta = (old && cur[i].run_ns >= old->run_ns) ? cur[i].run_ns - old->run_ns : cur[i].run_ns;
+                if (best == count || delta > best_delta)
+                {
+                    best = i;
+                    best_delta = delta;
+                }
+            }
+            shown[best] = 1;
+
+            const struct process_info *entry = &cur[best];
+            pos = 0;
+            tasks_live_append_u64(line, &pos, sizeof(line), (uint64_t)entry->pid);
+            tasks_live_pad(line, &pos, sizeof(line), 5);
+            buffer_append(line, &pos, sizeof(line),
+                          entry->state == PROC_RUNNING ? "RUNNING" :
+                          entry->state == PROC_READY ? "READY" :
+                          entry->state == PROC_WAITING ? "WAITING" : "ZOMBIE");
+            tasks_live_pad(line, &pos, sizeof(line), 14);
+            tasks_live_append_u64(line, &pos, sizeof(line), entry->cpu);
+            tasks_live_pad(line, &pos, sizeof(line), 19);
+            tasks_live_append_percent(line, &pos, sizeof(line), tasks_live_permille(best_delta, elapsed));
+            tasks_live_pad(line, &pos, sizeof(line), 26);
+            tasks_live_append_u64(line, &pos, sizeof(line), u64_divmod(entry->run_ns, 1000000u, NULL));
+            tasks_live_pad(line, &pos, sizeof(line), 35);
+            tasks_live_append_u64(line, &pos, sizeof(line), u64_divmod(entry->wait_ns, 1000000u, NULL));
+            tasks_live_pad(line, &pos, sizeof(line), 44);
+            tasks_live_append_u64(line, &pos, sizeof(line), entry->voluntary_switches);
+            tasks_live_pad(line, &pos, sizeof(line), 52);
+            tasks_live_append_u64(line, &pos, sizeof(line), entry->involuntary_switches);
+            tasks_live_pad(line, &pos, sizeof(line), 60);
+            tasks_live_append_u64(line, &pos, sizeof(line), entry->wake_latency_avg_ns / 1000u);
+            buffer_append(line, &pos, sizeof(line), "/");
+            tasks_live_append_u64(line, &pos, sizeof(line), entry->wake_latency_max_ns / 1000u);
+            line[pos] = '\0';
+            vga_write_line(line);
+        }
+
+        struct process_info *swap = prev;
+        prev = cur;
+        cur = swap;
+        prev_count = count;
+        prev_ns = now_ns;
+    }
+
+    kfree(prev);
+    kfree(cur);
+}
+
 static void format_device_flags(uint32_t flags, char *out)
 {
     size_t idx = 0;
@@ -2731,17 +3048,19 @@ static void command_net_ping(const char *args)
     int received = 0;
     uint32_t min_rtt = UINT32_MAX;
     uint32_t max_rtt = 0;
-    uint32_t total_rtt_ms = 0;
+    uint32_t total_rtt_us = 0;
     int abort_ping = 0;
 
     for (int i = 0; i < count; ++i)
     {
         ++sent;
         uint16_t sequence = ++shell_ping_sequence;
-        uint64_t arp_deadline = get_ticks() + SHELL_PING_ARP_WAIT_TICKS;
-        uint64_t send_tick = 0;
+        uint64_t send_ns = 0;
+        struct shell_timeout timeout;
 
-        int tx_status = shell_ping_transmit(dev, target, shell_ping_identifier, sequence, arp_deadline, &send_tick);
+        shell_timeout_start(&timeout, SHELL_PING_ARP_WAIT_TICKS);
+        int tx_status = shell_ping_transmit(dev, target, shell_ping_identifier, sequence, &timeout, &send_ns);
+        shell_timeout_stop(&timeout);
         if (tx_status < 0)
         {
             vga_write_line("net: ping transmit failed");
@@ -2755,10 +3074,11 @@ static void command_net_ping(const char *args)
         }
         else
         {
-            uint32_t rtt_ms = 0;
+            uint32_t rtt_us = 0;
             uint8_t reply_src[4];
-            uint64_t reply_deadline = send_tick + SHELL_PING_TIMEOUT_TICKS;
-            int reply_status = shell_ping_wait_for_reply(shell_ping_identifier, sequence, send_tick, reply_deadline, &rtt_ms, reply_src);
+            shell_timeout_start(&timeout, SHELL_PING_TIMEOUT_TICKS);
+            int reply_status = shell_ping_wait_for_reply(shell_ping_identifier, sequence, send_ns, &timeout, &rtt_us, reply_src);
+            shell_timeout_stop(&timeout);
 
             if (reply_status < 0)
             {
@@ -2774,14 +3094,14 @@ static void command_net_ping(const char *args)
             else
             {
                 ++received;
-                if (rtt_ms < min_rtt)
-                    min_rtt = rtt_ms;
-                if (rtt_ms > max_rtt)
-                    max_rtt = rtt_ms;
-                if (UINT32_MAX - total_rtt_ms < rtt_ms)
-                    total_rtt_ms = UINT32_MAX;
+                if (rtt_us < min_rtt)
+                    min_rtt = rtt_us;
+                if (rtt_us > max_rtt)
+                    max_rtt = rtt_us;
+                if (UINT32_MAX - total_rtt_us < rtt_us)
+                    total_rtt_us = UINT32_MAX;
                 else
-                    total_rtt_ms += rtt_ms;
+                    total_rtt_us += rtt_us;
 
                 char reply_ip[32];
                 format_ipv4_address(reply_src, reply_ip, sizeof(reply_ip));
@@ -2790,7 +3110,7 @@ static void command_net_ping(const char *args)
                 write_u64((uint64_t)sequence, seq_buf);
 
                 char time_buf[32];
-                write_u64((uint64_t)rtt_ms, time_buf);
+                format_us_as_ms(rtt_us, time_buf);
 
                 vga_write("net: reply from ");
                 vga_write(reply_ip);
@@ -2807,8 +3127,9 @@ static void command_net_ping(const char *args)
 
         if (i + 1 < count)
         {
-            uint64_t target_tick = get_ticks() + SHELL_PING_INTERVAL_TICKS;
-            while (get_ticks() < target_tick)
+            struct shell_timeout interval;
+            shell_timeout_start(&interval, SHELL_PING_INTERVAL_TICKS);
+            while (!interval.expired)
             {
                 int events = net_poll_devices();
                 if (events < 0)
@@ -2822,6 +3143,7 @@ static void command_net_ping(const char *args)
                 else
                     shell_yield();
             }
+            shell_timeout_stop(&interval);
             if (abort_ping)
                 break;
         }
@@ -2866,14 +3188,14 @@ static void command_net_ping(const char *args)
     {
         uint32_t avg_rtt = 0;
         if (received > 0)
-            avg_rtt = total_rtt_ms / (uint32_t)received;
+            avg_rtt = total_rtt_us / (uint32_t)received;
 
         char min_buf[32];
         char max_buf[32];
         char avg_buf[32];
-        write_u64((uint64_t)min_rtt, min_buf);
-        write_u64((uint64_t)max_rtt, max_buf);
-        write_u64((uint64_t)avg_rtt, avg_buf);
+        format_us_as_ms(min_rtt, min_buf);
+        format_us_as_ms(max_rtt, max_buf);
+        format_us_as_ms(avg_rtt, avg_buf);
 
         vga_write("net:     RTT min/avg/max = ");
         vga_write(min_buf);
@@ -3266,6 +3588,8 @@ static void command_kdlg(void)
     {
         char seq_buf[32];
         write_u64((uint64_t)entries[i].seq, seq_buf);
+        char time_buf[32];
+        format_ns_as_seconds(entries[i].timestamp_ns, time_buf);
 
         const char *level = klog_level_name(entries[i].level);
         const char *text = entries[i].text;
@@ -3282,6 +3606,11 @@ static void command_kdlg(void)
         if (idx < sizeof(line) - 1)
             line[idx++] = ' ';
 
+        for (size_t j = 0; time_buf[j] && idx < sizeof(line) - 1; ++j)
+            line[idx++] = time_buf[j];
+        if (idx < sizeof(line) - 1)
+            line[idx++] = ' ';
+
         for (size_t j = 0; level[j] && idx < sizeof(line) - 1; ++j)
             line[idx++] = level[j];
         if (idx < sizeof(line) - 1)
@@ -3498,140 +3827,1276 @@ static void command_spawn(const char *args)
     klog_info(logbuf);
 }
 
-static void command_shutdown(void)
+static void bench_append_average(char *line, size_t *pos, size_t cap, uint64_t total, uint32_t rounds)
 {
-    debug_publish_memory_info();
-
-    uint64_t total = (uint64_t)memory_total_bytes();
-    uint64_t used = (uint64_t)memory_used_bytes();
-    uint64_t free_space = (uint64_t)memory_free_bytes();
-    uint32_t base = (uint32_t)memory_heap_base();
-    uint32_t limit = (uint32_t)memory_heap_limit();
-    uint32_t cursor = base + (uint32_t)used;
+    char num_buf[32];
+    uint32_t remainder = 0;
+    write_u64(u64_divmod(total, rounds, &remainder), num_buf);
+    buffer_append(line, pos, cap, "  ");
+    buffer_append(line, pos, cap, num_buf);
+}
 
-    char total_buf[32];
-    char total_kb[32];
-    char used_buf[32];
-    char used_kb[32];
-    char free_buf[32];
-    char free_kb[32];
-    char base_hex[11];
-    char limit_hex[11];
-    char cursor_hex[11];
+static void command_bench_sched(const char *args)
+{
+    int max_tasks = 1024;
+    const char *token = skip_spaces(args);
+    if (*token && !parse_positive_int(token, &max_tasks))
+    {
+        vga_write_line("Usage: bench sched [max_tasks]");
+        return;
+    }
+    if (max_tasks > 4096)
+        max_tasks = 4096;
 
-    write_u64(total, total_buf);
-    write_u64(total / 1024u, total_kb);
-    write_u64(used, used_buf);
-    write_u64(used / 1024u, used_kb);
-    write_u64(free_space, free_buf);
-    write_u64(free_space / 1024u, free_kb);
-    write_hex32(base, base_hex);
-    write_hex32(limit, limit_hex);
-    write_hex32(cursor, cursor_hex);
+    const uint32_t rounds = 4096;
+    vga_write_line("tasks  fair  edf  linear (cycles per pick+requeue)");
+    for (uint32_t tasks = 4; tasks <= (uint32_t)max_tasks; tasks <<= 2)
+    {
+        struct sched_bench_result result;
+        if (process_sched_bench(tasks, rounds, &result) < 0)
+        {
+            vga_write_line("bench: out of memory");
+            return;
+        }
 
-    vga_write_line("Memory statistics:");
+        char line[96];
+        char num_buf[32];
+        size_t pos = 0;
+        write_u64((uint64_t)tasks, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        bench_append_average(line, &pos, sizeof(line), result.fair_cycles, rounds);
+        bench_append_average(line, &pos, sizeof(line), result.deadline_cycles, rounds);
+        bench_append_average(line, &pos, sizeof(line), result.linear_cycles, rounds);
+        line[pos] = '\0';
+        vga_write_line(line);
+    }
+}
 
-    vga_write("  Total: ");
-    vga_write(total_buf);
-    vga_write(" bytes (");
-    vga_write(total_kb);
-    vga_write_line(" KB)");
+static void bench_append_us(char *line, size_t *pos, size_t cap, uint64_t ns)
+{
+    char num_buf[32];
+    uint32_t remainder = 0;
+    write_u64(u64_divmod(ns, 1000U, &remainder), num_buf);
+    buffer_append(line, pos, cap, "  ");
+    buffer_append(line, pos, cap, num_buf);
+    buffer_append(line, pos, cap, "us");
+}
 
-    vga_write("  Used : ");
-    vga_write(used_buf);
-    vga_write(" bytes (");
-    vga_write(used_kb);
-    vga_write_line(" KB)");
+static void command_bench_sleep(void)
+{
+    static const uint32_t targets_us[] = { 50u, 200u, 1000u, 4000u };
+    const uint32_t rounds = 16;
 
-    vga_write("  Free : ");
-    vga_write(free_buf);
-    vga_write(" bytes (");
-    vga_write(free_kb);
-    vga_write_line(" KB)");
+    vga_write_line("target  avg  max (wakeup overshoot)");
+    for (size_t t = 0; t < sizeof(targets_us) / sizeof(targets_us[0]); ++t)
+    {
+        uint64_t target_ns = (uint64_t)targets_us[t] * 1000u;
+        uint64_t total = 0;
+        uint64_t worst = 0;
+        for (uint32_t i = 0; i < rounds; ++i)
+        {
+            uint64_t start = hrtimer_now_ns();
+            process_sleep_ns(target_ns);
+            uint64_t slept = hrtimer_now_ns() - start;
+            uint64_t over = (slept > target_ns) ? slept - target_ns : 0;
+            total += over;
+            if (over > worst)
+                worst = over;
+        }
 
-    vga_write("  Heap base   = ");
-    vga_write_line(base_hex);
-    vga_write("  Heap cursor = ");
-    vga_write_line(cursor_hex);
-    vga_write("  Heap limit  = ");
-    vga_write_line(limit_hex);
+        char line[96];
+        size_t pos = 0;
+        uint32_t remainder = 0;
+        bench_append_us(line, &pos, sizeof(line), target_ns);
+        bench_append_us(line, &pos, sizeof(line), u64_divmod(total, rounds, &remainder));
+        bench_append_us(line, &pos, sizeof(line), worst);
+        line[pos] = '\0';
+        vga_write_line(line);
+    }
 
-    uint64_t ticks = get_ticks();
-    uint32_t centis = 0;
-    uint64_t seconds = u64_divmod(ticks, 100U, &centis);
+    if (!hrtimer_is_oneshot())
+        vga_write_line("bench: no one-shot timer; sleeps round up to PIT ticks");
+}
 
-    char sec_buf[32];
-    char centi_buf[4];
-    write_u64(seconds, sec_buf);
-    centi_buf[0] = (char)('0' + (centis / 10U));
-    centi_buf[1] = (char)('0' + (centis % 10U));
-    centi_buf[2] = '\0';
+#define BENCH_SMP_MAX_THREADS CONFIG_MAX_CPUS
+#define BENCH_SMP_TOTAL_ITERATIONS (1u << 26)
 
-    vga_write("  Uptime: ");
-    vga_write(sec_buf);
-    vga_write(".");
-    vga_write(centi_buf);
-    vga_write_line("s");
+struct bench_smp_slot
+{
+    uint32_t iterations;
+    uint32_t cpu;
+    uint32_t checksum;
+    volatile uint32_t done;
+};
 
-    vga_write_line("Powering off...");
-    klog_info("shell: invoking power shutdown");
-    power_shutdown();
-}
+static struct bench_smp_slot bench_smp_slots[BENCH_SMP_MAX_THREADS];
+static volatile uint32_t bench_smp_next_slot = 0;
 
-static void shell_render_prompt(void)
+/* CPU-bound and touches nothing shared, so it may run on any CPU. */
+static void bench_smp_worker(void)
 {
-    const char *path_display = shell_cwd;
-    if (!path_display || path_display[0] == '\0')
-        path_display = "/";
-
-    vga_set_color(0xB, 0x0);
-    vga_write("proOS ");
-    vga_write(path_display);
-    vga_write(" >> ");
-    vga_set_color(0x7, 0x0);
+    uint32_t index = __sync_fetch_and_add(&bench_smp_next_slot, 1u);
+    struct bench_smp_slot *slot = &bench_smp_slots[index];
+    uint32_t state = index + 1u;
+    uint32_t checksum = 0;
+    for (uint32_t i = 0; i < slot->iterations; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        checksum ^= state >> 7;
+    }
+    slot->checksum = checksum;
+    slot->cpu = smp_cpu_id();
+    __sync_synchronize();
+    slot->done = 1;
 }
 
-static void shell_execute(char *line)
+/* Splits a fixed amount of work over @p threads workers; returns elapsed ns, 0 on failure. */
+static uint64_t bench_smp_run(uint32_t threads)
 {
-    if (!line)
-        return;
-
-    const char *trimmed = skip_spaces(line);
-    if (*trimmed == '\0')
-        return;
-
-    char *cursor = (char *)trimmed;
-    trim_trailing_spaces(cursor);
-
-    if (shell_str_equals(cursor, "help"))
-    {
-        command_help();
-    }
-    else if (shell_str_equals(cursor, "clear"))
+    bench_smp_next_slot = 0;
+    for (uint32_t i = 0; i < threads; ++i)
     {
-        command_clear();
+        bench_smp_slots[i].iterations = BENCH_SMP_TOTAL_ITERATIONS / threads;
+        bench_smp_slots[i].cpu = 0;
+        bench_smp_slots[i].done = 0;
     }
-    else if (shell_str_equals(cursor, "mem"))
+
+    uint64_t start = clock_monotonic_ns();
+    for (uint32_t i = 0; i < threads; ++i)
     {
-        command_mem();
+        int pid = process_create_kernel(bench_smp_worker, PROC_STACK_SIZE);
+        if (pid < 0)
+            return 0;
+        process_set_affinity(pid, smp_online_mask());
     }
-    else if (shell_str_equals(cursor, "reboot"))
+
+    for (;;)
     {
-        command_reboot();
+        uint32_t finished = 0;
+        for (uint32_t i = 0; i < threads; ++i)
+            finished += bench_smp_slots[i].done;
+        if (finished == threads)
+            break;
+        process_sleep(1);
     }
-    else if (shell_str_equals(cursor, "ls"))
+    return clock_monotonic_ns() - start;
+}
+
+static void command_bench_smp(const char *args)
+{
+    int threads = (int)smp_cpu_count();
+    const char *token = skip_spaces(args);
+    if (*token && !parse_positive_int(token, &threads))
     {
-        command_ls("");
+        vga_write_line("Usage: bench smp [threads]");
+        return;
     }
-    else if (shell_str_starts_with(cursor, "ls "))
+    if (threads > BENCH_SMP_MAX_THREADS)
+        threads = BENCH_SMP_MAX_THREADS;
+    if (process_count() + threads > MAX_PROCS)
     {
-        command_ls(cursor + 2);
+        vga_write_line("bench: not enough process slots");
+        return;
     }
-    else if (shell_str_equals(cursor, "tree"))
+
+    char line[96];
+    char num_buf[32];
+    size_t pos = 0;
+    write_u64((uint64_t)smp_cpu_count(), num_buf);
+    buffer_append(line, &pos, sizeof(line), "cpus online: ");
+    buffer_append(line, &pos, sizeof(line), num_buf);
+    line[pos] = '\0';
+    vga_write_line(line);
+    vga_write_line("threads  ms  speedup  cpus");
+
+    /* 1, 2, 4, ... threads workers, each doing an equal share of the same total. */
+    uint64_t baseline_us = 0;
+    uint32_t count = 1;
+    for (;;)
     {
-        command_tree("");
-    }
-    else if (shell_str_starts_with(cursor, "tree "))
+        uint64_t elapsed = bench_smp_run(count);
+        if (elapsed == 0)
+        {
+            vga_write_line("bench: failed to spawn workers");
+            return;
+        }
+
+        uint32_t remainder = 0;
+        uint64_t elapsed_us = u64_divmod(elapsed, 1000u, &remainder);
+        if (elapsed_us == 0)
+            elapsed_us = 1;
+        if (count == 1)
+            baseline_us = elapsed_us;
+        uint64_t speedup = u64_divmod(baseline_us * 100u, (uint32_t)elapsed_us, &remainder);
+
+        pos = 0;
+        write_u64((uint64_t)count, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        buffer_append(line, &pos, sizeof(line), "  ");
+        format_us_as_ms((uint32_t)elapsed_us, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        buffer_append(line, &pos, sizeof(line), "  ");
+        write_u64(u64_divmod(speedup, 100u, &remainder), num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        buffer_append(line, &pos, sizeof(line), remainder < 10u ? ".0" : ".");
+        write_u64((uint64_t)remainder, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        buffer_append(line, &pos, sizeof(line), "x ");
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            write_u64((uint64_t)bench_smp_slots[i].cpu, num_buf);
+            buffer_append(line, &pos, sizeof(line), " ");
+            buffer_append(line, &pos, sizeof(line), num_buf);
+        }
+        line[pos] = '\0';
+        vga_write_line(line);
+
+        if (count == (uint32_t)threads)
+            break;
+        count = ((count << 1) < (uint32_t)threads) ? (count << 1) : (uint32_t)threads;
+    }
+}
+
+#define BENCH_LOCK_MAX_THREADS 16
+#define BENCH_LOCK_TOTAL_PAIRS (1u << 15)
+
+/* One run of `bench futex`: every worker hammers the same lock. */
+struct bench_lock_state
+{
+    int use_futex;
+    int mutex_id;
+    uint32_t iterations;
+    struct futex_mutex futex;
+    volatile uint32_t counter;
+    volatile uint32_t done;
+};
+
+static struct bench_lock_state bench_lock = { 0, -1, 0, FUTEX_MUTEX_INIT, 0, 0 };
+
+static void bench_lock_worker(void)
+{
+    for (uint32_t i = 0; i < bench_lock.iterations; ++i)
+    {
+        if (bench_lock.use_futex)
+        {
+            futex_mutex_lock(&bench_lock.futex);
+            ++bench_lock.counter;
+            futex_mutex_unlock(&bench_lock.futex);
+        }
+        else
+        {
+            sys_mutex_lock(bench_lock.mutex_id);
+            ++bench_lock.counter;
+            sys_mutex_unlock(bench_lock.mutex_id);
+        }
+    }
+    __sync_fetch_and_add(&bench_lock.done, 1u);
+}
+
+/* Returns elapsed ns for BENCH_LOCK_TOTAL_PAIRS lock/unlock pairs, 0 on failure. */
+static uint64_t bench_lock_run(uint32_t threads, int use_futex)
+{
+    bench_lock.use_futex = use_futex;
+    bench_lock.iterations = BENCH_LOCK_TOTAL_PAIRS / threads;
+    bench_lock.futex.state = 0;
+    bench_lock.counter = 0;
+    bench_lock.done = 0;
+
+    uint64_t start = clock_monotonic_ns();
+    for (uint32_t i = 0; i < threads; ++i)
+    {
+        int pid = process_create_kernel(bench_lock_worker, PROC_STACK_SIZE);
+        if (pid < 0)
+            return 0;
+        process_set_affinity(pid, smp_online_mask());
+    }
+
+    while (bench_lock.done != threads)
+        process_sleep(1);
+    uint64_t elapsed = clock_monotonic_ns() - start;
+    return (bench_lock.counter == bench_lock.iterations * threads) ? elapsed : 0;
+}
+
+static void bench_lock_append_ms(char *line, size_t *pos, size_t cap, uint64_t ns)
+{
+    char num_buf[32];
+    uint32_t remainder = 0;
+    buffer_append(line, pos, cap, "  ");
+    format_us_as_ms((uint32_t)u64_divmod(ns, 1000u, &remainder), num_buf);
+    buffer_append(line, pos, cap, num_buf);
+}
+
+static void command_bench_futex(const char *args)
+{
+    int max_threads = BENCH_LOCK_MAX_THREADS;
+    const char *token = skip_spaces(args);
+    if (*token && !parse_positive_int(token, &max_threads))
+    {
+        vga_write_line("Usage: bench futex [max_threads]");
+        return;
+    }
+    if (max_threads > BENCH_LOCK_MAX_THREADS)
+        max_threads = BENCH_LOCK_MAX_THREADS;
+    if (max_threads < 2)
+        max_threads = 2;
+    if (process_count() + max_threads > MAX_PROCS)
+    {
+        vga_write_line("bench: not enough process slots");
+        return;
+    }
+    if (bench_lock.mutex_id < 0)
+        bench_lock.mutex_id = sync_mutex_create();
+    if (bench_lock.mutex_id < 0)
+    {
+        vga_write_line("bench: no free mutex");
+        return;
+    }
+
+    char line[96];
+    char num_buf[32];
+    size_t pos = 0;
+    write_u64((uint64_t)BENCH_LOCK_TOTAL_PAIRS, num_buf);
+    buffer_append(line, &pos, sizeof(line), num_buf);
+    buffer_append(line, &pos, sizeof(line), " lock/unlock pairs per run");
+    line[pos] = '\0';
+    vga_write_line(line);
+    vga_write_line("threads  sys_mutex ms  futex ms  syscalls (sys_mutex / futex)");
+
+    for (uint32_t threads = 2; threads <= (uint32_t)max_threads; threads <<= 1)
+    {
+        uint64_t mutex_ns = bench_lock_run(threads, 0);
+        struct futex_stats before;
+        struct futex_stats after;
+        futex_get_stats(&before);
+        uint64_t futex_ns = bench_lock_run(threads, 1);
+        futex_get_stats(&after);
+        if (mutex_ns == 0 || futex_ns == 0)
+        {
+            vga_write_line("bench: worker spawn failed or a count was lost");
+            return;
+        }
+
+        /* Every sys_mutex pair traps twice; the futex path only on contention. */
+        uint32_t futex_calls = (after.waits - before.waits) + (after.wakes - before.wakes);
+        pos = 0;
+        write_u64((uint64_t)threads, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        bench_lock_append_ms(line, &pos, sizeof(line), mutex_ns);
+        bench_lock_append_ms(line, &pos, sizeof(line), futex_ns);
+        buffer_append(line, &pos, sizeof(line), "  ");
+        write_u64((uint64_t)bench_lock.iterations * threads * 2u, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        buffer_append(line, &pos, sizeof(line), " / ");
+        write_u64((uint64_t)futex_calls, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        line[pos] = '\0';
+        vga_write_line(line);
+    }
+}
+
+#define BENCH_IPC_DEFAULT_ROUNDS 2000
+#define BENCH_IPC_STOP 0xFFFFFFFFu
+
+/* Shared by the two user processes of one `bench ipc` run. */
+struct bench_ipc_state
+{
+    int use_call;
+    uint32_t rounds;
+    pid_t server_pid;
+    pid_t client_pid;
+    volatile uint32_t go;
+    volatile uint32_t done;
+    uint32_t errors;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+};
+
+static struct bench_ipc_state bench_ipc;
+
+static void bench_ipc_server(void)
+{
+    while (!bench_ipc.go)
+        sys_yield();
+
+    uint32_t request = 0;
+    if (bench_ipc.use_call)
+    {
+        pid_t client = 0;
+        int size = sys_ipc_reply_wait(0, NULL, 0, &client, &request, sizeof(request));
+        while (size >= 0 && request != BENCH_IPC_STOP)
+        {
+            uint32_t answer = request + 1u;
+            size = sys_ipc_reply_wait(client, &answer, sizeof(answer), &client, &request, sizeof(request));
+        }
+        if (size >= 0)
+            sys_ipc_reply_wait(client, &request, sizeof(request), NULL, NULL, 0);
+    }
+    else
+    {
+        while (sys_ipc_recv(bench_ipc.client_pid, &request, sizeof(request)) >= 0)
+        {
+            uint32_t answer = request + 1u;
+            sys_ipc_send(bench_ipc.client_pid, &answer, sizeof(answer));
+            if (request == BENCH_IPC_STOP)
+                break;
+        }
+    }
+    __sync_fetch_and_add(&bench_ipc.done, 1u);
+}
+
+static int bench_ipc_round_trip(pid_t server, uint32_t request, uint32_t *answer)
+{
+    if (bench_ipc.use_call)
+        return sys_ipc_call(server, &request, sizeof(request), answer, sizeof(*answer)) == (int)sizeof(*answer);
+    if (sys_ipc_send(server, &request, sizeof(request)) < 0)
+        return 0;
+    return sys_ipc_recv(server, answer, sizeof(*answer)) == (int)sizeof(*answer);
+}
+
+static void bench_ipc_client(void)
+{
+    while (!bench_ipc.go)
+        sys_yield();
+
+    const struct clock_time_page *clock = sys_time_page();
+    pid_t server = bench_ipc.server_pid;
+    for (uint32_t i = 0; i < bench_ipc.rounds; ++i)
+    {
+        uint32_t answer = 0;
+        uint64_t start = time_page_monotonic_ns(clock);
+        int ok = bench_ipc_round_trip(server, i, &answer);
+        uint64_t rtt = time_page_monotonic_ns(clock) - start;
+        if (!ok || answer != i + 1u)
+        {
+            ++bench_ipc.errors;
+            break;
+        }
+        bench_ipc.total_ns += rtt;
+        if (rtt < bench_ipc.min_ns)
+            bench_ipc.min_ns = rtt;
+        if (rtt > bench_ipc.max_ns)
+            bench_ipc.max_ns = rtt;
+    }
+
+    uint32_t answer = 0;
+    bench_ipc_round_trip(server, BENCH_IPC_STOP, &answer);
+    __sync_fetch_and_add(&bench_ipc.done, 1u);
+}
+
+static uint32_t bench_ipc_handoffs(void)
+{
+    uint32_t total = 0;
+    for (uint32_t cpu = 0; cpu < CONFIG_MAX_CPUS; ++cpu)
+    {
+        struct sched_cpu_stats stats;
+        process_cpu_stats(cpu, &stats);
+        total += stats.handoffs;
+    }
+    return total;
+}
+
+/* Ping-pong between two fresh user processes; returns 0 when every round trip succeeded. */
+static int bench_ipc_run(int use_call, uint32_t rounds)
+{
+    bench_ipc.use_call = use_call;
+    bench_ipc.rounds = rounds;
+    bench_ipc.go = 0;
+    bench_ipc.done = 0;
+    bench_ipc.errors = 0;
+    bench_ipc.total_ns = 0;
+    bench_ipc.min_ns = ~0ull;
+    bench_ipc.max_ns = 0;
+
+    int server = process_create(bench_ipc_server, PROC_STACK_SIZE);
+    if (server < 0)
+        return -1;
+    int client = process_create(bench_ipc_client, PROC_STACK_SIZE);
+    if (client < 0)
+        return -1;
+    bench_ipc.server_pid = server;
+    bench_ipc.client_pid = client;
+    uint32_t rights = IPC_RIGHT_SEND | IPC_RIGHT_RECV;
+    ipc_cap_grant(client, server, rights);
+    ipc_cap_grant(server, client, rights);
+    __sync_synchronize();
+    bench_ipc.go = 1;
+
+    while (bench_ipc.done != 2u)
+        process_sleep(1);
+    return bench_ipc.errors ? -1 : 0;
+}
+
+static void bench_ipc_append_ns(char *line, size_t *pos, size_t cap, uint64_t ns)
+{
+    char num_buf[32];
+    write_u64(ns, num_buf);
+    buffer_append(line, pos, cap, "  ");
+    buffer_append(line, pos, cap, num_buf);
+    buffer_append(line, pos, cap, "ns");
+}
+
+static void command_bench_ipc(const char *args)
+{
+    int rounds = BENCH_IPC_DEFAULT_ROUNDS;
+    const char *token = skip_spaces(args);
+    if (*token && !parse_positive_int(token, &rounds))
+    {
+        vga_write_line("Usage: bench ipc [rounds]");
+        return;
+    }
+    /* Each path runs its own server and client process. */
+    if (process_count() + 2 > MAX_PROCS)
+    {
+        vga_write_line("bench: not enough process slots");
+        return;
+    }
+
+    static const char *const labels[2] = { "send/recv ", "call/reply" };
+    vga_write_line("path        avg  min  max (round trip)  handoffs");
+    for (int use_call = 0; use_call < 2; ++use_call)
+    {
+        uint32_t handoffs_before = bench_ipc_handoffs();
+        if (bench_ipc_run(use_call, (uint32_t)rounds) < 0)
+        {
+            vga_write_line("bench: failed to spawn peers or a round trip failed");
+            return;
+        }
+        uint32_t handoffs = bench_ipc_handoffs() - handoffs_before;
+
+        char line[96];
+        char num_buf[32];
+        size_t pos = 0;
+        uint32_t remainder = 0;
+        buffer_append(line, &pos, sizeof(line), labels[use_call]);
+        bench_ipc_append_ns(line, &pos, sizeof(line), u64_divmod(bench_ipc.total_ns, (uint32_t)rounds, &remainder));
+        bench_ipc_append_ns(line, &pos, sizeof(line), bench_ipc.min_ns);
+        bench_ipc_append_ns(line, &pos, sizeof(line), bench_ipc.max_ns);
+        buffer_append(line, &pos, sizeof(line), "  ");
+        write_u64((uint64_t)handoffs, num_buf);
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        line[pos] = '\0';
+        vga_write_line(line);
+    }
+}
+
+#define BENCH_RING_DEFAULT_MESSAGES 4000
+#define BENCH_RING_PAGES 4u
+
+/* One `bench ring` run: a producer streams fixed-size records to a consumer. */
+struct bench_ring_state
+{
+    int use_ring;
+    uint32_t messages;
+    pid_t consumer_pid;
+    pid_t producer_pid;
+    void *region;
+    volatile int ring_id;
+    volatile uint32_t go;
+    volatile uint32_t done;
+    uint32_t errors;
+    /** Kernel entries the producer made for full queues. */
+    uint32_t retries;
+    uint64_t elapsed_ns;
+};
+
+static struct bench_ring_state bench_ring;
+
+static void bench_ring_fill(uint8_t *data, uint32_t seq)
+{
+    for (uint32_t i = 0; i < CONFIG_MSG_DATA_MAX; ++i)
+        data[i] = (uint8_t)(seq + i);
+}
+
+static int bench_ring_check(const uint8_t *data, uint32_t seq)
+{
+    return data[0] == (uint8_t)seq && data[CONFIG_MSG_DATA_MAX - 1] == (uint8_t)(seq + CONFIG_MSG_DATA_MAX - 1);
+}
+
+static void bench_ring_consumer(void)
+{
+    while (!bench_ring.go)
+        sys_yield();
+    /* Released with errors set when the producer could not be started. */
+    if (bench_ring.errors)
+    {
+        __sync_fetch_and_add(&bench_ring.done, 1u);
+        return;
+    }
+
+    struct ipc_ring_header *ring = NULL;
+    if (bench_ring.use_ring)
+    {
+        while (bench_ring.ring_id == 0 && !bench_ring.errors)
+            sys_yield();
+        ring = (bench_ring.ring_id > 0) ? sys_ring_attach(bench_ring.ring_id - 1) : NULL;
+        if (!ring)
+            ++bench_ring.errors;
+    }
+
+    const struct clock_time_page *clock = sys_time_page();
+    uint64_t start = time_page_monotonic_ns(clock);
+    if (ring)
+    {
+        for (uint32_t i = 0; i < bench_ring.messages; ++i)
+        {
+            struct ipc_ring_slot *slot = ring_next(ring, bench_ring.ring_id - 1);
+            if (!slot || slot->length != CONFIG_MSG_DATA_MAX || !bench_ring_check(slot->data, i))
+            {
+                ++bench_ring.errors;
+                break;
+            }
+            ipc_ring_release(ring, slot);
+        }
+    }
+    else if (!bench_ring.use_ring)
+    {
+        uint8_t data[CONFIG_MSG_DATA_MAX];
+        for (uint32_t i = 0; i < bench_ring.messages; ++i)
+        {
+            if (sys_ipc_recv(bench_ring.producer_pid, data, sizeof(data)) != (int)sizeof(data) || !bench_ring_check(data, i))
+            {
+                ++bench_ring.errors;
+                break;
+            }
+        }
+    }
+    bench_ring.elapsed_ns = time_page_monotonic_ns(clock) - start;
+    __sync_fetch_and_add(&bench_ring.done, 1u);
+}
+
+static void bench_ring_producer(void)
+{
+    while (!bench_ring.go)
+        sys_yield();
+
+    struct ipc_ring_header *ring = NULL;
+    int ring_id = -1;
+    if (bench_ring.use_ring)
+    {
+        ring_id = sys_ring_create(bench_ring.consumer_pid, bench_ring.region, BENCH_RING_PAGES, CONFIG_MSG_DATA_MAX, 0);
+        if (ring_id < 0)
+            ++bench_ring.errors;
+        ring = (struct ipc_ring_header *)bench_ring.region;
+        /* Stored off by one so the consumer can spin on zero. */
+        bench_ring.ring_id = ring_id + 1;
+    }
+
+    uint8_t data[CONFIG_MSG_DATA_MAX];
+    for (uint32_t i = 0; i < bench_ring.messages && !bench_ring.errors; ++i)
+    {
+        if (ring)
+        {
+            /* Built straight into the shared slot; nothing is copied by the kernel. */
+            struct ipc_ring_slot *slot;
+            uint32_t pos;
+            while (!(slot = ipc_ring_reserve(ring, &pos)))
+            {
+                ++bench_ring.retries;
+                sys_yield();
+            }
+            bench_ring_fill(slot->data, i);
+            ring_post(ring, ring_id, slot, pos, CONFIG_MSG_DATA_MAX);
+        }
+        else
+        {
+            bench_ring_fill(data, i);
+            while (sys_ipc_send(bench_ring.consumer_pid, data, sizeof(data)) < 0)
+            {
+                ++bench_ring.retries;
+                sys_yield();
+            }
+        }
+    }
+    __sync_fetch_and_add(&bench_ring.done, 1u);
+}
+
+static int bench_ring_run(int use_ring, uint32_t messages, void *region)
+{
+    bench_ring.use_ring = use_ring;
+    bench_ring.messages = messages;
+    bench_ring.go = 0;
+    bench_ring.done = 0;
+    bench_ring.errors = 0;
+    bench_ring.retries = 0;
+    bench_ring.elapsed_ns = 0;
+    bench_ring.region = region;
+    bench_ring.ring_id = 0;
+
+    int consumer = process_create(bench_ring_consumer, PROC_STACK_SIZE);
+    if (consumer < 0)
+        return -1;
+    int producer = process_create(bench_ring_producer, PROC_STACK_SIZE);
+    if (producer < 0)
+    {
+        /* No ring exists yet; let the consumer exit instead of waiting for a peer. */
+        bench_ring.errors = 1;
+        __sync_synchronize();
+        bench_ring.go = 1;
+        while (bench_ring.done != 1u)
+            process_sleep(1);
+        return -1;
+    }
+    bench_ring.consumer_pid = consumer;
+    bench_ring.producer_pid = producer;
+    uint32_t rights = IPC_RIGHT_SEND | IPC_RIGHT_RECV | IPC_RIGHT_SHARE;
+    ipc_cap_grant(producer, consumer, rights);
+    ipc_cap_grant(consumer, producer, rights);
+    __sync_synchronize();
+    bench_ring.go = 1;
+
+    while (bench_ring.done != 2u)
+        process_sleep(1);
+    return bench_ring.errors ? -1 : 0;
+}
+
+static void command_bench_ring(const char *args)
+{
+    int messages = BENCH_RING_DEFAULT_MESSAGES;
+    const char *token = skip_spaces(args);
+    if (*token && !parse_positive_int(token, &messages))
+    {
+        vga_write_line("Usage: bench ring [messages]");
+        return;
+    }
+    if (process_count() + 2 > MAX_PROCS)
+    {
+        vga_write_line("bench: not enough process slots");
+        return;
+    }
+    /* Order 2 is BENCH_RING_PAGES pages, page aligned as ipc_share() requires. */
+    void *region = kalloc_pages(2);
+    if (!region)
+    {
+        vga_write_line("bench: out of memory");
+        return;
+    }
+
+    static const char *const labels[2] = { "mailbox", "ring   " };
+    vga_write_line("path     per msg   total  full  doorbells  sleeps");
+    for (int use_ring = 0; use_ring < 2; ++use_ring)
+    {
+        struct ipc_ring_stats before;
+        struct ipc_ring_stats after;
+        ipc_ring_get_stats(&before);
+        if (bench_ring_run(use_ring, (uint32_t)messages, region) < 0)
+        {
+            vga_write_line("bench: failed to spawn peers or a message was corrupted");
+            break;
+        }
+        ipc_ring_get_stats(&after);
+
+        char line[96];
+        char num_buf[32];
+        size_t pos = 0;
+        uint32_t remainder = 0;
+        buffer_append(line, &pos, sizeof(line), labels[use_ring]);
+        bench_ipc_append_ns(line, &pos, sizeof(line), u64_divmod(bench_ring.elapsed_ns, (uint32_t)messages, &remainder));
+        bench_ipc_append_ns(line, &pos, sizeof(line), bench_ring.elapsed_ns);
+        const uint32_t counts[3] = { bench_ring.retries, after.doorbells - before.doorbells, after.sleeps - before.sleeps };
+        for (int i = 0; i < 3; ++i)
+        {
+            write_u64((uint64_t)counts[i], num_buf);
+            buffer_append(line, &pos, sizeof(line), "  ");
+            buffer_append(line, &pos, sizeof(line), num_buf);
+        }
+        line[pos] = '\0';
+        vga_write_line(line);
+    }
+    kfree(region);
+}
+
+#define BENCH_SERVICES_TIMEOUT_TICKS (CONFIG_TIMER_HZ * 2u)
+
+/* One `bench services` run: a fresh user process calls each system daemon once. */
+struct bench_services_state
+{
+    enum system_service service;
+    volatile uint32_t done;
+    int reply_size;
+    int32_t status;
+    uint64_t elapsed_ns;
+};
+
+static struct bench_services_state bench_services;
+
+static void bench_services_client(void)
+{
+    const struct clock_time_page *clock = sys_time_page();
+    uint32_t request = 0;
+    struct service_reply reply = { 0 };
+    uint64_t start = time_page_monotonic_ns(clock);
+    bench_services.reply_size = -1;
+    pid_t server = (pid_t)sys_service_connect(bench_services.service, IPC_RIGHT_SEND | IPC_RIGHT_RECV);
+    if (server > 0)
+        bench_services.reply_size = sys_ipc_call(server, &request, sizeof(request), &reply, sizeof(reply));
+    bench_services.elapsed_ns = time_page_monotonic_ns(clock) - start;
+    bench_services.status = reply.status;
+    __sync_fetch_and_add(&bench_services.done, 1u);
+}
+
+/* Every daemon must answer sys_ipc_call(), if only to refuse it; a call that never returns is reported. */
+static void command_bench_services(void)
+{
+    static const struct
+    {
+        enum system_service service;
+        const char *label;
+    } targets[] = {
+        { SYSTEM_SERVICE_FSD, "fsd   " },
+        { SYSTEM_SERVICE_NETD, "netd  " },
+        { SYSTEM_SERVICE_INPUTD, "inputd" },
+    };
+
+    vga_write_line("service  reply  status  round trip");
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i)
+    {
+        if (process_count() + 1 > MAX_PROCS)
+        {
+            vga_write_line("bench: not enough process slots");
+            return;
+        }
+        bench_services.service = targets[i].service;
+        bench_services.done = 0;
+        bench_services.status = 0;
+        __sync_synchronize();
+        if (process_create(bench_services_client, PROC_STACK_SIZE) < 0)
+        {
+            vga_write_line("bench: failed to spawn the client");
+            return;
+        }
+
+        uint32_t waited = 0;
+        while (!bench_services.done && waited < BENCH_SERVICES_TIMEOUT_TICKS)
+        {
+            process_sleep(1);
+            ++waited;
+        }
+
+        char line[96];
+        char num_buf[32];
+        size_t pos = 0;
+        buffer_append(line, &pos, sizeof(line), targets[i].label);
+        if (!bench_services.done)
+        {
+            /* The client stays blocked in the call; later runs use a new one. */
+            buffer_append(line, &pos, sizeof(line), "   no reply");
+        }
+        else if (bench_services.reply_size < 0)
+        {
+            buffer_append(line, &pos, sizeof(line), "   call failed");
+        }
+        else
+        {
+            buffer_append(line, &pos, sizeof(line), "   ");
+            write_u64((uint64_t)bench_services.reply_size, num_buf);
+            buffer_append(line, &pos, sizeof(line), num_buf);
+            buffer_append(line, &pos, sizeof(line), "  ");
+            buffer_append(line, &pos, sizeof(line), (bench_services.status == SERVICE_STATUS_UNSUPPORTED) ? "unsupported" : "ok");
+            bench_ipc_append_ns(line, &pos, sizeof(line), bench_services.elapsed_ns);
+        }
+        line[pos] = '\0';
+        vga_write_line(line);
+    }
+}
+
+#define BENCH_SYSCALL_DEFAULT_CALLS 100000
+
+static void command_bench_syscall(const char *args)
+{
+    int calls = BENCH_SYSCALL_DEFAULT_CALLS;
+    const char *token = skip_spaces(args);
+    if (*token && !parse_positive_int(token, &calls))
+    {
+        vga_write_line("Usage: bench syscall [calls]");
+        return;
+    }
+
+    static const char *const labels[2] = { "int 0x80", "sysenter" };
+    vga_write_line("path      cycles per null syscall");
+    for (int fast = 0; fast < 2; ++fast)
+    {
+        char line[64];
+        char num_buf[32];
+        size_t pos = 0;
+        buffer_append(line, &pos, sizeof(line), labels[fast]);
+        if (fast && !syscall_fast_enabled)
+        {
+            buffer_append(line, &pos, sizeof(line), "  unsupported");
+            line[pos] = '\0';
+            vga_write_line(line);
+            continue;
+        }
+
+        uint64_t start = rdtsc();
+        for (int i = 0; i < calls; ++i)
+        {
+            if (fast)
+                syscall_fast_call(SYS_NULL, 0, 0, 0, 0);
+            else
+                sys_call6(SYS_NULL, 0, 0, 0, 0, 0, 0, 0);
+        }
+        uint64_t elapsed = rdtsc() - start;
+
+        uint32_t remainder = 0;
+        write_u64(u64_divmod(elapsed, (uint32_t)calls, &remainder), num_buf);
+        buffer_append(line, &pos, sizeof(line), "  ");
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        line[pos] = '\0';
+        vga_write_line(line);
+    }
+}
+
+#define BENCH_URING_DEFAULT_OPS 100000
+#define BENCH_URING_BATCH 32u
+
+static struct uring_shared *bench_uring = NULL;
+
+static void command_bench_uring(const char *args)
+{
+    int ops = BENCH_URING_DEFAULT_OPS;
+    const char *token = skip_spaces(args);
+    if (*token && !parse_positive_int(token, &ops))
+    {
+        vga_write_line("Usage: bench uring [ops]");
+        return;
+    }
+    /* The shell never exits, so its ring is set up once and kept. */
+    if (!bench_uring && sys_uring_setup(BENCH_URING_BATCH, &bench_uring) < 0)
+    {
+        vga_write_line("bench: no free submission ring");
+        return;
+    }
+
+    static const char *const labels[2] = { "one trap per call", "ring, 32 per enter" };
+    vga_write_line("path                cycles per null syscall  traps");
+    for (int batched = 0; batched < 2; ++batched)
+    {
+        uint32_t traps = 0;
+        uint32_t failures = 0;
+        uint64_t start = rdtsc();
+        if (!batched)
+        {
+            for (int i = 0; i < ops; ++i)
+                sys_call(SYS_NULL, 0, 0, 0, 0, 0);
+            traps = (uint32_t)ops;
+        }
+        else
+        {
+            uint32_t left = (uint32_t)ops;
+            while (left > 0)
+            {
+                uint32_t batch = (left < BENCH_URING_BATCH) ? left : BENCH_URING_BATCH;
+                for (uint32_t i = 0; i < batch; ++i)
+                    uring_queue(bench_uring, SYS_NULL, 0, 0, 0, 0, 0, i);
+                if (sys_ring_enter(batch, batch) != (int)batch)
+                    ++failures;
+                ++traps;
+
+                struct uring_cqe cqe;
+                while (uring_reap(bench_uring, &cqe))
+                {
+                    if (cqe.result != 0)
+                        ++failures;
+                }
+                left -= batch;
+            }
+        }
+        uint64_t elapsed = rdtsc() - start;
+
+        char line[80];
+        char num_buf[32];
+        size_t pos = 0;
+        uint32_t remainder = 0;
+        buffer_append(line, &pos, sizeof(line), labels[batched]);
+        write_u64(u64_divmod(elapsed, (uint32_t)ops, &remainder), num_buf);
+        buffer_append(line, &pos, sizeof(line), "  ");
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        write_u64((uint64_t)traps, num_buf);
+        buffer_append(line, &pos, sizeof(line), "  ");
+        buffer_append(line, &pos, sizeof(line), num_buf);
+        if (failures)
+            buffer_append(line, &pos, sizeof(line), "  (errors)");
+        line[pos] = '\0';
+        vga_write_line(line);
+    }
+}
+
+static void command_timers(void)
+{
+    debug_publish_timer_info();
+    command_cat(" /System/timers");
+}
+
+static void command_sysstat(const char *args)
+{
+    const char *arg = skip_spaces(args ? args : "");
+    if (shell_str_equals(arg, "reset"))
+    {
+        syscall_reset_stats();
+        vga_write_line("syscall statistics cleared");
+        return;
+    }
+    if (*arg)
+    {
+        vga_write_line("usage: sysstat [reset]");
+        return;
+    }
+
+    debug_publish_syscall_info();
+    command_cat(" /System/Syscalls");
+}
+
+static void command_bcache(const char *args)
+{
+    const char *arg = skip_spaces(args ? args : "");
+    if (shell_str_equals(arg, "sync"))
+    {
+        if (blockdev_sync(NULL) < 0)
+            vga_write_line("bcache: write-back failed");
+        else
+            vga_write_line("buffer cache flushed");
+        return;
+    }
+    if (*arg)
+    {
+        vga_write_line("usage: bcache [sync]");
+        return;
+    }
+
+    debug_publish_bcache_info();
+    command_cat(" /System/bcache");
+}
+
+static void command_blkq(const char *args)
+{
+    const char *arg = skip_spaces(args ? args : "");
+    if (shell_str_equals(arg, "reset"))
+    {
+        blkqueue_reset_stats();
+        vga_write_line("block queue statistics cleared");
+        return;
+    }
+    if (*arg)
+    {
+        char name[BLOCKDEV_NAME_MAX];
+        if (!shell_copy_token(arg, name, sizeof(name)))
+        {
+            vga_write_line("blkq: device name too long");
+            return;
+        }
+        const char *policy = skip_spaces(arg + str_len(name));
+        uint8_t elevator;
+        if (shell_str_equals(policy, "fifo"))
+            elevator = BLOCKDEV_ELEVATOR_FIFO;
+        else if (shell_str_equals(policy, "deadline"))
+            elevator = BLOCKDEV_ELEVATOR_DEADLINE;
+        else
+        {
+            vga_write_line("usage: blkq [reset | <device> fifo|deadline]");
+            return;
+        }
+        if (blockdev_set_elevator(blockdev_find(name), elevator) < 0)
+            vga_write_line("blkq: no such block device");
+        return;
+    }
+
+    debug_publish_blkqueue_info();
+    command_cat(" /System/blkqueue");
+}
+
+static void command_locks(const char *args)
+{
+    const char *arg = skip_spaces(args ? args : "");
+    if (shell_str_equals(arg, "reset"))
+    {
+        lock_class_reset_stats();
+        sync_reset_stats();
+        vga_write_line("lock statistics cleared");
+        return;
+    }
+    if (*arg)
+    {
+        vga_write_line("usage: locks [reset]");
+        return;
+    }
+
+    debug_publish_lock_info();
+    debug_publish_sync_info();
+    command_cat(" /System/locks");
+    command_cat(" /System/sync");
+}
+
+static void command_channels(void)
+{
+    debug_publish_channel_info();
+    command_cat(" /System/channels");
+}
+
+static void command_bench(const char *args)
+{
+    const char *sub = skip_spaces(args ? args : "");
+    char token[16];
+    size_t idx = 0;
+    while (sub[idx] && sub[idx] != ' ' && idx + 1 < sizeof(token))
+    {
+        token[idx] = sub[idx];
+        ++idx;
+    }
+    token[idx] = '\0';
+    const char *rest = skip_spaces(sub + idx);
+
+    if (shell_str_equals(token, "sched"))
+        command_bench_sched(rest);
+    else if (shell_str_equals(token, "sleep"))
+        command_bench_sleep();
+    else if (shell_str_equals(token, "smp"))
+        command_bench_smp(rest);
+    else if (shell_str_equals(token, "futex"))
+        command_bench_futex(rest);
+    else if (shell_str_equals(token, "ipc"))
+        command_bench_ipc(rest);
+    else if (shell_str_equals(token, "ring"))
+        command_bench_ring(rest);
+    else if (shell_str_equals(token, "syscall"))
+        command_bench_syscall(rest);
+    else if (shell_str_equals(token, "uring"))
+        command_bench_uring(rest);
+    else if (shell_str_equals(token, "services"))
+        command_bench_services();
+    else
+        vga_write_line("Usage: bench sched [max_tasks] | bench sleep | bench smp [threads] | bench futex [threads] | bench ipc [rounds] | bench ring [messages] | bench syscall [calls] | bench uring [ops] | bench services");
+}
+
+static void command_shutdown(void)
+{
+    debug_publish_memory_info();
+
+    uint64_t total = (uint64_t)memory_total_bytes();
+    uint64_t used = (uint64_t)memory_used_bytes();
+    uint64_t free_space = (uint64_t)memory_free_bytes();
+    uint32_t base = (uint32_t)memory_heap_base();
+    uint32_t limit = (uint32_t)memory_heap_limit();
+
+    char total_buf[32];
+    char total_kb[32];
+    char used_buf[32];
+    char used_kb[32];
+    char free_buf[32];
+    char free_kb[32];
+    char base_hex[11];
+    char limit_hex[11];
+
+    write_u64(total, total_buf);
+    write_u64(total / 1024u, total_kb);
+    write_u64(used, used_buf);
+    write_u64(used / 1024u, used_kb);
+    write_u64(free_space, free_buf);
+    write_u64(free_space / 1024u, free_kb);
+    write_hex32(base, base_hex);
+    write_hex32(limit, limit_hex);
+
+    vga_write_line("Memory statistics:");
+
+    vga_write("  Total: ");
+    vga_write(total_buf);
+    vga_write(" bytes (");
+    vga_write(total_kb);
+    vga_write_line(" KB)");
+
+    vga_write("  Used : ");
+    vga_write(used_buf);
+    vga_write(" bytes (");
+    vga_write(used_kb);
+    vga_write_line(" KB)");
+
+    vga_write("  Free : ");
+    vga_write(free_buf);
+    vga_write(" bytes (");
+    vga_write(free_kb);
+    vga_write_line(" KB)");
+
+    vga_write("  Heap base   = ");
+    vga_write_line(base_hex);
+    vga_write("  Heap limit  = ");
+    vga_write_line(limit_hex);
+
+    uint64_t ticks = get_ticks();
+    uint32_t centis = 0;
+    uint64_t seconds = u64_divmod(ticks, 100U, &centis);
+
+    char sec_buf[32];
+    char centi_buf[4];
+    write_u64(seconds, sec_buf);
+    centi_buf[0] = (char)('0' + (centis / 10U));
+    centi_buf[1] = (char)('0' + (centis % 10U));
+    centi_buf[2] = '\0';
+
+    vga_write("  Uptime: ");
+    vga_write(sec_buf);
+    vga_write(".");
+    vga_write(centi_buf);
+    vga_write_line("s");
+
+    vga_write_line("Powering off...");
+    klog_info("shell: invoking power shutdown");
+    power_shutdown();
+}
+
+static void shell_render_prompt(void)
+{
+    const char *path_display = shell_cwd;
+    if (!path_display || path_display[0] == '\0')
+        path_display = "/";
+
+    vga_set_color(0xB, 0x0);
+    vga_write("proOS ");
+    vga_write(path_display);
+    vga_write(" >> ");
+    vga_set_color(0x7, 0x0);
+}
+
+static void shell_execute(char *line)
+{
+    if (!line)
+        return;
+
+    const char *trimmed = skip_spaces(line);
+    if (*trimmed == '\0')
+        return;
+
+    char *cursor = (char *)trimmed;
+    trim_trailing_spaces(cursor);
+
+    if (shell_str_equals(cursor, "help"))
+    {
+        command_help();
+    }
+    else if (shell_str_equals(cursor, "clear"))
+    {
+        command_clear();
+    }
+    else if (shell_str_equals(cursor, "mem"))
+    {
+        command_mem();
+    }
+    else if (shell_str_equals(cursor, "reboot"))
+    {
+        command_reboot();
+    }
+    else if (shell_str_equals(cursor, "ls"))
+    {
+        command_ls("");
+    }
+    else if (shell_str_starts_with(cursor, "ls "))
+    {
+        command_ls(cursor + 2);
+    }
+    else if (shell_str_equals(cursor, "tree"))
+    {
+        command_tree("");
+    }
+    else if (shell_str_starts_with(cursor, "tree "))
     {
         command_tree(cursor + 4);
     }
@@ -3671,6 +5136,10 @@ static void shell_execute(char *line)
     {
         command_mount(cursor + 5);
     }
+    else if (shell_str_equals(cursor, "tasks -l"))
+    {
+        command_tasks_live();
+    }
     else if (shell_str_equals(cursor, "tasks") || shell_str_equals(cursor, "proc_list"))
     {
         command_proc_list();
@@ -3707,6 +5176,34 @@ static void shell_execute(char *line)
     {
         command_spawn(cursor + 5);
     }
+    else if (shell_str_equals(cursor, "timers"))
+    {
+        command_timers();
+    }
+    else if (shell_str_equals(cursor, "locks") || shell_str_starts_with(cursor, "locks "))
+    {
+        command_locks(cursor + 5);
+    }
+    else if (shell_str_equals(cursor, "sysstat") || shell_str_starts_with(cursor, "sysstat "))
+    {
+        command_sysstat(cursor + 7);
+    }
+    else if (shell_str_equals(cursor, "bcache") || shell_str_starts_with(cursor, "bcache "))
+    {
+        command_bcache(cursor + 6);
+    }
+    else if (shell_str_equals(cursor, "blkq") || shell_str_starts_with(cursor, "blkq "))
+    {
+        command_blkq(cursor + 4);
+    }
+    else if (shell_str_equals(cursor, "channels"))
+    {
+        command_channels();
+    }
+    else if (shell_str_equals(cursor, "bench") || shell_str_starts_with(cursor, "bench "))
+    {
+        command_bench(cursor + 5);
+    }
     else if (shell_str_equals(cursor, "devs"))
     {
         command_devlist();
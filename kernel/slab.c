@@ -0,0 +1,307 @@
+#include "slab.h"
+
+#include "memory.h"
+#include "spinlock.h"
+
+/*
+ * Object caches for fixed-size kernel structures.
+ *
+ * Each slab is a single page obtained from the buddy allocator. The slab
+ * header sits at the start of the page and the remaining space is cut into
+ * cache-line aligned objects, so the owning slab of any object is found by
+ * rounding its address down to the page. Free objects are chained through a
+ * link word stored just past the object, so the constructor runs only once
+ * when a slab is populated and callers hand objects back in their
+ * constructed state.
+ */
+
+enum slab_list
+{
+    SLAB_LIST_EMPTY = 0,
+    SLAB_LIST_PARTIAL,
+    SLAB_LIST_FULL,
+    SLAB_LIST_COUNT
+};
+
+struct slab
+{
+    struct kmem_cache *cache;
+    struct slab *next;
+    struct slab *prev;
+    void *free;
+    uint32_t in_use;
+    uint32_t list;
+};
+
+struct kmem_cache
+{
+    int used;
+    char name[KMEM_CACHE_NAME_MAX];
+    uint32_t object_size;
+    uint32_t stride;
+    uint32_t first_offset;
+    uint32_t link_offset;
+    uint32_t objects_per_slab;
+    kmem_ctor_t ctor;
+    struct slab *lists[SLAB_LIST_COUNT];
+    uint32_t slabs;
+    uint32_t active_objects;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t failures;
+    spinlock_t lock;
+};
+
+static struct kmem_cache cache_table[CONFIG_SLAB_MAX_CACHES];
+static spinlock_t cache_table_lock;
+
+static uint32_t align_value(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1u) & ~(alignment - 1u);
+}
+
+static void **object_link(const struct kmem_cache *cache, void *object)
+{
+    return (void **)((uint8_t *)object + cache->link_offset);
+}
+
+static void slab_list_insert(struct kmem_cache *cache, struct slab *slab, uint32_t list)
+{
+    slab->list = list;
+    slab->prev = NULL;
+    slab->next = cache->lists[list];
+    if (slab->next)
+        slab->next->prev = slab;
+    cache->lists[list] = slab;
+}
+
+static void slab_list_remove(struct kmem_cache *cache, struct slab *slab)
+{
+    if (slab->prev)
+        slab->prev->next = slab->next;
+    else
+        cache->lists[slab->list] = slab->next;
+    if (slab->next)
+        slab->next->prev = slab->prev;
+    slab->next = NULL;
+    slab->prev = NULL;
+}
+
+static void slab_move(struct kmem_cache *cache, struct slab *slab, uint32_t list)
+{
+    if (slab->list == list)
+        return;
+    slab_list_remove(cache, slab);
+    slab_list_insert(cache, slab, list);
+}
+
+static struct slab *slab_create(struct kmem_cache *cache)
+{
+    struct slab *slab = (struct slab *)kalloc_pages(0);
+    if (!slab)
+        return NULL;
+
+    slab->cache = cache;
+    slab->next = NULL;
+    slab->prev = NULL;
+    slab->free = NULL;
+    slab->in_use = 0;
+    slab->list = SLAB_LIST_EMPTY;
+
+    uint8_t *base = (uint8_t *)slab + cache->first_offset;
+    for (uint32_t i = cache->objects_per_slab; i > 0; --i)
+    {
+        void *object = base + (i - 1u) * cache->stride;
+        if (cache->ctor)
+            cache->ctor(object);
+        *object_link(cache, object) = slab->free;
+        slab->free = object;
+    }
+
+    return slab;
+}
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align, kmem_ctor_t ctor)
+{
+    if (size == 0)
+        return NULL;
+    if (align < CONFIG_SLAB_CACHE_LINE)
+        align = CONFIG_SLAB_CACHE_LINE;
+    if (align & (align - 1u))
+        return NULL;
+    uint32_t link = align_value((uint32_t)size, (uint32_t)sizeof(void *));
+    uint32_t stride = align_value(link + (uint32_t)sizeof(void *), (uint32_t)align);
+    uint32_t first = align_value((uint32_t)sizeof(struct slab), (uint32_t)align);
+    if (first + stride > MEMORY_PAGE_SIZE)
+        return NULL;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&cache_table_lock, &flags);
+
+    struct kmem_cache *cache = NULL;
+    for (size_t i = 0; i < CONFIG_SLAB_MAX_CACHES; ++i)
+    {
+        if (!cache_table[i].used)
+        {
+            cache = &cache_table[i];
+            break;
+        }
+    }
+
+    if (cache)
+    {
+        cache->used = 1;
+        size_t n = 0;
+        if (name)
+        {
+            while (name[n] && n + 1 < sizeof(cache->name))
+            {
+                cache->name[n] = name[n];
+                ++n;
+            }
+        }
+        cache->name[n] = '\0';
+        cache->object_size = (uint32_t)size;
+        cache->stride = stride;
+        cache->first_offset = first;
+        cache->link_offset = link;
+        cache->objects_per_slab = (MEMORY_PAGE_SIZE - first) / stride;
+        cache->ctor = ctor;
+        for (size_t i = 0; i < SLAB_LIST_COUNT; ++i)
+            cache->lists[i] = NULL;
+        cache->slabs = 0;
+        cache->active_objects = 0;
+        cache->hits = 0;
+        cache->misses = 0;
+        cache->failures = 0;
+        spinlock_init_named(&cache->lock, "slab.cache");
+    }
+
+    spinlock_unlock_irqrestore(&cache_table_lock, flags);
+    return cache;
+}
+
+void *kmem_cache_alloc(struct kmem_cache *cache)
+{
+    if (!cache || !cache->used)
+        return NULL;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&cache->lock, &flags);
+
+    struct slab *slab = cache->lists[SLAB_LIST_PARTIAL];
+    if (!slab)
+        slab = cache->lists[SLAB_LIST_EMPTY];
+
+    if (slab)
+    {
+        ++cache->hits;
+    }
+    else
+    {
+        ++cache->misses;
+        /* Populate outside the cache lock; constructors may be slow. */
+        spinlock_unlock_irqrestore(&cache->lock, flags);
+        slab = slab_create(cache);
+        spinlock_lock_irqsave(&cache->lock, &flags);
+        if (!slab)
+        {
+            ++cache->failures;
+            spinlock_unlock_irqrestore(&cache->lock, flags);
+            return NULL;
+        }
+        ++cache->slabs;
+        slab_list_insert(cache, slab, SLAB_LIST_EMPTY);
+    }
+
+    void *object = slab->free;
+    slab->free = *object_link(cache, object);
+    ++slab->in_use;
+    ++cache->active_objects;
+    slab_move(cache, slab, (slab->in_use == cache->objects_per_slab) ? SLAB_LIST_FULL : SLAB_LIST_PARTIAL);
+
+    spinlock_unlock_irqrestore(&cache->lock, flags);
+    return object;
+}
+
+void kmem_cache_free(struct kmem_cache *cache, void *object)
+{
+    if (!cache || !object)
+        return;
+
+    struct slab *slab = (struct slab *)((uintptr_t)object & ~(uintptr_t)(MEMORY_PAGE_SIZE - 1u));
+    uintptr_t offset = (uintptr_t)object - (uintptr_t)slab;
+    if (slab->cache != cache || offset < cache->first_offset || (offset - cache->first_offset) % cache->stride)
+        return;
+
+    struct slab *release = NULL;
+    uint32_t flags;
+    spinlock_lock_irqsave(&cache->lock, &flags);
+
+    if (slab->in_use == 0)
+    {
+        spinlock_unlock_irqrestore(&cache->lock, flags);
+        return;
+    }
+
+    *object_link(cache, object) = slab->free;
+    slab->free = object;
+    --slab->in_use;
+    --cache->active_objects;
+
+    if (slab->in_use > 0)
+    {
+        slab_move(cache, slab, SLAB_LIST_PARTIAL);
+    }
+    else if (cache->lists[SLAB_LIST_EMPTY] && cache->lists[SLAB_LIST_EMPTY] != slab)
+    {
+        /* Keep a single empty slab around to absorb alloc/free churn. */
+        slab_list_remove(cache, slab);
+        --cache->slabs;
+        slab->cache = NULL;
+        release = slab;
+    }
+    else
+    {
+        slab_move(cache, slab, SLAB_LIST_EMPTY);
+    }
+
+    spinlock_unlock_irqrestore(&cache->lock, flags);
+
+    if (release)
+        kfree(release);
+}
+
+size_t kmem_cache_snapshot(struct kmem_cache_info *out, size_t max)
+{
+    if (!out || max == 0)
+        return 0;
+
+    size_t count = 0;
+    for (size_t i = 0; i < CONFIG_SLAB_MAX_CACHES && count < max; ++i)
+    {
+        struct kmem_cache *cache = &cache_table[i];
+        if (!cache->used)
+            continue;
+
+        uint32_t flags;
+        spinlock_lock_irqsave(&cache->lock, &flags);
+
+        struct kmem_cache_info *info = &out[count++];
+        for (size_t n = 0; n < sizeof(info->name); ++n)
+            info->name[n] = cache->name[n];
+        info->object_size = cache->object_size;
+        info->stride = cache->stride;
+        info->objects_per_slab = cache->objects_per_slab;
+        info->slabs = cache->slabs;
+        info->active_objects = cache->active_objects;
+        info->total_objects = cache->slabs * cache->objects_per_slab;
+        info->hits = cache->hits;
+        info->misses = cache->misses;
+        info->failures = cache->failures;
+
+        spinlock_unlock_irqrestore(&cache->lock, flags);
+    }
+
+    return count;
+}
@@ -0,0 +1,34 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#define KMEM_CACHE_NAME_MAX 24
+
+struct kmem_cache;
+
+typedef void (*kmem_ctor_t)(void *object);
+
+struct kmem_cache_info
+{
+    char name[KMEM_CACHE_NAME_MAX];
+    uint32_t object_size;
+    uint32_t stride;
+    uint32_t objects_per_slab;
+    uint32_t slabs;
+    uint32_t active_objects;
+    uint32_t total_objects;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t failures;
+};
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align, kmem_ctor_t ctor);
+void *kmem_cache_alloc(struct kmem_cache *cache);
+void kmem_cache_free(struct kmem_cache *cache, void *object);
+size_t kmem_cache_snapshot(struct kmem_cache_info *out, size_t max);
+
+#endif
@@ -0,0 +1,273 @@
+#include "smp.h"
+
+#include "apic.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "klog.h"
+#include "memory.h"
+#include "proc.h"
+#include "syscall.h"
+#include "tsc.h"
+
+#define GDT_KERNEL_ENTRIES      3u
+#define GDT_ENTRIES             (GDT_KERNEL_ENTRIES + CONFIG_MAX_CPUS)
+#define GDT_KERNEL_CODE         0x08u
+#define GDT_KERNEL_DATA         0x10u
+#define GDT_CPU_SELECTOR(index) ((uint16_t)((GDT_KERNEL_ENTRIES + (index)) * 8u))
+
+#define GDT_ACCESS_CODE         0x9Au
+#define GDT_ACCESS_DATA         0x92u
+#define GDT_FLAGS_FLAT          0xCu
+#define GDT_FLAGS_BYTES         0x4u
+
+/* How long the boot CPU waits for APs to answer the start-up IPIs. */
+#define SMP_AP_WAIT_NS          100000000u
+#define SMP_AP_SETTLE_NS        1000000u
+
+#if CONFIG_MAX_CPUS > 32
+#error "CONFIG_MAX_CPUS must fit in a 32-bit CPU mask"
+#endif
+
+struct gdt_pointer
+{
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed));
+
+extern uint8_t ap_trampoline_start[];
+extern uint8_t ap_trampoline_gdtr[];
+extern uint8_t ap_trampoline_end[];
+
+static uint64_t gdt[GDT_ENTRIES] __attribute__((aligned(8)));
+static struct gdt_pointer gdt_ptr;
+static struct cpu_local cpu_locals[CONFIG_MAX_CPUS];
+static volatile uint32_t online_mask = 0;
+static volatile uint32_t arrived_mask = 0;
+
+/* Read by ap_trampoline.s before an AP has a stack of its own. */
+volatile uint32_t smp_ap_next = 0;
+uint32_t smp_ap_max = 0;
+uint32_t smp_ap_stacks = 0;
+uint32_t smp_ap_stack_size = CONFIG_SMP_AP_STACK_SIZE;
+
+void smp_ap_entry(uint32_t ticket) __attribute__((noreturn, used));
+
+static uint64_t gdt_entry(uint32_t base, uint32_t limit, uint8_t access, uint8_t flags)
+{
+    uint64_t entry = limit & 0xFFFFu;
+    entry |= (uint64_t)(base & 0xFFFFFFu) << 16;
+    entry |= (uint64_t)access << 40;
+    entry |= (uint64_t)((limit >> 16) & 0xFu) << 48;
+    entry |= (uint64_t)(flags & 0xFu) << 52;
+    entry |= (uint64_t)((base >> 24) & 0xFFu) << 56;
+    return entry;
+}
+
+static void gdt_load(void)
+{
+    __asm__ __volatile__(
+        "lgdt %0\n\t"
+        "ljmp $0x08, $1f\n"
+        "1:\n\t"
+        "movw $0x10, %%ax\n\t"
+        "movw %%ax, %%ds\n\t"
+        "movw %%ax, %%es\n\t"
+        "movw %%ax, %%fs\n\t"
+        "movw %%ax, %%ss\n\t"
+        : : "m"(gdt_ptr) : "eax", "memory");
+}
+
+static void smp_load_cpu_selector(uint32_t index)
+{
+    uint16_t selector = GDT_CPU_SELECTOR(index);
+    __asm__ __volatile__("movw %0, %%gs" : : "r"(selector) : "memory");
+}
+
+static uint32_t popcount32(uint32_t value)
+{
+    uint32_t count = 0;
+    while (value)
+    {
+        value &= value - 1u;
+        ++count;
+    }
+    return count;
+}
+
+static void smp_reschedule_interrupt(struct regs *frame)
+{
+    (void)frame;
+    lapic_eoi();
+    ++cpu_this()->ipi_resched;
+    process_scheduler_ipi();
+}
+
+static void smp_tick_interrupt(struct regs *frame)
+{
+    (void)frame;
+    lapic_eoi();
+    ++cpu_this()->ipi_tick;
+    process_scheduler_tick();
+}
+
+void smp_early_init(void)
+{
+    gdt[0] = 0;
+    gdt[1] = gdt_entry(0, 0xFFFFFu, GDT_ACCESS_CODE, GDT_FLAGS_FLAT);
+    gdt[2] = gdt_entry(0, 0xFFFFFu, GDT_ACCESS_DATA, GDT_FLAGS_FLAT);
+
+    /* One small data segment per CPU whose base is that CPU's block. */
+    for (uint32_t i = 0; i < CONFIG_MAX_CPUS; ++i)
+    {
+        struct cpu_local *cpu = &cpu_locals[i];
+        cpu->self = cpu;
+        cpu->index = i;
+        cpu->apic_id = 0;
+        cpu->current = NULL;
+        cpu->idle = NULL;
+        cpu->online = 0;
+        cpu->ipi_resched = 0;
+        cpu->ipi_tick = 0;
+        gdt[GDT_KERNEL_ENTRIES + i] = gdt_entry((uint32_t)(uintptr_t)cpu, sizeof(struct cpu_local) - 1u,
+                                                GDT_ACCESS_DATA, GDT_FLAGS_BYTES);
+    }
+
+    gdt_ptr.limit = (uint16_t)(sizeof(gdt) - 1u);
+    gdt_ptr.base = (uint32_t)(uintptr_t)gdt;
+    gdt_load();
+    smp_load_cpu_selector(0);
+
+    cpu_locals[0].online = 1;
+    online_mask = 1u;
+}
+
+void smp_ap_entry(uint32_t ticket)
+{
+    uint32_t index = ticket + 1u;
+    struct cpu_local *cpu = &cpu_locals[index];
+
+    smp_load_cpu_selector(index);
+    idt_load();
+    syscall_cpu_init();
+    lapic_ap_init();
+    cpu->apic_id = lapic_id();
+    __sync_fetch_and_or(&arrived_mask, 1u << index);
+
+    /* The boot CPU sets online once this CPU has an idle thread. */
+    while (!cpu->online)
+        __asm__ __volatile__("pause");
+
+    process_schedule();
+    for (;;)
+        __asm__ __volatile__("cli\n\thlt");
+}
+
+uint32_t smp_init(void)
+{
+    cpu_locals[0].apic_id = lapic_id();
+    if (!lapic_present() || !tsc_khz() || CONFIG_MAX_CPUS < 2)
+        return 1;
+
+    irq_install_local_handler(IRQ_VECTOR_IPI_RESCHEDULE, smp_reschedule_interrupt);
+    irq_install_local_handler(IRQ_VECTOR_IPI_TICK, smp_tick_interrupt);
+
+    smp_ap_max = CONFIG_MAX_CPUS - 1u;
+    void *stacks = kalloc((size_t)smp_ap_max * CONFIG_SMP_AP_STACK_SIZE);
+    if (!stacks)
+    {
+        klog_warn("smp: no memory for AP stacks");
+        return 1;
+    }
+    smp_ap_stacks = (uint32_t)(uintptr_t)stacks;
+    smp_ap_next = 0;
+
+    uint8_t *trampoline = (uint8_t *)(uintptr_t)CONFIG_SMP_TRAMPOLINE_BASE;
+    size_t length = (size_t)(ap_trampoline_end - ap_trampoline_start);
+    for (size_t i = 0; i < length; ++i)
+        trampoline[i] = ap_trampoline_start[i];
+    struct gdt_pointer *gdtr = (struct gdt_pointer *)(trampoline + (ap_trampoline_gdtr - ap_trampoline_start));
+    *gdtr = gdt_ptr;
+
+    /*
+     * No MADT parser yet, so broadcast the start-up IPIs and count who
+     * answers. Every AP that takes a ticket reports in within microseconds.
+     */
+    uint64_t start = clock_monotonic_ns();
+    lapic_send_init_sipi(CONFIG_SMP_TRAMPOLINE_BASE >> 12);
+    for (;;)
+    {
+        uint64_t elapsed = clock_monotonic_ns() - start;
+        if (elapsed >= SMP_AP_WAIT_NS)
+            break;
+
+        uint32_t tickets = smp_ap_next;
+        if (tickets > smp_ap_max)
+            tickets = smp_ap_max;
+        if (elapsed >= SMP_AP_SETTLE_NS && popcount32(arrived_mask) == tickets)
+            break;
+        __asm__ __volatile__("pause");
+    }
+
+    uint32_t arrived = arrived_mask;
+    for (uint32_t index = 1; index < CONFIG_MAX_CPUS; ++index)
+    {
+        if (!(arrived & (1u << index)))
+            continue;
+        if (process_cpu_init(index) < 0)
+        {
+            klog_warn("smp: no idle thread for an AP; leaving it parked");
+            continue;
+        }
+        __sync_fetch_and_or(&online_mask, 1u << index);
+        cpu_locals[index].online = 1;
+    }
+
+    uint32_t count = smp_cpu_count();
+    klog_info(count > 1u ? "smp: application processors online" : "smp: no application processors answered");
+    return count;
+}
+
+uint32_t smp_cpu_count(void)
+{
+    return popcount32(online_mask);
+}
+
+uint32_t smp_online_mask(void)
+{
+    return online_mask;
+}
+
+struct cpu_local *smp_cpu(uint32_t index)
+{
+    if (index >= CONFIG_MAX_CPUS)
+        return NULL;
+    return &cpu_locals[index];
+}
+
+int smp_other_cpus_busy(void)
+{
+    uint32_t self = smp_cpu_id();
+    uint32_t online = online_mask;
+    for (uint32_t i = 0; i < CONFIG_MAX_CPUS; ++i)
+    {
+        if (i == self || !(online & (1u << i)))
+            continue;
+        if (cpu_locals[i].current != cpu_locals[i].idle)
+            return 1;
+    }
+    return 0;
+}
+
+void smp_send_reschedule(uint32_t index)
+{
+    if (index >= CONFIG_MAX_CPUS || index == smp_cpu_id() || !(online_mask & (1u << index)))
+        return;
+    lapic_send_ipi(cpu_locals[index].apic_id, IRQ_VECTOR_IPI_RESCHEDULE);
+}
+
+void smp_send_tick(uint32_t index)
+{
+    if (index >= CONFIG_MAX_CPUS || index == smp_cpu_id() || !(online_mask & (1u << index)))
+        return;
+    lapic_send_ipi(cpu_locals[index].apic_id, IRQ_VECTOR_IPI_TICK);
+}
@@ -0,0 +1,72 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+struct process;
+
+/**
+ * @brief Per-CPU block addressed through %gs.
+ *
+ * Each CPU loads %gs with a GDT descriptor whose base is its own block, so
+ * cpu_this() is one load and never needs the CPU number first. The
+ * interrupt and syscall stubs leave %gs alone for the same reason.
+ */
+struct cpu_local
+{
+    /** Points at this block; read as %gs:0. */
+    struct cpu_local *self;
+    uint32_t index;
+    uint32_t apic_id;
+    struct process *current;
+    struct process *idle;
+    volatile uint32_t online;
+    uint32_t ipi_resched;
+    uint32_t ipi_tick;
+};
+
+static inline struct cpu_local *cpu_this(void)
+{
+    struct cpu_local *cpu;
+    __asm__ __volatile__("movl %%gs:0, %0" : "=r"(cpu));
+    return cpu;
+}
+
+/* One instruction, so the answer cannot mix two CPUs across a migration. */
+static inline struct process *cpu_current(void)
+{
+    struct process *proc;
+    __asm__ __volatile__("movl %%gs:%c1, %0" : "=r"(proc) : "i"(offsetof(struct cpu_local, current)));
+    return proc;
+}
+
+static inline uint32_t smp_cpu_id(void)
+{
+    uint32_t index;
+    __asm__ __volatile__("movl %%gs:%c1, %0" : "=r"(index) : "i"(offsetof(struct cpu_local, index)));
+    return index;
+}
+
+/** Install the kernel GDT and point %gs at the boot CPU's block; call first in kmain(). */
+void smp_early_init(void);
+/**
+ * @brief Start the application processors with INIT/SIPI.
+ *
+ * Needs the local APIC, a calibrated TSC and an initialised scheduler. Each
+ * AP gets an idle thread and enters its scheduler loop.
+ *
+ * @return the number of CPUs online, 1 when the machine is uniprocessor.
+ */
+uint32_t smp_init(void);
+uint32_t smp_cpu_count(void);
+uint32_t smp_online_mask(void);
+struct cpu_local *smp_cpu(uint32_t index);
+/** @return 1 while any other online CPU runs something other than its idle thread. */
+int smp_other_cpus_busy(void);
+void smp_send_reschedule(uint32_t index);
+void smp_send_tick(uint32_t index);
+
+#endif
@@ -1,43 +1,176 @@
 #include "spinlock.h"
 
-static inline int atomic_test_and_set(volatile int *ptr)
+#include "io.h"
+#include "smp.h"
+
+/* Unnamed, so taking it never recurses into the statistics it protects. */
+static spinlock_t registry_lock;
+static struct lock_class *class_head = NULL;
+static struct lock_class *class_tail = NULL;
+
+static inline void cpu_relax(void)
 {
-    return __sync_lock_test_and_set(ptr, 1);
+    __asm__ __volatile__("pause");
 }
 
-static inline void atomic_clear(volatile int *ptr)
+static inline void compiler_barrier(void)
 {
-    __sync_lock_release(ptr);
+    __asm__ __volatile__("" ::: "memory");
 }
 
-static inline void cpu_relax(void)
+static inline uint64_t lock_clock(void)
 {
-    __asm__ __volatile__("pause");
+#if CONFIG_LOCK_STATS
+    return rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void stat_max(volatile uint64_t *slot, uint64_t value)
+{
+    uint64_t seen = *slot;
+    while (value > seen)
+    {
+        uint64_t prior = __sync_val_compare_and_swap(slot, seen, value);
+        if (prior == seen)
+            break;
+        seen = prior;
+    }
+}
+
+static void lock_class_register(struct lock_class *cls)
+{
+    __sync_fetch_and_add(&cls->instances, 1u);
+    if (cls->registered)
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&registry_lock, &flags);
+    if (!cls->registered)
+    {
+        cls->next = NULL;
+        if (class_tail)
+            class_tail->next = cls;
+        else
+            class_head = cls;
+        class_tail = cls;
+        cls->registered = 1;
+    }
+    spinlock_unlock_irqrestore(&registry_lock, flags);
+}
+
+static void lock_note_acquired(struct lock_class *cls, int contended, uint64_t spun)
+{
+#if CONFIG_LOCK_STATS
+    if (!cls)
+        return;
+    __sync_fetch_and_add(&cls->acquisitions, 1u);
+    if (!contended)
+        return;
+    __sync_fetch_and_add(&cls->contended, 1u);
+    __sync_fetch_and_add(&cls->spin_cycles, spun);
+    stat_max(&cls->max_spin_cycles, spun);
+#else
+    (void)cls;
+    (void)contended;
+    (void)spun;
+#endif
+}
+
+static void lock_note_released(struct lock_class *cls, uint64_t held)
+{
+#if CONFIG_LOCK_STATS
+    if (!cls)
+        return;
+    __sync_fetch_and_add(&cls->hold_cycles, held);
+    stat_max(&cls->max_hold_cycles, held);
+#else
+    (void)cls;
+    (void)held;
+#endif
 }
 
 void spinlock_init(spinlock_t *lock)
 {
     if (!lock)
         return;
-    lock->locked = 0;
+    lock->ticket.word = 0;
+    lock->owner_cpu = LOCK_NO_OWNER;
+    lock->owner_pc = 0;
+    lock->acquired_tsc = 0;
+    lock->cls = NULL;
 }
 
-void spinlock_lock(spinlock_t *lock)
+void spinlock_init_class(spinlock_t *lock, struct lock_class *cls)
 {
-    if (!lock)
+    spinlock_init(lock);
+    if (!lock || !cls)
         return;
-    while (atomic_test_and_set(&lock->locked))
+    lock->cls = cls;
+    lock_class_register(cls);
+}
+
+static void spinlock_acquire(spinlock_t *lock, uintptr_t pc)
+{
+    uint32_t prior = __sync_fetch_and_add(&lock->ticket.word, 1u << 16);
+    uint16_t mine = (uint16_t)(prior >> 16);
+    int contended = ((uint16_t)prior != mine);
+    uint64_t spun = 0;
+
+    if (contended)
     {
-        for (int i = 0; i < CONFIG_STRESS_SPIN_CYCLES; ++i)
+        uint64_t start = lock_clock();
+        while (lock->ticket.half.owner != mine)
             cpu_relax();
+        spun = lock_clock() - start;
     }
+    compiler_barrier();
+
+    lock->owner_cpu = smp_cpu_id();
+    lock->owner_pc = pc;
+    lock->acquired_tsc = lock_clock();
+    lock_note_acquired(lock->cls, contended, spun);
+}
+
+void spinlock_lock(spinlock_t *lock)
+{
+    if (!lock)
+        return;
+    spinlock_acquire(lock, (uintptr_t)__builtin_return_address(0));
+}
+
+int spinlock_trylock(spinlock_t *lock)
+{
+    if (!lock)
+        return 0;
+
+    uint32_t seen = lock->ticket.word;
+    if ((uint16_t)seen != (uint16_t)(seen >> 16))
+        return 0;
+    if (!__sync_bool_compare_and_swap(&lock->ticket.word, seen, seen + (1u << 16)))
+        return 0;
+
+    lock->owner_cpu = smp_cpu_id();
+    lock->owner_pc = (uintptr_t)__builtin_return_address(0);
+    lock->acquired_tsc = lock_clock();
+    lock_note_acquired(lock->cls, 0, 0);
+    return 1;
 }
 
 void spinlock_unlock(spinlock_t *lock)
 {
     if (!lock)
         return;
-    atomic_clear(&lock->locked);
+
+    uint64_t held = lock_clock() - lock->acquired_tsc;
+    struct lock_class *cls = lock->cls;
+    lock->owner_cpu = LOCK_NO_OWNER;
+    lock->owner_pc = 0;
+    compiler_barrier();
+    /* Only the holder writes owner, and x86 stores are not reordered with earlier ones. */
+    lock->ticket.half.owner = (uint16_t)(lock->ticket.half.owner + 1u);
+    lock_note_released(cls, held);
 }
 
 void spinlock_lock_irqsave(spinlock_t *lock, uint32_t *flags)
@@ -50,7 +183,7 @@ void spinlock_lock_irqsave(spinlock_t *lock, uint32_t *flags)
     __asm__ __volatile__("cli" ::: "memory");
     if (flags)
         *flags = state;
-    spinlock_lock(lock);
+    spinlock_acquire(lock, (uintptr_t)__builtin_return_address(0));
 }
 
 void spinlock_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
@@ -60,3 +193,155 @@ void spinlock_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
     spinlock_unlock(lock);
     __asm__ __volatile__("push %0; popf" :: "r"(flags) : "memory");
 }
+
+int spinlock_is_locked(const spinlock_t *lock)
+{
+    if (!lock)
+        return 0;
+    uint32_t seen = lock->ticket.word;
+    return (uint16_t)seen != (uint16_t)(seen >> 16);
+}
+
+void mcs_lock_init(mcs_lock_t *lock)
+{
+    if (!lock)
+        return;
+    lock->tail = NULL;
+    lock->owner_cpu = LOCK_NO_OWNER;
+    lock->owner_pc = 0;
+    lock->acquired_tsc = 0;
+    lock->cls = NULL;
+}
+
+void mcs_lock_init_class(mcs_lock_t *lock, struct lock_class *cls)
+{
+    mcs_lock_init(lock);
+    if (!lock || !cls)
+        return;
+    lock->cls = cls;
+    lock_class_register(cls);
+}
+
+static void mcs_acquire(mcs_lock_t *lock, struct mcs_node *node, uintptr_t pc)
+{
+    node->next = NULL;
+    node->waiting = 1;
+
+    struct mcs_node *prev = __sync_lock_test_and_set(&lock->tail, node);
+    int contended = (prev != NULL);
+    uint64_t spun = 0;
+
+    if (contended)
+    {
+        uint64_t start = lock_clock();
+        prev->next = node;
+        while (node->waiting)
+            cpu_relax();
+        spun = lock_clock() - start;
+    }
+    compiler_barrier();
+
+    lock->owner_cpu = smp_cpu_id();
+    lock->owner_pc = pc;
+    lock->acquired_tsc = lock_clock();
+    lock_note_acquired(lock->cls, contended, spun);
+}
+
+static void mcs_release(mcs_lock_t *lock, struct mcs_node *node)
+{
+    uint64_t held = lock_clock() - lock->acquired_tsc;
+    struct lock_class *cls = lock->cls;
+    lock->owner_cpu = LOCK_NO_OWNER;
+    lock->owner_pc = 0;
+    compiler_barrier();
+
+    struct mcs_node *next = node->next;
+    if (!next)
+    {
+        if (__sync_bool_compare_and_swap(&lock->tail, node, NULL))
+        {
+            lock_note_released(cls, held);
+            return;
+        }
+        /* A waiter swapped itself in but has not linked behind us yet. */
+        while (!(next = node->next))
+            cpu_relax();
+    }
+    next->waiting = 0;
+    lock_note_released(cls, held);
+}
+
+void mcs_lock(mcs_lock_t *lock, struct mcs_node *node)
+{
+    if (!lock || !node)
+        return;
+    mcs_acquire(lock, node, (uintptr_t)__builtin_return_address(0));
+}
+
+void mcs_unlock(mcs_lock_t *lock, struct mcs_node *node)
+{
+    if (!lock || !node)
+        return;
+    mcs_release(lock, node);
+}
+
+void mcs_lock_irqsave(mcs_lock_t *lock, struct mcs_node *node, uint32_t *flags)
+{
+    if (!lock || !node)
+        return;
+
+    uint32_t state;
+    __asm__ __volatile__("pushf; pop %0" : "=r"(state));
+    __asm__ __volatile__("cli" ::: "memory");
+    if (flags)
+        *flags = state;
+    mcs_acquire(lock, node, (uintptr_t)__builtin_return_address(0));
+}
+
+void mcs_unlock_irqrestore(mcs_lock_t *lock, struct mcs_node *node, uint32_t flags)
+{
+    if (!lock || !node)
+        return;
+    mcs_release(lock, node);
+    __asm__ __volatile__("push %0; popf" :: "r"(flags) : "memory");
+}
+
+size_t lock_class_snapshot(struct lock_class_stats *out, size_t capacity)
+{
+    size_t count = 0;
+    uint32_t flags;
+    spinlock_lock_irqsave(&registry_lock, &flags);
+    for (struct lock_class *cls = class_head; cls; cls = cls->next, ++count)
+    {
+        if (!out || count >= capacity)
+            continue;
+        struct lock_class_stats *entry = &out[count];
+        entry->name = cls->name;
+        entry->kind = cls->kind;
+        entry->instances = cls->instances;
+        entry->acquisitions = cls->acquisitions;
+        entry->contended = cls->contended;
+        entry->spin_cycles = cls->spin_cycles;
+        entry->max_spin_cycles = cls->max_spin_cycles;
+        entry->hold_cycles = cls->hold_cycles;
+        entry->max_hold_cycles = cls->max_hold_cycles;
+    }
+    spinlock_unlock_irqrestore(&registry_lock, flags);
+    return count;
+}
+
+void lock_class_reset_stats(void)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&registry_lock, &flags);
+    for (struct lock_class *cls = class_head; cls; cls = cls->next)
+    {
+        cls->acquisitions = 0;
+        cls->contended = 0;
+        cls->spin_cycles = 0;
+        cls->max_spin_cycles = 0;
+        cls->hold_cycles = 0;
+        cls->max_hold_cycles = 0;
+    }
+    spinlock_unlock_irqrestore(&registry_lock, flags);
+}
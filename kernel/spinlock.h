@@ -1,19 +1,147 @@
 #ifndef SPINLOCK_H
 #define SPINLOCK_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "config.h"
 
+#define LOCK_KIND_TICKET 0u
+#define LOCK_KIND_MCS    1u
+
+#define LOCK_NO_OWNER    0xFFFFFFFFu
+
+/**
+ * @brief Statistics shared by every lock initialised at one call site.
+ *
+ * spinlock_init_named() and mcs_lock_init_named() declare one class per
+ * call site, the way a mailbox lock in every process feeds one row of the
+ * `locks` report. Counters are updated atomically because two CPUs may hold
+ * different locks of the same class at once. Cycle counts are TSC cycles.
+ */
+struct lock_class
+{
+    const char *name;
+    uint32_t kind;
+    volatile uint32_t registered;
+    volatile uint32_t instances;
+    volatile uint64_t acquisitions;
+    /** Acquisitions that found the lock held and had to spin. */
+    volatile uint64_t contended;
+    volatile uint64_t spin_cycles;
+    volatile uint64_t max_spin_cycles;
+    volatile uint64_t hold_cycles;
+    volatile uint64_t max_hold_cycles;
+    struct lock_class *next;
+};
+
+#define LOCK_CLASS_INIT(class_name, class_kind) { (class_name), (class_kind), 0, 0, 0, 0, 0, 0, 0, 0, NULL }
+
+/**
+ * @brief FIFO ticket lock.
+ *
+ * Waiters take a ticket and spin until @c owner reaches it, so the lock is
+ * handed over in arrival order and no CPU can starve.
+ */
 typedef struct
 {
-    volatile int locked;
+    union
+    {
+        volatile uint32_t word;
+        struct
+        {
+            volatile uint16_t owner;
+            volatile uint16_t next;
+        } half;
+    } ticket;
+    /** smp_cpu_id() of the holder, or LOCK_NO_OWNER. */
+    volatile uint32_t owner_cpu;
+    /** Return address of the spinlock_lock*() call that took the lock. */
+    uintptr_t owner_pc;
+    uint64_t acquired_tsc;
+    struct lock_class *cls;
 } spinlock_t;
 
+/**
+ * @brief Queue entry for an MCS lock, owned by the caller.
+ *
+ * Each waiter spins on its own node instead of the shared lock word, so a
+ * contended hand-off touches one remote cache line. The node usually lives
+ * on the stack and must stay valid until the matching unlock.
+ */
+struct mcs_node
+{
+    struct mcs_node *volatile next;
+    volatile uint32_t waiting;
+};
+
+typedef struct
+{
+    struct mcs_node *volatile tail;
+    volatile uint32_t owner_cpu;
+    uintptr_t owner_pc;
+    uint64_t acquired_tsc;
+    struct lock_class *cls;
+} mcs_lock_t;
+
+/**
+ * @brief Snapshot of one lock class for the `locks` report.
+ */
+struct lock_class_stats
+{
+    const char *name;
+    uint32_t kind;
+    uint32_t instances;
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t spin_cycles;
+    uint64_t max_spin_cycles;
+    uint64_t hold_cycles;
+    uint64_t max_hold_cycles;
+};
+
+/** Initialise an unnamed lock; it takes part in no statistics. */
 void spinlock_init(spinlock_t *lock);
+/** Initialise @p lock and attach it to @p cls, registering the class on first use. */
+void spinlock_init_class(spinlock_t *lock, struct lock_class *cls);
 void spinlock_lock(spinlock_t *lock);
+/** @return 1 when the lock was taken without waiting, 0 when it is held. */
+int spinlock_trylock(spinlock_t *lock);
 void spinlock_unlock(spinlock_t *lock);
 void spinlock_lock_irqsave(spinlock_t *lock, uint32_t *flags);
 void spinlock_unlock_irqrestore(spinlock_t *lock, uint32_t flags);
+/** @return 1 while any CPU holds @p lock. */
+int spinlock_is_locked(const spinlock_t *lock);
+
+void mcs_lock_init(mcs_lock_t *lock);
+void mcs_lock_init_class(mcs_lock_t *lock, struct lock_class *cls);
+void mcs_lock(mcs_lock_t *lock, struct mcs_node *node);
+void mcs_unlock(mcs_lock_t *lock, struct mcs_node *node);
+void mcs_lock_irqsave(mcs_lock_t *lock, struct mcs_node *node, uint32_t *flags);
+void mcs_unlock_irqrestore(mcs_lock_t *lock, struct mcs_node *node, uint32_t flags);
+
+/** Initialise a lock whose statistics appear under @p name in the `locks` report. */
+#define spinlock_init_named(lock, name)                                                      \
+    do                                                                                       \
+    {                                                                                        \
+        static struct lock_class spinlock_class__ = LOCK_CLASS_INIT(name, LOCK_KIND_TICKET); \
+        spinlock_init_class((lock), &spinlock_class__);                                      \
+    } while (0)
+
+#define mcs_lock_init_named(lock, name)                                                      \
+    do                                                                                       \
+    {                                                                                        \
+        static struct lock_class mcs_class__ = LOCK_CLASS_INIT(name, LOCK_KIND_MCS);         \
+        mcs_lock_init_class((lock), &mcs_class__);                                           \
+    } while (0)
+
+/**
+ * @brief Copy the registered lock classes into @p out, in registration order.
+ *
+ * @return the number of classes registered, which may exceed @p capacity.
+ */
+size_t lock_class_snapshot(struct lock_class_stats *out, size_t capacity);
+/** Zero the counters of every registered class. */
+void lock_class_reset_stats(void);
 
 #endif
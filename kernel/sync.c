@@ -2,99 +2,205 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "config.h"
+#include "io.h"
+#include "tsc.h"
 
 #include <stddef.h>
 
+/* Lives on the waiting thread's stack for as long as it is queued. */
+struct sync_waiter
+{
+    struct process *proc;
+    struct sync_waiter *next;
+    uint64_t queued_tsc;
+    /* Set by the releasing side once the mutex or a count is ours. */
+    volatile int granted;
+};
+
+struct sync_wait_queue
+{
+    struct sync_waiter *head;
+    struct sync_waiter *tail;
+    uint32_t length;
+};
+
 struct sync_mutex
 {
+    spinlock_t lock;
     int used;
     int locked;
     pid_t owner;
-    pid_t waiters[CONFIG_SYNC_MAX_WAITERS];
-    uint8_t wait_count;
+    struct sync_wait_queue waiters;
+    uint64_t acquired_tsc;
+    uint32_t acquisitions;
+    uint32_t contended;
+    uint64_t wait_cycles;
+    uint64_t max_wait_cycles;
+    uint64_t hold_cycles;
+    uint64_t max_hold_cycles;
 };
 
 struct sync_semaphore
 {
+    spinlock_t lock;
     int used;
     int count;
-    pid_t waiters[CONFIG_SYNC_MAX_WAITERS];
-    uint8_t wait_count;
+    struct sync_wait_queue waiters;
 };
 
 static struct sync_mutex mutexes[CONFIG_SYNC_MAX_MUTEXES];
 static struct sync_semaphore semaphores[CONFIG_SYNC_MAX_SEMAPHORES];
-static spinlock_t sync_lock;
+/* Guards only the used flags while an object is handed out. */
+static spinlock_t table_lock;
+
+static void wait_queue_init(struct sync_wait_queue *queue)
+{
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->length = 0;
+}
+
+static void wait_queue_push(struct sync_wait_queue *queue, struct sync_waiter *waiter)
+{
+    waiter->next = NULL;
+    if (queue->tail)
+        queue->tail->next = waiter;
+    else
+        queue->head = waiter;
+    queue->tail = waiter;
+    ++queue->length;
+}
+
+static struct sync_waiter *wait_queue_pop(struct sync_wait_queue *queue)
+{
+    struct sync_waiter *waiter = queue->head;
+    if (!waiter)
+        return NULL;
+    queue->head = waiter->next;
+    if (!queue->head)
+        queue->tail = NULL;
+    --queue->length;
+    waiter->next = NULL;
+    return waiter;
+}
+
+/* Sleep until the releasing side sets granted; other wakeups just loop. */
+static void wait_until_granted(struct sync_waiter *waiter)
+{
+    while (!waiter->granted)
+        process_block_current();
+}
+
+static void mutex_reset_stats(struct sync_mutex *mtx)
+{
+    mtx->acquisitions = 0;
+    mtx->contended = 0;
+    mtx->wait_cycles = 0;
+    mtx->max_wait_cycles = 0;
+    mtx->hold_cycles = 0;
+    mtx->max_hold_cycles = 0;
+}
 
-static int waiter_exists(pid_t *list, uint8_t count, pid_t pid)
+/* Lend every waiter's urgency to @p owner while it still holds @p mtx. */
+static void mutex_lend_waiters(struct sync_mutex *mtx, struct process *owner)
 {
-    for (uint8_t i = 0; i < count; ++i)
+    uint32_t flags;
+    spinlock_lock_irqsave(&mtx->lock, &flags);
+    if (mtx->used && mtx->locked && mtx->owner == owner->pid)
     {
-        if (list[i] == pid)
-            return 1;
+        for (struct sync_waiter *waiter = mtx->waiters.head; waiter; waiter = waiter->next)
+            process_inherit(owner, waiter->proc);
     }
-    return 0;
+    spinlock_unlock_irqrestore(&mtx->lock, flags);
 }
 
-static int enqueue_waiter(pid_t *list, uint8_t *count, pid_t pid)
+/*
+ * Boost the owner of the mutex @p donor just queued on, then follow the
+ * chain while each owner is itself waiting. Only one mutex lock is held at
+ * a time, so chains cannot deadlock against each other; a boost that races
+ * with an unlock is undone by that unlock's refresh.
+ */
+static void mutex_propagate(pid_t owner_pid, struct process *donor)
 {
-    if (!list || !count)
-        return -1;
-    if (*count >= CONFIG_SYNC_MAX_WAITERS)
-        return -1;
-    list[*count] = pid;
-    ++(*count);
-    return 0;
+    for (uint32_t depth = 0; depth < CONFIG_SYNC_PI_MAX_DEPTH && owner_pid > 0; ++depth)
+    {
+        struct process *owner = process_lookup(owner_pid);
+        if (!owner || owner == donor)
+            return;
+        process_inherit(owner, donor);
+
+        struct sync_mutex *next = owner->pi_blocked_on;
+        if (!next)
+            return;
+
+        uint32_t flags;
+        spinlock_lock_irqsave(&next->lock, &flags);
+        owner_pid = next->locked ? next->owner : -1;
+        spinlock_unlock_irqrestore(&next->lock, flags);
+    }
 }
 
-static pid_t dequeue_waiter(pid_t *list, uint8_t *count)
+/* After an unlock: drop inherited urgency, then take it again from mutexes still held. */
+static void mutex_refresh_inheritance(struct process *self)
 {
-    if (!list || !count || *count == 0)
-        return -1;
-    pid_t pid = list[0];
-    for (uint8_t i = 1; i < *count; ++i)
-        list[i - 1] = list[i];
-    --(*count);
-    return pid;
+    if (!self->pi_boosted)
+        return;
+
+    process_inherit_reset(self);
+    for (int i = 0; i < CONFIG_SYNC_MAX_MUTEXES; ++i)
+    {
+        if (mutexes[i].used && mutexes[i].locked && mutexes[i].owner == self->pid)
+            mutex_lend_waiters(&mutexes[i], self);
+    }
 }
 
 void sync_init(void)
 {
-    spinlock_init(&sync_lock);
+    spinlock_init_named(&table_lock, "sync.table");
     for (int i = 0; i < CONFIG_SYNC_MAX_MUTEXES; ++i)
     {
+        spinlock_init_named(&mutexes[i].lock, "sync.mutex");
         mutexes[i].used = 0;
         mutexes[i].locked = 0;
         mutexes[i].owner = -1;
-        mutexes[i].wait_count = 0;
+        wait_queue_init(&mutexes[i].waiters);
+        mutexes[i].acquired_tsc = 0;
+        mutex_reset_stats(&mutexes[i]);
     }
     for (int i = 0; i < CONFIG_SYNC_MAX_SEMAPHORES; ++i)
     {
+        spinlock_init_named(&semaphores[i].lock, "sync.semaphore");
         semaphores[i].used = 0;
         semaphores[i].count = 0;
-        semaphores[i].wait_count = 0;
+        wait_queue_init(&semaphores[i].waiters);
     }
 }
 
 int sync_mutex_create(void)
 {
     uint32_t flags;
-    spinlock_lock_irqsave(&sync_lock, &flags);
+    spinlock_lock_irqsave(&table_lock, &flags);
 
     for (int i = 0; i < CONFIG_SYNC_MAX_MUTEXES; ++i)
     {
-        if (!mutexes[i].used)
-        {
-            mutexes[i].used = 1;
-            mutexes[i].locked = 0;
-            mutexes[i].owner = -1;
-            mutexes[i].wait_count = 0;
-            spinlock_unlock_irqrestore(&sync_lock, flags);
-            return i;
-        }
+        struct sync_mutex *mtx = &mutexes[i];
+        if (mtx->used)
+            continue;
+
+        uint32_t mtx_flags;
+        spinlock_lock_irqsave(&mtx->lock, &mtx_flags);
+        mtx->locked = 0;
+        mtx->owner = -1;
+        wait_queue_init(&mtx->waiters);
+        mutex_reset_stats(mtx);
+        mtx->used = 1;
+        spinlock_unlock_irqrestore(&mtx->lock, mtx_flags);
+
+        spinlock_unlock_irqrestore(&table_lock, flags);
+        return i;
     }
 
-    spinlock_unlock_irqrestore(&sync_lock, flags);
+    spinlock_unlock_irqrestore(&table_lock, flags);
     return -1;
 }
 
@@ -107,40 +213,46 @@ int sync_mutex_lock(int id)
     if (!current)
         return -1;
 
-    pid_t self = current->pid;
+    struct sync_mutex *mtx = &mutexes[id];
+    uint32_t flags;
+    spinlock_lock_irqsave(&mtx->lock, &flags);
 
-    while (1)
+    if (!mtx->used)
     {
-        uint32_t flags;
-        spinlock_lock_irqsave(&sync_lock, &flags);
-
-        struct sync_mutex *mtx = &mutexes[id];
-        if (!mtx->used)
-        {
-            spinlock_unlock_irqrestore(&sync_lock, flags);
-            return -1;
-        }
-
-        if (!mtx->locked)
-        {
-            mtx->locked = 1;
-            mtx->owner = self;
-            spinlock_unlock_irqrestore(&sync_lock, flags);
-            return 0;
-        }
-
-        if (mtx->owner == self)
-        {
-            spinlock_unlock_irqrestore(&sync_lock, flags);
-            return 0;
-        }
+        spinlock_unlock_irqrestore(&mtx->lock, flags);
+        return -1;
+    }
 
-        if (!waiter_exists(mtx->waiters, mtx->wait_count, self))
-            enqueue_waiter(mtx->waiters, &mtx->wait_count, self);
+    if (!mtx->locked)
+    {
+        mtx->locked = 1;
+        mtx->owner = current->pid;
+        mtx->acquired_tsc = rdtsc();
+        ++mtx->acquisitions;
+        spinlock_unlock_irqrestore(&mtx->lock, flags);
+        return 0;
+    }
 
-        spinlock_unlock_irqrestore(&sync_lock, flags);
-        process_block_current();
+    if (mtx->owner == current->pid)
+    {
+        spinlock_unlock_irqrestore(&mtx->lock, flags);
+        return 0;
     }
+
+    struct sync_waiter waiter;
+    waiter.proc = current;
+    waiter.queued_tsc = rdtsc();
+    waiter.granted = 0;
+    wait_queue_push(&mtx->waiters, &waiter);
+    ++mtx->contended;
+    current->pi_blocked_on = mtx;
+    pid_t owner = mtx->owner;
+    spinlock_unlock_irqrestore(&mtx->lock, flags);
+
+    mutex_propagate(owner, current);
+    wait_until_granted(&waiter);
+    current->pi_blocked_on = NULL;
+    return 0;
 }
 
 int sync_mutex_unlock(int id)
@@ -152,25 +264,36 @@ int sync_mutex_unlock(int id)
     if (!current)
         return -1;
 
-    pid_t self = current->pid;
-
-    pid_t wake_pid = -1;
-
+    struct sync_mutex *mtx = &mutexes[id];
     uint32_t flags;
-    spinlock_lock_irqsave(&sync_lock, &flags);
+    spinlock_lock_irqsave(&mtx->lock, &flags);
 
-    struct sync_mutex *mtx = &mutexes[id];
-    if (!mtx->used || !mtx->locked || mtx->owner != self)
+    if (!mtx->used || !mtx->locked || mtx->owner != current->pid)
     {
-        spinlock_unlock_irqrestore(&sync_lock, flags);
+        spinlock_unlock_irqrestore(&mtx->lock, flags);
         return -1;
     }
 
-    if (mtx->wait_count > 0)
+    uint64_t now = rdtsc();
+    uint64_t held = now - mtx->acquired_tsc;
+    mtx->hold_cycles += held;
+    if (held > mtx->max_hold_cycles)
+        mtx->max_hold_cycles = held;
+
+    struct process *next_owner = NULL;
+    struct sync_waiter *waiter = wait_queue_pop(&mtx->waiters);
+    if (waiter)
     {
-        wake_pid = dequeue_waiter(mtx->waiters, &mtx->wait_count);
-        mtx->owner = wake_pid;
-        mtx->locked = 1;
+        /* Hand over directly so a running thread cannot barge in ahead of the queue. */
+        uint64_t waited = now - waiter->queued_tsc;
+        mtx->wait_cycles += waited;
+        if (waited > mtx->max_wait_cycles)
+            mtx->max_wait_cycles = waited;
+        next_owner = waiter->proc;
+        mtx->owner = next_owner->pid;
+        mtx->acquired_tsc = now;
+        ++mtx->acquisitions;
+        waiter->granted = 1;
     }
     else
     {
@@ -178,13 +301,13 @@ int sync_mutex_unlock(int id)
         mtx->owner = -1;
     }
 
-    spinlock_unlock_irqrestore(&sync_lock, flags);
+    spinlock_unlock_irqrestore(&mtx->lock, flags);
 
-    if (wake_pid > 0)
+    mutex_refresh_inheritance(current);
+    if (next_owner)
     {
-        struct process *target = process_lookup(wake_pid);
-        if (target)
-            process_wake(target);
+        mutex_lend_waiters(mtx, next_owner);
+        process_wake(next_owner);
     }
 
     return 0;
@@ -196,21 +319,26 @@ int sync_semaphore_create(int initial_count)
         return -1;
 
     uint32_t flags;
-    spinlock_lock_irqsave(&sync_lock, &flags);
+    spinlock_lock_irqsave(&table_lock, &flags);
 
     for (int i = 0; i < CONFIG_SYNC_MAX_SEMAPHORES; ++i)
     {
-        if (!semaphores[i].used)
-        {
-            semaphores[i].used = 1;
-            semaphores[i].count = initial_count;
-            semaphores[i].wait_count = 0;
-            spinlock_unlock_irqrestore(&sync_lock, flags);
-            return i;
-        }
+        struct sync_semaphore *sem = &semaphores[i];
+        if (sem->used)
+            continue;
+
+        uint32_t sem_flags;
+        spinlock_lock_irqsave(&sem->lock, &sem_flags);
+        sem->count = initial_count;
+        wait_queue_init(&sem->waiters);
+        sem->used = 1;
+        spinlock_unlock_irqrestore(&sem->lock, sem_flags);
+
+        spinlock_unlock_irqrestore(&table_lock, flags);
+        return i;
     }
 
-    spinlock_unlock_irqrestore(&sync_lock, flags);
+    spinlock_unlock_irqrestore(&table_lock, flags);
     return -1;
 }
 
@@ -223,33 +351,32 @@ int sync_semaphore_wait(int id)
     if (!current)
         return -1;
 
-    pid_t self = current->pid;
+    struct sync_semaphore *sem = &semaphores[id];
+    uint32_t flags;
+    spinlock_lock_irqsave(&sem->lock, &flags);
 
-    while (1)
+    if (!sem->used)
     {
-        uint32_t flags;
-        spinlock_lock_irqsave(&sync_lock, &flags);
-
-        struct sync_semaphore *sem = &semaphores[id];
-        if (!sem->used)
-        {
-            spinlock_unlock_irqrestore(&sync_lock, flags);
-            return -1;
-        }
+        spinlock_unlock_irqrestore(&sem->lock, flags);
+        return -1;
+    }
 
-        if (sem->count > 0)
-        {
-            sem->count -= 1;
-            spinlock_unlock_irqrestore(&sync_lock, flags);
-            return 0;
-        }
+    if (sem->count > 0)
+    {
+        sem->count -= 1;
+        spinlock_unlock_irqrestore(&sem->lock, flags);
+        return 0;
+    }
 
-        if (!waiter_exists(sem->waiters, sem->wait_count, self))
-            enqueue_waiter(sem->waiters, &sem->wait_count, self);
+    struct sync_waiter waiter;
+    waiter.proc = current;
+    waiter.queued_tsc = 0;
+    waiter.granted = 0;
+    wait_queue_push(&sem->waiters, &waiter);
+    spinlock_unlock_irqrestore(&sem->lock, flags);
 
-        spinlock_unlock_irqrestore(&sync_lock, flags);
-        process_block_current();
-    }
+    wait_until_granted(&waiter);
+    return 0;
 }
 
 int sync_semaphore_post(int id)
@@ -257,35 +384,80 @@ int sync_semaphore_post(int id)
     if (id < 0 || id >= CONFIG_SYNC_MAX_SEMAPHORES)
         return -1;
 
-    pid_t wake_pid = -1;
-
+    struct sync_semaphore *sem = &semaphores[id];
     uint32_t flags;
-    spinlock_lock_irqsave(&sync_lock, &flags);
+    spinlock_lock_irqsave(&sem->lock, &flags);
 
-    struct sync_semaphore *sem = &semaphores[id];
     if (!sem->used)
     {
-        spinlock_unlock_irqrestore(&sync_lock, flags);
+        spinlock_unlock_irqrestore(&sem->lock, flags);
         return -1;
     }
 
-    if (sem->wait_count > 0)
+    struct process *wake = NULL;
+    struct sync_waiter *waiter = wait_queue_pop(&sem->waiters);
+    if (waiter)
     {
-        wake_pid = dequeue_waiter(sem->waiters, &sem->wait_count);
+        /* The count goes straight to the oldest waiter instead of through sem->count. */
+        wake = waiter->proc;
+        waiter->granted = 1;
     }
     else
     {
         sem->count += 1;
     }
 
-    spinlock_unlock_irqrestore(&sync_lock, flags);
+    spinlock_unlock_irqrestore(&sem->lock, flags);
 
-    if (wake_pid > 0)
+    if (wake)
+        process_wake(wake);
+
+    return 0;
+}
+
+size_t sync_mutex_snapshot(struct sync_mutex_stats *out, size_t capacity)
+{
+    size_t count = 0;
+    for (int i = 0; i < CONFIG_SYNC_MAX_MUTEXES; ++i)
     {
-        struct process *target = process_lookup(wake_pid);
-        if (target)
-            process_wake(target);
+        struct sync_mutex *mtx = &mutexes[i];
+        if (!mtx->used)
+            continue;
+        if (!out || count >= capacity)
+        {
+            ++count;
+            continue;
+        }
+
+        struct sync_mutex_stats *entry = &out[count++];
+        uint32_t flags;
+        spinlock_lock_irqsave(&mtx->lock, &flags);
+        entry->id = i;
+        entry->owner = mtx->locked ? mtx->owner : 0;
+        entry->waiters = mtx->waiters.length;
+        entry->acquisitions = mtx->acquisitions;
+        entry->contended = mtx->contended;
+        uint64_t wait = mtx->wait_cycles;
+        uint64_t max_wait = mtx->max_wait_cycles;
+        uint64_t hold = mtx->hold_cycles;
+        uint64_t max_hold = mtx->max_hold_cycles;
+        spinlock_unlock_irqrestore(&mtx->lock, flags);
+
+        entry->wait_ns = tsc_to_ns(wait);
+        entry->max_wait_ns = tsc_to_ns(max_wait);
+        entry->hold_ns = tsc_to_ns(hold);
+        entry->max_hold_ns = tsc_to_ns(max_hold);
     }
+    return count;
+}
 
-    return 0;
+void sync_reset_stats(void)
+{
+    for (int i = 0; i < CONFIG_SYNC_MAX_MUTEXES; ++i)
+    {
+        uint32_t flags;
+        spinlock_lock_irqsave(&mutexes[i].lock, &flags);
+        mutex_reset_stats(&mutexes[i]);
+        spinlock_unlock_irqrestore(&mutexes[i].lock, flags);
+    }
 }
@@ -1,16 +1,47 @@
 #ifndef SYNC_H
 #define SYNC_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+/**
+ * @brief Counters for one mutex, as reported in /System/sync.
+ *
+ * Wait time runs from queueing until ownership is handed over; hold time
+ * from acquisition to unlock.
+ */
+struct sync_mutex_stats
+{
+    int id;
+    int owner;
+    uint32_t waiters;
+    uint32_t acquisitions;
+    uint32_t contended;
+    uint64_t wait_ns;
+    uint64_t max_wait_ns;
+    uint64_t hold_ns;
+    uint64_t max_hold_ns;
+};
+
 void sync_init(void);
 
 int sync_mutex_create(void);
+/**
+ * @brief Acquire mutex @p id, sleeping in FIFO order while it is held.
+ *
+ * A waiter lends its urgency to the owner (and to the owner's owner, up to
+ * CONFIG_SYNC_PI_MAX_DEPTH steps) through process_inherit() until unlock.
+ */
 int sync_mutex_lock(int id);
+/** Release mutex @p id, handing it straight to the longest waiter. */
 int sync_mutex_unlock(int id);
 
 int sync_semaphore_create(int initial_count);
 int sync_semaphore_wait(int id);
 int sync_semaphore_post(int id);
 
+/** @return the number of mutexes in use, copying up to @p capacity of them. */
+size_t sync_mutex_snapshot(struct sync_mutex_stats *out, size_t capacity);
+void sync_reset_stats(void);
+
 #endif
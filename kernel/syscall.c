@@ -6,6 +6,14 @@
 #include "ipc.h"
 #include "service.h"
 #include "sync.h"
+#include "futex.h"
+#include "evset.h"
+#include "net_socket.h"
+#include "uring.h"
+#include "uaccess.h"
+#include "clock.h"
+#include "smp.h"
+#include "io.h"
 
 #include "config.h"
 
@@ -18,20 +26,32 @@ struct syscall_entry
     const char *name;
 };
 
+#define MSR_SYSENTER_CS  0x174u
+#define MSR_SYSENTER_ESP 0x175u
+#define MSR_SYSENTER_EIP 0x176u
+#define CPUID_EDX_SEP    (1u << 11)
+#define SYSENTER_STACK_SIZE 256u
+
+struct syscall_counters
+{
+    volatile uint64_t calls;
+    volatile uint64_t errors;
+    volatile uint64_t cycles;
+    volatile uint64_t max_cycles;
+    volatile uint32_t latency_hist[SYSCALL_LATENCY_BUCKETS];
+};
+
 static struct syscall_entry syscall_table[SYSCALL_TABLE_SIZE];
+static struct syscall_counters syscall_counters[SYSCALL_TABLE_SIZE];
 static spinlock_t syscall_lock;
 
-static void copy_to_user(char *dst, const char *src, size_t len)
-{
-    for (size_t i = 0; i < len; ++i)
-        dst[i] = src[i];
-}
+uint32_t syscall_fast_enabled = 0;
 
-static void copy_from_user(char *dst, const char *src, size_t len)
-{
-    for (size_t i = 0; i < len; ++i)
-        dst[i] = src[i];
-}
+/* The entry stub moves straight back to the caller's stack; this only catches an NMI in between. */
+static uint8_t sysenter_stacks[CONFIG_MAX_CPUS][SYSENTER_STACK_SIZE] __attribute__((aligned(16)));
+
+extern void syscall_sysenter_entry(void);
+int32_t syscall_fast_dispatch(uint32_t number_argc, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3) __attribute__((used));
 
 int syscall_validate_user_pointer(const void *ptr)
 {
@@ -70,11 +90,14 @@ static int32_t sys_write_handler(struct syscall_envelope *msg)
     if (!syscall_validate_user_buffer(buf, len))
         return -1;
 
-    for (size_t i = 0; i < len; ++i)
+    char chunk[64];
+    for (size_t done = 0; done < len; done += sizeof(chunk))
     {
-        char ch;
-        copy_from_user(&ch, buf + i, 1);
-        vga_write_char(ch);
+        size_t part = (len - done < sizeof(chunk)) ? len - done : sizeof(chunk);
+        if (copy_from_user(chunk, buf + done, part) < 0)
+            return -EFAULT;
+        for (size_t i = 0; i < part; ++i)
+            vga_write_char(chunk[i]);
     }
 
     return (int32_t)len;
@@ -109,6 +132,38 @@ static int32_t sys_sleep_handler(struct syscall_envelope *msg)
     return 0;
 }
 
+static int32_t sys_sleep_ns_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 2)
+        return -1;
+
+    uint64_t ns = ((uint64_t)msg->args[1] << 32) | msg->args[0];
+    process_sleep_ns(ns);
+    return 0;
+}
+
+static int32_t sys_clock_get_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 2)
+        return -1;
+
+    uint32_t clock_id = msg->args[0];
+    uint64_t *out = (uint64_t *)(uintptr_t)msg->args[1];
+    if (clock_id != CLOCK_MONOTONIC && clock_id != CLOCK_REALTIME)
+        return -1;
+    if (!syscall_validate_user_buffer(out, sizeof(*out)))
+        return -1;
+
+    uint64_t now = (clock_id == CLOCK_REALTIME) ? clock_realtime_ns() : clock_monotonic_ns();
+    return copy_to_user(out, &now, sizeof(now));
+}
+
+static int32_t sys_time_page_handler(struct syscall_envelope *msg)
+{
+    (void)msg;
+    return (int32_t)(uintptr_t)clock_time_page();
+}
+
 static int32_t sys_ipc_send_handler(struct syscall_envelope *msg)
 {
     if (msg->argc < 3)
@@ -123,11 +178,8 @@ static int32_t sys_ipc_send_handler(struct syscall_envelope *msg)
     if (size > 0 && !syscall_validate_user_buffer(buffer, size))
         return -1;
 
-    uint8_t local[CONFIG_MSG_DATA_MAX];
-    if (size > 0)
-        copy_from_user((char *)local, (const char *)buffer, size);
-
-    return ipc_send(target, (size > 0) ? local : NULL, size);
+    /* ipc_send() copies with fault fixups, so the buffer goes straight through. */
+    return ipc_send(target, (size > 0) ? buffer : NULL, size);
 }
 
 static int32_t sys_ipc_recv_handler(struct syscall_envelope *msg)
@@ -138,29 +190,72 @@ static int32_t sys_ipc_recv_handler(struct syscall_envelope *msg)
     pid_t source = (pid_t)msg->args[0];
     void *buffer = (void *)(uintptr_t)msg->args[1];
     size_t max = (size_t)msg->args[2];
+    uint32_t timeout_ticks = (msg->argc > 3) ? msg->args[3] : 0;
+    pid_t *out_sender = (msg->argc > 4) ? (pid_t *)(uintptr_t)msg->args[4] : NULL;
 
     if (max > 0 && !syscall_validate_user_buffer(buffer, max))
         return -1;
+    if (out_sender && !syscall_validate_user_buffer(out_sender, sizeof(*out_sender)))
+        return -1;
 
-    size_t scratch_cap = (max > CONFIG_MSG_DATA_MAX) ? CONFIG_MSG_DATA_MAX : max;
-    uint8_t scratch[CONFIG_MSG_DATA_MAX];
-    uint8_t *recv_buf = (scratch_cap > 0) ? scratch : NULL;
+    /* Delivered straight into the caller's buffer; a fault there comes back as -EFAULT. */
+    return ipc_recv_from(source, (max > 0) ? buffer : NULL, max, timeout_ticks, out_sender);
+}
 
-    int rc = ipc_recv(source, recv_buf, scratch_cap);
-    if (rc <= 0)
-        return rc;
+/* Buffers are handed to ipc_call() as-is so the request is copied only once. */
+static int32_t sys_ipc_call_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 5)
+        return -1;
 
-    if (buffer && max > 0 && recv_buf)
-    {
-        size_t available = (size_t)rc;
-        size_t copy_len = (available > max) ? max : available;
-        if (copy_len > scratch_cap)
-            copy_len = scratch_cap;
-        if (copy_len > 0)
-            copy_to_user((char *)buffer, (const char *)recv_buf, copy_len);
-    }
+    pid_t target = (pid_t)msg->args[0];
+    const void *request = (const void *)(uintptr_t)msg->args[1];
+    size_t request_size = (size_t)msg->args[2];
+    void *reply = (void *)(uintptr_t)msg->args[3];
+    size_t reply_max = (size_t)msg->args[4];
+
+    if (!syscall_validate_user_buffer(request, request_size))
+        return -1;
+    if (!syscall_validate_user_buffer(reply, reply_max))
+        return -1;
+    return ipc_call(target, request, request_size, reply, reply_max);
+}
+
+static int32_t sys_ipc_reply_wait_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 6)
+        return -1;
 
-    return rc;
+    pid_t client = (pid_t)msg->args[0];
+    const void *reply = (const void *)(uintptr_t)msg->args[1];
+    size_t reply_size = (size_t)msg->args[2];
+    pid_t *out_client = (pid_t *)(uintptr_t)msg->args[3];
+    void *buffer = (void *)(uintptr_t)msg->args[4];
+    size_t max = (size_t)msg->args[5];
+
+    if (!syscall_validate_user_buffer(reply, reply_size))
+        return -1;
+    if (out_client && !syscall_validate_user_buffer(out_client, sizeof(*out_client)))
+        return -1;
+    if (!syscall_validate_user_buffer(buffer, max))
+        return -1;
+    return ipc_reply_wait(client, reply, reply_size, out_client, buffer, max);
+}
+
+static int32_t sys_ipc_accept_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 3)
+        return -1;
+
+    pid_t *out_client = (pid_t *)(uintptr_t)msg->args[0];
+    void *buffer = (void *)(uintptr_t)msg->args[1];
+    size_t max = (size_t)msg->args[2];
+
+    if (!syscall_validate_user_buffer(out_client, sizeof(*out_client)))
+        return -1;
+    if (!syscall_validate_user_buffer(buffer, max))
+        return -1;
+    return ipc_accept(out_client, buffer, max);
 }
 
 static int32_t sys_ipc_share_handler(struct syscall_envelope *msg)
@@ -186,6 +281,115 @@ static int32_t sys_ipc_share_handler(struct syscall_envelope *msg)
     return ipc_share(target, addr, pages);
 }
 
+static int32_t sys_ring_create_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 4)
+        return -1;
+
+    pid_t peer = (pid_t)msg->args[0];
+    void *addr = (void *)(uintptr_t)msg->args[1];
+    size_t pages = (size_t)msg->args[2];
+    uint32_t ring_flags = (msg->argc > 4) ? msg->args[4] : 0;
+
+    if (pages == 0 || pages > CONFIG_USER_SPACE_LIMIT / CONFIG_IPC_PAGE_SIZE)
+        return -1;
+    if (!syscall_validate_user_buffer(addr, pages * (size_t)CONFIG_IPC_PAGE_SIZE))
+        return -1;
+    return ipc_ring_create(peer, addr, pages, msg->args[3], ring_flags);
+}
+
+static int32_t sys_ring_attach_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 1)
+        return -1;
+
+    void *ring = ipc_ring_attach((int)msg->args[0]);
+    return ring ? (int32_t)(uintptr_t)ring : -1;
+}
+
+static int32_t sys_ring_doorbell_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 1)
+        return -1;
+    return ipc_ring_doorbell((int)msg->args[0]);
+}
+
+static int32_t sys_ring_wait_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 1)
+        return -1;
+
+    uint32_t timeout = (msg->argc > 1) ? msg->args[1] : 0;
+    return ipc_ring_wait((int)msg->args[0], timeout);
+}
+
+static int32_t sys_evset_create_handler(struct syscall_envelope *msg)
+{
+    (void)msg;
+    return evset_create();
+}
+
+static int32_t sys_evset_add_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 3)
+        return -1;
+
+    uint32_t cookie = (msg->argc > 3) ? msg->args[3] : 0;
+    return evset_add((int)msg->args[0], msg->args[1], (int32_t)msg->args[2], cookie);
+}
+
+static int32_t sys_evset_remove_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 3)
+        return -1;
+    return evset_remove((int)msg->args[0], msg->args[1], (int32_t)msg->args[2]);
+}
+
+static int32_t sys_evset_wait_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 3)
+        return -1;
+
+    struct evset_event *events = (struct evset_event *)(uintptr_t)msg->args[1];
+    size_t max = (size_t)msg->args[2];
+    uint32_t timeout = (msg->argc > 3) ? msg->args[3] : 0;
+    if (max == 0 || max > CONFIG_EVSET_MAX_SOURCES)
+        return -1;
+    if (!syscall_validate_user_buffer(events, max * sizeof(*events)))
+        return -1;
+    return evset_wait((int)msg->args[0], events, max, timeout);
+}
+
+static int32_t sys_net_open_handler(struct syscall_envelope *msg)
+{
+    (void)msg;
+    return net_open();
+}
+
+static int32_t sys_net_send_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 3)
+        return -1;
+
+    const void *data = (const void *)(uintptr_t)msg->args[1];
+    size_t size = (size_t)msg->args[2];
+    if (!syscall_validate_user_buffer(data, size))
+        return -1;
+    return net_send((int)msg->args[0], data, size);
+}
+
+static int32_t sys_net_recv_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 3)
+        return -1;
+
+    void *buffer = (void *)(uintptr_t)msg->args[1];
+    size_t max = (size_t)msg->args[2];
+    if (!syscall_validate_user_buffer(buffer, max))
+        return -1;
+    return net_recv((int)msg->args[0], buffer, max);
+}
+
 static int32_t sys_service_connect_handler(struct syscall_envelope *msg)
 {
     if (msg->argc < 2)
@@ -217,7 +421,8 @@ static int32_t sys_send_handler(struct syscall_envelope *msg)
         return -1;
 
     struct ipc_message local;
-    copy_from_user((char *)&local, (const char *)user_message, sizeof(struct ipc_message));
+    if (copy_from_user(&local, user_message, sizeof(struct ipc_message)) < 0)
+        return -EFAULT;
 
     if (local.size > CONFIG_MSG_DATA_MAX)
         return -1;
@@ -227,7 +432,8 @@ static int32_t sys_send_handler(struct syscall_envelope *msg)
     {
         if (!syscall_validate_user_buffer(local.data, local.size))
             return -1;
-        copy_from_user((char *)data_buf, (const char *)local.data, local.size);
+        if (copy_from_user(data_buf, local.data, local.size) < 0)
+            return -EFAULT;
     }
 
     struct process *sender = process_current();
@@ -245,12 +451,14 @@ static int32_t sys_recv_handler(struct syscall_envelope *msg)
     int channel_id = (int)msg->args[0];
     struct ipc_message *user_message = (struct ipc_message *)(uintptr_t)msg->args[1];
     uint32_t flags = msg->args[2];
+    uint32_t timeout_ticks = (msg->argc > 3) ? msg->args[3] : 0;
 
     if (!syscall_validate_user_buffer(user_message, sizeof(struct ipc_message)))
         return -1;
 
     struct ipc_message request;
-    copy_from_user((char *)&request, (const char *)user_message, sizeof(struct ipc_message));
+    if (copy_from_user(&request, user_message, sizeof(struct ipc_message)) < 0)
+        return -EFAULT;
 
     void *user_buffer = request.data;
     size_t user_capacity = request.size;
@@ -264,7 +472,7 @@ static int32_t sys_recv_handler(struct syscall_envelope *msg)
     uint8_t data_buf[CONFIG_MSG_DATA_MAX];
     struct ipc_message delivery;
 
-    int rc = ipc_channel_receive(proc, channel_id, &delivery, (user_buffer && user_capacity > 0) ? data_buf : NULL, (user_buffer && user_capacity > 0) ? CONFIG_MSG_DATA_MAX : 0, flags);
+    int rc = ipc_channel_receive_timeout(proc, channel_id, &delivery, (user_buffer && user_capacity > 0) ? data_buf : NULL, (user_buffer && user_capacity > 0) ? CONFIG_MSG_DATA_MAX : 0, flags, timeout_ticks);
     if (rc <= 0)
         return rc;
 
@@ -275,8 +483,8 @@ static int32_t sys_recv_handler(struct syscall_envelope *msg)
     if (user_buffer && user_capacity > 0)
     {
         size_t to_copy = (copy_len < user_capacity) ? copy_len : user_capacity;
-        if (to_copy > 0)
-            copy_to_user((char *)user_buffer, (const char *)data_buf, to_copy);
+        if (to_copy > 0 && copy_to_user(user_buffer, data_buf, to_copy) < 0)
+            return -EFAULT;
         if (copy_len > user_capacity)
             delivery.header |= IPC_MESSAGE_TRUNCATED;
         delivery.size = (uint32_t)to_copy;
@@ -288,7 +496,8 @@ static int32_t sys_recv_handler(struct syscall_envelope *msg)
         delivery.data = NULL;
     }
 
-    copy_to_user((char *)user_message, (const char *)&delivery, sizeof(struct ipc_message));
+    if (copy_to_user(user_message, &delivery, sizeof(struct ipc_message)) < 0)
+        return -EFAULT;
     return 1;
 }
 
@@ -300,6 +509,7 @@ static int32_t sys_chan_create_handler(struct syscall_envelope *msg)
     const char *name = (const char *)(uintptr_t)msg->args[0];
     size_t name_len = (size_t)msg->args[1];
     uint32_t flags = (msg->argc >= 3) ? msg->args[2] : 0;
+    uint32_t ring_bytes = (msg->argc >= 4) ? msg->args[3] : 0;
 
     char buffer[CONFIG_IPC_CHANNEL_NAME_MAX];
     size_t copy_len = 0;
@@ -309,7 +519,8 @@ static int32_t sys_chan_create_handler(struct syscall_envelope *msg)
         if (!syscall_validate_user_buffer(name, name_len))
             return -1;
         copy_len = (name_len < (CONFIG_IPC_CHANNEL_NAME_MAX - 1)) ? name_len : (CONFIG_IPC_CHANNEL_NAME_MAX - 1);
-        copy_from_user(buffer, name, copy_len);
+        if (copy_from_user(buffer, name, copy_len) < 0)
+            return -EFAULT;
         buffer[copy_len] = '\0';
     }
     else
@@ -317,7 +528,7 @@ static int32_t sys_chan_create_handler(struct syscall_envelope *msg)
         buffer[0] = '\0';
     }
 
-    return ipc_channel_create((copy_len > 0) ? buffer : NULL, copy_len, flags);
+    return ipc_channel_create_sized((copy_len > 0) ? buffer : NULL, copy_len, flags, ring_bytes);
 }
 
 static int32_t sys_chan_join_handler(struct syscall_envelope *msg)
@@ -349,7 +560,10 @@ static int32_t sys_chan_peek_handler(struct syscall_envelope *msg)
     if (msg->argc < 1)
         return -1;
     int channel_id = (int)msg->args[0];
-    return ipc_channel_peek(channel_id);
+    struct process *proc = process_current();
+    if (!proc)
+        return -1;
+    return ipc_channel_peek(proc, channel_id);
 }
 
 static int32_t sys_service_channel_handler(struct syscall_envelope *msg)
@@ -378,7 +592,42 @@ static int32_t sys_sched_set_handler(struct syscall_envelope *msg)
     uint8_t policy = (uint8_t)msg->args[1];
     uint32_t weight = msg->args[2];
     uint64_t deadline = (uint64_t)msg->args[3];
-    return process_set_scheduler(pid, policy, weight, deadline);
+    uint32_t runtime = (msg->argc >= 5) ? msg->args[4] : 0;
+    uint32_t period = (msg->argc >= 6) ? msg->args[5] : 0;
+    return process_set_scheduler(pid, policy, weight, deadline, runtime, period, 0);
+}
+
+static int32_t sys_sched_affinity_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 2)
+        return -1;
+    uint32_t mask = msg->args[1] & CONFIG_SCHED_SYSCALL_AFFINITY;
+    if (mask == 0)
+        return -1;
+    return process_set_affinity((int)msg->args[0], mask);
+}
+
+static int32_t sys_futex_wait_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 2)
+        return -1;
+
+    volatile uint32_t *addr = (volatile uint32_t *)(uintptr_t)msg->args[0];
+    uint32_t timeout = (msg->argc > 2) ? msg->args[2] : 0;
+    if (!syscall_validate_user_buffer((const void *)addr, sizeof(*addr)))
+        return -1;
+    return futex_wait(addr, msg->args[1], timeout);
+}
+
+static int32_t sys_futex_wake_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 2)
+        return -1;
+
+    volatile uint32_t *addr = (volatile uint32_t *)(uintptr_t)msg->args[0];
+    if (!syscall_validate_user_buffer((const void *)addr, sizeof(*addr)))
+        return -1;
+    return futex_wake(addr, msg->args[1]);
 }
 
 static int32_t sys_mutex_create_handler(struct syscall_envelope *msg)
@@ -427,16 +676,172 @@ static int32_t sys_sem_post_handler(struct syscall_envelope *msg)
     return sync_semaphore_post(id);
 }
 
-static int32_t syscall_invoke(struct syscall_envelope *msg)
+static int32_t sys_uring_setup_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 2)
+        return -1;
+
+    struct uring_shared **out = (struct uring_shared **)(uintptr_t)msg->args[1];
+    if (!syscall_validate_user_buffer(out, sizeof(*out)))
+        return -1;
+    return uring_setup(msg->args[0], out);
+}
+
+static int32_t sys_ring_enter_handler(struct syscall_envelope *msg)
+{
+    if (msg->argc < 1)
+        return -1;
+
+    uint32_t min_complete = (msg->argc > 1) ? msg->args[1] : 0;
+    return uring_enter(msg->args[0], min_complete);
+}
+
+static int32_t sys_null_handler(struct syscall_envelope *msg)
+{
+    (void)msg;
+    return 0;
+}
+
+static void syscall_stat_max(volatile uint64_t *slot, uint64_t value)
+{
+    uint64_t seen = *slot;
+    while (value > seen)
+    {
+        uint64_t prior = __sync_val_compare_and_swap(slot, seen, value);
+        if (prior == seen)
+            break;
+        seen = prior;
+    }
+}
+
+static uint32_t syscall_latency_bucket(uint64_t cycles)
+{
+    uint32_t bucket = 0;
+    cycles >>= SYSCALL_LATENCY_SHIFT;
+    while (cycles && bucket + 1u < SYSCALL_LATENCY_BUCKETS)
+    {
+        cycles >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+/* Counters are updated with atomics so that every CPU can dispatch without a shared lock. */
+static void syscall_account(uint32_t number, int32_t result, uint64_t cycles)
+{
+    struct syscall_counters *counters = &syscall_counters[number];
+    __sync_fetch_and_add(&counters->calls, 1u);
+    if (result < 0)
+        __sync_fetch_and_add(&counters->errors, 1u);
+    __sync_fetch_and_add(&counters->cycles, cycles);
+    syscall_stat_max(&counters->max_cycles, cycles);
+    __sync_fetch_and_add(&counters->latency_hist[syscall_latency_bucket(cycles)], 1u);
+
+    struct process *proc = process_current();
+    if (proc)
+    {
+        ++proc->syscalls;
+        proc->syscall_cycles += cycles;
+    }
+}
+
+int32_t syscall_dispatch(struct syscall_envelope *msg)
 {
     if (msg->number >= SYSCALL_TABLE_SIZE)
         return -1;
 
-    syscall_handler_t handler = syscall_table[msg->number].handler;
-    if (!handler)
+    uint32_t number = msg->number;
+    uint64_t start = rdtsc();
+    syscall_handler_t handler = syscall_table[number].handler;
+    int32_t result = handler ? handler(msg) : -1;
+    syscall_account(number, result, rdtsc() - start);
+    return result;
+}
+
+size_t syscall_stats_snapshot(struct syscall_stats *out, size_t capacity)
+{
+    size_t count = 0;
+    for (uint32_t i = 0; i < SYSCALL_TABLE_SIZE; ++i)
+    {
+        const struct syscall_counters *counters = &syscall_counters[i];
+        if (!syscall_table[i].handler && !counters->calls)
+            continue;
+        if (out && count < capacity)
+        {
+            struct syscall_stats *entry = &out[count];
+            entry->number = i;
+            entry->name = syscall_table[i].name;
+            entry->calls = counters->calls;
+            entry->errors = counters->errors;
+            entry->cycles = counters->cycles;
+            entry->max_cycles = counters->max_cycles;
+            for (uint32_t b = 0; b < SYSCALL_LATENCY_BUCKETS; ++b)
+                entry->latency_hist[b] = counters->latency_hist[b];
+        }
+        ++count;
+    }
+    return count;
+}
+
+void syscall_reset_stats(void)
+{
+    for (uint32_t i = 0; i < SYSCALL_TABLE_SIZE; ++i)
+    {
+        struct syscall_counters *counters = &syscall_counters[i];
+        counters->calls = 0;
+        counters->errors = 0;
+        counters->cycles = 0;
+        counters->max_cycles = 0;
+        for (uint32_t b = 0; b < SYSCALL_LATENCY_BUCKETS; ++b)
+            counters->latency_hist[b] = 0;
+    }
+}
+
+/* SYSENTER lands here with the caller's registers; the envelope never leaves this stack. */
+int32_t syscall_fast_dispatch(uint32_t number_argc, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    struct syscall_envelope msg;
+    msg.number = number_argc & ((1u << SYSCALL_FAST_ARGC_SHIFT) - 1u);
+    msg.argc = number_argc >> SYSCALL_FAST_ARGC_SHIFT;
+    if (msg.argc > SYSCALL_FAST_MAX_ARGS)
         return -1;
 
-    return handler(msg);
+    msg.args[0] = arg0;
+    msg.args[1] = arg1;
+    msg.args[2] = arg2;
+    msg.args[3] = arg3;
+    msg.args[4] = 0;
+    msg.args[5] = 0;
+    msg.result = 0;
+    msg.status = 0;
+    return syscall_dispatch(&msg);
+}
+
+/* CPUID.1:EDX.SEP, minus the Pentium Pro parts that report it without implementing it. */
+static int syscall_sysenter_supported(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_SEP))
+        return 0;
+
+    uint32_t family = (eax >> 8) & 0xFu;
+    uint32_t model = (eax >> 4) & 0xFu;
+    uint32_t stepping = eax & 0xFu;
+    if (family == 6u && model < 3u && stepping < 3u)
+        return 0;
+    return 1;
+}
+
+void syscall_cpu_init(void)
+{
+    if (!syscall_fast_enabled)
+        return;
+
+    uint32_t index = cpu_this()->index;
+    wrmsr(MSR_SYSENTER_CS, 0x08u);
+    wrmsr(MSR_SYSENTER_ESP, (uint32_t)(uintptr_t)&sysenter_stacks[index][SYSENTER_STACK_SIZE]);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)(uintptr_t)syscall_sysenter_entry);
 }
 
 int syscall_register_handler(uint32_t number, syscall_handler_t handler, const char *name)
@@ -473,7 +878,7 @@ int syscall_unregister_handler(uint32_t number)
 
 void syscall_init(void)
 {
-    spinlock_init(&syscall_lock);
+    spinlock_init_named(&syscall_lock, "syscall");
     for (size_t i = 0; i < SYSCALL_TABLE_SIZE; ++i)
     {
         syscall_table[i].handler = NULL;
@@ -492,38 +897,61 @@ void syscall_init(void)
     syscall_register_handler(SYS_CHAN_PEEK, sys_chan_peek_handler, "sys_chan_peek");
     syscall_register_handler(SYS_GET_SERVICE_CHANNEL, sys_service_channel_handler, "sys_get_service_channel");
     syscall_register_handler(SYS_SLEEP, sys_sleep_handler, "sys_sleep");
+    syscall_register_handler(SYS_SLEEP_NS, sys_sleep_ns_handler, "sys_sleep_ns");
+    syscall_register_handler(SYS_CLOCK_GET, sys_clock_get_handler, "sys_clock_get");
+    syscall_register_handler(SYS_TIME_PAGE, sys_time_page_handler, "sys_time_page");
     syscall_register_handler(SYS_IPC_SEND, sys_ipc_send_handler, "sys_ipc_send");
     syscall_register_handler(SYS_IPC_RECV, sys_ipc_recv_handler, "sys_ipc_recv");
     syscall_register_handler(SYS_IPC_SHARE, sys_ipc_share_handler, "sys_ipc_share");
+    syscall_register_handler(SYS_IPC_CALL, sys_ipc_call_handler, "sys_ipc_call");
+    syscall_register_handler(SYS_IPC_REPLY_WAIT, sys_ipc_reply_wait_handler, "sys_ipc_reply_wait");
+    syscall_register_handler(SYS_IPC_ACCEPT, sys_ipc_accept_handler, "sys_ipc_accept");
+    syscall_register_handler(SYS_RING_CREATE, sys_ring_create_handler, "sys_ring_create");
+    syscall_register_handler(SYS_RING_ATTACH, sys_ring_attach_handler, "sys_ring_attach");
+    syscall_register_handler(SYS_RING_DOORBELL, sys_ring_doorbell_handler, "sys_ring_doorbell");
+    syscall_register_handler(SYS_RING_WAIT, sys_ring_wait_handler, "sys_ring_wait");
+    syscall_register_handler(SYS_EVSET_CREATE, sys_evset_create_handler, "sys_evset_create");
+    syscall_register_handler(SYS_EVSET_ADD, sys_evset_add_handler, "sys_evset_add");
+    syscall_register_handler(SYS_EVSET_REMOVE, sys_evset_remove_handler, "sys_evset_remove");
+    syscall_register_handler(SYS_EVSET_WAIT, sys_evset_wait_handler, "sys_evset_wait");
+    syscall_register_handler(SYS_NET_OPEN, sys_net_open_handler, "sys_net_open");
+    syscall_register_handler(SYS_NET_SEND, sys_net_send_handler, "sys_net_send");
+    syscall_register_handler(SYS_NET_RECV, sys_net_recv_handler, "sys_net_recv");
+    syscall_register_handler(SYS_NULL, sys_null_handler, "sys_null");
+    syscall_register_handler(SYS_URING_SETUP, sys_uring_setup_handler, "sys_uring_setup");
+    syscall_register_handler(SYS_RING_ENTER, sys_ring_enter_handler, "sys_ring_enter");
     syscall_register_handler(SYS_SERVICE_CONNECT, sys_service_connect_handler, "sys_service_connect");
     syscall_register_handler(SYS_SCHED_SET, sys_sched_set_handler, "sys_sched_set");
+    syscall_register_handler(SYS_SCHED_AFFINITY, sys_sched_affinity_handler, "sys_sched_affinity");
+    syscall_register_handler(SYS_FUTEX_WAIT, sys_futex_wait_handler, "sys_futex_wait");
+    syscall_register_handler(SYS_FUTEX_WAKE, sys_futex_wake_handler, "sys_futex_wake");
     syscall_register_handler(SYS_MUTEX_CREATE, sys_mutex_create_handler, "sys_mutex_create");
     syscall_register_handler(SYS_MUTEX_LOCK, sys_mutex_lock_handler, "sys_mutex_lock");
     syscall_register_handler(SYS_MUTEX_UNLOCK, sys_mutex_unlock_handler, "sys_mutex_unlock");
     syscall_register_handler(SYS_SEM_CREATE, sys_sem_create_handler, "sys_sem_create");
     syscall_register_handler(SYS_SEM_WAIT, sys_sem_wait_handler, "sys_sem_wait");
     syscall_register_handler(SYS_SEM_POST, sys_sem_post_handler, "sys_sem_post");
+
+    syscall_fast_enabled = syscall_sysenter_supported() ? 1u : 0u;
+    syscall_cpu_init();
 }
 
 void syscall_handler(struct regs *frame)
 {
-    struct syscall_envelope *message = (struct syscall_envelope *)frame->eax;
-    if (!syscall_validate_user_buffer(message, sizeof(struct syscall_envelope)))
-    {
-        frame->eax = (uint32_t)-1;
-        return;
-    }
-
-    if (message->argc > SYSCALL_MAX_ARGS)
+    struct syscall_envelope *user_message = (struct syscall_envelope *)frame->eax;
+    struct syscall_envelope message;
+    if (copy_from_user(&message, user_message, sizeof(message)) < 0)
     {
-        message->status = 1;
-        message->result = -1;
-        frame->eax = (uint32_t)-1;
+        frame->eax = (uint32_t)-EFAULT;
         return;
     }
 
-    int32_t result = syscall_invoke(message);
-    message->result = result;
-    message->status = (result < 0) ? 1u : 0u;
+    int32_t result = -1;
+    if (message.argc <= SYSCALL_MAX_ARGS)
+        result = syscall_dispatch(&message);
+    message.result = result;
+    message.status = (result < 0) ? 1u : 0u;
+    if (copy_to_user(user_message, &message, sizeof(message)) < 0)
+        result = -EFAULT;
     frame->eax = (uint32_t)result;
 }
@@ -29,10 +29,33 @@ enum syscall_number
     SYS_SEM_CREATE = 20,
     SYS_SEM_WAIT = 21,
     SYS_SEM_POST = 22,
-    SYS_DYNAMIC_BASE = 32
+    SYS_SLEEP_NS = 23,
+    SYS_CLOCK_GET = 24,
+    SYS_TIME_PAGE = 25,
+    SYS_SCHED_AFFINITY = 26,
+    SYS_FUTEX_WAIT = 27,
+    SYS_FUTEX_WAKE = 28,
+    SYS_IPC_CALL = 29,
+    SYS_IPC_REPLY_WAIT = 30,
+    SYS_RING_CREATE = 31,
+    SYS_RING_ATTACH = 32,
+    SYS_RING_DOORBELL = 33,
+    SYS_RING_WAIT = 34,
+    SYS_EVSET_CREATE = 35,
+    SYS_EVSET_ADD = 36,
+    SYS_EVSET_REMOVE = 37,
+    SYS_EVSET_WAIT = 38,
+    SYS_NET_OPEN = 39,
+    SYS_NET_SEND = 40,
+    SYS_NET_RECV = 41,
+    SYS_NULL = 42,
+    SYS_URING_SETUP = 43,
+    SYS_RING_ENTER = 44,
+    SYS_IPC_ACCEPT = 45,
+    SYS_DYNAMIC_BASE = 48
 };
 
-#define SYSCALL_MAX_ARGS 4
+#define SYSCALL_MAX_ARGS 6
 #define SYSCALL_TABLE_SIZE 64
 
 struct syscall_envelope
@@ -46,9 +69,49 @@ struct syscall_envelope
 
 typedef int32_t (*syscall_handler_t)(struct syscall_envelope *message);
 
+/*
+ * Per-syscall latency histogram in TSC cycles: bucket 0 counts calls under
+ * 2^SYSCALL_LATENCY_SHIFT cycles, bucket b those in [2^(b+SHIFT-1),
+ * 2^(b+SHIFT)), and the last bucket everything slower.
+ */
+#define SYSCALL_LATENCY_BUCKETS 20u
+#define SYSCALL_LATENCY_SHIFT   7u
+
+struct syscall_stats
+{
+    uint32_t number;
+    /** NULL for numbers that were called without a handler. */
+    const char *name;
+    uint64_t calls;
+    /** Calls that returned a negative value. */
+    uint64_t errors;
+    uint64_t cycles;
+    uint64_t max_cycles;
+    uint32_t latency_hist[SYSCALL_LATENCY_BUCKETS];
+};
+
+/*
+ * Fast path: syscall_fast_call() enters through SYSENTER with the number in
+ * the low half of %eax, argc above SYSCALL_FAST_ARGC_SHIFT and up to four
+ * arguments in %ebx, %esi, %edi and %ebp. Only valid while
+ * syscall_fast_enabled is set; int 0x80 always works.
+ */
+#define SYSCALL_FAST_ARGC_SHIFT 16
+#define SYSCALL_FAST_MAX_ARGS 4
+
+extern uint32_t syscall_fast_enabled;
+int32_t syscall_fast_call(uint32_t number_argc, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
 void syscall_init(void);
+/** Load this CPU's SYSENTER MSRs; every CPU runs it once before scheduling. */
+void syscall_cpu_init(void);
 int syscall_register_handler(uint32_t number, syscall_handler_t handler, const char *name);
 int syscall_unregister_handler(uint32_t number);
+/** Run one already-validated envelope through the table; used by batched submissions. */
+int32_t syscall_dispatch(struct syscall_envelope *msg);
+/** Copy out the counters of every syscall that has a handler or was called; returns how many there are. */
+size_t syscall_stats_snapshot(struct syscall_stats *out, size_t capacity);
+void syscall_reset_stats(void);
 int syscall_validate_user_buffer(const void *ptr, size_t length);
 int syscall_validate_user_pointer(const void *ptr);
 
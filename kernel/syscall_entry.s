@@ -2,8 +2,11 @@
 .code32
 
 .global isr128
+.global syscall_fast_call
+.global syscall_sysenter_entry
 
 .extern syscall_handler
+.extern syscall_fast_dispatch
 
 isr128:
     pushl $0
@@ -18,17 +21,58 @@ isr128:
     mov %ax, %ds
     mov %ax, %es
     mov %ax, %fs
-    mov %ax, %gs
 
     mov %esp, %eax
     pushl %eax
     call syscall_handler
     add $4, %esp
 
-    popl %gs
+    /* %gs holds this CPU's per-CPU selector; never restore another CPU's. */
+    addl $4, %esp
     popl %fs
     popl %es
     popl %ds
     popa
     add $8, %esp
     iret
+
+/*
+ * int32_t syscall_fast_call(number_argc, arg0, arg1, arg2, arg3)
+ *
+ * Callers already run in ring 0, so there is no SYSEXIT: the entry stub
+ * switches back to the stack passed in %ecx and returns to the address in
+ * %edx. SYSENTER clears IF like the int 0x80 gate does; popfl restores it.
+ */
+syscall_fast_call:
+    pushl %ebx
+    pushl %esi
+    pushl %edi
+    pushl %ebp
+    pushfl
+    movl 24(%esp), %eax
+    movl 28(%esp), %ebx
+    movl 32(%esp), %esi
+    movl 36(%esp), %edi
+    movl 40(%esp), %ebp
+    movl %esp, %ecx
+    movl $1f, %edx
+    sysenter
+1:
+    popfl
+    popl %ebp
+    popl %edi
+    popl %esi
+    popl %ebx
+    ret
+
+syscall_sysenter_entry:
+    movl %ecx, %esp
+    pushl %edx
+    pushl %ebp
+    pushl %edi
+    pushl %esi
+    pushl %ebx
+    pushl %eax
+    call syscall_fast_dispatch
+    addl $20, %esp
+    ret
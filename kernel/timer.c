@@ -0,0 +1,251 @@
+#include "timer.h"
+
+#include "pit.h"
+#include "spinlock.h"
+
+#include <stddef.h>
+
+/*
+ * Hierarchical timing wheel.
+ *
+ * Level 0 has one slot per tick for the next TIMER_WHEEL_SIZE ticks; each
+ * higher level covers TIMER_WHEEL_SIZE times the span of the one below.
+ * Arming and cancelling are O(1) list operations. Each tick runs one level-0
+ * slot, and whenever a level wraps the matching slot of the next level is
+ * cascaded down, so per-tick cost does not depend on how many timers are
+ * pending. Timers further out than the top level are parked in its last
+ * reachable slot and re-sorted when that slot cascades.
+ */
+
+#define TIMER_WHEEL_BITS   CONFIG_TIMER_WHEEL_BITS
+#define TIMER_WHEEL_SIZE   (1u << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK   (TIMER_WHEEL_SIZE - 1u)
+#define TIMER_WHEEL_LEVELS CONFIG_TIMER_WHEEL_LEVELS
+#define TIMER_WHEEL_SPAN   ((uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+static struct timer *wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+static uint64_t wheel_clock = 0;
+static spinlock_t timer_lock;
+static struct timer_stats stats;
+
+static void wheel_unlink(struct timer *timer)
+{
+    if (timer->prev)
+        timer->prev->next = timer->next;
+    else
+        wheel[timer->level][timer->slot] = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+static void wheel_link(struct timer *timer)
+{
+    uint64_t expires = timer->expires;
+    if (expires < wheel_clock)
+        expires = wheel_clock;
+
+    uint64_t delta = expires - wheel_clock;
+    if (delta >= TIMER_WHEEL_SPAN)
+    {
+        expires = wheel_clock + TIMER_WHEEL_SPAN - 1u;
+        delta = TIMER_WHEEL_SPAN - 1u;
+    }
+
+    unsigned int level = 0;
+    while (level + 1u < TIMER_WHEEL_LEVELS && delta >= ((uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1u))))
+        ++level;
+
+    unsigned int slot = (unsigned int)(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    timer->level = (uint8_t)level;
+    timer->slot = (uint8_t)slot;
+    timer->prev = NULL;
+    timer->next = wheel[level][slot];
+    if (timer->next)
+        timer->next->prev = timer;
+    wheel[level][slot] = timer;
+}
+
+static void wheel_cascade(unsigned int level, unsigned int slot)
+{
+    struct timer *list = wheel[level][slot];
+    wheel[level][slot] = NULL;
+    while (list)
+    {
+        struct timer *timer = list;
+        list = timer->next;
+        wheel_link(timer);
+        ++stats.cascaded;
+    }
+}
+
+void timer_system_init(void)
+{
+    spinlock_init_named(&timer_lock, "timer.wheel");
+    for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        for (unsigned int slot = 0; slot < TIMER_WHEEL_SIZE; ++slot)
+            wheel[level][slot] = NULL;
+    }
+    wheel_clock = get_ticks() + 1u;
+    stats.pending = 0;
+    stats.fired = 0;
+    stats.cancelled = 0;
+    stats.cascaded = 0;
+}
+
+void timer_init(struct timer *timer, timer_callback_t callback, void *data)
+{
+    if (!timer)
+        return;
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->data = data;
+    timer->pending = 0;
+    timer->level = 0;
+    timer->slot = 0;
+}
+
+void timer_arm_at(struct timer *timer, uint64_t expires)
+{
+    if (!timer || !timer->callback)
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&timer_lock, &flags);
+    if (timer->pending)
+        wheel_unlink(timer);
+    else
+        ++stats.pending;
+    timer->expires = expires;
+    timer->pending = 1;
+    wheel_link(timer);
+    spinlock_unlock_irqrestore(&timer_lock, flags);
+}
+
+void timer_arm(struct timer *timer, uint32_t delay_ticks)
+{
+    timer_arm_at(timer, get_ticks() + (uint64_t)delay_ticks);
+}
+
+int timer_cancel(struct timer *timer)
+{
+    if (!timer)
+        return 0;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&timer_lock, &flags);
+    int was_pending = timer->pending;
+    if (was_pending)
+    {
+        wheel_unlink(timer);
+        timer->pending = 0;
+        --stats.pending;
+        ++stats.cancelled;
+    }
+    spinlock_unlock_irqrestore(&timer_lock, flags);
+    return was_pending;
+}
+
+int timer_pending(const struct timer *timer)
+{
+    return timer ? timer->pending : 0;
+}
+
+void timer_tick(uint64_t now)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&timer_lock, &flags);
+
+    while (wheel_clock <= now)
+    {
+        unsigned int index = (unsigned int)wheel_clock & TIMER_WHEEL_MASK;
+        if (index == 0)
+        {
+            for (unsigned int level = 1; level < TIMER_WHEEL_LEVELS; ++level)
+            {
+                unsigned int slot = (unsigned int)(wheel_clock >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+                wheel_cascade(level, slot);
+                if (slot != 0)
+                    break;
+            }
+        }
+
+        /* Advance first so a callback re-arming for "now" lands in the next slot. */
+        ++wheel_clock;
+
+        struct timer *timer;
+        while ((timer = wheel[0][index]) != NULL)
+        {
+            wheel_unlink(timer);
+            timer->pending = 0;
+            --stats.pending;
+            ++stats.fired;
+
+            timer_callback_t callback = timer->callback;
+            void *data = timer->data;
+            spinlock_unlock_irqrestore(&timer_lock, flags);
+            callback(data);
+            spinlock_lock_irqsave(&timer_lock, &flags);
+        }
+    }
+
+    spinlock_unlock_irqrestore(&timer_lock, flags);
+}
+
+uint64_t timer_next_expiry(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&timer_lock, &flags);
+
+    /*
+     * Level 0 gives exact expiries. An upper-level slot is only looked at
+     * again when it cascades, so its cascade tick is the bound to report:
+     * waking there re-sorts the slot and the next idle period sees the
+     * precise time. Every level is scanned because an old upper-level slot
+     * can cascade before the earliest level-0 timer is due.
+     */
+    for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        unsigned int shift = TIMER_WHEEL_BITS * level;
+        uint64_t base = wheel_clock >> shift;
+        for (unsigned int offset = 0; offset < TIMER_WHEEL_SIZE; ++offset)
+        {
+            uint64_t slot_clock = base + offset;
+            if (!wheel[level][slot_clock & TIMER_WHEEL_MASK])
+                continue;
+
+            uint64_t when = slot_clock << shift;
+            if (when < wheel_clock)
+            {
+                /* The current slot already cascaded; it comes round again a full turn later. */
+                when += (uint64_t)TIMER_WHEEL_SIZE << shift;
+                if (when < next)
+                    next = when;
+                continue;
+            }
+            if (when < next)
+                next = when;
+            break;
+        }
+    }
+
+    spinlock_unlock_irqrestore(&timer_lock, flags);
+    return next;
+}
+
+void timer_get_stats(struct timer_stats *out)
+{
+    if (!out)
+        return;
+
+    uint32_t flags;
+    spinlock_lock_irqsave(&timer_lock, &flags);
+    *out = stats;
+    spinlock_unlock_irqrestore(&timer_lock, flags);
+}
@@ -0,0 +1,51 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+typedef void (*timer_callback_t)(void *data);
+
+/**
+ * @brief One-shot kernel timer driven by the PIT tick.
+ *
+ * Embed a struct timer in the owning object and initialise it once with
+ * timer_init(). Callbacks run from the timer interrupt with interrupts
+ * disabled; they may re-arm their own timer.
+ */
+struct timer
+{
+    struct timer *next;
+    struct timer *prev;
+    uint64_t expires;
+    timer_callback_t callback;
+    void *data;
+    uint8_t pending;
+    uint8_t level;
+    uint8_t slot;
+};
+
+struct timer_stats
+{
+    uint32_t pending;
+    uint32_t fired;
+    uint32_t cancelled;
+    uint32_t cascaded;
+};
+
+void timer_system_init(void);
+void timer_init(struct timer *timer, timer_callback_t callback, void *data);
+/** Arm @p timer to fire @p delay_ticks from now; re-arming moves it. */
+void timer_arm(struct timer *timer, uint32_t delay_ticks);
+/** Arm @p timer for an absolute tick; past ticks fire on the next tick. */
+void timer_arm_at(struct timer *timer, uint64_t expires);
+/** @return 1 if the timer was pending and is now disarmed, 0 otherwise. */
+int timer_cancel(struct timer *timer);
+int timer_pending(const struct timer *timer);
+void timer_tick(uint64_t now);
+/** Earliest tick a pending timer may fire at (a lower bound), or UINT64_MAX. */
+uint64_t timer_next_expiry(void);
+void timer_get_stats(struct timer_stats *out);
+
+#endif
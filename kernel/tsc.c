@@ -0,0 +1,85 @@
+#include "tsc.h"
+
+#include "io.h"
+
+#define PIT_CHANNEL2      0x42
+#define PIT_COMMAND       0x43
+#define PIT_GATE_PORT     0x61
+#define PIT_GATE_ENABLE   0x01
+#define PIT_SPEAKER       0x02
+#define PIT_OUT2          0x20
+#define PIT_CH2_ONESHOT   0xB0
+#define PIT_FREQUENCY     1193182u
+
+/* The longest window a 16-bit channel 2 count allows (59659 PIT clocks). */
+#define TSC_CALIBRATE_MS  50u
+/* Anything slower is not a TSC worth timing with; treat as unusable. */
+#define TSC_MIN_KHZ       16000u
+
+static uint32_t tsc_rate_khz = 0;
+/* Nanoseconds per cycle and cycles per nanosecond, 32.32 fixed point. */
+static uint64_t ns_per_cycle = 0;
+static uint64_t cycles_per_ns = 0;
+
+int tsc_calibrate(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & (1u << 4)))
+        return -1;
+
+    /* Gate channel 2 on with the speaker off, then count one window down in mode 0. */
+    uint32_t latch = (PIT_FREQUENCY * TSC_CALIBRATE_MS) / 1000u;
+    outb(PIT_GATE_PORT, (uint8_t)((inb(PIT_GATE_PORT) & ~PIT_SPEAKER) | PIT_GATE_ENABLE));
+    outb(PIT_COMMAND, PIT_CH2_ONESHOT);
+    outb(PIT_CHANNEL2, (uint8_t)(latch & 0xFFu));
+    outb(PIT_CHANNEL2, (uint8_t)((latch >> 8) & 0xFFu));
+
+    uint64_t start = rdtsc();
+    uint32_t spins = 0;
+    while (!(inb(PIT_GATE_PORT) & PIT_OUT2))
+    {
+        if (++spins == 0x1000000u)
+            return -1;
+    }
+    uint64_t cycles = rdtsc() - start;
+
+    uint64_t khz = div_u64_u32(cycles, TSC_CALIBRATE_MS, NULL);
+    if (khz < TSC_MIN_KHZ || (khz >> 32))
+        return -1;
+
+    tsc_rate_khz = (uint32_t)khz;
+    ns_per_cycle = div_u64_u32((uint64_t)1000000u << 32, tsc_rate_khz, NULL);
+    cycles_per_ns = div_u64_u32((uint64_t)tsc_rate_khz << 32, 1000000u, NULL);
+    return 0;
+}
+
+uint32_t tsc_khz(void)
+{
+    return tsc_rate_khz;
+}
+
+uint64_t tsc_ns_mult(void)
+{
+    return ns_per_cycle;
+}
+
+uint64_t tsc_to_ns(uint64_t cycles)
+{
+    return mul_u64_u64_shr32(cycles, ns_per_cycle);
+}
+
+uint64_t tsc_from_ns(uint64_t ns)
+{
+    return mul_u64_u64_shr32(ns, cycles_per_ns);
+}
+
+void tsc_delay_ns(uint64_t ns)
+{
+    if (!tsc_rate_khz)
+        return;
+
+    uint64_t end = rdtsc() + tsc_from_ns(ns);
+    while (rdtsc() < end)
+        __asm__ __volatile__("pause");
+}
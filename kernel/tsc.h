@@ -0,0 +1,54 @@
+#ifndef TSC_H
+#define TSC_H
+
+#include <stdint.h>
+
+/**
+ * @brief Measure the TSC rate against PIT channel 2.
+ *
+ * Must run with interrupts disabled before channel 2 is used for anything
+ * else. @return 0 on success, -1 if the CPU has no usable TSC.
+ */
+int tsc_calibrate(void);
+/** Calibrated TSC frequency in kHz, or 0 when uncalibrated. */
+uint32_t tsc_khz(void);
+/** Nanoseconds per cycle as a 32.32 fixed-point multiplier, or 0 when uncalibrated. */
+uint64_t tsc_ns_mult(void);
+uint64_t tsc_to_ns(uint64_t cycles);
+uint64_t tsc_from_ns(uint64_t ns);
+/** Busy-wait for @p ns nanoseconds; no-op without a calibrated TSC. */
+void tsc_delay_ns(uint64_t ns);
+
+/*
+ * (value * mult) >> 32 with a 32.32 fixed-point @p mult, built from 32-bit
+ * partial products so neither the kernel nor user code needs libgcc.
+ */
+static inline uint64_t mul_u64_u64_shr32(uint64_t value, uint64_t mult)
+{
+    uint32_t value_low = (uint32_t)value;
+    uint32_t value_high = (uint32_t)(value >> 32);
+    uint32_t mult_low = (uint32_t)mult;
+    uint32_t mult_high = (uint32_t)(mult >> 32);
+
+    uint64_t result = ((uint64_t)value_low * mult_low) >> 32;
+    result += (uint64_t)value_low * mult_high;
+    result += (uint64_t)value_high * mult_low;
+    result += ((uint64_t)value_high * mult_high) << 32;
+    return result;
+}
+
+/* 64-by-32 bit division without pulling in libgcc's __udivdi3. */
+static inline uint64_t div_u64_u32(uint64_t dividend, uint32_t divisor, uint32_t *remainder)
+{
+    uint32_t high = (uint32_t)(dividend >> 32);
+    uint32_t low = (uint32_t)dividend;
+    uint32_t quotient_high = high / divisor;
+    uint32_t rem = high % divisor;
+    uint32_t quotient_low;
+    __asm__("divl %4" : "=a"(quotient_low), "=d"(rem) : "a"(low), "d"(rem), "rm"(divisor));
+    if (remainder)
+        *remainder = rem;
+    return ((uint64_t)quotient_high << 32) | quotient_low;
+}
+
+#endif
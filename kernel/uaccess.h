@@ -0,0 +1,43 @@
+#ifndef UACCESS_H
+#define UACCESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "syscall.h"
+
+#define EFAULT 14
+
+/**
+ * @brief Copy with `rep movsd`, surviving faults on either buffer.
+ *
+ * A page fault or general-protection fault inside the copy resumes through
+ * the exception table instead of halting.
+ *
+ * @return bytes left uncopied; 0 on success.
+ */
+size_t uaccess_copy(void *dst, const void *src, size_t len);
+
+/** @return 0, or -EFAULT if @p src is outside user space or faulted. */
+static inline int copy_from_user(void *dst, const void *src, size_t len)
+{
+    if (!syscall_validate_user_buffer(src, len))
+        return -EFAULT;
+    return uaccess_copy(dst, src, len) ? -EFAULT : 0;
+}
+
+/** @return 0, or -EFAULT if @p dst is outside user space or faulted. */
+static inline int copy_to_user(void *dst, const void *src, size_t len)
+{
+    if (!syscall_validate_user_buffer(dst, len))
+        return -EFAULT;
+    return uaccess_copy(dst, src, len) ? -EFAULT : 0;
+}
+
+/** Read one aligned word, as futexes and doorbells compare it. @return 0, or -EFAULT. */
+static inline int get_user_u32(uint32_t *value, const volatile uint32_t *src)
+{
+    return copy_from_user(value, (const void *)src, sizeof(*value));
+}
+
+#endif
@@ -0,0 +1,42 @@
+.section .text
+.code32
+
+.global uaccess_copy
+
+/*
+ * size_t uaccess_copy(void *dst, const void *src, size_t len)
+ *
+ * Each rep instruction has an __ex_table entry; a fault on it resumes at
+ * the matching fixup with %ecx still counting what was left.
+ */
+uaccess_copy:
+    pushl %esi
+    pushl %edi
+    movl 12(%esp), %edi
+    movl 16(%esp), %esi
+    movl 20(%esp), %edx
+    cld
+    movl %edx, %ecx
+    shrl $2, %ecx
+    andl $3, %edx
+1:  rep movsl
+    movl %edx, %ecx
+2:  rep movsb
+    xorl %eax, %eax
+    popl %edi
+    popl %esi
+    ret
+
+3:  leal (%edx,%ecx,4), %eax
+    popl %edi
+    popl %esi
+    ret
+
+4:  movl %ecx, %eax
+    popl %edi
+    popl %esi
+    ret
+
+.section __ex_table, "a"
+    .long 1b, 3b
+    .long 2b, 4b
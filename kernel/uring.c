@@ -0,0 +1,183 @@
+#include "uring.h"
+
+#include "spinlock.h"
+#include "proc.h"
+#include "memory.h"
+#include "syscall.h"
+#include "config.h"
+#include "uaccess.h"
+
+struct uring
+{
+    struct process *owner;
+    struct uring_shared *shared;
+    /* Both arrays live in the shared region; each SQE is copied out before use. */
+    struct uring_sqe *sqes;
+    struct uring_cqe *cqes;
+    /* Snapshotted at setup, so user code cannot widen indexing past the arrays. */
+    uint32_t sq_mask;
+    uint32_t cq_mask;
+};
+
+static spinlock_t uring_lock;
+static struct uring rings[CONFIG_URING_MAX];
+
+static struct uring *uring_lookup(struct process *proc)
+{
+    if (!proc)
+        return NULL;
+    for (size_t i = 0; i < CONFIG_URING_MAX; ++i)
+    {
+        if (rings[i].owner == proc)
+            return &rings[i];
+    }
+    return NULL;
+}
+
+void uring_init(void)
+{
+    spinlock_init_named(&uring_lock, "uring");
+    for (size_t i = 0; i < CONFIG_URING_MAX; ++i)
+    {
+        rings[i].owner = NULL;
+        rings[i].shared = NULL;
+    }
+}
+
+int uring_setup(uint32_t entries, struct uring_shared **out)
+{
+    struct process *self = process_current();
+    if (!self || !out || entries == 0 || entries > CONFIG_URING_MAX_ENTRIES)
+        return -1;
+
+    uint32_t sq_entries = 1;
+    while (sq_entries < entries)
+        sq_entries <<= 1;
+    uint32_t cq_entries = sq_entries * 2u;
+
+    size_t bytes = sizeof(struct uring_shared) + sq_entries * sizeof(struct uring_sqe) +
+                   cq_entries * sizeof(struct uring_cqe);
+    struct uring_shared *shared = (struct uring_shared *)kalloc(bytes);
+    if (!shared)
+        return -1;
+
+    shared->sq_head = 0;
+    shared->sq_tail = 0;
+    shared->cq_head = 0;
+    shared->cq_tail = 0;
+    shared->sq_entries = sq_entries;
+    shared->cq_entries = cq_entries;
+    shared->sqes = (struct uring_sqe *)(shared + 1);
+    shared->cqes = (struct uring_cqe *)(shared->sqes + sq_entries);
+
+    struct uring *ring = NULL;
+    uint32_t flags;
+    spinlock_lock_irqsave(&uring_lock, &flags);
+    if (!uring_lookup(self))
+    {
+        ring = uring_lookup(NULL);
+        if (ring)
+        {
+            ring->owner = self;
+            ring->shared = shared;
+            ring->sqes = shared->sqes;
+            ring->cqes = shared->cqes;
+            ring->sq_mask = sq_entries - 1u;
+            ring->cq_mask = cq_entries - 1u;
+        }
+    }
+    spinlock_unlock_irqrestore(&uring_lock, flags);
+
+    if (!ring)
+    {
+        kfree(shared);
+        return -1;
+    }
+    if (copy_to_user(out, &shared, sizeof(shared)) < 0)
+    {
+        spinlock_lock_irqsave(&uring_lock, &flags);
+        ring->owner = NULL;
+        ring->shared = NULL;
+        spinlock_unlock_irqrestore(&uring_lock, flags);
+        kfree(shared);
+        return -EFAULT;
+    }
+    return 0;
+}
+
+static int32_t uring_issue(const struct uring_sqe *sqe)
+{
+    /* A nested enter would consume the entries behind this one out of order. */
+    if (sqe->number == SYS_RING_ENTER || sqe->number == SYS_URING_SETUP)
+        return -1;
+    if (sqe->argc > 4u)
+        return -1;
+
+    struct syscall_envelope msg;
+    msg.number = sqe->number;
+    msg.argc = sqe->argc;
+    for (size_t i = 0; i < 4; ++i)
+        msg.args[i] = sqe->args[i];
+    msg.args[4] = 0;
+    msg.args[5] = 0;
+    msg.result = 0;
+    msg.status = 0;
+    return syscall_dispatch(&msg);
+}
+
+int uring_enter(uint32_t to_submit, uint32_t min_complete)
+{
+    /* Only the owner touches its ring, so no lock is held while entries run. */
+    struct uring *ring = uring_lookup(process_current());
+    if (!ring)
+        return -1;
+    if (min_complete > ring->cq_mask + 1u)
+        return -1;
+
+    struct uring_shared *shared = ring->shared;
+    uint32_t submitted = 0;
+    while (submitted < to_submit)
+    {
+        uint32_t sq_head = shared->sq_head;
+        if (sq_head == shared->sq_tail)
+            break;
+        uint32_t cq_tail = shared->cq_tail;
+        if (cq_tail - shared->cq_head > ring->cq_mask)
+            break;
+
+        struct uring_sqe sqe = ring->sqes[sq_head & ring->sq_mask];
+        __sync_synchronize();
+        shared->sq_head = sq_head + 1u;
+
+        int32_t result = uring_issue(&sqe);
+
+        struct uring_cqe *cqe = &ring->cqes[cq_tail & ring->cq_mask];
+        cqe->user_data = sqe.user_data;
+        cqe->result = result;
+        __sync_synchronize();
+        shared->cq_tail = cq_tail + 1u;
+        ++submitted;
+    }
+    return (int)submitted;
+}
+
+void uring_process_cleanup(struct process *proc)
+{
+    if (!proc)
+        return;
+
+    struct uring_shared *shared = NULL;
+    uint32_t flags;
+    spinlock_lock_irqsave(&uring_lock, &flags);
+    struct uring *ring = uring_lookup(proc);
+    if (ring)
+    {
+        shared = ring->shared;
+        ring->owner = NULL;
+        ring->shared = NULL;
+    }
+    spinlock_unlock_irqrestore(&uring_lock, flags);
+
+    if (shared)
+        kfree(shared);
+}
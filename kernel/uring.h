@@ -0,0 +1,45 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "uring_types.h"
+
+struct process;
+
+/**
+ * Per-process submission/completion rings for batching syscalls.
+ *
+ * A process queues any number of syscalls in its submission ring and runs
+ * them all with one uring_enter(); each result lands in the completion
+ * ring where it can be reaped without another trap. Entries run in order
+ * on the caller's thread, so an entry that blocks holds up the ones behind
+ * it. The kernel keeps its own copy of the ring geometry and masks every
+ * index, so a process scribbling over the shared header only hurts itself.
+ */
+
+void uring_init(void);
+/**
+ * @brief Give the caller a ring pair with @p entries submission slots.
+ *
+ * @param entries rounded up to a power of two, at most CONFIG_URING_MAX_ENTRIES;
+ *        the completion ring gets twice as many slots.
+ * @param out receives the shared header.
+ * @return 0, -EFAULT if @p out could not be written, or -1.
+ */
+int uring_setup(uint32_t entries, struct uring_shared **out);
+/**
+ * @brief Run up to @p to_submit queued entries.
+ *
+ * Stops early when the submission ring runs dry or the completion ring is
+ * full. Every consumed entry has completed by the time this returns, so
+ * @p min_complete never has to sleep; it is only rejected when it could
+ * not fit in the completion ring.
+ *
+ * @return the number of entries consumed, or -1.
+ */
+int uring_enter(uint32_t to_submit, uint32_t min_complete);
+void uring_process_cleanup(struct process *proc);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef URING_TYPES_H
+#define URING_TYPES_H
+
+#include <stdint.h>
+
+/** One queued syscall: any number from enum syscall_number with up to four arguments. */
+struct uring_sqe
+{
+    uint32_t number;
+    uint32_t argc;
+    uint32_t args[4];
+    /** Copied unchanged into the completion. */
+    uint32_t user_data;
+    uint32_t reserved;
+};
+
+struct uring_cqe
+{
+    uint32_t user_data;
+    /** What the syscall returned; -1 for entries the ring refuses to run. */
+    int32_t result;
+};
+
+/**
+ * Header of a submission/completion ring pair shared with its process.
+ *
+ * The process fills sqes[sq_tail % sq_entries] and then advances sq_tail;
+ * the kernel advances sq_head as it consumes them. Completions go the
+ * other way through cq_tail (kernel) and cq_head (process). Both counters
+ * run freely and are masked on use; the entry counts are powers of two.
+ */
+struct uring_shared
+{
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    struct uring_sqe *sqes;
+    struct uring_cqe *cqes;
+};
+
+#endif
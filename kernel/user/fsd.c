@@ -2,11 +2,42 @@
 #include "../service_types.h"
 #include "../ipc_types.h"
 
+#define FSD_COOKIE_MAILBOX 1u
+#define FSD_COOKIE_CALLS   2u
+
 void user_fsd(void)
 {
+    struct evset_event events[2];
+    uint8_t request[CONFIG_MSG_DATA_MAX];
+    /* No filesystem operations are served over IPC yet; every request is refused. */
+    const struct service_reply unsupported = { SERVICE_STATUS_UNSUPPORTED };
+
+    int set = sys_evset_create();
+    if (set < 0 || sys_evset_add(set, EVSET_SOURCE_MAILBOX, 0, FSD_COOKIE_MAILBOX) < 0 ||
+        sys_evset_add(set, EVSET_SOURCE_CALLS, 0, FSD_COOKIE_CALLS) < 0)
+    {
+        for (;;)
+            sys_sleep(10);
+    }
+
     for (;;)
     {
-        /* TODO: handle filesystem requests via IPC */
-        sys_sleep(10);
+        int ready = sys_evset_wait(set, events, 2, 0);
+        for (int i = 0; i < ready; ++i)
+        {
+            if (events[i].cookie == FSD_COOKIE_CALLS)
+            {
+                service_refuse_calls(request, sizeof(request), events[i].count);
+                continue;
+            }
+            for (uint32_t n = 0; n < events[i].count; ++n)
+            {
+                pid_t sender = 0;
+                if (sys_ipc_recv_from(IPC_ANY_PROCESS, request, sizeof(request), 1, &sender) <= 0)
+                    break;
+                if (sender > 0)
+                    sys_ipc_send(sender, &unsupported, sizeof(unsupported));
+            }
+        }
     }
 }
@@ -2,11 +2,50 @@
 #include "../service_types.h"
 #include "../ipc_types.h"
 
+#define INPUTD_COOKIE_KEYBOARD 1u
+#define INPUTD_COOKIE_MAILBOX  2u
+#define INPUTD_COOKIE_CALLS    3u
+
 void user_inputd(void)
 {
+    struct evset_event events[4];
+    uint8_t request[CONFIG_MSG_DATA_MAX];
+    /* No requests are defined for this service yet; every one is refused. */
+    const struct service_reply unsupported = { SERVICE_STATUS_UNSUPPORTED };
+
+    int set = sys_evset_create();
+    if (set < 0)
+    {
+        for (;;)
+            sys_sleep(10);
+    }
+    sys_evset_add(set, EVSET_SOURCE_IRQ, 1, INPUTD_COOKIE_KEYBOARD);
+    sys_evset_add(set, EVSET_SOURCE_MAILBOX, 0, INPUTD_COOKIE_MAILBOX);
+    sys_evset_add(set, EVSET_SOURCE_CALLS, 0, INPUTD_COOKIE_CALLS);
+
     for (;;)
     {
-        /* TODO: translate keyboard/mouse events via IPC */
-        sys_sleep(10);
+        int ready = sys_evset_wait(set, events, 4, 0);
+        for (int i = 0; i < ready; ++i)
+        {
+            if (events[i].cookie == INPUTD_COOKIE_KEYBOARD)
+            {
+                /* keyboard.c already translates scancodes into the console buffer; nothing subscribes here yet. */
+                continue;
+            }
+            if (events[i].cookie == INPUTD_COOKIE_CALLS)
+            {
+                service_refuse_calls(request, sizeof(request), events[i].count);
+                continue;
+            }
+            for (uint32_t n = 0; n < events[i].count; ++n)
+            {
+                pid_t sender = 0;
+                if (sys_ipc_recv_from(IPC_ANY_PROCESS, request, sizeof(request), 1, &sender) <= 0)
+                    break;
+                if (sender > 0)
+                    sys_ipc_send(sender, &unsupported, sizeof(unsupported));
+            }
+        }
     }
 }
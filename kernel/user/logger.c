@@ -8,6 +8,7 @@ struct logger_event
 	uint8_t reserved0;
 	uint8_t reserved1;
 	uint8_t reserved2;
+	uint64_t timestamp_ns;
 	char module[CONFIG_KLOG_MODULE_NAME_LEN];
 	char text[CONFIG_KLOG_ENTRY_LEN];
 };
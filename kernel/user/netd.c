@@ -2,11 +2,58 @@
 #include "../service_types.h"
 #include "../ipc_types.h"
 
+#define NETD_COOKIE_SOCKET  1u
+#define NETD_COOKIE_MAILBOX 2u
+#define NETD_COOKIE_CALLS   3u
+#define NETD_FRAME_MAX      1600
+
 void user_netd(void)
 {
+    static uint8_t frame[NETD_FRAME_MAX];
+    struct evset_event events[4];
+    uint8_t request[CONFIG_MSG_DATA_MAX];
+    /* No requests are defined for this service yet; every one is refused. */
+    const struct service_reply unsupported = { SERVICE_STATUS_UNSUPPORTED };
+
+    int set = sys_evset_create();
+    if (set < 0)
+    {
+        for (;;)
+            sys_sleep(10);
+    }
+
+    /* No NIC means no socket; netd then only serves its mailbox. */
+    int sock = sys_net_open();
+    if (sock >= 0)
+        sys_evset_add(set, EVSET_SOURCE_NET, sock, NETD_COOKIE_SOCKET);
+    sys_evset_add(set, EVSET_SOURCE_MAILBOX, 0, NETD_COOKIE_MAILBOX);
+    sys_evset_add(set, EVSET_SOURCE_CALLS, 0, NETD_COOKIE_CALLS);
+
     for (;;)
     {
-        /* TODO: handle networking workloads */
-        sys_sleep(10);
+        int ready = sys_evset_wait(set, events, 4, 0);
+        for (int i = 0; i < ready; ++i)
+        {
+            if (events[i].cookie == NETD_COOKIE_SOCKET)
+            {
+                /* netd runs no protocols yet; drain the frames so the socket queue does not stall. */
+                while (sys_net_recv(sock, frame, sizeof(frame)) > 0)
+                    ;
+                continue;
+            }
+            if (events[i].cookie == NETD_COOKIE_CALLS)
+            {
+                service_refuse_calls(request, sizeof(request), events[i].count);
+                continue;
+            }
+            for (uint32_t n = 0; n < events[i].count; ++n)
+            {
+                pid_t sender = 0;
+                if (sys_ipc_recv_from(IPC_ANY_PROCESS, request, sizeof(request), 1, &sender) <= 0)
+                    break;
+                if (sender > 0)
+                    sys_ipc_send(sender, &unsupported, sizeof(unsupported));
+            }
+        }
     }
 }
@@ -4,13 +4,17 @@
 #include "../syscall.h"
 #include "../ipc_types.h"
 #include "../service_types.h"
+#include "../clock.h"
+#include "../ipc_ring.h"
+#include "../evset_types.h"
+#include "../uring_types.h"
 #include <stddef.h>
 #include <stdint.h>
 
 #define USER_SCHED_POLICY_FAIR 0u
 #define USER_SCHED_POLICY_DEADLINE 1u
 
-static inline int32_t sys_call(uint32_t number, uint32_t argc, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3)
+static inline int32_t sys_call6(uint32_t number, uint32_t argc, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5)
 {
     struct syscall_envelope request;
     request.number = number;
@@ -19,6 +23,8 @@ static inline int32_t sys_call(uint32_t number, uint32_t argc, uint32_t arg0, ui
     request.args[1] = arg1;
     request.args[2] = arg2;
     request.args[3] = arg3;
+    request.args[4] = arg4;
+    request.args[5] = arg5;
     request.result = 0;
     request.status = 0;
 
@@ -27,6 +33,14 @@ static inline int32_t sys_call(uint32_t number, uint32_t argc, uint32_t arg0, ui
     return request.result;
 }
 
+/* Up to four arguments go in registers through SYSENTER when the CPU has it. */
+static inline int32_t sys_call(uint32_t number, uint32_t argc, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    if (syscall_fast_enabled)
+        return syscall_fast_call(number | (argc << SYSCALL_FAST_ARGC_SHIFT), arg0, arg1, arg2, arg3);
+    return sys_call6(number, argc, arg0, arg1, arg2, arg3, 0, 0);
+}
+
 static inline int sys_write(const char *buf, size_t len)
 {
     return (int)sys_call(SYS_WRITE, 2, (uint32_t)(uintptr_t)buf, (uint32_t)len, 0, 0);
@@ -52,6 +66,32 @@ static inline int sys_sleep(uint32_t ticks)
     return (int)sys_call(SYS_SLEEP, 1, ticks, 0, 0, 0);
 }
 
+static inline int sys_sleep_ns(uint64_t ns)
+{
+    return (int)sys_call(SYS_SLEEP_NS, 2, (uint32_t)ns, (uint32_t)(ns >> 32), 0, 0);
+}
+
+static inline int sys_clock_get(uint32_t clock_id, uint64_t *out_ns)
+{
+    return (int)sys_call(SYS_CLOCK_GET, 2, clock_id, (uint32_t)(uintptr_t)out_ns, 0, 0);
+}
+
+static inline const struct clock_time_page *sys_time_page(void)
+{
+    return (const struct clock_time_page *)(uintptr_t)sys_call(SYS_TIME_PAGE, 0, 0, 0, 0, 0);
+}
+
+/* Read clocks from the shared time page; the page is looked up once per caller. */
+static inline uint64_t time_page_monotonic_ns(const struct clock_time_page *page)
+{
+    return clock_time_page_read(page, CLOCK_MONOTONIC);
+}
+
+static inline uint64_t time_page_realtime_ns(const struct clock_time_page *page)
+{
+    return clock_time_page_read(page, CLOCK_REALTIME);
+}
+
 static inline int sys_ipc_send(pid_t target, const void *buffer, size_t size)
 {
     return (int)sys_call(SYS_IPC_SEND, 3, (uint32_t)target, (uint32_t)(uintptr_t)buffer, (uint32_t)size, 0);
@@ -62,6 +102,39 @@ static inline int sys_ipc_recv(pid_t source, void *buffer, size_t max)
     return (int)sys_call(SYS_IPC_RECV, 3, (uint32_t)source, (uint32_t)(uintptr_t)buffer, (uint32_t)max, 0);
 }
 
+/* Returns 0 if nothing arrived within timeout_ticks. */
+static inline int sys_ipc_recv_timeout(pid_t source, void *buffer, size_t max, uint32_t timeout_ticks)
+{
+    return (int)sys_call(SYS_IPC_RECV, 4, (uint32_t)source, (uint32_t)(uintptr_t)buffer, (uint32_t)max, timeout_ticks);
+}
+
+/* Like sys_ipc_recv_timeout(); *out_sender names who sent the message. */
+static inline int sys_ipc_recv_from(pid_t source, void *buffer, size_t max, uint32_t timeout_ticks, pid_t *out_sender)
+{
+    return (int)sys_call6(SYS_IPC_RECV, 5, (uint32_t)source, (uint32_t)(uintptr_t)buffer, (uint32_t)max, timeout_ticks,
+                          (uint32_t)(uintptr_t)out_sender, 0);
+}
+
+/* Returns the reply length; the server runs on our time slice until it answers. */
+static inline int sys_ipc_call(pid_t target, const void *request, size_t request_size, void *reply, size_t reply_max)
+{
+    return (int)sys_call6(SYS_IPC_CALL, 5, (uint32_t)target, (uint32_t)(uintptr_t)request, (uint32_t)request_size,
+                          (uint32_t)(uintptr_t)reply, (uint32_t)reply_max, 0);
+}
+
+/* Reply to `client` (<= 0 for none), then wait for the next call; *out_client names its sender. */
+static inline int sys_ipc_reply_wait(pid_t client, const void *reply, size_t reply_size, pid_t *out_client, void *buffer, size_t max)
+{
+    return (int)sys_call6(SYS_IPC_REPLY_WAIT, 6, (uint32_t)client, (uint32_t)(uintptr_t)reply, (uint32_t)reply_size,
+                          (uint32_t)(uintptr_t)out_client, (uint32_t)(uintptr_t)buffer, (uint32_t)max);
+}
+
+/* Take the oldest queued call without blocking; -1 if none. Answer it with sys_ipc_reply_wait(client, ..., NULL, NULL, 0). */
+static inline int sys_ipc_accept(pid_t *out_client, void *buffer, size_t max)
+{
+    return (int)sys_call(SYS_IPC_ACCEPT, 3, (uint32_t)(uintptr_t)out_client, (uint32_t)(uintptr_t)buffer, (uint32_t)max, 0);
+}
+
 static inline int sys_ipc_share(pid_t target, void *addr, size_t pages)
 {
     return (int)sys_call(SYS_IPC_SHARE, 3, (uint32_t)target, (uint32_t)(uintptr_t)addr, (uint32_t)pages, 0);
@@ -72,12 +145,38 @@ static inline int sys_service_connect(enum system_service service, uint32_t righ
     return (int)sys_call(SYS_SERVICE_CONNECT, 2, (uint32_t)service, rights, 0, 0);
 }
 
+/* Accept up to `count` queued calls (an EVSET_SOURCE_CALLS event) and answer each with SERVICE_STATUS_UNSUPPORTED. */
+static inline void service_refuse_calls(void *request, size_t max, uint32_t count)
+{
+    const struct service_reply unsupported = { SERVICE_STATUS_UNSUPPORTED };
+    for (uint32_t n = 0; n < count; ++n)
+    {
+        pid_t client = 0;
+        if (sys_ipc_accept(&client, request, max) < 0)
+            break;
+        sys_ipc_reply_wait(client, &unsupported, sizeof(unsupported), NULL, NULL, 0);
+    }
+}
+
 static inline int sys_sched_set(int pid, uint8_t policy, uint32_t weight, uint64_t deadline_ticks)
 {
     uint32_t deadline_low = (uint32_t)(deadline_ticks & 0xFFFFFFFFu);
     return (int)sys_call(SYS_SCHED_SET, 4, (uint32_t)pid, (uint32_t)policy, weight, deadline_low);
 }
 
+/* Deadline task served by a constant-bandwidth server: `runtime` ticks every `period` ticks. */
+static inline int sys_sched_set_cbs(int pid, uint64_t deadline_ticks, uint32_t runtime, uint32_t period)
+{
+    uint32_t deadline_low = (uint32_t)(deadline_ticks & 0xFFFFFFFFu);
+    return (int)sys_call6(SYS_SCHED_SET, 6, (uint32_t)pid, USER_SCHED_POLICY_DEADLINE, 0, deadline_low, runtime, period);
+}
+
+/* Bit n of `mask` allows CPU n; pid 0 means the caller. Only CPU 0 is granted for now. */
+static inline int sys_sched_affinity(int pid, uint32_t mask)
+{
+    return (int)sys_call(SYS_SCHED_AFFINITY, 2, (uint32_t)pid, mask, 0, 0);
+}
+
 static inline int sys_mutex_create(void)
 {
     return (int)sys_call(SYS_MUTEX_CREATE, 0, 0, 0, 0, 0);
@@ -108,11 +207,237 @@ static inline int sys_sem_post(int id)
     return (int)sys_call(SYS_SEM_POST, 1, (uint32_t)id, 0, 0, 0);
 }
 
+/* Sleeps only while *addr == expected; 0 after a wake or mismatch, 1 on timeout. */
+static inline int sys_futex_wait(volatile uint32_t *addr, uint32_t expected, uint32_t timeout_ticks)
+{
+    return (int)sys_call(SYS_FUTEX_WAIT, 3, (uint32_t)(uintptr_t)addr, expected, timeout_ticks, 0);
+}
+
+static inline int sys_futex_wake(volatile uint32_t *addr, uint32_t count)
+{
+    return (int)sys_call(SYS_FUTEX_WAKE, 2, (uint32_t)(uintptr_t)addr, count, 0, 0);
+}
+
+/*
+ * Mutex living in caller memory: 0 free, 1 held, 2 held with sleepers.
+ * Lock and unlock are one atomic each unless another thread is involved;
+ * only then does either side trap into sys_futex_wait/sys_futex_wake.
+ */
+struct futex_mutex
+{
+    volatile uint32_t state;
+};
+
+#define FUTEX_MUTEX_INIT { 0u }
+
+static inline void futex_mutex_lock(struct futex_mutex *mutex)
+{
+    uint32_t seen = __sync_val_compare_and_swap(&mutex->state, 0u, 1u);
+    if (seen == 0u)
+        return;
+
+    /* Mark the word contended before sleeping so the holder's unlock wakes us. */
+    if (seen != 2u)
+        seen = __sync_lock_test_and_set(&mutex->state, 2u);
+    while (seen != 0u)
+    {
+        sys_futex_wait(&mutex->state, 2u, 0);
+        seen = __sync_lock_test_and_set(&mutex->state, 2u);
+    }
+}
+
+static inline int futex_mutex_trylock(struct futex_mutex *mutex)
+{
+    return __sync_bool_compare_and_swap(&mutex->state, 0u, 1u);
+}
+
+static inline void futex_mutex_unlock(struct futex_mutex *mutex)
+{
+    if (__sync_fetch_and_sub(&mutex->state, 1u) == 1u)
+        return;
+    mutex->state = 0u;
+    sys_futex_wake(&mutex->state, 1u);
+}
+
+/* Counting semaphore with the same shape: post only traps when someone sleeps. */
+struct futex_sem
+{
+    volatile uint32_t count;
+    volatile uint32_t sleepers;
+};
+
+#define FUTEX_SEM_INIT(initial) { (uint32_t)(initial), 0u }
+
+static inline int futex_sem_trywait(struct futex_sem *sem)
+{
+    uint32_t seen = sem->count;
+    while (seen != 0u)
+    {
+        uint32_t prior = __sync_val_compare_and_swap(&sem->count, seen, seen - 1u);
+        if (prior == seen)
+            return 1;
+        seen = prior;
+    }
+    return 0;
+}
+
+static inline void futex_sem_wait(struct futex_sem *sem)
+{
+    while (!futex_sem_trywait(sem))
+    {
+        __sync_fetch_and_add(&sem->sleepers, 1u);
+        sys_futex_wait(&sem->count, 0u, 0);
+        __sync_fetch_and_sub(&sem->sleepers, 1u);
+    }
+}
+
+static inline void futex_sem_post(struct futex_sem *sem)
+{
+    __sync_fetch_and_add(&sem->count, 1u);
+    if (sem->sleepers)
+        sys_futex_wake(&sem->count, 1u);
+}
+
+/* Share `pages` at page-aligned `addr` with `peer` as a ring of `slot_size`-byte messages; returns the ring id. */
+static inline int sys_ring_create(pid_t peer, void *addr, size_t pages, uint32_t slot_size, uint32_t flags)
+{
+    return (int)sys_call6(SYS_RING_CREATE, 5, (uint32_t)peer, (uint32_t)(uintptr_t)addr, (uint32_t)pages, slot_size, flags, 0);
+}
+
+/* The peer's way to find the ring it was told about; NULL unless it is one of the two ends. */
+static inline struct ipc_ring_header *sys_ring_attach(int ring_id)
+{
+    int32_t addr = sys_call(SYS_RING_ATTACH, 1, (uint32_t)ring_id, 0, 0, 0);
+    return (addr < 0) ? NULL : (struct ipc_ring_header *)(uintptr_t)addr;
+}
+
+static inline int sys_ring_doorbell(int ring_id)
+{
+    return (int)sys_call(SYS_RING_DOORBELL, 1, (uint32_t)ring_id, 0, 0, 0);
+}
+
+/* 0 once the ring holds a message, 1 on timeout. */
+static inline int sys_ring_wait(int ring_id, uint32_t timeout_ticks)
+{
+    return (int)sys_call(SYS_RING_WAIT, 2, (uint32_t)ring_id, timeout_ticks, 0, 0);
+}
+
+/*
+ * Producer side: fill slot->data after ipc_ring_reserve(), then post it.
+ * The doorbell syscall is made only when the consumer is asleep.
+ */
+static inline void ring_post(struct ipc_ring_header *ring, int ring_id, struct ipc_ring_slot *slot, uint32_t pos, uint32_t length)
+{
+    if (ipc_ring_commit(ring, slot, pos, length))
+        sys_ring_doorbell(ring_id);
+}
+
+/* Consumer side: the next message, read in place until ipc_ring_release(); sleeps while the ring is empty. */
+static inline struct ipc_ring_slot *ring_next(struct ipc_ring_header *ring, int ring_id)
+{
+    struct ipc_ring_slot *slot;
+    while (!(slot = ipc_ring_peek(ring)))
+    {
+        if (sys_ring_wait(ring_id, 0) < 0)
+            return NULL;
+    }
+    return slot;
+}
+
+static inline int sys_evset_create(void)
+{
+    return (int)sys_call(SYS_EVSET_CREATE, 0, 0, 0, 0, 0);
+}
+
+/* Watch one source (see enum evset_source); `cookie` comes back in its events. */
+static inline int sys_evset_add(int set, uint32_t kind, int32_t id, uint32_t cookie)
+{
+    return (int)sys_call(SYS_EVSET_ADD, 4, (uint32_t)set, kind, (uint32_t)id, cookie);
+}
+
+static inline int sys_evset_remove(int set, uint32_t kind, int32_t id)
+{
+    return (int)sys_call(SYS_EVSET_REMOVE, 3, (uint32_t)set, kind, (uint32_t)id, 0);
+}
+
+/* Sleeps until a source is ready and returns how many events were written; 0 on timeout. */
+static inline int sys_evset_wait(int set, struct evset_event *events, size_t max, uint32_t timeout_ticks)
+{
+    return (int)sys_call(SYS_EVSET_WAIT, 4, (uint32_t)set, (uint32_t)(uintptr_t)events, (uint32_t)max, timeout_ticks);
+}
+
+static inline int sys_net_open(void)
+{
+    return (int)sys_call(SYS_NET_OPEN, 0, 0, 0, 0, 0);
+}
+
+static inline int sys_net_send(int sock, const void *data, size_t size)
+{
+    return (int)sys_call(SYS_NET_SEND, 3, (uint32_t)sock, (uint32_t)(uintptr_t)data, (uint32_t)size, 0);
+}
+
+/* Returns the frame length, 0 when none is queued. */
+static inline int sys_net_recv(int sock, void *buffer, size_t max)
+{
+    return (int)sys_call(SYS_NET_RECV, 3, (uint32_t)sock, (uint32_t)(uintptr_t)buffer, (uint32_t)max, 0);
+}
+
+static inline int sys_uring_setup(uint32_t entries, struct uring_shared **out)
+{
+    return (int)sys_call(SYS_URING_SETUP, 2, entries, (uint32_t)(uintptr_t)out, 0, 0);
+}
+
+/* Runs up to `to_submit` queued entries in one trap; returns how many were consumed. */
+static inline int sys_ring_enter(uint32_t to_submit, uint32_t min_complete)
+{
+    return (int)sys_call(SYS_RING_ENTER, 2, to_submit, min_complete, 0, 0);
+}
+
+/* Queue one syscall without entering the kernel; -1 when the submission ring is full. */
+static inline int uring_queue(struct uring_shared *ring, uint32_t number, uint32_t argc, uint32_t arg0, uint32_t arg1,
+                              uint32_t arg2, uint32_t arg3, uint32_t user_data)
+{
+    uint32_t tail = ring->sq_tail;
+    if (tail - ring->sq_head >= ring->sq_entries)
+        return -1;
+
+    struct uring_sqe *sqe = &ring->sqes[tail & (ring->sq_entries - 1u)];
+    sqe->number = number;
+    sqe->argc = argc;
+    sqe->args[0] = arg0;
+    sqe->args[1] = arg1;
+    sqe->args[2] = arg2;
+    sqe->args[3] = arg3;
+    sqe->user_data = user_data;
+    __sync_synchronize();
+    ring->sq_tail = tail + 1u;
+    return 0;
+}
+
+/* Pop one completion into *out; returns 0 when none are waiting. */
+static inline int uring_reap(struct uring_shared *ring, struct uring_cqe *out)
+{
+    uint32_t head = ring->cq_head;
+    if (head == ring->cq_tail)
+        return 0;
+
+    __sync_synchronize();
+    *out = ring->cqes[head & (ring->cq_entries - 1u)];
+    ring->cq_head = head + 1u;
+    return 1;
+}
+
 static inline int sys_chan_create(const char *name, size_t name_len, uint32_t flags)
 {
     return (int)sys_call(SYS_CHAN_CREATE, 3, (uint32_t)(uintptr_t)name, (uint32_t)name_len, flags, 0);
 }
 
+/* Queue up to `ring_bytes` of messages; each costs 16 bytes plus its padded payload. */
+static inline int sys_chan_create_sized(const char *name, size_t name_len, uint32_t flags, uint32_t ring_bytes)
+{
+    return (int)sys_call(SYS_CHAN_CREATE, 4, (uint32_t)(uintptr_t)name, (uint32_t)name_len, flags, ring_bytes);
+}
+
 static inline int sys_chan_join(int channel_id)
 {
     return (int)sys_call(SYS_CHAN_JOIN, 1, (uint32_t)channel_id, 0, 0, 0);
@@ -143,6 +468,11 @@ static inline int sys_chan_recv(int channel_id, struct ipc_message *message, uin
     return (int)sys_call(SYS_RECV, 3, (uint32_t)channel_id, (uint32_t)(uintptr_t)message, flags, 0);
 }
 
+static inline int sys_chan_recv_timeout(int channel_id, struct ipc_message *message, uint32_t flags, uint32_t timeout_ticks)
+{
+    return (int)sys_call(SYS_RECV, 4, (uint32_t)channel_id, (uint32_t)(uintptr_t)message, flags, timeout_ticks);
+}
+
 static inline void sys_exit(int code)
 {
     (void)sys_call(SYS_EXIT, 1, (uint32_t)code, 0, 0, 0);
@@ -28,8 +28,8 @@ struct boot_info
     uint32_t font_char_count;
     uint32_t font_flags;
     uint32_t boot_drive;
-    uint32_t reserved0;
-    uint32_t reserved1;
+    uint32_t mem_map_ptr;
+    uint32_t mem_map_count;
     uint32_t reserved2;
 };
 
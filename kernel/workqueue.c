@@ -0,0 +1,262 @@
+#include "workqueue.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "config.h"
+
+#include <stddef.h>
+
+struct work_queue
+{
+    spinlock_t lock;
+    struct work_item *head;
+    struct work_item *tail;
+    struct process *worker;
+};
+
+static struct work_queue queues[WORK_PRIORITY_COUNT];
+
+static spinlock_t tasklet_lock;
+static struct tasklet *tasklet_head = NULL;
+static struct tasklet *tasklet_tail = NULL;
+
+static struct workqueue_stats stats;
+
+/* Fair-share weight of each priority's worker thread. */
+static const uint32_t worker_weight[WORK_PRIORITY_COUNT] = {
+    CONFIG_SCHED_DEFAULT_WEIGHT * 8u,
+    CONFIG_SCHED_DEFAULT_WEIGHT,
+    CONFIG_SCHED_DEFAULT_WEIGHT / 4u,
+};
+
+void workqueue_init(void)
+{
+    for (uint32_t i = 0; i < WORK_PRIORITY_COUNT; ++i)
+    {
+        spinlock_init_named(&queues[i].lock, "workqueue");
+        queues[i].head = NULL;
+        queues[i].tail = NULL;
+        queues[i].worker = NULL;
+    }
+    spinlock_init_named(&tasklet_lock, "workqueue.tasklet");
+    tasklet_head = NULL;
+    tasklet_tail = NULL;
+    stats = (struct workqueue_stats){ { 0 }, { 0 }, 0, 0, 0, 0 };
+}
+
+void work_init(struct work_item *work, deferred_fn_t fn, void *data, work_priority_t priority)
+{
+    if (!work)
+        return;
+    work->next = NULL;
+    work->fn = fn;
+    work->data = data;
+    work->priority = (priority < WORK_PRIORITY_COUNT) ? (uint8_t)priority : (uint8_t)WORK_PRIORITY_NORMAL;
+    work->pending = 0;
+}
+
+static void workqueue_kick(struct work_queue *queue)
+{
+    struct process *worker = queue->worker;
+    if (worker)
+        process_wake(worker);
+}
+
+int workqueue_queue(struct work_item *work)
+{
+    if (!work || !work->fn || work->priority >= WORK_PRIORITY_COUNT)
+        return -1;
+    if (__sync_lock_test_and_set(&work->pending, 1u))
+        return 0;
+
+    struct work_queue *queue = &queues[work->priority];
+    uint32_t flags;
+    spinlock_lock_irqsave(&queue->lock, &flags);
+    work->next = NULL;
+    if (queue->tail)
+        queue->tail->next = work;
+    else
+        queue->head = work;
+    queue->tail = work;
+    ++stats.queued[work->priority];
+    spinlock_unlock_irqrestore(&queue->lock, flags);
+
+    workqueue_kick(queue);
+    return 1;
+}
+
+static struct work_item *workqueue_pop(struct work_queue *queue)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&queue->lock, &flags);
+    struct work_item *work = queue->head;
+    if (work)
+    {
+        queue->head = work->next;
+        if (!queue->head)
+            queue->tail = NULL;
+        work->next = NULL;
+    }
+    spinlock_unlock_irqrestore(&queue->lock, flags);
+    return work;
+}
+
+void tasklet_init(struct tasklet *tasklet, deferred_fn_t fn, void *data)
+{
+    if (!tasklet)
+        return;
+    tasklet->next = NULL;
+    tasklet->fn = fn;
+    tasklet->data = data;
+    tasklet->state = 0;
+}
+
+static void tasklet_enqueue(struct tasklet *tasklet)
+{
+    uint32_t flags;
+    spinlock_lock_irqsave(&tasklet_lock, &flags);
+    tasklet->next = NULL;
+    if (tasklet_tail)
+        tasklet_tail->next = tasklet;
+    else
+        tasklet_head = tasklet;
+    tasklet_tail = tasklet;
+    spinlock_unlock_irqrestore(&tasklet_lock, flags);
+}
+
+int tasklet_schedule(struct tasklet *tasklet)
+{
+    if (!tasklet || !tasklet->fn)
+        return -1;
+    if (__sync_fetch_and_or(&tasklet->state, TASKLET_STATE_SCHEDULED) & TASKLET_STATE_SCHEDULED)
+        return 0;
+
+    tasklet_enqueue(tasklet);
+    __sync_fetch_and_add(&stats.tasklets_scheduled, 1u);
+    return 1;
+}
+
+/*
+ * Run up to @p budget tasklets with interrupts off. A tasklet still running
+ * on another CPU goes back on the queue and ends this pass, leaving it to
+ * that CPU's next exit. Returns 1 if tasklets remain queued.
+ */
+static int tasklet_run(uint32_t budget)
+{
+    uint32_t flags;
+    __asm__ __volatile__("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+
+    int more = 0;
+    for (uint32_t done = 0; done < budget; ++done)
+    {
+        spinlock_lock(&tasklet_lock);
+        struct tasklet *tasklet = tasklet_head;
+        if (tasklet)
+        {
+            tasklet_head = tasklet->next;
+            if (!tasklet_head)
+                tasklet_tail = NULL;
+            tasklet->next = NULL;
+        }
+        more = (tasklet_head != NULL);
+        spinlock_unlock(&tasklet_lock);
+
+        if (!tasklet)
+            break;
+        if (__sync_fetch_and_or(&tasklet->state, TASKLET_STATE_RUNNING) & TASKLET_STATE_RUNNING)
+        {
+            tasklet_enqueue(tasklet);
+            more = 1;
+            break;
+        }
+
+        /* Clear SCHEDULED first so the tasklet may reschedule itself. */
+        __sync_fetch_and_and(&tasklet->state, ~TASKLET_STATE_SCHEDULED);
+        tasklet->fn(tasklet->data);
+        __sync_fetch_and_and(&tasklet->state, ~TASKLET_STATE_RUNNING);
+        __sync_fetch_and_add(&stats.tasklets_run, 1u);
+        more = (tasklet_head != NULL);
+    }
+
+    __asm__ __volatile__("push %0; popf" :: "r"(flags) : "memory");
+    return more;
+}
+
+void tasklet_irq_exit(void)
+{
+    if (!tasklet_head)
+        return;
+    if (!tasklet_run(CONFIG_TASKLET_IRQ_BUDGET))
+        return;
+
+    /* A flood of tasklets must not starve the interrupted thread. */
+    __sync_fetch_and_add(&stats.tasklets_deferred, 1u);
+    workqueue_kick(&queues[WORK_PRIORITY_HIGH]);
+}
+
+static void workqueue_worker(work_priority_t priority)
+{
+    struct work_queue *queue = &queues[priority];
+    queue->worker = process_current();
+    __sync_fetch_and_add(&stats.workers, 1u);
+
+    for (;;)
+    {
+        /* The high worker also mops up tasklets an IRQ exit left behind. */
+        int busy = (priority == WORK_PRIORITY_HIGH) ? tasklet_run(CONFIG_TASKLET_IRQ_BUDGET) : 0;
+
+        struct work_item *work = workqueue_pop(queue);
+        if (work)
+        {
+            deferred_fn_t fn = work->fn;
+            void *data = work->data;
+            __sync_lock_release(&work->pending);
+            fn(data);
+            __sync_fetch_and_add(&stats.completed[priority], 1u);
+            continue;
+        }
+
+        if (busy)
+            process_yield();
+        else
+            process_block_current();
+    }
+}
+
+static void workqueue_worker_high(void)
+{
+    workqueue_worker(WORK_PRIORITY_HIGH);
+}
+
+static void workqueue_worker_normal(void)
+{
+    workqueue_worker(WORK_PRIORITY_NORMAL);
+}
+
+static void workqueue_worker_low(void)
+{
+    workqueue_worker(WORK_PRIORITY_LOW);
+}
+
+void workqueue_start_workers(void)
+{
+    static process_entry_t const entries[WORK_PRIORITY_COUNT] = {
+        workqueue_worker_high,
+        workqueue_worker_normal,
+        workqueue_worker_low,
+    };
+
+    for (uint32_t i = 0; i < WORK_PRIORITY_COUNT; ++i)
+    {
+        int pid = process_create_kernel(entries[i], PROC_STACK_SIZE);
+        if (pid < 0)
+            continue;
+        process_set_scheduler(pid, SCHED_POLICY_FAIR, worker_weight[i], 0, 0, 0, 0);
+    }
+}
+
+void workqueue_get_stats(struct workqueue_stats *out)
+{
+    if (!out)
+        return;
+    *out = stats;
+}
@@ -0,0 +1,88 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stdint.h>
+
+/**
+ * Deferred work for interrupt handlers.
+ *
+ * A top half acknowledges the device, grabs what cannot wait, and hands the
+ * rest to a tasklet or a work item:
+ *  - tasklets run with interrupts off as the outermost handler returns,
+ *    before the interrupted code resumes, and never sleep;
+ *  - work items run in a kernel worker thread per priority, may sleep, and
+ *    compete with other threads for the CPU.
+ */
+
+typedef void (*deferred_fn_t)(void *data);
+
+typedef enum
+{
+    WORK_PRIORITY_HIGH = 0,
+    WORK_PRIORITY_NORMAL = 1,
+    WORK_PRIORITY_LOW = 2,
+    WORK_PRIORITY_COUNT
+} work_priority_t;
+
+/** Owned by the caller; must stay valid while queued or running. */
+struct work_item
+{
+    struct work_item *next;
+    deferred_fn_t fn;
+    void *data;
+    uint8_t priority;
+    /** Set while queued; cleared just before @c fn runs, so it may requeue itself. */
+    volatile uint32_t pending;
+};
+
+struct tasklet
+{
+    struct tasklet *next;
+    deferred_fn_t fn;
+    void *data;
+    /** TASKLET_STATE_* bits. */
+    volatile uint32_t state;
+};
+
+#define TASKLET_STATE_SCHEDULED 0x1u
+/* Held while fn runs, so one tasklet never runs on two CPUs at once. */
+#define TASKLET_STATE_RUNNING   0x2u
+
+#define WORK_ITEM_INIT(func, arg, prio) { NULL, (func), (arg), (prio), 0 }
+#define TASKLET_INIT(func, arg) { NULL, (func), (arg), 0 }
+
+struct workqueue_stats
+{
+    uint32_t queued[WORK_PRIORITY_COUNT];
+    uint32_t completed[WORK_PRIORITY_COUNT];
+    uint32_t tasklets_scheduled;
+    uint32_t tasklets_run;
+    /** Tasklets left over by an IRQ exit that hit its budget and passed to the high worker. */
+    uint32_t tasklets_deferred;
+    uint32_t workers;
+};
+
+/** Set up the queues; safe to call before interrupts are enabled. */
+void workqueue_init(void);
+/** Spawn one worker thread per priority; needs the process system. */
+void workqueue_start_workers(void);
+
+void work_init(struct work_item *work, deferred_fn_t fn, void *data, work_priority_t priority);
+/**
+ * @brief Queue @p work on its priority's worker; callable from IRQ context.
+ * @return 1 if queued, 0 if it was already pending, -1 on bad arguments.
+ */
+int workqueue_queue(struct work_item *work);
+
+void tasklet_init(struct tasklet *tasklet, deferred_fn_t fn, void *data);
+/**
+ * @brief Run @p tasklet at the next interrupt exit; callable from IRQ context.
+ * @return 1 if scheduled, 0 if it was already pending.
+ */
+int tasklet_schedule(struct tasklet *tasklet);
+/** Drain pending tasklets; called by irq_handler() as an interrupt returns. */
+void tasklet_irq_exit(void);
+
+void workqueue_get_stats(struct workqueue_stats *out);
+
+#endif
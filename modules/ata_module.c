@@ -255,7 +255,8 @@ static int ata_block_write(struct block_device *bdev, uint64_t lba, uint32_t cou
 
 static const struct blockdev_ops ata_ops = {
     ata_block_read,
-    ata_block_write
+    ata_block_write,
+    NULL
 };
 
 static int ata_register_device(struct ata_device *dev)
@@ -23,8 +23,8 @@ static size_t local_strlen(const char *s)
 static int pit_start(struct device_node *node)
 {
     (void)node;
-    pit_init(100);
-    klog_info("pit.driver: configured at 100 Hz");
+    pit_init(CONFIG_TIMER_HZ);
+    klog_info("pit.driver: configured at kernel tick rate");
     return 0;
 }
 
@@ -75,7 +75,7 @@ int module_init(void)
         return -1;
     }
 
-    const char *status = "pit: 100Hz\n";
+    const char *status = pit_tickless_available() ? "pit: periodic, tickless idle\n" : "pit: periodic\n";
     vfs_write_file("/Devices/pit0.status", status, local_strlen(status));
 
     return 0;
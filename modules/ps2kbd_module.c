@@ -17,7 +17,7 @@ static struct irq_mailbox kbd_mailbox;
 struct key_fifo_entry
 {
     uint32_t payload;
-    uint32_t timestamp;
+    uint64_t timestamp_ns;
     char ch;
 };
 
@@ -49,13 +49,13 @@ static const char keymap_shift[128] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 };
 
-static void fifo_push(uint32_t payload, char ch, uint32_t timestamp)
+static void fifo_push(uint32_t payload, char ch, uint64_t timestamp_ns)
 {
     uint8_t next = (uint8_t)((fifo_tail + 1) % KEY_FIFO_CAPACITY);
     if (next == fifo_head)
         return;
     key_fifo[fifo_tail].payload = payload;
-    key_fifo[fifo_tail].timestamp = timestamp;
+    key_fifo[fifo_tail].timestamp_ns = timestamp_ns;
     key_fifo[fifo_tail].ch = ch;
     fifo_tail = next;
 }
@@ -84,26 +84,26 @@ static void process_pending_events(void)
         {
             if (release)
             {
-                fifo_push(event.data, 0, event.timestamp);
+                fifo_push(event.data, 0, event.timestamp_ns);
                 continue;
             }
 
             switch (scancode)
             {
                 case 0x48:
-                    fifo_push(event.data, KB_KEY_ARROW_UP, event.timestamp);
+                    fifo_push(event.data, KB_KEY_ARROW_UP, event.timestamp_ns);
                     break;
                 case 0x50:
-                    fifo_push(event.data, KB_KEY_ARROW_DOWN, event.timestamp);
+                    fifo_push(event.data, KB_KEY_ARROW_DOWN, event.timestamp_ns);
                     break;
                 case 0x4B:
-                    fifo_push(event.data, KB_KEY_ARROW_LEFT, event.timestamp);
+                    fifo_push(event.data, KB_KEY_ARROW_LEFT, event.timestamp_ns);
                     break;
                 case 0x4D:
-                    fifo_push(event.data, KB_KEY_ARROW_RIGHT, event.timestamp);
+                    fifo_push(event.data, KB_KEY_ARROW_RIGHT, event.timestamp_ns);
                     break;
                 default:
-                    fifo_push(event.data, 0, event.timestamp);
+                    fifo_push(event.data, 0, event.timestamp_ns);
                     break;
             }
             continue;
@@ -112,25 +112,25 @@ static void process_pending_events(void)
         if (scancode == 0x2A || scancode == 0x36)
         {
             shift_state = release ? 0 : 1;
-            fifo_push(event.data, 0, event.timestamp);
+            fifo_push(event.data, 0, event.timestamp_ns);
             continue;
         }
 
         if (release)
         {
-            fifo_push(event.data, 0, event.timestamp);
+            fifo_push(event.data, 0, event.timestamp_ns);
             continue;
         }
 
         if (scancode == 0x0E)
         {
-            fifo_push(event.data, '\b', event.timestamp);
+            fifo_push(event.data, '\b', event.timestamp_ns);
             continue;
         }
 
         if (scancode == 0x1C)
         {
-            fifo_push(event.data, '\n', event.timestamp);
+            fifo_push(event.data, '\n', event.timestamp_ns);
             continue;
         }
 
@@ -139,7 +139,7 @@ static void process_pending_events(void)
 
         char translated = shift_state ? keymap_shift[scancode] : keymap[scancode];
         if (translated)
-            fifo_push(event.data, translated, event.timestamp);
+            fifo_push(event.data, translated, event.timestamp_ns);
     }
 }
 
@@ -167,7 +167,7 @@ static int32_t sys_kbd_poll(struct syscall_envelope *message)
 
     struct ps2kbd_user_event
     {
-        uint32_t timestamp;
+        uint64_t timestamp_ns;
         uint32_t payload;
         uint8_t ch;
         uint8_t reserved[3];
@@ -191,7 +191,7 @@ static int32_t sys_kbd_poll(struct syscall_envelope *message)
         return 0;
     }
 
-    user_event->timestamp = entry.timestamp;
+    user_event->timestamp_ns = entry.timestamp_ns;
     user_event->payload = entry.payload;
     user_event->ch = (uint8_t)entry.ch;
     user_event->reserved[0] = 0;
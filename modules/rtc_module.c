@@ -3,6 +3,7 @@
 
 #include "module_api.h"
 
+#include "clock.h"
 #include "devmgr.h"
 #include "io.h"
 #include "klog.h"
@@ -21,11 +22,18 @@ static uint8_t bcd_to_bin(uint8_t value)
     return (uint8_t)(((value >> 4) * 10u) + (value & 0x0Fu));
 }
 
-static int snapshot_timestamp(char *buffer, size_t length, size_t *out_len)
+struct rtc_time
 {
-    if (!buffer || length < 20)
-        return -1;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+};
 
+static void read_rtc_time(struct rtc_time *out)
+{
     uint8_t status_b = read_cmos(0x0B);
     int is_bcd = ((status_b & 0x04u) == 0);
 
@@ -50,12 +58,47 @@ static int snapshot_timestamp(char *buffer, size_t length, size_t *out_len)
         year = bcd_to_bin(year);
     }
 
-    uint16_t full_year = 2000u + year;
+    out->year = (uint16_t)(2000u + year);
+    out->month = month;
+    out->day = day;
+    out->hour = hour;
+    out->minute = minute;
+    out->second = second;
+}
+
+/* Days since 1970-01-01 for a proleptic Gregorian date (Hinnant's days_from_civil). */
+static uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t day)
+{
+    if (month <= 2)
+        --year;
+    uint32_t era = year / 400u;
+    uint32_t year_of_era = year - era * 400u;
+    uint32_t shifted_month = (month > 2) ? month - 3u : month + 9u;
+    uint32_t day_of_year = (153u * shifted_month + 2u) / 5u + day - 1u;
+    uint32_t day_of_era = year_of_era * 365u + year_of_era / 4u - year_of_era / 100u + day_of_year;
+    return era * 146097u + day_of_era - 719468u;
+}
+
+static uint64_t rtc_time_to_unix_ns(const struct rtc_time *time)
+{
+    uint32_t days = days_from_civil(time->year, time->month, time->day);
+    uint64_t seconds = (uint64_t)days * 86400u
+        + (uint32_t)time->hour * 3600u + (uint32_t)time->minute * 60u + time->second;
+    return seconds * 1000000000ull;
+}
+
+static int snapshot_timestamp(char *buffer, size_t length, size_t *out_len)
+{
+    if (!buffer || length < 20)
+        return -1;
+
+    struct rtc_time now;
+    read_rtc_time(&now);
 
     char temp[32];
     size_t pos = 0;
 
-    uint16_t fields[] = { full_year, month, day, hour, minute, second };
+    uint16_t fields[] = { now.year, now.month, now.day, now.hour, now.minute, now.second };
     const size_t field_widths[] = { 4, 2, 2, 2, 2, 2 };
     const char separators[] = { '-', '-', ' ', ':', ':' };
 
@@ -134,6 +177,12 @@ int module_init(void)
         return -1;
     }
 
+    /* Whole-second precision: the seed lands anywhere within the current RTC second. */
+    struct rtc_time now;
+    read_rtc_time(&now);
+    if (now.month >= 1 && now.month <= 12 && now.day >= 1 && now.day <= 31)
+        clock_set_realtime(rtc_time_to_unix_ns(&now));
+
     char snapshot[32];
     size_t written = 0;
     if (snapshot_timestamp(snapshot, sizeof(snapshot), &written) == 0)